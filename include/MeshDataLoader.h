@@ -40,4 +40,33 @@ inline bool LoadObj(const char *filename, PhysicsMeshData &meshdata ,const MathL
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+// Loads a headerless 16-bit height map (.raw/.r16) of numRows * numColumns unsigned samples.
+// Samples are recentered around zero to fit the signed 16-bit PhysX heightfield format.
+inline bool LoadRawHeightMap(const char *filename, uint32_t numRows, uint32_t numColumns, PhysicsHeightFieldData &heightField, bool bigEndian = false)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file)
+        return false;
+
+    const size_t numSamples = size_t(numRows) * numColumns;
+    std::vector<uint16_t> rawSamples(numSamples);
+    const size_t numRead = fread(rawSamples.data(), sizeof(uint16_t), numSamples, file);
+    fclose(file);
+    if (numRead != numSamples)
+        return false;
+
+    heightField.m_NumRows = numRows;
+    heightField.m_NumColumns = numColumns;
+    heightField.m_Heights.resize(numSamples);
+    heightField.m_MaterialIndices.clear();
+    for (size_t i = 0; i < numSamples; i++)
+    {
+        uint16_t sample = rawSamples[i];
+        if (bigEndian)
+            sample = uint16_t((sample >> 8) | (sample << 8));
+        heightField.m_Heights[i] = int16_t(int32_t(sample) - 32768);
+    }
+    return true;
+}
@@ -3,13 +3,21 @@
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
+#include <span>
+#include <future>
 
 class IPhysicsEngine;
 class IPhysicsScene;
 class IColliderGeometry;
 class IPhysicsObject;
 class IPhysicsMaterial;
+class IPhysicsObjectPool;
+class IPhysicsPrefab;
 
+// The Create* factories, collider cooking and IPhysicsPrefab::Instantiate may be called from any
+// number of threads at once. Scenes are not: build objects on worker threads, then add them from
+// the simulation thread (AddPhysicsObjects takes a whole batch). Creating and destroying the
+// engine itself must not overlap with any other call.
 class IPhysicsEngine
 {
 public:
@@ -17,6 +25,8 @@ public:
 	virtual PhysicsPtr<IPhysicsMaterial> CreateMaterial(const PhysicsMaterialCreateOptions &options) = 0;
 	virtual PhysicsPtr<IPhysicsScene> CreateScene(const PhysicsSceneCreateOptions &options) = 0;
 	virtual PhysicsPtr<IColliderGeometry> CreateColliderGeometry(const CollisionGeometryCreateOptions &options) = 0;
+	virtual PhysicsPtr<IPhysicsObjectPool> CreateObjectPool(PhysicsPtr<IPhysicsScene> &scene, const PhysicsObjectPoolCreateOptions &options) = 0;
+	virtual PhysicsPtr<IPhysicsPrefab> CreatePrefab(const PhysicsPrefabCreateOptions &options) = 0;
 	virtual void SetSolverIterationCount(uint32_t count) = 0;
 	virtual uint32_t GetSolverIterationCount() const = 0;
 };
@@ -27,10 +37,26 @@ public:
 	virtual void Release() = 0;
 	virtual void Tick(MathLib::HReal deltaTime) = 0;
 	virtual bool AddPhysicsObject(PhysicsPtr<IPhysicsObject> &physicsObject) = 0;
+	// Inserts all objects with a single PxScene::addActors call; returns how many were added.
+	virtual uint32_t AddPhysicsObjects(std::span<PhysicsPtr<IPhysicsObject>> physicsObjects) = 0;
 	virtual void RemovePhysicsObject(PhysicsPtr<IPhysicsObject> &physicsObject) = 0;
+	// World bounds of every object in the scene, refreshed once per Tick from local bounds and poses.
+	// Entry i belongs to GetBoundingBoxObjects()[i]; adding or removing objects invalidates both spans.
+	virtual std::span<const MathLib::HAABBox3D> GetWorldBoundingBoxes() const = 0;
+	virtual std::span<IPhysicsObject *const> GetBoundingBoxObjects() const = 0;
+	// Refreshes the world bounds outside Tick, e.g. after teleporting objects.
+	virtual void UpdateWorldBoundingBoxes() = 0;
+	virtual void SetSolverBudget(const PhysicsSolverBudgetOptions &options) = 0;
+	virtual const PhysicsSolverBudgetOptions &GetSolverBudget() const = 0;
+	// Moving average of simulate plus fetchResults, in milliseconds.
+	virtual MathLib::HReal GetAverageStepMilliseconds() const = 0;
+	// Current iteration scale of the budget controller; 1 when it is disabled.
+	virtual MathLib::HReal GetSolverBudgetScale() const = 0;
 	virtual uint32_t GetPhysicsObjectCount() const = 0;
 	virtual uint32_t GetPhysicsRigidDynamicCount() const = 0;
 	virtual uint32_t GetPhysicsRigidStaticCount() const = 0;
+	// Picks each dynamic body's convex LOD as the number of lodDistances its importance-scaled distance exceeds.
+	virtual void SelectConvexLODs(const MathLib::HVector3 &viewPoint, const std::vector<MathLib::HReal> &lodDistances) = 0;
 	virtual size_t GetOffset() const = 0;
 };
 
@@ -42,22 +68,36 @@ public:
 	virtual void SetScale(const MathLib::HVector3 &scale) = 0;
 	virtual void GetParams(CollisionGeometryCreateOptions &options) = 0;
 	virtual MathLib::HAABBox3D GetBoundingBox()const = 0;
+	// Levels actually cooked for a convex mesh, 0 without a LOD chain. The chain drops requested limits
+	// that would not remove any vertex, so it can be shorter than ConvexMeshGeometryParams::m_LODVertexLimits.
+	virtual uint32_t GetConvexLODCount() const = 0;
+	virtual uint32_t GetConvexLODVertexCount(uint32_t lod) const = 0;
 };
 
+// Pose, velocity, damping and solver setters of bodies in a scene are recorded and reach PhysX at
+// the scene's next Tick; until then getters return the new values but queries and contacts do not
+// see them. Outside a scene the writes are applied immediately.
 class IPhysicsObject
 {
 public:
 	virtual void Release() = 0;
 	virtual void Update() = 0;
 	virtual bool AddColliderGeometry(PhysicsPtr<IColliderGeometry> &colliderGeometry, const MathLib::HTransform3 &localTrans) = 0;
-	virtual void GetColliderGeometries(std::vector<PhysicsPtr<IColliderGeometry>> &geomeries, std::vector<MathLib::HTransform3> *geoLocalPos) = 0;
+	virtual const std::vector<PhysicsPtr<IColliderGeometry>> &GetColliderGeometries() const = 0;
+	virtual const std::vector<MathLib::HTransform3> &GetColliderLocalTransforms() const = 0;
 	virtual PhysicsObjectType GetType() const = 0;
 	virtual size_t GetOffset() const = 0;
+	virtual void SetPose(const PhysicsPose &pose) = 0;
+	virtual const PhysicsPose &GetPose() const = 0;
 	virtual void SetTransform(const MathLib::HTransform3 &trans) = 0;
+	// Built from the pose on the first call after it changes; prefer GetPose on hot paths.
 	virtual const MathLib::HTransform3 &GetTransform() const = 0;
 	virtual bool IsValid() const = 0;
 	virtual MathLib::HAABBox3D GetLocalBoundingBox() const = 0;
 	virtual MathLib::HAABBox3D GetWorldBoundingBox() const = 0;
+	// Disabled objects stay in their scene but are skipped by the simulation.
+	virtual void SetSimulationEnabled(bool bEnabled) = 0;
+	virtual bool IsSimulationEnabled() const = 0;
 };
 
 class IDynamicObject
@@ -73,6 +113,15 @@ public:
 	virtual MathLib::HReal GetAngularDamping() const = 0;
 	virtual MathLib::HVector3 GetAngularVelocity() const = 0;
 	virtual bool IsSleeping() const = 0;
+	// Level of the cooked hull LOD chain used by convex colliders that have one; 0 is the finest.
+	virtual void SetConvexLOD(uint32_t lod) = 0;
+	virtual uint32_t GetConvexLOD() const = 0;
+	// Distance-based LOD selection divides the distance by this, so important bodies keep finer hulls.
+	// The scene's solver budget also reads it, see PhysicsSolverBudgetOptions. Values <= 0 are ignored.
+	virtual void SetLODImportance(const MathLib::HReal &importance) = 0;
+	virtual MathLib::HReal GetLODImportance() const = 0;
+	virtual void SetSolverOverrides(const PhysicsSolverOverrides &overrides) = 0;
+	virtual const PhysicsSolverOverrides &GetSolverOverrides() const = 0;
 };
 
 class IPhysicsMaterial
@@ -90,6 +139,49 @@ public:
 	virtual size_t GetOffset() const = 0;
 };
 
+// Objects of one prefab kept in a scene with simulation disabled while idle, so taking and
+// returning them skips actor creation, shape attachment and scene insertion.
+class IPhysicsObjectPool
+{
+public:
+	virtual void Release() = 0;
+	virtual PhysicsPtr<IPhysicsObject> TakeObject(const MathLib::HTransform3 &transform) = 0;
+	virtual void ReturnObject(PhysicsPtr<IPhysicsObject> &object) = 0;
+	virtual uint32_t GetIdleCount() const = 0;
+};
+
+// Shapes, mass properties and bounds built once and shared by every instance. Dynamic prefabs
+// cannot hold triangle meshes or heightfields, CreatePrefab returns null for them.
+class IPhysicsPrefab
+{
+public:
+	virtual void Release() = 0;
+	// One object per transform; linearVelocities is either empty or as long as transforms.
+	virtual std::vector<PhysicsPtr<IPhysicsObject>> Instantiate(std::span<const MathLib::HTransform3> transforms, std::span<const MathLib::HVector3> linearVelocities) = 0;
+	virtual MathLib::HAABBox3D GetLocalBoundingBox() const = 0;
+};
+
+// Handle of a convex decomposition running in the background. Releasing it cancels the work if it
+// is still running; futures obtained from GetResult stay valid.
+class IConvexDecomposeTask
+{
+public:
+	virtual void Release() = 0;
+	// Overall progress in [0, 1], reaches 1 once the hulls are available.
+	virtual MathLib::HReal GetProgress() const = 0;
+	virtual void Cancel() = 0;
+	virtual bool IsCancelled() const = 0;
+	virtual bool IsReady() const = 0;
+	// The hulls, or none when the decomposition failed or was cancelled.
+	virtual std::shared_future<std::vector<PhysicsMeshDataPtr>> GetResult() const = 0;
+	// Once the result is ready: whether ConvexDecomposeOptions::m_TimeBudgetMs cut the decomposition short.
+	virtual bool HasTimedOut() const = 0;
+	// With ConvexDecomposeOptions::m_bPublishIntermediateHulls, the hulls of the parts after the latest
+	// subdivision level, not merged down to the requested count. Returns the revision of that set, which
+	// grows with every level, or 0 while none was published.
+	virtual uint32_t GetIntermediateResult(std::vector<PhysicsMeshDataPtr> &hulls) const = 0;
+};
+
 class PhysicsEngineUtils
 {
 public:
@@ -100,6 +192,26 @@ public:
 	static PhysicsPtr<IPhysicsMaterial> CreateMaterial(const PhysicsMaterialCreateOptions &options);
 	static PhysicsPtr<IPhysicsScene> CreateScene(const PhysicsSceneCreateOptions &options);
 	static PhysicsPtr<IColliderGeometry> CreateColliderGeometry(const CollisionGeometryCreateOptions &options);
+	static PhysicsPtr<IPhysicsObjectPool> CreateObjectPool(PhysicsPtr<IPhysicsScene> &scene, const PhysicsObjectPoolCreateOptions &options);
+	static PhysicsPtr<IPhysicsPrefab> CreatePrefab(const PhysicsPrefabCreateOptions &options);
 	static void BuildConvexMesh(const std::vector<MathLib::HVector3> &vertices, const std::vector<uint32_t> &indices, PhysicsMeshData &meshdata);
+	static void BuildHeightFieldMesh(const HeightFieldGeometryParams &params, PhysicsMeshData &meshdata);
+	static bool FitPrimitives(const PhysicsMeshData &meshData, const MathLib::HVector3 &scale, PrimitiveFitReport &report);
 	static bool ConvexDecomposition(const PhysicsMeshData &meshData, const ConvexDecomposeOptions &params, std::vector<PhysicsMeshData> &convexMeshesData);
+	// Returns right away; null when the engine was created without a convex decomposer.
+	static PhysicsPtr<IConvexDecomposeTask> DecomposeAsync(const PhysicsMeshData &meshData, const ConvexDecomposeOptions &params);
+	// Decomposes every request on the decomposer's worker pool and returns how many produced hulls.
+	static uint32_t ConvexDecompositionBatch(std::span<const ConvexDecomposeRequest> requests, std::vector<std::vector<PhysicsMeshDataPtr>> &convexMeshesData);
+	// Merges existing convex hulls down to params.m_MaximumNumberOfHulls, cheapest pair first as the decomposition does.
+	static bool MergeConvexHulls(const std::vector<PhysicsMeshData> &convexMeshesData, const ConvexDecomposeOptions &params, std::vector<PhysicsMeshData> &mergedMeshesData);
+	// Overrides PhysicsEngineOptions::m_ConvexDecomposeCacheDirectory; empty disables the cache.
+	static void SetConvexDecomposeCacheDirectory(const std::string &directory);
+	static std::string GetConvexDecomposeCacheDirectory();
+	// Batch pose expansion for bulk readback, vectorized where SSE is available.
+	static void ToTransforms(std::span<const PhysicsPose> poses, std::span<MathLib::HTransform3> transforms);
+	// For benchmarks: turns the AVX kernels off so they can be compared against the SSE and scalar paths.
+	static void SetWideSimdEnabled(bool bEnable);
+	// For checks: casts random rays at the mesh through the hierarchy the decomposition projects hull vertices
+	// with, and again testing every triangle; returns how many of them got a different hit.
+	static uint32_t CountRaycastMismatches(const PhysicsMeshData &meshData, uint32_t numRays, uint32_t seed = 0);
 };
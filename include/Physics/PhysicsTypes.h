@@ -1,9 +1,16 @@
 #pragma once
 #include <Math/MathUtils.h>
 #include <Math/GraphicUtils/MeshData.h>
+#include <variant>
+#include <optional>
+#include <limits>
+#include <string>
 #define DEFAULT_CPU_DISPATCHER_NUM_THREADS 2
 #define DEFAULT_SOLVER_ITERATION_COUNT 6
 
+class IPhysicsMaterial;
+class IColliderGeometry;
+
 template <typename T>
 struct PhysicsDeleter
 {
@@ -48,11 +55,59 @@ PhysXPtr<T> make_physx_ptr(T *ptr)
 	return PhysXPtr<T>(ptr);
 }
 
+// Rigid pose as a unit quaternion (x, y, z, w) followed by a position. The layout matches
+// physx::PxTransform, so poses read back from PhysX are plain copies; the affine HTransform3
+// is only built when asked for.
+struct PhysicsPose
+{
+	MathLib::HReal m_Rotation[4] = {0, 0, 0, 1};
+	MathLib::HReal m_Position[3] = {0, 0, 0};
+
+	PhysicsPose() = default;
+	PhysicsPose(const MathLib::HQuaternion &rotation, const MathLib::HVector3 &position)
+		: m_Rotation{rotation.x(), rotation.y(), rotation.z(), rotation.w()}, m_Position{position[0], position[1], position[2]}
+	{
+	}
+	explicit PhysicsPose(const MathLib::HTransform3 &transform)
+		: PhysicsPose(MathLib::HQuaternion(MathLib::HMatrix3(transform.rotation())), transform.translation())
+	{
+	}
+
+	MathLib::HQuaternion GetRotation() const { return MathLib::HQuaternion(m_Rotation[3], m_Rotation[0], m_Rotation[1], m_Rotation[2]); }
+	MathLib::HVector3 GetPosition() const { return MathLib::HVector3(m_Position[0], m_Position[1], m_Position[2]); }
+	MathLib::HTransform3 ToTransform() const
+	{
+		MathLib::HTransform3 transform = MathLib::HTransform3::Identity();
+		transform.linear() = GetRotation().toRotationMatrix();
+		transform.translation() = GetPosition();
+		return transform;
+	}
+};
+
+struct ConvexDecomposeOptions
+{
+	uint32_t m_MaximumNumberOfHulls = 8;			// Maximum number of convex hull generated
+	uint32_t m_MaximumNumberOfVerticesPerHull = 64; // (default=64, range=4-1024)
+	uint32_t m_VoxelGridResolution = 1000000;		//(default=1,000,000, range=10,000-16,000,000).
+	MathLib::HReal m_Concavity = 0.0025f;			// Value between 0 and 1
+	uint32_t m_MaximumNumberOfThreads = 0;			// Thread budget of the clipping-plane search and hull merging, 0 picks one by resolution (merging: the whole pool)
+	bool m_bProjectHullVertices = true;				// Snap hull vertices back onto the source mesh surface
+	uint32_t m_TimeBudgetMs = 0;					// Wall-clock budget counted from when a pool thread starts the run, time spent queued is excluded; 0 for none, past it the parts refined so far are merged and returned
+	bool m_bPublishIntermediateHulls = false;		// Publish coarse hulls after every subdivision level, see IConvexDecomposeTask::GetIntermediateResult
+};
+
 struct PhysicsEngineOptions
 {
 	uint32_t m_NumThreads = DEFAULT_CPU_DISPATCHER_NUM_THREADS;
 	bool m_bEnablePVD = true;
 	uint32_t m_SolverIterationCount = DEFAULT_SOLVER_ITERATION_COUNT;
+	// When set, triangle meshes attached to dynamic bodies are replaced by their convex decomposition,
+	// computed asynchronously; the mesh's convex hull stands in until the decomposition is ready.
+	bool m_bDecomposeDynamicTriangleMeshes = false;
+	ConvexDecomposeOptions m_TriangleMeshDecomposeOptions;
+	// Directory of the on-disk decomposition cache; results are keyed by mesh content and options,
+	// so known assets skip V-HACD on later runs. Empty disables the cache.
+	std::string m_ConvexDecomposeCacheDirectory;
 };
 
 enum class PhysicsSceneFilterShaderType
@@ -82,42 +137,154 @@ enum class CollierGeometryType
 	COLLIER_GEOMETRY_TYPE_PLANE,
 	COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH,
 	COLLIER_GEOMETRY_TYPE_CONVEX_MESH,
+	COLLIER_GEOMETRY_TYPE_HEIGHTFIELD,
 	COLLIER_GEOMETRY_TYPE_COUNT
 };
 
-struct CollisionGeometryCreateOptions
+typedef MathLib::GraphicUtils::MeshData32 PhysicsMeshData;
+// Mesh buffers are immutable once created and shared by reference between geometry
+// descriptions, collider geometries and render objects instead of being copied.
+typedef std::shared_ptr<const PhysicsMeshData> PhysicsMeshDataPtr;
+
+inline PhysicsMeshDataPtr MakePhysicsMeshData(std::vector<MathLib::HVector3> vertices, std::vector<uint32_t> indices)
 {
-	CollierGeometryType m_GeometryType;
-	MathLib::HTransform3 m_LocalTransform;
-	struct SphereParams
-	{
-		MathLib::HReal m_Radius = 1;
-	} m_SphereParams;
-	struct BoxParams
-	{
-		MathLib::HVector3 m_HalfExtents = {1, 1, 1};
-	} m_BoxParams;
-	struct CapsuleParams
-	{
-		MathLib::HReal m_Radius = 1;
-		MathLib::HReal m_HalfHeight = 1;
-	} m_CapsuleParams;
-	struct PlaneParams
-	{
-		MathLib::HVector3 m_Normal = {0, 1, 0};
-		MathLib::HReal m_Distance = 0;
-	} m_PlaneParams;
-	struct TriangleMeshParams
-	{
-		std::vector<MathLib::HVector3> m_Vertices;
-		std::vector<uint32_t> m_Indices;
-	} m_TriangleMeshParams;
-	struct ConvexMeshParams
+	std::shared_ptr<PhysicsMeshData> meshData = std::make_shared<PhysicsMeshData>();
+	meshData->m_Vertices = std::move(vertices);
+	meshData->m_Indices = std::move(indices);
+	return meshData;
+}
+
+inline PhysicsMeshDataPtr MakePhysicsMeshData(PhysicsMeshData &&meshData)
+{
+	return std::make_shared<const PhysicsMeshData>(std::move(meshData));
+}
+
+struct ConvexDecomposeRequest
+{
+	PhysicsMeshDataPtr m_MeshData;
+	ConvexDecomposeOptions m_Options;
+};
+
+// Height samples laid out row-major (m_NumRows * m_NumColumns). Rows run along local X,
+// columns along local Z and heights along Y.
+struct PhysicsHeightFieldData
+{
+	static constexpr uint8_t HoleMaterialIndex = 0x7f;
+
+	uint32_t m_NumRows = 0;
+	uint32_t m_NumColumns = 0;
+	std::vector<int16_t> m_Heights;
+	// Optional, one entry per sample: index into HeightFieldGeometryParams::m_Materials,
+	// or HoleMaterialIndex to cut a hole into the two triangles of the cell starting at this sample.
+	// Geometries with indices past m_Materials (past 0 without materials) are rejected.
+	std::vector<uint8_t> m_MaterialIndices;
+};
+typedef std::shared_ptr<const PhysicsHeightFieldData> PhysicsHeightFieldDataPtr;
+
+struct SphereGeometryParams
+{
+	static constexpr CollierGeometryType Type = CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE;
+	MathLib::HReal m_Radius = 1;
+};
+
+struct BoxGeometryParams
+{
+	static constexpr CollierGeometryType Type = CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX;
+	MathLib::HVector3 m_HalfExtents = {1, 1, 1};
+};
+
+struct CapsuleGeometryParams
+{
+	static constexpr CollierGeometryType Type = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE;
+	MathLib::HReal m_Radius = 1;
+	MathLib::HReal m_HalfHeight = 1;
+};
+
+struct PlaneGeometryParams
+{
+	static constexpr CollierGeometryType Type = CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE;
+	MathLib::HVector3 m_Normal = {0, 1, 0};
+	MathLib::HReal m_Distance = 0;
+};
+
+struct TriangleMeshGeometryParams
+{
+	static constexpr CollierGeometryType Type = CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH;
+	PhysicsMeshDataPtr m_MeshData;
+};
+
+struct ConvexMeshGeometryParams
+{
+	static constexpr CollierGeometryType Type = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH;
+	PhysicsMeshDataPtr m_MeshData;
+	// Vertex limits of the cooked hull LOD chain, e.g. {255, 64, 32, 16}. Empty cooks a single 255 vertex hull.
+	std::vector<uint32_t> m_LODVertexLimits;
+};
+
+struct HeightFieldGeometryParams
+{
+	static constexpr CollierGeometryType Type = CollierGeometryType::COLLIER_GEOMETRY_TYPE_HEIGHTFIELD;
+	PhysicsHeightFieldDataPtr m_HeightFieldData;
+	MathLib::HReal m_HeightScale = 1;
+	MathLib::HReal m_RowScale = 1;
+	MathLib::HReal m_ColumnScale = 1;
+	// Materials selected by the per-sample material indices. When empty every sample uses the object's material.
+	std::vector<PhysicsPtr<IPhysicsMaterial>> m_Materials;
+};
+
+// Alternatives are listed in CollierGeometryType order, so index() is the geometry type.
+typedef std::variant<SphereGeometryParams,
+					 BoxGeometryParams,
+					 CapsuleGeometryParams,
+					 PlaneGeometryParams,
+					 TriangleMeshGeometryParams,
+					 ConvexMeshGeometryParams,
+					 HeightFieldGeometryParams>
+	CollisionGeometryParams;
+static_assert(std::variant_size_v<CollisionGeometryParams> == size_t(CollierGeometryType::COLLIER_GEOMETRY_TYPE_COUNT));
+
+// Bounding primitive fitted to a mesh, placed by m_LocalTransform in the mesh's frame.
+struct PrimitiveFit
+{
+	CollisionGeometryParams m_Params;
+	MathLib::HTransform3 m_LocalTransform = MathLib::HTransform3::Identity();
+	MathLib::HReal m_Volume = 0;
+	// Excess volume relative to the mesh: (m_Volume - mesh volume) / mesh volume.
+	MathLib::HReal m_VolumeError = std::numeric_limits<MathLib::HReal>::max();
+};
+
+struct PrimitiveFitReport
+{
+	MathLib::HReal m_MeshVolume = 0;
+	PrimitiveFit m_Sphere;
+	PrimitiveFit m_Capsule;
+	PrimitiveFit m_Box;
+
+	// Cheapest primitive for contact generation (sphere, capsule, box) within the tolerance, nullptr if none fits.
+	const PrimitiveFit *SelectCheapest(MathLib::HReal tolerance) const
 	{
-		std::vector<MathLib::HVector3> m_Vertices;
-		std::vector<uint32_t> m_Indices;
-	} m_ConvexMeshParams;
+		for (const PrimitiveFit *fit : {&m_Sphere, &m_Capsule, &m_Box})
+		{
+			if (fit->m_VolumeError <= tolerance)
+				return fit;
+		}
+		return nullptr;
+	}
+};
+
+struct CollisionGeometryCreateOptions
+{
+	CollisionGeometryParams m_Params;
 	MathLib::HVector3 m_Scale = {1, 1, 1};
+	// Pose of the geometry in the frame it is attached with; fitted primitive proxies are usually offset and rotated.
+	MathLib::HTransform3 m_LocalTransform = MathLib::HTransform3::Identity();
+	// Replace mesh geometry by the cheapest bounding primitive whose volume error is within m_PrimitiveFitTolerance.
+	bool m_bFitPrimitive = false;
+	MathLib::HReal m_PrimitiveFitTolerance = 0.25f;
+
+	CollierGeometryType GetType() const { return static_cast<CollierGeometryType>(m_Params.index()); }
+	template <typename Params>
+	const Params *GetParams() const { return std::get_if<Params>(&m_Params); }
 };
 
 enum class PhysicsObjectType
@@ -127,6 +294,28 @@ enum class PhysicsObjectType
 	PHYSICS_OBJECT_TYPE_COUNT
 };
 
+// Per-body solver settings; unset fields follow the engine default and the scene's solver budget.
+struct PhysicsSolverOverrides
+{
+	std::optional<uint32_t> m_PositionIterations;
+	std::optional<uint32_t> m_VelocityIterations;
+	std::optional<MathLib::HReal> m_SleepThreshold;
+	std::optional<MathLib::HReal> m_StabilizationThreshold;
+};
+
+// Adaptive solver budget of a scene. While the averaged step time is over the target, bodies with an
+// LOD importance below 1 lose position iterations; while there is headroom, bodies above 1 (stacks,
+// gameplay-critical props) gain them. Bodies with an explicit iteration override are left alone.
+struct PhysicsSolverBudgetOptions
+{
+	bool m_bEnabled = false;
+	MathLib::HReal m_TargetStepMilliseconds = 8.0f;
+	MathLib::HReal m_MinScale = 0.25f;
+	MathLib::HReal m_MaxScale = 2.0f;
+	// Weight of the newest step in the moving average of step times.
+	MathLib::HReal m_Smoothing = 0.1f;
+};
+
 struct PhysicsObjectCreateOptions
 {
 	PhysicsObjectType m_ObjectType;
@@ -134,12 +323,20 @@ struct PhysicsObjectCreateOptions
 	PhysicsMaterialCreateOptions m_MaterialOptions;
 };
 
-typedef MathLib::GraphicUtils::MeshData32 PhysicsMeshData;
+// Template for objects sharing their colliders and material. m_ObjectOptions.m_Transform is ignored,
+// instances are placed by the transforms they are instantiated with.
+struct PhysicsPrefabCreateOptions
+{
+	PhysicsObjectCreateOptions m_ObjectOptions;
+	std::vector<PhysicsPtr<IColliderGeometry>> m_ColliderGeometries;
+	std::vector<MathLib::HTransform3> m_ColliderLocalTransforms;
+};
 
-struct ConvexDecomposeOptions
+struct PhysicsObjectPoolCreateOptions
 {
-	uint32_t m_MaximumNumberOfHulls = 8;			// Maximum number of convex hull generated
-	uint32_t m_MaximumNumberOfVerticesPerHull = 64; // (default=64, range=4-1024)
-	uint32_t m_VoxelGridResolution = 1000000;		//(default=1,000,000, range=10,000-16,000,000).
-	MathLib::HReal m_Concavity = 0.0025f;			// Value between 0 and 1
-};
\ No newline at end of file
+	PhysicsPrefabCreateOptions m_Prefab;
+	// Objects created and inserted into the scene up front.
+	uint32_t m_PrewarmCount = 32;
+	// Returned objects beyond this many idle ones are removed from the scene and released.
+	uint32_t m_MaxIdleCount = 500;
+};
@@ -0,0 +1,739 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <unordered_set>
+
+// Ad-hoc benchmarks run from the testing application; results are printed to stdout.
+namespace TestBenchmark
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	static double ElapsedMilliseconds(const Clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	static PhysicsPtr<IPhysicsScene> CreateBenchmarkScene()
+	{
+		PhysicsSceneCreateOptions sceneOptions;
+		sceneOptions.m_FilterShaderType = PhysicsSceneFilterShaderType::eDEFAULT;
+		sceneOptions.m_Gravity = MathLib::HVector3(0.0f, -9.81f, 0.0f);
+		return PhysicsEngineUtils::CreateScene(sceneOptions);
+	}
+
+	// Drops a grid of spheres onto a static terrain object and times the simulation steps.
+	static double TimeSpheresOnTerrain(PhysicsPtr<IColliderGeometry>& terrain, MathLib::HReal extent, uint32_t numBodiesPerSide, uint32_t numSteps)
+	{
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+
+		PhysicsObjectCreateOptions terrainOptions;
+		terrainOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC;
+		terrainOptions.m_Transform = MathLib::HTransform3::Identity();
+		PhysicsPtr<IPhysicsObject> terrainObject = PhysicsEngineUtils::CreateObject(terrainOptions);
+		terrainObject->AddColliderGeometry(terrain, MathLib::HTransform3::Identity());
+		scene->AddPhysicsObject(terrainObject);
+
+		CollisionGeometryCreateOptions sphereOptions;
+		sphereOptions.m_Params = SphereGeometryParams{0.5f};
+		PhysicsPtr<IColliderGeometry> sphere = PhysicsEngineUtils::CreateColliderGeometry(sphereOptions);
+		const MathLib::HReal spacing = extent / MathLib::HReal(numBodiesPerSide + 1);
+		for (uint32_t i = 0; i < numBodiesPerSide; i++)
+		{
+			for (uint32_t j = 0; j < numBodiesPerSide; j++)
+			{
+				PhysicsObjectCreateOptions objectOptions;
+				objectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+				objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(spacing * (i + 1), 20.0f, spacing * (j + 1))));
+				PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+				object->AddColliderGeometry(sphere, MathLib::HTransform3::Identity());
+				scene->AddPhysicsObject(object);
+			}
+		}
+
+		const Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < numSteps; i++)
+			scene->Tick(1.f / 60.f);
+		return ElapsedMilliseconds(start) / numSteps;
+	}
+
+	// Compares a heightfield terrain with the equivalent triangle mesh: input data size and step time with resting contacts.
+	static void BenchmarkHeightFieldTerrain(uint32_t resolution = 256, uint32_t numBodiesPerSide = 32, uint32_t numSteps = 300)
+	{
+		std::shared_ptr<PhysicsHeightFieldData> heightFieldData = std::make_shared<PhysicsHeightFieldData>();
+		heightFieldData->m_NumRows = resolution;
+		heightFieldData->m_NumColumns = resolution;
+		heightFieldData->m_Heights.resize(size_t(resolution) * resolution);
+		for (uint32_t row = 0; row < resolution; row++)
+			for (uint32_t column = 0; column < resolution; column++)
+				heightFieldData->m_Heights[row * resolution + column] = int16_t(std::sin(row * 0.05f) * std::cos(column * 0.05f) * 1000.0f);
+
+		HeightFieldGeometryParams heightFieldParams;
+		heightFieldParams.m_HeightFieldData = heightFieldData;
+		heightFieldParams.m_HeightScale = 0.005f;
+		CollisionGeometryCreateOptions heightFieldOptions;
+		heightFieldOptions.m_Params = heightFieldParams;
+		PhysicsPtr<IColliderGeometry> heightField = PhysicsEngineUtils::CreateColliderGeometry(heightFieldOptions);
+
+		PhysicsMeshData meshData;
+		PhysicsEngineUtils::BuildHeightFieldMesh(heightFieldParams, meshData);
+		const size_t meshBytes = meshData.m_Vertices.size() * sizeof(MathLib::HVector3) + meshData.m_Indices.size() * sizeof(uint32_t);
+		CollisionGeometryCreateOptions meshOptions;
+		meshOptions.m_Params = TriangleMeshGeometryParams{MakePhysicsMeshData(std::move(meshData))};
+		PhysicsPtr<IColliderGeometry> triangleMesh = PhysicsEngineUtils::CreateColliderGeometry(meshOptions);
+
+		const size_t heightFieldBytes = heightFieldData->m_Heights.size() * 4; // PxHeightFieldSample
+		const MathLib::HReal extent = MathLib::HReal(resolution - 1);
+		const double heightFieldStep = TimeSpheresOnTerrain(heightField, extent, numBodiesPerSide, numSteps);
+		const double triangleMeshStep = TimeSpheresOnTerrain(triangleMesh, extent, numBodiesPerSide, numSteps);
+
+		printf("HeightField %ux%u: %zu bytes, %.3f ms/step\n", resolution, resolution, heightFieldBytes, heightFieldStep);
+		printf("TriangleMesh %ux%u: %zu bytes, %.3f ms/step\n", resolution, resolution, meshBytes, triangleMeshStep);
+	}
+
+	// Settles a pile of dynamic bodies sharing one geometry on a ground plane and times the simulation steps.
+	static double TimeBodyPile(PhysicsPtr<IColliderGeometry>& geometry, MathLib::HReal spacing, uint32_t numBodiesPerSide, uint32_t numLayers, uint32_t numSteps, uint32_t convexLOD = 0)
+	{
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+
+		PhysicsObjectCreateOptions groundOptions;
+		groundOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC;
+		groundOptions.m_Transform = MathLib::HTransform3::Identity();
+		PhysicsPtr<IPhysicsObject> ground = PhysicsEngineUtils::CreateObject(groundOptions);
+		CollisionGeometryCreateOptions planeOptions;
+		planeOptions.m_Params = PlaneGeometryParams{MathLib::HVector3(0, 1, 0), 0};
+		PhysicsPtr<IColliderGeometry> plane = PhysicsEngineUtils::CreateColliderGeometry(planeOptions);
+		ground->AddColliderGeometry(plane, MathLib::HTransform3::Identity());
+		scene->AddPhysicsObject(ground);
+
+		for (uint32_t layer = 0; layer < numLayers; layer++)
+		{
+			for (uint32_t i = 0; i < numBodiesPerSide; i++)
+			{
+				for (uint32_t j = 0; j < numBodiesPerSide; j++)
+				{
+					PhysicsObjectCreateOptions objectOptions;
+					objectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+					objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(spacing * i, spacing * (layer + 1), spacing * j)));
+					PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+					object->AddColliderGeometry(geometry, MathLib::HTransform3::Identity());
+					dynamic_cast<IDynamicObject*>(object.get())->SetConvexLOD(convexLOD);
+					scene->AddPhysicsObject(object);
+				}
+			}
+		}
+
+		const Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < numSteps; i++)
+			scene->Tick(1.f / 60.f);
+		return ElapsedMilliseconds(start) / numSteps;
+	}
+
+	// Compares contact generation cost of a convex mesh against its fitted sphere, capsule and box proxies.
+	static void BenchmarkPrimitiveProxies(const PhysicsMeshDataPtr& convexMeshData, uint32_t numBodiesPerSide = 16, uint32_t numLayers = 4, uint32_t numSteps = 300)
+	{
+		PrimitiveFitReport report;
+		if (convexMeshData == nullptr || !PhysicsEngineUtils::FitPrimitives(*convexMeshData, MathLib::HVector3(1, 1, 1), report))
+			return;
+
+		CollisionGeometryCreateOptions convexOptions;
+		convexOptions.m_Params = ConvexMeshGeometryParams{convexMeshData};
+		PhysicsPtr<IColliderGeometry> convex = PhysicsEngineUtils::CreateColliderGeometry(convexOptions);
+		const MathLib::HReal spacing = convex->GetBoundingBox().sizes().maxCoeff() * 1.5f;
+		printf("Convex: volume %.4f, %.3f ms/step\n", report.m_MeshVolume, TimeBodyPile(convex, spacing, numBodiesPerSide, numLayers, numSteps));
+
+		const std::pair<const char*, const PrimitiveFit*> fits[] = {{"Sphere", &report.m_Sphere}, {"Capsule", &report.m_Capsule}, {"Box", &report.m_Box}};
+		for (const auto& fit : fits)
+		{
+			CollisionGeometryCreateOptions proxyOptions;
+			proxyOptions.m_Params = fit.second->m_Params;
+			proxyOptions.m_LocalTransform = fit.second->m_LocalTransform;
+			PhysicsPtr<IColliderGeometry> proxy = PhysicsEngineUtils::CreateColliderGeometry(proxyOptions);
+			printf("%s: volume error %.1f%%, %.3f ms/step\n", fit.first, fit.second->m_VolumeError * 100, TimeBodyPile(proxy, spacing, numBodiesPerSide, numLayers, numSteps));
+		}
+	}
+
+	// Times the same convex pile at every level of a cooked hull LOD chain and reports the saving over the finest level.
+	static void BenchmarkConvexLODs(const PhysicsMeshDataPtr& meshData, uint32_t numBodiesPerSide = 16, uint32_t numLayers = 4, uint32_t numSteps = 300)
+	{
+		if (meshData == nullptr)
+			return;
+		CollisionGeometryCreateOptions convexOptions;
+		convexOptions.m_Params = ConvexMeshGeometryParams{meshData, {255, 64, 32, 16}};
+		PhysicsPtr<IColliderGeometry> convex = PhysicsEngineUtils::CreateColliderGeometry(convexOptions);
+		const MathLib::HReal spacing = convex->GetBoundingBox().sizes().maxCoeff() * 1.5f;
+
+		// The cooked chain may hold fewer levels than requested, so the rows follow the chain.
+		double finestStep = 0;
+		for (uint32_t lod = 0; lod < convex->GetConvexLODCount(); lod++)
+		{
+			const double step = TimeBodyPile(convex, spacing, numBodiesPerSide, numLayers, numSteps, lod);
+			if (lod == 0)
+				finestStep = step;
+			printf("Convex LOD %u (%u vertices): %.3f ms/step, %.1f%% saved\n", lod, convex->GetConvexLODVertexCount(lod), step, (1.0 - step / finestStep) * 100.0);
+		}
+	}
+
+	// Spawns and despawns projectiles in waves, once through CreateObject/AddPhysicsObject and once through an object pool.
+	static void BenchmarkObjectPool(uint32_t numWaves = 100, uint32_t numObjectsPerWave = 64)
+	{
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+		CollisionGeometryCreateOptions sphereOptions;
+		sphereOptions.m_Params = SphereGeometryParams{0.5f};
+		PhysicsPtr<IColliderGeometry> sphere = PhysicsEngineUtils::CreateColliderGeometry(sphereOptions);
+
+		PhysicsObjectPoolCreateOptions poolOptions;
+		poolOptions.m_Prefab.m_ObjectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+		poolOptions.m_Prefab.m_ObjectOptions.m_Transform = MathLib::HTransform3::Identity();
+		poolOptions.m_Prefab.m_ColliderGeometries.push_back(sphere);
+		poolOptions.m_Prefab.m_ColliderLocalTransforms.push_back(MathLib::HTransform3::Identity());
+		poolOptions.m_PrewarmCount = numObjectsPerWave;
+		std::vector<PhysicsPtr<IPhysicsObject>> objects(numObjectsPerWave);
+		auto spawnTransform = [](uint32_t i)
+		{ return MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(MathLib::HReal(i) * 2.0f, 10.0f, 0.0f))); };
+
+		Clock::time_point start = Clock::now();
+		for (uint32_t wave = 0; wave < numWaves; wave++)
+		{
+			for (uint32_t i = 0; i < numObjectsPerWave; i++)
+			{
+				PhysicsObjectCreateOptions objectOptions = poolOptions.m_Prefab.m_ObjectOptions;
+				objectOptions.m_Transform = spawnTransform(i);
+				objects[i] = PhysicsEngineUtils::CreateObject(objectOptions);
+				objects[i]->AddColliderGeometry(sphere, MathLib::HTransform3::Identity());
+				scene->AddPhysicsObject(objects[i]);
+			}
+			scene->Tick(1.f / 60.f);
+			for (auto& object : objects)
+			{
+				scene->RemovePhysicsObject(object);
+				object->Release();
+			}
+		}
+		const double createStep = ElapsedMilliseconds(start) / numWaves;
+
+		PhysicsPtr<IPhysicsObjectPool> pool = PhysicsEngineUtils::CreateObjectPool(scene, poolOptions);
+		start = Clock::now();
+		for (uint32_t wave = 0; wave < numWaves; wave++)
+		{
+			for (uint32_t i = 0; i < numObjectsPerWave; i++)
+				objects[i] = pool->TakeObject(spawnTransform(i));
+			scene->Tick(1.f / 60.f);
+			for (auto& object : objects)
+				pool->ReturnObject(object);
+		}
+		const double poolStep = ElapsedMilliseconds(start) / numWaves;
+		pool->Release();
+
+		printf("Create/Add: %.3f ms/wave of %u objects\n", createStep, numObjectsPerWave);
+		printf("Pool take/return: %.3f ms/wave of %u objects\n", poolStep, numObjectsPerWave);
+	}
+
+	// Spawns a wave of multi-shape debris, once object by object and once through a prefab with batched scene insertion.
+	static void BenchmarkPrefabWave(const std::vector<PhysicsMeshDataPtr>& debrisMeshData, uint32_t numObjects = 5000)
+	{
+		if (debrisMeshData.empty())
+			return;
+		PhysicsPrefabCreateOptions prefabOptions;
+		prefabOptions.m_ObjectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+		for (const auto& meshData : debrisMeshData)
+		{
+			CollisionGeometryCreateOptions options;
+			options.m_Params = ConvexMeshGeometryParams{meshData};
+			prefabOptions.m_ColliderGeometries.push_back(PhysicsEngineUtils::CreateColliderGeometry(options));
+			prefabOptions.m_ColliderLocalTransforms.push_back(MathLib::HTransform3::Identity());
+		}
+
+		const uint32_t numPerSide = uint32_t(std::ceil(std::cbrt(double(numObjects))));
+		std::vector<MathLib::HTransform3> transforms(numObjects);
+		std::vector<MathLib::HVector3> velocities(numObjects, MathLib::HVector3(0, 5.0f, 0));
+		for (uint32_t i = 0; i < numObjects; i++)
+			transforms[i] = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(MathLib::HReal(i % numPerSide), MathLib::HReal(i / numPerSide % numPerSide), MathLib::HReal(i / (numPerSide * numPerSide))) * 3.0f));
+
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+		Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < numObjects; i++)
+		{
+			PhysicsObjectCreateOptions objectOptions = prefabOptions.m_ObjectOptions;
+			objectOptions.m_Transform = transforms[i];
+			PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+			for (size_t j = 0; j < prefabOptions.m_ColliderGeometries.size(); j++)
+				object->AddColliderGeometry(prefabOptions.m_ColliderGeometries[j], prefabOptions.m_ColliderLocalTransforms[j]);
+			dynamic_cast<IDynamicObject*>(object.get())->SetLinearVelocity(velocities[i]);
+			scene->AddPhysicsObject(object);
+		}
+		const double loopSpawn = ElapsedMilliseconds(start);
+
+		scene = CreateBenchmarkScene();
+		start = Clock::now();
+		PhysicsPtr<IPhysicsPrefab> prefab = PhysicsEngineUtils::CreatePrefab(prefabOptions);
+		std::vector<PhysicsPtr<IPhysicsObject>> objects = prefab->Instantiate(transforms, velocities);
+		scene->AddPhysicsObjects(objects);
+		const double prefabSpawn = ElapsedMilliseconds(start);
+
+		printf("Per-object spawn of %u bodies: %.3f ms\n", numObjects, loopSpawn);
+		printf("Prefab spawn of %u bodies: %.3f ms\n", numObjects, prefabSpawn);
+	}
+
+	// Builds bodies on worker threads and adds them to a scene in one batch from this thread. Every worker
+	// asks for the same box and for a few shared convex and sphere geometries, so the registry and
+	// material manager are hit concurrently; the run fails if any creation fails or a geometry is duplicated.
+	static bool StressParallelCreation(const PhysicsMeshDataPtr& convexMeshData, uint32_t numThreads = 16, uint32_t numObjects = 100000)
+	{
+		constexpr uint32_t NumSphereSizes = 8;
+		std::vector<std::vector<PhysicsPtr<IPhysicsObject>>> threadObjects(numThreads);
+		std::vector<std::vector<PhysicsPtr<IColliderGeometry>>> threadGeometries(numThreads);
+		std::vector<uint32_t> threadFailures(numThreads, 0);
+
+		Clock::time_point start = Clock::now();
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([&, t]()
+			{
+				const uint32_t begin = uint32_t(uint64_t(numObjects) * t / numThreads);
+				const uint32_t end = uint32_t(uint64_t(numObjects) * (t + 1) / numThreads);
+				for (uint32_t i = begin; i < end; i++)
+				{
+					CollisionGeometryCreateOptions geometryOptions;
+					if (i % 3 == 0)
+						geometryOptions.m_Params = BoxGeometryParams{MathLib::HVector3(0.5f, 0.5f, 0.5f)};
+					else if (i % 3 == 1 && convexMeshData)
+						geometryOptions.m_Params = ConvexMeshGeometryParams{convexMeshData};
+					else
+						geometryOptions.m_Params = SphereGeometryParams{0.25f + 0.05f * MathLib::HReal(i % NumSphereSizes)};
+					PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(geometryOptions);
+
+					PhysicsObjectCreateOptions objectOptions;
+					objectOptions.m_ObjectType = i % 10 == 0 ? PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC : PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+					objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(MathLib::HReal(i % 256) * 2.0f, MathLib::HReal(i / 65536) * 2.0f, MathLib::HReal(i / 256 % 256) * 2.0f)));
+					PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+					if (geometry == nullptr || object == nullptr || !object->AddColliderGeometry(geometry, MathLib::HTransform3::Identity()))
+					{
+						threadFailures[t]++;
+						continue;
+					}
+					threadObjects[t].push_back(object);
+					threadGeometries[t].push_back(geometry);
+				}
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		const double createTime = ElapsedMilliseconds(start);
+
+		std::vector<PhysicsPtr<IPhysicsObject>> objects;
+		objects.reserve(numObjects);
+		std::unordered_set<const IColliderGeometry*> geometries;
+		uint32_t numFailures = 0;
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			objects.insert(objects.end(), threadObjects[t].begin(), threadObjects[t].end());
+			for (const auto& geometry : threadGeometries[t])
+				geometries.insert(geometry.get());
+			numFailures += threadFailures[t];
+		}
+
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+		start = Clock::now();
+		const uint32_t numAdded = scene->AddPhysicsObjects(objects);
+		const double addTime = ElapsedMilliseconds(start);
+
+		const size_t numExpectedGeometries = 1 + (convexMeshData ? 1 : 0) + NumSphereSizes;
+		const bool passed = numFailures == 0 && numAdded == numObjects && geometries.size() == numExpectedGeometries;
+		printf("Created %u bodies on %u threads: %.3f ms, batch add: %.3f ms\n", numObjects, numThreads, createTime, addTime);
+		printf("Parallel creation %s: %u failures, %u added, %zu distinct geometries (expected %zu)\n",
+			   passed ? "passed" : "FAILED", numFailures, numAdded, geometries.size(), numExpectedGeometries);
+		return passed;
+	}
+
+	// Times pose readback into affine transforms: the former translate/rotate construction, the scalar
+	// PhysicsPose::ToTransform and the batched conversion; and the write direction from a transform.
+	static void BenchmarkPoseConversion(uint32_t numPoses = 100000, uint32_t numIterations = 100)
+	{
+		std::vector<PhysicsPose> poses(numPoses);
+		for (uint32_t i = 0; i < numPoses; i++)
+		{
+			const MathLib::HVector3 axis = MathLib::HVector3(MathLib::HReal(i % 7) + 1, MathLib::HReal(i % 5), MathLib::HReal(i % 3)).normalized();
+			poses[i] = PhysicsPose(MathLib::HQuaternion(Eigen::AngleAxis<MathLib::HReal>(MathLib::HReal(i) * 0.001f, axis)), MathLib::HVector3(MathLib::HReal(i), 1, 2));
+		}
+		std::vector<MathLib::HTransform3> transforms(numPoses);
+
+		Clock::time_point start = Clock::now();
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+		{
+			for (uint32_t i = 0; i < numPoses; i++)
+			{
+				MathLib::HTransform3 transform = MathLib::HTransform3::Identity();
+				transform.translate(poses[i].GetPosition());
+				transform.rotate(poses[i].GetRotation());
+				transforms[i] = transform;
+			}
+		}
+		const double translateRotate = ElapsedMilliseconds(start) / numIterations;
+
+		start = Clock::now();
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+		{
+			for (uint32_t i = 0; i < numPoses; i++)
+				transforms[i] = poses[i].ToTransform();
+		}
+		const double scalar = ElapsedMilliseconds(start) / numIterations;
+
+		start = Clock::now();
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+			PhysicsEngineUtils::ToTransforms(poses, transforms);
+		const double batch = ElapsedMilliseconds(start) / numIterations;
+
+		start = Clock::now();
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+		{
+			for (uint32_t i = 0; i < numPoses; i++)
+				poses[i] = PhysicsPose(transforms[i]);
+		}
+		const double fromTransform = ElapsedMilliseconds(start) / numIterations;
+
+		printf("Pose to transform, %u poses: translate/rotate %.3f ms, scalar %.3f ms, batch %.3f ms\n", numPoses, translateRotate, scalar, batch);
+		printf("Transform to pose, %u poses: %.3f ms (skipped entirely by SetPose)\n", numPoses, fromTransform);
+	}
+
+	// Times refreshing world bounds object by object against the scene's batched refresh; TestCheck::CheckWorldBounds compares them.
+	static void BenchmarkWorldBounds(uint32_t numBodiesPerSide = 64, uint32_t numLayers = 8, uint32_t numIterations = 100)
+	{
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+		CollisionGeometryCreateOptions boxOptions;
+		boxOptions.m_Params = BoxGeometryParams{MathLib::HVector3(0.5f, 0.25f, 1.0f)};
+		PhysicsPtr<IColliderGeometry> box = PhysicsEngineUtils::CreateColliderGeometry(boxOptions);
+		for (uint32_t layer = 0; layer < numLayers; layer++)
+		{
+			for (uint32_t i = 0; i < numBodiesPerSide; i++)
+			{
+				for (uint32_t j = 0; j < numBodiesPerSide; j++)
+				{
+					PhysicsObjectCreateOptions objectOptions;
+					objectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+					objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(3.0f * i, 3.0f * (layer + 1), 3.0f * j)));
+					objectOptions.m_Transform.rotate(Eigen::AngleAxis<MathLib::HReal>(0.1f * (i + j + layer), MathLib::HVector3(0, 1, 0)));
+					PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+					object->AddColliderGeometry(box, MathLib::HTransform3::Identity());
+					scene->AddPhysicsObject(object);
+				}
+			}
+		}
+		scene->Tick(1.0f / 60.0f);
+
+		std::span<IPhysicsObject *const> objects = scene->GetBoundingBoxObjects();
+		std::vector<MathLib::HAABBox3D> boxes(objects.size());
+		Clock::time_point start = Clock::now();
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+		{
+			for (size_t i = 0; i < objects.size(); i++)
+				boxes[i] = objects[i]->GetWorldBoundingBox();
+		}
+		const double perObject = ElapsedMilliseconds(start) / numIterations;
+
+		start = Clock::now();
+		for (uint32_t iteration = 0; iteration < numIterations; iteration++)
+			scene->UpdateWorldBoundingBoxes();
+		const double batched = ElapsedMilliseconds(start) / numIterations;
+
+		printf("World bounds of %zu bodies: per object %.3f ms, batched %.3f ms\n", objects.size(), perObject, batched);
+	}
+
+	// Runs a box stack (high importance) under a rain of debris (low importance) and lets the scene's
+	// solver budget chase half of the unconstrained step time.
+	static void BenchmarkSolverBudget(uint32_t numStackLayers = 20, uint32_t numDebrisPerSide = 24, uint32_t numSteps = 600)
+	{
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+		CollisionGeometryCreateOptions groundOptions;
+		groundOptions.m_Params = PlaneGeometryParams{MathLib::HVector3(0, 1, 0), 0};
+		PhysicsPtr<IColliderGeometry> ground = PhysicsEngineUtils::CreateColliderGeometry(groundOptions);
+		PhysicsObjectCreateOptions groundObjectOptions;
+		groundObjectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC;
+		groundObjectOptions.m_Transform = MathLib::HTransform3::Identity();
+		PhysicsPtr<IPhysicsObject> groundObject = PhysicsEngineUtils::CreateObject(groundObjectOptions);
+		groundObject->AddColliderGeometry(ground, MathLib::HTransform3::Identity());
+		scene->AddPhysicsObject(groundObject);
+
+		CollisionGeometryCreateOptions boxOptions;
+		boxOptions.m_Params = BoxGeometryParams{MathLib::HVector3(0.5f, 0.5f, 0.5f)};
+		PhysicsPtr<IColliderGeometry> box = PhysicsEngineUtils::CreateColliderGeometry(boxOptions);
+		CollisionGeometryCreateOptions sphereOptions;
+		sphereOptions.m_Params = SphereGeometryParams{0.3f};
+		PhysicsPtr<IColliderGeometry> sphere = PhysicsEngineUtils::CreateColliderGeometry(sphereOptions);
+
+		auto addBody = [&scene](PhysicsPtr<IColliderGeometry>& geometry, const MathLib::HVector3& position, MathLib::HReal importance)
+		{
+			PhysicsObjectCreateOptions objectOptions;
+			objectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+			objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(position));
+			PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+			object->AddColliderGeometry(geometry, MathLib::HTransform3::Identity());
+			dynamic_cast<IDynamicObject*>(object.get())->SetLODImportance(importance);
+			scene->AddPhysicsObject(object);
+		};
+		for (uint32_t layer = 0; layer < numStackLayers; layer++)
+		{
+			for (uint32_t i = 0; i < numStackLayers - layer; i++)
+				addBody(box, MathLib::HVector3(MathLib::HReal(i) + 0.5f * layer - 0.5f * numStackLayers, 0.5f + layer, 0), 2.0f);
+		}
+		for (uint32_t i = 0; i < numDebrisPerSide; i++)
+		{
+			for (uint32_t j = 0; j < numDebrisPerSide; j++)
+				addBody(sphere, MathLib::HVector3(MathLib::HReal(i) - 0.5f * numDebrisPerSide, 30.0f, MathLib::HReal(j) + 5.0f), 0.5f);
+		}
+
+		for (uint32_t step = 0; step < 60; step++)
+			scene->Tick(1.0f / 60.0f);
+		PhysicsSolverBudgetOptions budget;
+		budget.m_bEnabled = true;
+		budget.m_TargetStepMilliseconds = scene->GetAverageStepMilliseconds() * 0.5f;
+		scene->SetSolverBudget(budget);
+		printf("Solver budget target: %.3f ms\n", budget.m_TargetStepMilliseconds);
+		for (uint32_t step = 0; step < numSteps; step++)
+		{
+			scene->Tick(1.0f / 60.0f);
+			if ((step + 1) % 60 == 0)
+				printf("Step %u: average %.3f ms, scale %.3f\n", step + 1, scene->GetAverageStepMilliseconds(), scene->GetSolverBudgetScale());
+		}
+	}
+
+	// Decomposes the mesh once blocking and once in the background while a sphere pile keeps simulating,
+	// then cancels a third run halfway and reports how long the cancel took to land.
+	static void BenchmarkAsyncDecomposition(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 100000, uint32_t numBodiesPerSide = 16)
+	{
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+
+		Clock::time_point start = Clock::now();
+		std::vector<PhysicsMeshData> blockingHulls;
+		if (!PhysicsEngineUtils::ConvexDecomposition(*meshData, options, blockingHulls))
+			return;
+		const double blocking = ElapsedMilliseconds(start);
+
+		PhysicsPtr<IPhysicsScene> scene = CreateBenchmarkScene();
+		CollisionGeometryCreateOptions sphereOptions;
+		sphereOptions.m_Params = SphereGeometryParams{0.5f};
+		PhysicsPtr<IColliderGeometry> sphere = PhysicsEngineUtils::CreateColliderGeometry(sphereOptions);
+		for (uint32_t i = 0; i < numBodiesPerSide * numBodiesPerSide; i++)
+		{
+			PhysicsObjectCreateOptions objectOptions;
+			objectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+			objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(MathLib::HReal(i % numBodiesPerSide), 10.0f + i / numBodiesPerSide, 0)));
+			PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+			object->AddColliderGeometry(sphere, MathLib::HTransform3::Identity());
+			scene->AddPhysicsObject(object);
+		}
+
+		start = Clock::now();
+		PhysicsPtr<IConvexDecomposeTask> task = PhysicsEngineUtils::DecomposeAsync(*meshData, options);
+		uint32_t numSteps = 0;
+		while (!task->IsReady())
+		{
+			scene->Tick(1.0f / 60.0f);
+			numSteps++;
+		}
+		const double async = ElapsedMilliseconds(start);
+		const size_t numAsyncHulls = task->GetResult().get().size();
+		printf("Decomposition at resolution %u: blocking %.1f ms (%zu hulls), async %.1f ms (%zu hulls) with %u steps simulated meanwhile\n",
+			   resolution, blocking, blockingHulls.size(), async, numAsyncHulls, numSteps);
+
+		task = PhysicsEngineUtils::DecomposeAsync(*meshData, options);
+		while (!task->IsReady() && task->GetProgress() < 0.5f)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		start = Clock::now();
+		task->Cancel();
+		task->GetResult().wait();
+		printf("Cancelled at %.0f%%, worker stopped after %.1f ms\n", task->GetProgress() * 100, ElapsedMilliseconds(start));
+	}
+
+	// Decomposes copies of the mesh one after another and then as one batch on the decomposer's pool.
+	static void BenchmarkBatchDecomposition(const PhysicsMeshDataPtr& meshData, uint32_t numMeshes = 16, uint32_t resolution = 50000)
+	{
+		std::vector<ConvexDecomposeRequest> requests(numMeshes);
+		for (uint32_t i = 0; i < numMeshes; i++)
+		{
+			// Slightly different resolutions, so the batch is not a set of identical jobs.
+			requests[i].m_MeshData = meshData;
+			requests[i].m_Options.m_VoxelGridResolution = resolution + i * resolution / numMeshes;
+			requests[i].m_Options.m_MaximumNumberOfHulls = 16;
+		}
+
+		Clock::time_point start = Clock::now();
+		size_t numSerialHulls = 0;
+		for (const ConvexDecomposeRequest& request : requests)
+		{
+			std::vector<PhysicsMeshData> convexMeshesData;
+			PhysicsEngineUtils::ConvexDecomposition(*request.m_MeshData, request.m_Options, convexMeshesData);
+			numSerialHulls += convexMeshesData.size();
+		}
+		const double serial = ElapsedMilliseconds(start);
+
+		start = Clock::now();
+		std::vector<std::vector<PhysicsMeshDataPtr>> convexMeshesData;
+		const uint32_t numDecomposed = PhysicsEngineUtils::ConvexDecompositionBatch(requests, convexMeshesData);
+		const double batch = ElapsedMilliseconds(start);
+		size_t numBatchHulls = 0;
+		for (const auto& hulls : convexMeshesData)
+			numBatchHulls += hulls.size();
+		printf("Decomposition of %u meshes: serial %.1f ms (%zu hulls), batch %.1f ms (%u meshes, %zu hulls), speedup %.2fx\n",
+			   numMeshes, serial, numSerialHulls, batch, numDecomposed, numBatchHulls, serial / batch);
+	}
+
+	// Decomposes the mesh against an empty cache directory (cold), then again from the cache (warm).
+	static void BenchmarkDecomposeCache(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 100000, uint32_t numWarmRuns = 100)
+	{
+		const std::string previousDirectory = PhysicsEngineUtils::GetConvexDecomposeCacheDirectory();
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "PhysXToyDecomposeCacheBenchmark";
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(directory.string());
+
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+		Clock::time_point start = Clock::now();
+		std::vector<PhysicsMeshData> coldHulls;
+		PhysicsEngineUtils::ConvexDecomposition(*meshData, options, coldHulls);
+		const double cold = ElapsedMilliseconds(start);
+
+		std::vector<PhysicsMeshData> warmHulls;
+		start = Clock::now();
+		for (uint32_t i = 0; i < numWarmRuns; i++)
+			PhysicsEngineUtils::ConvexDecomposition(*meshData, options, warmHulls);
+		const double warm = ElapsedMilliseconds(start) / numWarmRuns;
+
+		printf("Decomposition cache at resolution %u: cold %.1f ms, warm %.3f ms (%.0fx), %zu hulls\n",
+			   resolution, cold, warm, cold / warm, coldHulls.size());
+
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(previousDirectory);
+		std::filesystem::remove_all(directory, error);
+	}
+
+	// Times the decomposition with the voxel plane kernels on the scalar path and on AVX2; TestCheck::CheckWideKernels compares the hulls.
+	static void BenchmarkVoxelClipping(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 1000000)
+	{
+		// A cache hit would skip the voxel work entirely.
+		const std::string cacheDirectory = PhysicsEngineUtils::GetConvexDecomposeCacheDirectory();
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(std::string());
+
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+		std::vector<PhysicsMeshData> hulls[2];
+		double times[2];
+		for (int wide = 0; wide < 2; wide++)
+		{
+			PhysicsEngineUtils::SetWideSimdEnabled(wide == 1);
+			const Clock::time_point start = Clock::now();
+			PhysicsEngineUtils::ConvexDecomposition(*meshData, options, hulls[wide]);
+			times[wide] = ElapsedMilliseconds(start);
+		}
+		PhysicsEngineUtils::SetWideSimdEnabled(true);
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(cacheDirectory);
+
+		printf("Voxel clipping at resolution %u: scalar %.1f ms, AVX2 %.1f ms, %zu hulls\n",
+			   resolution, times[0], times[1], hulls[1].size());
+	}
+
+	// Decomposes the mesh with and without snapping the hull vertices back onto it; the difference is
+	// the time spent raycasting the source mesh.
+	static void BenchmarkHullProjection(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 100000, uint32_t numRuns = 5)
+	{
+		// A cache hit would skip the projection entirely.
+		const std::string cacheDirectory = PhysicsEngineUtils::GetConvexDecomposeCacheDirectory();
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(std::string());
+
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+		double times[2];
+		size_t numHulls = 0;
+		for (int project = 0; project < 2; project++)
+		{
+			options.m_bProjectHullVertices = project == 1;
+			std::vector<PhysicsMeshData> hulls;
+			const Clock::time_point start = Clock::now();
+			for (uint32_t i = 0; i < numRuns; i++)
+				PhysicsEngineUtils::ConvexDecomposition(*meshData, options, hulls);
+			times[project] = ElapsedMilliseconds(start) / numRuns;
+			numHulls = hulls.size();
+		}
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(cacheDirectory);
+
+		printf("Hull projection on %zu triangles at resolution %u: decomposition %.1f ms without, %.1f ms with projection, projection %.1f ms, %zu hulls\n",
+			   meshData->m_Indices.size() / 3, resolution, times[0], times[1], times[1] - times[0], numHulls);
+	}
+
+	// Decomposes the mesh into many hulls, then times merging them down on one thread and on the whole
+	// pool; TestCheck::CheckHullMerging compares the results.
+	static void BenchmarkHullMerging(const PhysicsMeshDataPtr& meshData, uint32_t numHulls = 256, uint32_t numMergedHulls = 16, uint32_t resolution = 1000000)
+	{
+		const std::string cacheDirectory = PhysicsEngineUtils::GetConvexDecomposeCacheDirectory();
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(std::string());
+
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = numHulls;
+		std::vector<PhysicsMeshData> hulls;
+		PhysicsEngineUtils::ConvexDecomposition(*meshData, options, hulls);
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(cacheDirectory);
+
+		options.m_MaximumNumberOfHulls = numMergedHulls;
+		std::vector<PhysicsMeshData> merged[2];
+		double times[2];
+		for (int pool = 0; pool < 2; pool++)
+		{
+			options.m_MaximumNumberOfThreads = pool == 1 ? 0 : 1;
+			const Clock::time_point start = Clock::now();
+			PhysicsEngineUtils::MergeConvexHulls(hulls, options, merged[pool]);
+			times[pool] = ElapsedMilliseconds(start);
+		}
+
+		printf("Merging %zu hulls into %zu: %.1f ms on one thread, %.1f ms on the pool (%.2fx)\n",
+			   hulls.size(), merged[1].size(), times[0], times[1], times[0] / times[1]);
+	}
+
+	// Decomposes the mesh without a budget, then with fractions of that time, polling the coarse hulls
+	// published meanwhile; reports when the first ones arrived and what each budget returned.
+	static void BenchmarkTimeBudget(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 1000000)
+	{
+		// A cache hit would return the complete result right away.
+		const std::string cacheDirectory = PhysicsEngineUtils::GetConvexDecomposeCacheDirectory();
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(std::string());
+
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+		options.m_bPublishIntermediateHulls = true;
+		double fullTime = 0;
+		for (uint32_t fraction : {0u, 8u, 4u, 2u})
+		{
+			options.m_TimeBudgetMs = fraction > 0 ? static_cast<uint32_t>(fullTime / fraction) : 0;
+			const Clock::time_point start = Clock::now();
+			PhysicsPtr<IConvexDecomposeTask> task = PhysicsEngineUtils::DecomposeAsync(*meshData, options);
+			if (!task)
+				break;
+			double firstIntermediate = -1;
+			std::vector<PhysicsMeshDataPtr> intermediateHulls;
+			while (!task->IsReady())
+			{
+				if (firstIntermediate < 0 && task->GetIntermediateResult(intermediateHulls) > 0)
+					firstIntermediate = ElapsedMilliseconds(start);
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			const double elapsed = ElapsedMilliseconds(start);
+			if (fraction == 0)
+				fullTime = elapsed;
+			printf("Budget %u ms at resolution %u: done in %.1f ms, %zu hulls%s, first coarse hulls after %.1f ms, %u coarse sets\n",
+				   options.m_TimeBudgetMs, resolution, elapsed, task->GetResult().get().size(), task->HasTimedOut() ? " (timed out)" : "",
+				   firstIntermediate, task->GetIntermediateResult(intermediateHulls));
+		}
+		PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(cacheDirectory);
+	}
+};
@@ -0,0 +1,339 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+// Checks run from the testing application, with --check or on a key. Each one prints what it
+// compared and returns false on any mismatch; RunAll reports how many failed.
+namespace TestCheck
+{
+	static bool Report(const char* name, bool bPassed)
+	{
+		printf("%s: %s\n", name, bPassed ? "passed" : "FAILED");
+		return bPassed;
+	}
+
+	static bool SameHulls(const std::vector<PhysicsMeshData>& a, const std::vector<PhysicsMeshData>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (a[i].m_Vertices != b[i].m_Vertices || a[i].m_Indices != b[i].m_Indices)
+				return false;
+		}
+		return true;
+	}
+
+	// Points the decomposition cache at a directory for one scope, empty to run without it.
+	struct ScopedCacheDirectory
+	{
+		explicit ScopedCacheDirectory(const std::string& directory)
+			: m_Previous(PhysicsEngineUtils::GetConvexDecomposeCacheDirectory())
+		{
+			PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(directory);
+		}
+		~ScopedCacheDirectory() { PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(m_Previous); }
+
+		std::string m_Previous;
+	};
+
+	// Spheres dropped onto the flat terraces of a heightfield and onto its mesh from
+	// BuildHeightFieldMesh have to come to rest on the same terrace heights.
+	static bool CheckHeightFieldMesh(uint32_t numBlocksPerSide = 8, uint32_t blockSize = 8, uint32_t numSteps = 120)
+	{
+		const uint32_t resolution = numBlocksPerSide * blockSize;
+		const MathLib::HReal heightScale = 0.01f;
+		std::shared_ptr<PhysicsHeightFieldData> heightFieldData = std::make_shared<PhysicsHeightFieldData>();
+		heightFieldData->m_NumRows = resolution;
+		heightFieldData->m_NumColumns = resolution;
+		heightFieldData->m_Heights.resize(size_t(resolution) * resolution);
+		for (uint32_t row = 0; row < resolution; row++)
+			for (uint32_t column = 0; column < resolution; column++)
+				heightFieldData->m_Heights[row * resolution + column] = int16_t((row / blockSize * 3 + column / blockSize * 5) % 7 * 100);
+
+		HeightFieldGeometryParams heightFieldParams;
+		heightFieldParams.m_HeightFieldData = heightFieldData;
+		heightFieldParams.m_HeightScale = heightScale;
+		CollisionGeometryCreateOptions heightFieldOptions;
+		heightFieldOptions.m_Params = heightFieldParams;
+		PhysicsMeshData meshData;
+		PhysicsEngineUtils::BuildHeightFieldMesh(heightFieldParams, meshData);
+		CollisionGeometryCreateOptions meshOptions;
+		meshOptions.m_Params = TriangleMeshGeometryParams{MakePhysicsMeshData(std::move(meshData))};
+		PhysicsPtr<IColliderGeometry> terrains[2] = {PhysicsEngineUtils::CreateColliderGeometry(heightFieldOptions), PhysicsEngineUtils::CreateColliderGeometry(meshOptions)};
+
+		CollisionGeometryCreateOptions sphereOptions;
+		const MathLib::HReal radius = 0.5f;
+		sphereOptions.m_Params = SphereGeometryParams{radius};
+		PhysicsPtr<IColliderGeometry> sphere = PhysicsEngineUtils::CreateColliderGeometry(sphereOptions);
+
+		MathLib::HReal maxError = 0;
+		for (PhysicsPtr<IColliderGeometry>& terrain : terrains)
+		{
+			if (terrain == nullptr || sphere == nullptr)
+				return Report("HeightField against its mesh", false);
+			PhysicsSceneCreateOptions sceneOptions;
+			sceneOptions.m_FilterShaderType = PhysicsSceneFilterShaderType::eDEFAULT;
+			sceneOptions.m_Gravity = MathLib::HVector3(0.0f, -9.81f, 0.0f);
+			PhysicsPtr<IPhysicsScene> scene = PhysicsEngineUtils::CreateScene(sceneOptions);
+			PhysicsObjectCreateOptions terrainOptions;
+			terrainOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC;
+			PhysicsPtr<IPhysicsObject> terrainObject = PhysicsEngineUtils::CreateObject(terrainOptions);
+			terrainObject->AddColliderGeometry(terrain, MathLib::HTransform3::Identity());
+			scene->AddPhysicsObject(terrainObject);
+
+			// One sphere above the middle of every terrace, away from the slopes between them.
+			std::vector<PhysicsPtr<IPhysicsObject>> spheres;
+			std::vector<MathLib::HReal> restHeights;
+			for (uint32_t i = 0; i < numBlocksPerSide; i++)
+			{
+				for (uint32_t j = 0; j < numBlocksPerSide; j++)
+				{
+					const MathLib::HReal x = MathLib::HReal(i * blockSize) + MathLib::HReal(blockSize - 1) * 0.5f;
+					const MathLib::HReal z = MathLib::HReal(j * blockSize) + MathLib::HReal(blockSize - 1) * 0.5f;
+					const MathLib::HReal terraceHeight = MathLib::HReal(heightFieldData->m_Heights[i * blockSize * resolution + j * blockSize]) * heightScale;
+					PhysicsObjectCreateOptions objectOptions;
+					objectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+					objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(x, terraceHeight + 2.0f, z)));
+					PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+					object->AddColliderGeometry(sphere, MathLib::HTransform3::Identity());
+					scene->AddPhysicsObject(object);
+					spheres.push_back(object);
+					restHeights.push_back(terraceHeight + radius);
+				}
+			}
+			for (uint32_t step = 0; step < numSteps; step++)
+				scene->Tick(1.0f / 60.0f);
+			for (size_t i = 0; i < spheres.size(); i++)
+				maxError = std::max(maxError, std::abs(spheres[i]->GetPose().m_Position[1] - restHeights[i]));
+		}
+		printf("HeightField against its mesh: %u terraces each, largest rest height error %g\n", numBlocksPerSide * numBlocksPerSide, maxError);
+		return Report("HeightField against its mesh", maxError < 0.05f);
+	}
+
+	// The finest level of a convex LOD chain has to be the hull cooked without limits, every further
+	// level has to drop vertices, and the coarsest one has to meet the last limit.
+	static bool CheckConvexLODs(const PhysicsMeshDataPtr& meshData)
+	{
+		if (meshData == nullptr)
+			return Report("Convex LOD chain", false);
+		const std::vector<uint32_t> limits = {255, 64, 32, 16};
+		CollisionGeometryCreateOptions singleOptions;
+		singleOptions.m_Params = ConvexMeshGeometryParams{meshData};
+		CollisionGeometryCreateOptions chainOptions;
+		chainOptions.m_Params = ConvexMeshGeometryParams{meshData, limits};
+		PhysicsPtr<IColliderGeometry> single = PhysicsEngineUtils::CreateColliderGeometry(singleOptions);
+		PhysicsPtr<IColliderGeometry> chain = PhysicsEngineUtils::CreateColliderGeometry(chainOptions);
+		if (single == nullptr || chain == nullptr || single->GetConvexLODCount() != 1 || chain->GetConvexLODCount() == 0)
+			return Report("Convex LOD chain", false);
+
+		const uint32_t numVertices = single->GetConvexLODVertexCount(0);
+		bool bPassed = chain->GetConvexLODVertexCount(0) == numVertices && numVertices <= limits.front();
+		for (uint32_t lod = 1; lod < chain->GetConvexLODCount(); lod++)
+			bPassed = bPassed && chain->GetConvexLODVertexCount(lod) < chain->GetConvexLODVertexCount(lod - 1);
+		const uint32_t coarsest = chain->GetConvexLODVertexCount(chain->GetConvexLODCount() - 1);
+		bPassed = bPassed && coarsest <= limits.back();
+		printf("Convex LOD chain: %u vertices without limits, %u levels down to %u vertices\n", numVertices, chain->GetConvexLODCount(), coarsest);
+		return Report("Convex LOD chain", bPassed);
+	}
+
+	// The scene's batched world bounds refresh has to agree with each object's own world bounds.
+	static bool CheckWorldBounds(uint32_t numBodiesPerSide = 16, uint32_t numLayers = 4)
+	{
+		PhysicsSceneCreateOptions sceneOptions;
+		sceneOptions.m_FilterShaderType = PhysicsSceneFilterShaderType::eDEFAULT;
+		sceneOptions.m_Gravity = MathLib::HVector3(0.0f, -9.81f, 0.0f);
+		PhysicsPtr<IPhysicsScene> scene = PhysicsEngineUtils::CreateScene(sceneOptions);
+		CollisionGeometryCreateOptions boxOptions;
+		boxOptions.m_Params = BoxGeometryParams{MathLib::HVector3(0.5f, 0.25f, 1.0f)};
+		PhysicsPtr<IColliderGeometry> box = PhysicsEngineUtils::CreateColliderGeometry(boxOptions);
+		for (uint32_t layer = 0; layer < numLayers; layer++)
+		{
+			for (uint32_t i = 0; i < numBodiesPerSide; i++)
+			{
+				for (uint32_t j = 0; j < numBodiesPerSide; j++)
+				{
+					PhysicsObjectCreateOptions objectOptions;
+					objectOptions.m_ObjectType = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
+					objectOptions.m_Transform = MathLib::HTransform3(MathLib::HTranslation3(MathLib::HVector3(3.0f * i, 3.0f * (layer + 1), 3.0f * j)));
+					objectOptions.m_Transform.rotate(Eigen::AngleAxis<MathLib::HReal>(0.1f * (i + j + layer), MathLib::HVector3(0, 1, 0)));
+					PhysicsPtr<IPhysicsObject> object = PhysicsEngineUtils::CreateObject(objectOptions);
+					object->AddColliderGeometry(box, MathLib::HTransform3::Identity());
+					scene->AddPhysicsObject(object);
+				}
+			}
+		}
+		// Bodies are falling and turning after a few steps, so the poses are not the initial ones.
+		for (uint32_t step = 0; step < 10; step++)
+			scene->Tick(1.0f / 60.0f);
+		scene->UpdateWorldBoundingBoxes();
+
+		std::span<IPhysicsObject *const> objects = scene->GetBoundingBoxObjects();
+		std::span<const MathLib::HAABBox3D> worldBoxes = scene->GetWorldBoundingBoxes();
+		MathLib::HReal maxError = 0;
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			const MathLib::HAABBox3D objectBox = objects[i]->GetWorldBoundingBox();
+			maxError = std::max(maxError, (worldBoxes[i].min() - objectBox.min()).cwiseAbs().maxCoeff());
+			maxError = std::max(maxError, (worldBoxes[i].max() - objectBox.max()).cwiseAbs().maxCoeff());
+		}
+		printf("World bounds of %zu bodies: largest difference %g\n", objects.size(), maxError);
+		return Report("Batched world bounds", objects.size() == size_t(numBodiesPerSide) * numBodiesPerSide * numLayers && maxError < 1e-4f);
+	}
+
+	// A decomposition read back from the disk cache has to match the one that was stored.
+	static bool CheckDecomposeCache(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 100000)
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "PhysXToyDecomposeCacheCheck";
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+
+		bool bPassed = false;
+		size_t numFiles = 0;
+		if (meshData)
+		{
+			ScopedCacheDirectory cacheDirectory(directory.string());
+			ConvexDecomposeOptions options;
+			options.m_VoxelGridResolution = resolution;
+			options.m_MaximumNumberOfHulls = 16;
+			std::vector<PhysicsMeshData> storedHulls, loadedHulls;
+			const bool bStored = PhysicsEngineUtils::ConvexDecomposition(*meshData, options, storedHulls);
+			for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+				numFiles += entry.is_regular_file();
+			const bool bLoaded = PhysicsEngineUtils::ConvexDecomposition(*meshData, options, loadedHulls);
+			bPassed = bStored && bLoaded && numFiles == 1 && SameHulls(storedHulls, loadedHulls);
+			printf("Decomposition cache: %zu hulls stored, %zu read back, %zu cache files\n", storedHulls.size(), loadedHulls.size(), numFiles);
+		}
+		std::filesystem::remove_all(directory, error);
+		return Report("Decomposition cache round trip", bPassed);
+	}
+
+	// The clipping-plane search keeps the best plane of every chunk and merges them in plane order,
+	// so one thread and the whole pool have to produce the same hulls.
+	static bool CheckThreadCountIndependence(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 100000)
+	{
+		if (meshData == nullptr)
+			return Report("Decomposition on one thread and on the pool", false);
+		// A cache hit would return the first result for the second run.
+		ScopedCacheDirectory cacheDirectory(std::string());
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+		std::vector<PhysicsMeshData> hulls[2];
+		for (int pool = 0; pool < 2; pool++)
+		{
+			// The pool clamps the request to its size.
+			options.m_MaximumNumberOfThreads = pool == 1 ? UINT32_MAX : 1;
+			PhysicsEngineUtils::ConvexDecomposition(*meshData, options, hulls[pool]);
+		}
+		printf("Decomposition at resolution %u: %zu hulls on one thread, %zu on the pool\n", resolution, hulls[0].size(), hulls[1].size());
+		return Report("Decomposition on one thread and on the pool", !hulls[0].empty() && SameHulls(hulls[0], hulls[1]));
+	}
+
+	// The AVX2 voxel kernels round like the scalar ones, so turning them off must not change any hull.
+	static bool CheckWideKernels(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 100000)
+	{
+		if (meshData == nullptr)
+			return Report("Decomposition with and without AVX2", false);
+		ScopedCacheDirectory cacheDirectory(std::string());
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+		std::vector<PhysicsMeshData> hulls[2];
+		for (int wide = 0; wide < 2; wide++)
+		{
+			PhysicsEngineUtils::SetWideSimdEnabled(wide == 1);
+			PhysicsEngineUtils::ConvexDecomposition(*meshData, options, hulls[wide]);
+		}
+		PhysicsEngineUtils::SetWideSimdEnabled(true);
+		printf("Decomposition at resolution %u: %zu hulls scalar, %zu with AVX2\n", resolution, hulls[0].size(), hulls[1].size());
+		return Report("Decomposition with and without AVX2", !hulls[0].empty() && SameHulls(hulls[0], hulls[1]));
+	}
+
+	// The hull projection raycasts through a SAH hierarchy with AVX2 packets; every ray has to get
+	// exactly the hit testing each triangle on its own gives.
+	static bool CheckRaycastHierarchy(const PhysicsMeshDataPtr& meshData, uint32_t numRays = 100000)
+	{
+		if (meshData == nullptr)
+			return Report("Raycast hierarchy against every triangle", false);
+		const uint32_t numMismatches = PhysicsEngineUtils::CountRaycastMismatches(*meshData, numRays);
+		printf("Raycasts on %zu triangles: %u of %u rays hit differently\n", meshData->m_Indices.size() / 3, numMismatches, numRays);
+		return Report("Raycast hierarchy against every triangle", numMismatches == 0);
+	}
+
+	// Merging on one thread and with the pair costs spread over the pool has to give the same hulls.
+	static bool CheckHullMerging(const PhysicsMeshDataPtr& meshData, uint32_t numHulls = 64, uint32_t numMergedHulls = 8, uint32_t resolution = 100000)
+	{
+		if (meshData == nullptr)
+			return Report("Hull merging on one thread and on the pool", false);
+		ScopedCacheDirectory cacheDirectory(std::string());
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = numHulls;
+		std::vector<PhysicsMeshData> hulls;
+		PhysicsEngineUtils::ConvexDecomposition(*meshData, options, hulls);
+
+		options.m_MaximumNumberOfHulls = numMergedHulls;
+		std::vector<PhysicsMeshData> merged[2];
+		bool bMerged = hulls.size() > numMergedHulls;
+		for (int pool = 0; pool < 2; pool++)
+		{
+			options.m_MaximumNumberOfThreads = pool == 1 ? 0 : 1;
+			bMerged = PhysicsEngineUtils::MergeConvexHulls(hulls, options, merged[pool]) && bMerged;
+		}
+		printf("Merging %zu hulls: %zu on one thread, %zu on the pool\n", hulls.size(), merged[0].size(), merged[1].size());
+		return Report("Hull merging on one thread and on the pool", bMerged && merged[0].size() <= numMergedHulls && SameHulls(merged[0], merged[1]));
+	}
+
+	// Without a budget, or with one it never reaches, publishing coarse hulls on the way must not change
+	// what the decomposition finally returns.
+	static bool CheckTimeBudgetOff(const PhysicsMeshDataPtr& meshData, uint32_t resolution = 100000)
+	{
+		if (meshData == nullptr)
+			return Report("Decomposition without a time budget", false);
+		ScopedCacheDirectory cacheDirectory(std::string());
+		ConvexDecomposeOptions options;
+		options.m_VoxelGridResolution = resolution;
+		options.m_MaximumNumberOfHulls = 16;
+		std::vector<PhysicsMeshData> hulls;
+		PhysicsEngineUtils::ConvexDecomposition(*meshData, options, hulls);
+
+		options.m_bPublishIntermediateHulls = true;
+		bool bPassed = !hulls.empty();
+		for (uint32_t budget : {0u, 3600000u})
+		{
+			options.m_TimeBudgetMs = budget;
+			PhysicsPtr<IConvexDecomposeTask> task = PhysicsEngineUtils::DecomposeAsync(*meshData, options);
+			if (!task)
+				return Report("Decomposition without a time budget", false);
+			std::vector<PhysicsMeshData> budgetHulls;
+			for (const PhysicsMeshDataPtr& hull : task->GetResult().get())
+				budgetHulls.push_back(*hull);
+			printf("Decomposition with budget %u ms: %zu hulls, %zu without a budget%s\n", budget, budgetHulls.size(), hulls.size(),
+				   task->HasTimedOut() ? " (timed out)" : "");
+			bPassed = bPassed && !task->HasTimedOut() && SameHulls(hulls, budgetHulls);
+		}
+		return Report("Decomposition without a time budget", bPassed);
+	}
+
+	// Returns the number of failed checks; meshData is the triangle mesh the decomposition checks run on.
+	static uint32_t RunAll(const PhysicsMeshDataPtr& meshData)
+	{
+		uint32_t numFailed = 0;
+		numFailed += !CheckHeightFieldMesh();
+		numFailed += !CheckConvexLODs(meshData);
+		numFailed += !CheckWorldBounds();
+		numFailed += !CheckDecomposeCache(meshData);
+		numFailed += !CheckThreadCountIndependence(meshData);
+		numFailed += !CheckWideKernels(meshData);
+		numFailed += !CheckRaycastHierarchy(meshData);
+		numFailed += !CheckHullMerging(meshData);
+		numFailed += !CheckTimeBudgetOff(meshData);
+		printf("%u checks failed\n", numFailed);
+		return numFailed;
+	}
+};
@@ -1,20 +1,24 @@
 #pragma once
 #include "MeshDataLoader.h"
 #include "TestMeshGenerator.h"
+#include <random>
+// rand() shares one hidden state between threads; each thread gets its own engine instead.
 inline  unsigned RandomUInt(unsigned range)
 {
-	return rand() % range;
+	thread_local std::mt19937 generator(std::random_device{}());
+	return std::uniform_int_distribution<unsigned>(0, range - 1)(generator);
 }
 namespace TestRigidBody
 {
 	static MathLib::HReal stackZ = 15.0f;
-	static PhysicsMeshData TriangleMeshData;
-	static PhysicsMeshData ConvexMeshData;
-	static std::vector<PhysicsMeshData> ConvexDecomposedMeshData;
+	static PhysicsMeshDataPtr TriangleMeshData;
+	static PhysicsMeshDataPtr ConvexMeshData;
+	static std::vector<PhysicsMeshDataPtr> ConvexDecomposedMeshData;
 
 	static void CreateTestingMeshData(const char* path =nullptr,const MathLib::HReal scale =1)
 	{
-		if (path == nullptr || (!LoadObj(path,TriangleMeshData,scale)))
+		PhysicsMeshData triangleMeshData;
+		if (path == nullptr || (!LoadObj(path,triangleMeshData,scale)))
 		{		
 			uint32_t numVerts = 0;
 			uint32_t numFaces = 0;
@@ -22,17 +26,27 @@ namespace TestRigidBody
 			numVerts = MeshGenerateUtils::Bunny_getNbVerts();
 			numFaces = MeshGenerateUtils::Bunny_getNbFaces();
 
-			TriangleMeshData.m_Vertices.resize(numVerts);
-			TriangleMeshData.m_Indices.resize(numFaces * 3);
+			triangleMeshData.m_Vertices.resize(numVerts);
+			triangleMeshData.m_Indices.resize(numFaces * 3);
 
-			memcpy(TriangleMeshData.m_Vertices.data(), MeshGenerateUtils::Bunny_getVerts(), sizeof(MathLib::HVector3) * numVerts);
-			memcpy(TriangleMeshData.m_Indices.data(), MeshGenerateUtils::Bunny_getFaces(), sizeof(uint32_t) * numFaces * 3);
+			memcpy(triangleMeshData.m_Vertices.data(), MeshGenerateUtils::Bunny_getVerts(), sizeof(MathLib::HVector3) * numVerts);
+			memcpy(triangleMeshData.m_Indices.data(), MeshGenerateUtils::Bunny_getFaces(), sizeof(uint32_t) * numFaces * 3);
 		}
-		PhysicsEngineUtils::BuildConvexMesh(TriangleMeshData.m_Vertices, TriangleMeshData.m_Indices, ConvexMeshData);
+		TriangleMeshData = MakePhysicsMeshData(std::move(triangleMeshData));
+
+		// The decomposition runs in the background while the single hull is built.
 		ConvexDecomposeOptions decomposeOptions;
 		decomposeOptions.m_VoxelGridResolution = 1000;
 		decomposeOptions.m_MaximumNumberOfHulls = 16;
-		PhysicsEngineUtils::ConvexDecomposition(TriangleMeshData, decomposeOptions, ConvexDecomposedMeshData);
+		PhysicsPtr<IConvexDecomposeTask> decomposeTask = PhysicsEngineUtils::DecomposeAsync(*TriangleMeshData, decomposeOptions);
+
+		PhysicsMeshData convexMeshData;
+		PhysicsEngineUtils::BuildConvexMesh(TriangleMeshData->m_Vertices, TriangleMeshData->m_Indices, convexMeshData);
+		ConvexMeshData = MakePhysicsMeshData(std::move(convexMeshData));
+
+		ConvexDecomposedMeshData.clear();
+		if (decomposeTask)
+			ConvexDecomposedMeshData = decomposeTask->GetResult().get();
 	}
 
 	static PhysicsPtr<IPhysicsObject> CreateDynamic(const MathLib::HTransform3& t, PhysicsPtr < IColliderGeometry>& geometry, const MathLib::HVector3& velocity = MathLib::HVector3(0, 0, 0))
@@ -67,9 +81,7 @@ namespace TestRigidBody
 		for (size_t i = 0; i < ConvexDecomposedMeshData.size(); i++)
 		{
 			CollisionGeometryCreateOptions options;
-			options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH;
-			options.m_ConvexMeshParams.m_Vertices = ConvexDecomposedMeshData[i].m_Vertices;
-			options.m_ConvexMeshParams.m_Indices = ConvexDecomposedMeshData[i].m_Indices;
+			options.m_Params = ConvexMeshGeometryParams{ConvexDecomposedMeshData[i]};
 			options.m_Scale = MathLib::HVector3(3.0f, 3.0f, 3.0f);
 			geos[i] = PhysicsEngineUtils::CreateColliderGeometry(options);
 		}
@@ -102,8 +114,7 @@ namespace TestRigidBody
 	{
 		std::vector<PhysicsPtr<IPhysicsObject>> objects;
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX;
-		options.m_BoxParams.m_HalfExtents = MathLib::HVector3(halfExtent, halfExtent, halfExtent);
+		options.m_Params = BoxGeometryParams{MathLib::HVector3(halfExtent, halfExtent, halfExtent)};
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
 
@@ -137,8 +148,7 @@ namespace TestRigidBody
 	{
 		std::vector<PhysicsPtr<IPhysicsObject>> objects;
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE;
-		options.m_SphereParams.m_Radius = halfExtent;
+		options.m_Params = SphereGeometryParams{halfExtent};
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
 
@@ -164,9 +174,7 @@ namespace TestRigidBody
 	{
 		std::vector<PhysicsPtr<IPhysicsObject>> objects;
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE;
-		options.m_CapsuleParams.m_HalfHeight = halfExtent / 2;
-		options.m_CapsuleParams.m_Radius = halfExtent / 2;
+		options.m_Params = CapsuleGeometryParams{halfExtent / 2, halfExtent / 2};
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
 
@@ -192,15 +200,11 @@ namespace TestRigidBody
 	{
 		std::vector<PhysicsPtr<IPhysicsObject>> objects;
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH;
-		options.m_TriangleMeshParams.m_Vertices = TriangleMeshData.m_Vertices;
-		options.m_TriangleMeshParams.m_Indices = TriangleMeshData.m_Indices;
+		options.m_Params = TriangleMeshGeometryParams{TriangleMeshData};
 		options.m_Scale = MathLib::HVector3(3.0f, 3.0f, 3.0f);
 
 		PhysicsPtr<IColliderGeometry> geometry0 = PhysicsEngineUtils::CreateColliderGeometry(options);
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH;
-		options.m_ConvexMeshParams.m_Vertices = ConvexMeshData.m_Vertices;
-		options.m_ConvexMeshParams.m_Indices= ConvexMeshData.m_Indices;
+		options.m_Params = ConvexMeshGeometryParams{ConvexMeshData};
 		options.m_Scale = MathLib::HVector3(3.0f, 3.0f, 3.0f);
 		PhysicsPtr<IColliderGeometry> geometry1 = PhysicsEngineUtils::CreateColliderGeometry(options);
 
@@ -227,9 +231,7 @@ namespace TestRigidBody
 	{
 		std::vector<PhysicsPtr<IPhysicsObject>> objects;
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH;
-		options.m_ConvexMeshParams.m_Vertices = ConvexMeshData.m_Vertices;
-		options.m_ConvexMeshParams.m_Indices = ConvexMeshData.m_Indices;
+		options.m_Params = ConvexMeshGeometryParams{ConvexMeshData};
 		options.m_Scale = MathLib::HVector3(3.0f, 3.0f, 3.0f);
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
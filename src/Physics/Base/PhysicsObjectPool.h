@@ -1,52 +1,103 @@
 #pragma once
+#include "Physics/PhysicsCommon.h"
 #include <vector>
-#include <queue>
 #include <mutex>
-template <class PhysicsObject>
-class PhysicsObjectPool
+
+class PhysicsObjectPool : public IPhysicsObjectPool
 {
 public:
-	PhysicsObjectPool(uint32_t maxSize = 500)
+	PhysicsObjectPool(PhysicsPtr<IPhysicsScene> &scene, PhysicsPtr<IPhysicsPrefab> &prefab, const PhysicsObjectPoolCreateOptions &options)
 	{
-		m_MaxSize = maxSize;
-		m_ObjectPool.resize(maxSize);
-		for (auto& object : m_ObjectPool)
-		{
-			object = new PhysicsObject();
-		}
+		m_Scene = scene;
+		m_Prefab = prefab;
+		m_MaxIdleCount = options.m_MaxIdleCount;
+		const std::vector<MathLib::HTransform3> transforms(options.m_PrewarmCount, MathLib::HTransform3::Identity());
+		m_IdleObjects = _CreateObjects(transforms);
 	}
-	
-	PhysicsObject* TakeObject()
+
+	void Release() override
 	{
 		std::lock_guard<std::mutex> lock(m_Mutex);
-		PhysicsObject* object = m_ObjectPool.front();
-		m_ObjectPool.pop();
-		if (m_ObjectPool.size() / m_MaxSize < 0.5)
+		for (auto &object : m_IdleObjects)
+			_DestroyObject(object);
+		m_IdleObjects.clear();
+		m_Scene.reset();
+		m_Prefab.reset();
+	}
+
+	PhysicsPtr<IPhysicsObject> TakeObject(const MathLib::HTransform3 &transform) override
+	{
+		PhysicsPtr<IPhysicsObject> object;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!m_IdleObjects.empty())
+			{
+				object = m_IdleObjects.back();
+				m_IdleObjects.pop_back();
+			}
+		}
+		if (object == nullptr)
+		{
+			std::vector<PhysicsPtr<IPhysicsObject>> objects = _CreateObjects({&transform, 1});
+			if (objects.empty())
+				return nullptr;
+			object = objects[0];
+		}
+
+		object->SetSimulationEnabled(true);
+		object->SetTransform(transform);
+		if (IDynamicObject *dynamicObject = dynamic_cast<IDynamicObject *>(object.get()))
 		{
-			m_ObjectPool.resize(m_MaxSize);
+			dynamicObject->SetLinearVelocity(MathLib::HVector3(0, 0, 0));
+			dynamicObject->SetAngularVelocity(MathLib::HVector3(0, 0, 0));
 		}
 		return object;
 	}
 
-	void ReturnObject(PhysicsObject** object)
+	void ReturnObject(PhysicsPtr<IPhysicsObject> &object) override
 	{
+		if (object == nullptr)
+			return;
+		object->SetSimulationEnabled(false);
 		std::lock_guard<std::mutex> lock(m_Mutex);
-		if (m_ObjectPool.size() < m_MaxSize)
-		{
-			m_ObjectPool.push(*object);
-		}
+		if (m_IdleObjects.size() < m_MaxIdleCount)
+			m_IdleObjects.push_back(object);
 		else
-		{
-			if (object)
-			{
-				*object->Release();
-				delete *object;
-			}
-		}
-		*object = nullptr;
+			_DestroyObject(object);
+		object = nullptr;
+	}
+
+	uint32_t GetIdleCount() const override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return static_cast<uint32_t>(m_IdleObjects.size());
 	}
+
+private:
+	// Idle objects are inserted with simulation already disabled, so they never enter the broadphase.
+	std::vector<PhysicsPtr<IPhysicsObject>> _CreateObjects(std::span<const MathLib::HTransform3> transforms)
+	{
+		if (m_Scene == nullptr || m_Prefab == nullptr)
+			return {};
+		std::vector<PhysicsPtr<IPhysicsObject>> objects = m_Prefab->Instantiate(transforms, {});
+		for (auto &object : objects)
+			object->SetSimulationEnabled(false);
+		if (m_Scene->AddPhysicsObjects(objects) != objects.size())
+			return {};
+		return objects;
+	}
+
+	void _DestroyObject(PhysicsPtr<IPhysicsObject> &object)
+	{
+		if (m_Scene)
+			m_Scene->RemovePhysicsObject(object);
+		object->Release();
+	}
+
 private:
-	std::mutex m_Mutex;
-	std::queue<PhysicsObject*> m_ObjectPool;
-	uint32_t m_MaxSize;
-};
\ No newline at end of file
+	mutable std::mutex m_Mutex;
+	PhysicsPtr<IPhysicsScene> m_Scene;
+	PhysicsPtr<IPhysicsPrefab> m_Prefab;
+	uint32_t m_MaxIdleCount;
+	std::vector<PhysicsPtr<IPhysicsObject>> m_IdleObjects;
+};
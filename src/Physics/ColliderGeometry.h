@@ -1,209 +1,142 @@
 #pragma once
 #include "Physics/PhysicsCommon.h"
+#include "ConvexMeshLODChain.h"
+#include <algorithm>
 
 namespace physx
 {
 	class PxShape;
 }
 
-class BoxColliderGeometry : public IColliderGeometry
+// Collider geometry backed by a CollisionGeometryParams variant. Per-type behaviour
+// (bounds here, shapes in ShapeFactory) is resolved with std::visit over overloads.
+class ColliderGeometry : public IColliderGeometry
 {
 public:
-	BoxColliderGeometry(const MathLib::HVector3 &halfExtents) : m_HalfExtents(halfExtents)
+	ColliderGeometry(const CollisionGeometryParams &params, const MathLib::HTransform3 &localTransform = MathLib::HTransform3::Identity())
+		: m_Params(params), m_LocalTransform(localTransform)
 	{
-		m_BoundingBox = MathLib::HAABBox3D(-halfExtents, halfExtents);
+		m_Scale = MathLib::HVector3(1, 1, 1);
+		m_BoundingBox = _ComputeBoundingBox();
 	}
 	void Release() override {}
-	CollierGeometryType GetType() const override { return CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX; }
+	CollierGeometryType GetType() const override { return static_cast<CollierGeometryType>(m_Params.index()); }
 	void SetScale(const MathLib::HVector3 &scale) override
 	{
 		m_Scale = scale;
-		const auto halfExtents = MathLib::HadamardProduct<3>(m_HalfExtents, scale);
-		m_BoundingBox = MathLib::HAABBox3D(-halfExtents, halfExtents);
+		m_BoundingBox = _ComputeBoundingBox();
 	}
-	MathLib::HVector3 GetHalfSize() const { return m_HalfExtents; }
+	// Copies handed out by the engine keep the registered geometry they were copied from alive,
+	// so later requests for the same options reuse its cooked meshes.
+	void SetPrototype(const std::shared_ptr<const ColliderGeometry> &prototype) { m_Prototype = prototype; }
 	MathLib::HVector3 GetScale() const { return m_Scale; }
-	void GetParams(CollisionGeometryCreateOptions &options)
-	{
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX;
-		options.m_BoxParams.m_HalfExtents = m_HalfExtents;
+	const MathLib::HTransform3 &GetLocalTransform() const { return m_LocalTransform; }
+	void SetConvexLODs(const std::shared_ptr<const ConvexMeshLODChain> &lods) { m_ConvexLODs = lods; }
+	const std::shared_ptr<const ConvexMeshLODChain> &GetConvexLODs() const { return m_ConvexLODs; }
+	uint32_t GetConvexLODCount() const override { return m_ConvexLODs ? m_ConvexLODs->GetLODCount() : 0; }
+	uint32_t GetConvexLODVertexCount(uint32_t lod) const override { return m_ConvexLODs ? m_ConvexLODs->GetVertexCount(lod) : 0; }
+	const CollisionGeometryParams &GetGeometryParams() const { return m_Params; }
+	template <typename Params>
+	const Params *GetGeometryParams() const { return std::get_if<Params>(&m_Params); }
+	void GetParams(CollisionGeometryCreateOptions &options) override
+	{
+		options.m_Params = m_Params;
 		options.m_Scale = m_Scale;
+		options.m_LocalTransform = m_LocalTransform;
 	}
 	MathLib::HAABBox3D GetBoundingBox() const override { return m_BoundingBox; }
 
-private:
-	MathLib::HVector3 m_HalfExtents;
-	MathLib::HVector3 m_Scale;
-	MathLib::HAABBox3D m_BoundingBox;
-};
-
-class SphereColliderGeometry : public IColliderGeometry
-{
-public:
-	SphereColliderGeometry(MathLib::HReal radius) : m_Radius(radius)
-	{
-		const MathLib::HVector3 extend(radius, radius, radius);
-		m_BoundingBox = MathLib::HAABBox3D(-extend, extend);
-	}
-	void Release() override {}
-	CollierGeometryType GetType() const override { return CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE; }
-	void SetScale(const MathLib::HVector3 &scale) override
-	{
-		m_Scale = scale;
-		const auto halfExtents = m_Scale * m_Radius;
-		m_BoundingBox = MathLib::HAABBox3D(-halfExtents, halfExtents);
-	}
-	MathLib::HReal GetRadius() const { return m_Radius; }
-	MathLib::HVector3 GetScale() const { return m_Scale; }
-	void GetParams(CollisionGeometryCreateOptions &options)
+	static bool IsValid(const CollisionGeometryParams &params)
 	{
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE;
-		options.m_SphereParams.m_Radius = m_Radius;
-		options.m_Scale = m_Scale;
+		return std::visit([](const auto &p)
+						  { return _IsValid(p); },
+						  params);
 	}
-	MathLib::HAABBox3D GetBoundingBox() const override { return m_BoundingBox; }
 
 private:
-	MathLib::HReal m_Radius;
-	MathLib::HVector3 m_Scale;
-	MathLib::HAABBox3D m_BoundingBox;
-};
-
-class PlaneColliderGeometry : public IColliderGeometry
-{
-public:
-	PlaneColliderGeometry(const MathLib::HVector3 &normal, MathLib::HReal distance) : m_Normal(normal), m_Distance(distance)
-	{
-	}
-	void Release() override {}
-	CollierGeometryType GetType() const override { return CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE; }
-	void SetScale(const MathLib::HVector3 &scale) override
+	MathLib::HAABBox3D _ComputeBoundingBox() const
 	{
-		m_Scale = scale;
+		MathLib::HAABBox3D box = std::visit([this](const auto &p)
+											{ return _ComputeBoundingBox(p, m_Scale); },
+											m_Params);
+		if (!box.isEmpty())
+			box.transform(m_LocalTransform);
+		return box;
 	}
-	MathLib::HVector3 GetNormal() const { return m_Normal; }
-	MathLib::HReal GetDistance() const { return m_Distance; }
-	MathLib::HVector3 GetScale() const { return m_Scale; }
-	void GetParams(CollisionGeometryCreateOptions &options)
-	{
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE;
-		options.m_PlaneParams.m_Normal = m_Normal;
-		options.m_PlaneParams.m_Distance = m_Distance;
-		options.m_Scale = m_Scale;
-	}
-	MathLib::HAABBox3D GetBoundingBox() const override { return MathLib::HAABBox3D(); }
 
-private:
-	MathLib::HVector3 m_Normal;
-	MathLib::HReal m_Distance;
-	MathLib::HVector3 m_Scale;
-};
-
-class CapsuleColliderGeometry : public IColliderGeometry
-{
-public:
-	CapsuleColliderGeometry(MathLib::HReal radius, MathLib::HReal halfHeight) : m_Radius(radius), m_HalfHeight(halfHeight)
+	static MathLib::HAABBox3D _ComputeBoundingBox(const SphereGeometryParams &params, const MathLib::HVector3 &scale)
 	{
-		m_BoundingBox = MathLib::HAABBox3D(-MathLib::HVector3(radius, halfHeight, radius), MathLib::HVector3(radius, halfHeight, radius));
+		const MathLib::HVector3 halfExtents = scale * params.m_Radius;
+		return MathLib::HAABBox3D(-halfExtents, halfExtents);
 	}
-	void Release() override {}
-	CollierGeometryType GetType() const override { return CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE; }
-	void SetScale(const MathLib::HVector3 &scale) override
+	static MathLib::HAABBox3D _ComputeBoundingBox(const BoxGeometryParams &params, const MathLib::HVector3 &scale)
 	{
-		m_Scale = scale;
-		const auto halfExtents = MathLib::HadamardProduct<3>(MathLib::HVector3(m_HalfHeight + m_Radius,m_Radius, m_Radius), scale);
-		m_BoundingBox = MathLib::HAABBox3D(-halfExtents, halfExtents);
+		const auto halfExtents = MathLib::HadamardProduct<3>(params.m_HalfExtents, scale);
+		return MathLib::HAABBox3D(-halfExtents, halfExtents);
 	}
-	MathLib::HReal GetRadius() const { return m_Radius; }
-	MathLib::HReal GetHalfHeight() const { return m_HalfHeight; }
-	MathLib::HVector3 GetScale() const { return m_Scale; }
-	void GetParams(CollisionGeometryCreateOptions &options)
+	static MathLib::HAABBox3D _ComputeBoundingBox(const CapsuleGeometryParams &params, const MathLib::HVector3 &scale)
 	{
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE;
-		options.m_CapsuleParams.m_Radius = m_Radius;
-		options.m_CapsuleParams.m_HalfHeight = m_HalfHeight;
-		options.m_Scale = m_Scale;
+		const auto halfExtents = MathLib::HadamardProduct<3>(MathLib::HVector3(params.m_HalfHeight + params.m_Radius, params.m_Radius, params.m_Radius), scale);
+		return MathLib::HAABBox3D(-halfExtents, halfExtents);
 	}
-	MathLib::HAABBox3D GetBoundingBox() const override { return m_BoundingBox; }
-
-private:
-	MathLib::HReal m_Radius;
-	MathLib::HReal m_HalfHeight;
-	MathLib::HVector3 m_Scale;
-	MathLib::HAABBox3D m_BoundingBox;
-};
-
-class TriangleMeshColliderGeometry : public IColliderGeometry
-{
-public:
-	TriangleMeshColliderGeometry(const std::vector<MathLib::HVector3> &vertices, const std::vector<uint32_t> &indices) : m_Vertices(vertices), m_Indices(indices)
+	static MathLib::HAABBox3D _ComputeBoundingBox(const PlaneGeometryParams &, const MathLib::HVector3 &)
 	{
-		for (const auto &v : vertices)
-			m_BoundingBox.extend(v);
-	}
-	void Release() override {}
-	CollierGeometryType GetType() const override { return CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH; }
-	void SetScale(const MathLib::HVector3 &scale) override
-	{
-		m_Scale = scale;
-		m_BoundingBox.setEmpty();
-		for (const auto &v : m_Vertices)
-			m_BoundingBox.extend(MathLib::HadamardProduct<3>(v, scale));
+		return MathLib::HAABBox3D();
 	}
-	const std::vector<MathLib::HVector3> &GetVertices() const { return m_Vertices; }
-	const std::vector<uint32_t> &GetIndices() const { return m_Indices; }
-	MathLib::HVector3 GetScale() const { return m_Scale; }
-	void GetParams(CollisionGeometryCreateOptions &options)
+	static MathLib::HAABBox3D _ComputeBoundingBox(const TriangleMeshGeometryParams &params, const MathLib::HVector3 &scale)
 	{
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH;
-		options.m_TriangleMeshParams.m_Vertices = m_Vertices;
-		options.m_TriangleMeshParams.m_Indices = m_Indices;
-		options.m_Scale = m_Scale;
+		return _ComputeMeshBoundingBox(*params.m_MeshData, scale);
 	}
-	MathLib::HAABBox3D GetBoundingBox() const override { return m_BoundingBox; }
-
-private:
-	std::vector<MathLib::HVector3> m_Vertices;
-	std::vector<uint32_t> m_Indices;
-	MathLib::HVector3 m_Scale;
-	MathLib::HAABBox3D m_BoundingBox;
-};
-
-class ConvexMeshColliderGeometry : public IColliderGeometry
-{
-public:
-	ConvexMeshColliderGeometry(const std::vector<MathLib::HVector3> &vertices, const std::vector<uint32_t> &indices) : m_Vertices(vertices), m_Indices(indices)
+	static MathLib::HAABBox3D _ComputeBoundingBox(const ConvexMeshGeometryParams &params, const MathLib::HVector3 &scale)
 	{
-		for (const auto &v : vertices)
-			m_BoundingBox.extend(v);
+		return _ComputeMeshBoundingBox(*params.m_MeshData, scale);
 	}
-	void Release() override {}
-	CollierGeometryType GetType() const override { return CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH; }
-	void SetScale(const MathLib::HVector3 &scale) override
+	static MathLib::HAABBox3D _ComputeBoundingBox(const HeightFieldGeometryParams &params, const MathLib::HVector3 &scale)
 	{
-		m_Scale = scale;
-		m_BoundingBox.setEmpty();
-		for (const auto &v : m_Vertices)
-			m_BoundingBox.extend(MathLib::HadamardProduct<3>(v, scale));
+		const PhysicsHeightFieldData &heightField = *params.m_HeightFieldData;
+		const auto minmax = std::minmax_element(heightField.m_Heights.begin(), heightField.m_Heights.end());
+		const MathLib::HVector3 min(0, MathLib::HReal(*minmax.first) * params.m_HeightScale, 0);
+		const MathLib::HVector3 max(MathLib::HReal(heightField.m_NumRows - 1) * params.m_RowScale,
+									MathLib::HReal(*minmax.second) * params.m_HeightScale,
+									MathLib::HReal(heightField.m_NumColumns - 1) * params.m_ColumnScale);
+		return MathLib::HAABBox3D(MathLib::HadamardProduct<3>(min, scale), MathLib::HadamardProduct<3>(max, scale));
 	}
-	const std::vector<MathLib::HVector3> &GetVertices() const { return m_Vertices; }
-	const std::vector<uint32_t> &GetIndices() const { return m_Indices; }
-	MathLib::HVector3 GetScale() const { return m_Scale; }
-	void GetParams(CollisionGeometryCreateOptions &options)
+	static MathLib::HAABBox3D _ComputeMeshBoundingBox(const PhysicsMeshData &meshData, const MathLib::HVector3 &scale)
 	{
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH;
-		options.m_ConvexMeshParams.m_Vertices = m_Vertices;
-		options.m_ConvexMeshParams.m_Indices = m_Indices;
-		options.m_Scale = m_Scale;
+		MathLib::HAABBox3D box;
+		box.setEmpty();
+		for (const auto &v : meshData.m_Vertices)
+			box.extend(MathLib::HadamardProduct<3>(v, scale));
+		return box;
 	}
-	MathLib::HAABBox3D GetBoundingBox() const override
-	{
-		return m_BoundingBox;
+
+	template <typename Params>
+	static bool _IsValid(const Params &) { return true; }
+	static bool _IsValid(const TriangleMeshGeometryParams &params) { return params.m_MeshData != nullptr; }
+	static bool _IsValid(const ConvexMeshGeometryParams &params) { return params.m_MeshData != nullptr; }
+	static bool _IsValid(const HeightFieldGeometryParams &params)
+	{
+		const PhysicsHeightFieldData *heightField = params.m_HeightFieldData.get();
+		if (heightField == nullptr || heightField->m_NumRows < 2 || heightField->m_NumColumns < 2)
+			return false;
+		const size_t numSamples = size_t(heightField->m_NumRows) * heightField->m_NumColumns;
+		if (heightField->m_Heights.size() != numSamples || (!heightField->m_MaterialIndices.empty() && heightField->m_MaterialIndices.size() != numSamples))
+			return false;
+		// PhysX keeps 7 bits per sample material, and without m_Materials the shape only has the object's material.
+		const size_t numMaterials = std::max<size_t>(params.m_Materials.size(), 1);
+		for (uint8_t materialIndex : heightField->m_MaterialIndices)
+		{
+			if (materialIndex != PhysicsHeightFieldData::HoleMaterialIndex && (materialIndex >= numMaterials || materialIndex > PhysicsHeightFieldData::HoleMaterialIndex))
+				return false;
+		}
+		return true;
 	}
 
 private:
-	std::vector<MathLib::HVector3> m_Vertices;
-	std::vector<uint32_t> m_Indices;
+	CollisionGeometryParams m_Params;
+	MathLib::HTransform3 m_LocalTransform;
 	MathLib::HVector3 m_Scale;
+	std::shared_ptr<const ConvexMeshLODChain> m_ConvexLODs;
 	MathLib::HAABBox3D m_BoundingBox;
-};
\ No newline at end of file
+	std::shared_ptr<const ColliderGeometry> m_Prototype;
+};
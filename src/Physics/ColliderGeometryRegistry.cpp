@@ -0,0 +1,214 @@
+#include "ColliderGeometryRegistry.h"
+#include "ColliderGeometry.h"
+#include <string_view>
+
+namespace
+{
+    void HashCombine(size_t &seed, size_t value)
+    {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    // -0 and 0 compare equal, so they have to hash alike.
+    size_t HashReal(MathLib::HReal value)
+    {
+        return std::hash<MathLib::HReal>()(value == MathLib::HReal(0) ? MathLib::HReal(0) : value);
+    }
+
+    size_t HashReals(const MathLib::HReal *values, size_t count)
+    {
+        size_t seed = 0;
+        for (size_t i = 0; i < count; i++)
+            HashCombine(seed, HashReal(values[i]));
+        return seed;
+    }
+
+    template <typename T>
+    size_t HashBytes(const std::vector<T> &values)
+    {
+        return std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T)));
+    }
+}
+
+std::shared_ptr<const ColliderGeometry> ColliderGeometryRegistry::Find(const CollisionGeometryCreateOptions &options)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return _Find(_Hash(options), options);
+}
+
+std::shared_ptr<const ColliderGeometry> ColliderGeometryRegistry::Register(const CollisionGeometryCreateOptions &options, const std::shared_ptr<const ColliderGeometry> &geometry)
+{
+    if (geometry == nullptr)
+        return nullptr;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const size_t hash = _Hash(options);
+    if (std::shared_ptr<const ColliderGeometry> registered = _Find(hash, options))
+        return registered;
+    m_Geometries.emplace(hash, RegisteredGeometry{options, geometry});
+    if (m_Geometries.size() + m_MeshHashes.size() >= m_PruneThreshold)
+        _PruneExpired();
+    return geometry;
+}
+
+void ColliderGeometryRegistry::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Geometries.clear();
+    m_MeshHashes.clear();
+    m_PruneThreshold = MinPruneThreshold;
+}
+
+std::shared_ptr<const ColliderGeometry> ColliderGeometryRegistry::_Find(size_t hash, const CollisionGeometryCreateOptions &options)
+{
+    auto range = m_Geometries.equal_range(hash);
+    for (auto it = range.first; it != range.second;)
+    {
+        std::shared_ptr<const ColliderGeometry> geometry = it->second.m_Geometry.lock();
+        if (geometry == nullptr)
+        {
+            it = m_Geometries.erase(it);
+            continue;
+        }
+        if (_Equal(it->second.m_Options, options))
+            return geometry;
+        ++it;
+    }
+    return nullptr;
+}
+
+// Sweeps both maps, so that the stored options stop pinning the meshes of released geometries.
+void ColliderGeometryRegistry::_PruneExpired()
+{
+    std::erase_if(m_Geometries, [](const auto &entry)
+                  { return entry.second.m_Geometry.expired(); });
+    std::erase_if(m_MeshHashes, [](const auto &entry)
+                  { return entry.second.first.expired(); });
+    m_PruneThreshold = std::max(MinPruneThreshold, 2 * (m_Geometries.size() + m_MeshHashes.size()));
+}
+
+size_t ColliderGeometryRegistry::_Hash(const CollisionGeometryCreateOptions &options)
+{
+    size_t seed = std::visit([this](const auto &params)
+                             { return _HashParams(params); },
+                             options.m_Params);
+    HashCombine(seed, options.m_Params.index());
+    HashCombine(seed, HashReals(options.m_Scale.data(), 3));
+    HashCombine(seed, HashReals(options.m_LocalTransform.data(), 16));
+    HashCombine(seed, options.m_bFitPrimitive);
+    HashCombine(seed, HashReal(options.m_PrimitiveFitTolerance));
+    return seed;
+}
+
+size_t ColliderGeometryRegistry::_HashParams(const SphereGeometryParams &params)
+{
+    return HashReal(params.m_Radius);
+}
+
+size_t ColliderGeometryRegistry::_HashParams(const BoxGeometryParams &params)
+{
+    return HashReals(params.m_HalfExtents.data(), 3);
+}
+
+size_t ColliderGeometryRegistry::_HashParams(const CapsuleGeometryParams &params)
+{
+    const MathLib::HReal values[] = {params.m_Radius, params.m_HalfHeight};
+    return HashReals(values, 2);
+}
+
+size_t ColliderGeometryRegistry::_HashParams(const PlaneGeometryParams &params)
+{
+    const MathLib::HReal values[] = {params.m_Normal[0], params.m_Normal[1], params.m_Normal[2], params.m_Distance};
+    return HashReals(values, 4);
+}
+
+size_t ColliderGeometryRegistry::_HashParams(const TriangleMeshGeometryParams &params)
+{
+    return _HashMesh(params.m_MeshData);
+}
+
+size_t ColliderGeometryRegistry::_HashParams(const ConvexMeshGeometryParams &params)
+{
+    size_t seed = _HashMesh(params.m_MeshData);
+    for (uint32_t limit : params.m_LODVertexLimits)
+        HashCombine(seed, limit);
+    return seed;
+}
+
+size_t ColliderGeometryRegistry::_HashParams(const HeightFieldGeometryParams &params)
+{
+    // Heightfield samples are large and rarely duplicated, so the data is identified by its buffer.
+    size_t seed = std::hash<const PhysicsHeightFieldData *>()(params.m_HeightFieldData.get());
+    const MathLib::HReal values[] = {params.m_HeightScale, params.m_RowScale, params.m_ColumnScale};
+    HashCombine(seed, HashReals(values, 3));
+    for (const auto &material : params.m_Materials)
+        HashCombine(seed, std::hash<const IPhysicsMaterial *>()(material.get()));
+    return seed;
+}
+
+size_t ColliderGeometryRegistry::_HashMesh(const PhysicsMeshDataPtr &meshData)
+{
+    if (meshData == nullptr)
+        return 0;
+    auto it = m_MeshHashes.find(meshData.get());
+    if (it != m_MeshHashes.end() && !it->second.first.expired())
+        return it->second.second;
+    size_t seed = HashBytes(meshData->m_Vertices);
+    HashCombine(seed, HashBytes(meshData->m_Indices));
+    m_MeshHashes[meshData.get()] = std::make_pair(std::weak_ptr<const PhysicsMeshData>(meshData), seed);
+    return seed;
+}
+
+bool ColliderGeometryRegistry::_Equal(const CollisionGeometryCreateOptions &lhs, const CollisionGeometryCreateOptions &rhs)
+{
+    if (lhs.m_Params.index() != rhs.m_Params.index() || lhs.m_Scale != rhs.m_Scale || lhs.m_LocalTransform.matrix() != rhs.m_LocalTransform.matrix() ||
+        lhs.m_bFitPrimitive != rhs.m_bFitPrimitive || lhs.m_PrimitiveFitTolerance != rhs.m_PrimitiveFitTolerance)
+        return false;
+    return std::visit([&rhs](const auto &params)
+                      { return _EqualParams(params, std::get<std::decay_t<decltype(params)>>(rhs.m_Params)); },
+                      lhs.m_Params);
+}
+
+bool ColliderGeometryRegistry::_EqualParams(const SphereGeometryParams &lhs, const SphereGeometryParams &rhs)
+{
+    return lhs.m_Radius == rhs.m_Radius;
+}
+
+bool ColliderGeometryRegistry::_EqualParams(const BoxGeometryParams &lhs, const BoxGeometryParams &rhs)
+{
+    return lhs.m_HalfExtents == rhs.m_HalfExtents;
+}
+
+bool ColliderGeometryRegistry::_EqualParams(const CapsuleGeometryParams &lhs, const CapsuleGeometryParams &rhs)
+{
+    return lhs.m_Radius == rhs.m_Radius && lhs.m_HalfHeight == rhs.m_HalfHeight;
+}
+
+bool ColliderGeometryRegistry::_EqualParams(const PlaneGeometryParams &lhs, const PlaneGeometryParams &rhs)
+{
+    return lhs.m_Normal == rhs.m_Normal && lhs.m_Distance == rhs.m_Distance;
+}
+
+bool ColliderGeometryRegistry::_EqualParams(const TriangleMeshGeometryParams &lhs, const TriangleMeshGeometryParams &rhs)
+{
+    return _EqualMesh(lhs.m_MeshData, rhs.m_MeshData);
+}
+
+bool ColliderGeometryRegistry::_EqualParams(const ConvexMeshGeometryParams &lhs, const ConvexMeshGeometryParams &rhs)
+{
+    return lhs.m_LODVertexLimits == rhs.m_LODVertexLimits && _EqualMesh(lhs.m_MeshData, rhs.m_MeshData);
+}
+
+bool ColliderGeometryRegistry::_EqualParams(const HeightFieldGeometryParams &lhs, const HeightFieldGeometryParams &rhs)
+{
+    return lhs.m_HeightFieldData == rhs.m_HeightFieldData && lhs.m_HeightScale == rhs.m_HeightScale && lhs.m_RowScale == rhs.m_RowScale &&
+           lhs.m_ColumnScale == rhs.m_ColumnScale && lhs.m_Materials == rhs.m_Materials;
+}
+
+bool ColliderGeometryRegistry::_EqualMesh(const PhysicsMeshDataPtr &lhs, const PhysicsMeshDataPtr &rhs)
+{
+    if (lhs == rhs)
+        return true;
+    if (lhs == nullptr || rhs == nullptr)
+        return false;
+    return lhs->m_Vertices == rhs->m_Vertices && lhs->m_Indices == rhs->m_Indices;
+}
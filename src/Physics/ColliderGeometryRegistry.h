@@ -0,0 +1,66 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+#include <algorithm>
+#include <mutex>
+
+class ColliderGeometry;
+
+// Content-hashed registry of collider geometries. Identical create options find the same immutable
+// prototype, whose cooked meshes the engine's per-caller copies share. Primitives hash their few
+// floats, mesh content hashes are computed once per mesh buffer. Prototypes and meshes are only
+// referenced weakly, expired entries are pruned on lookup and whenever the registry has doubled
+// since the last sweep. All methods are thread-safe.
+class ColliderGeometryRegistry
+{
+public:
+	ColliderGeometryRegistry() = default;
+
+	std::shared_ptr<const ColliderGeometry> Find(const CollisionGeometryCreateOptions &options);
+	// Returns the geometry already registered for the options if another caller got there first.
+	std::shared_ptr<const ColliderGeometry> Register(const CollisionGeometryCreateOptions &options, const std::shared_ptr<const ColliderGeometry> &geometry);
+	// Prototypes that still have users.
+	uint32_t GetGeometryCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return static_cast<uint32_t>(std::count_if(m_Geometries.begin(), m_Geometries.end(), [](const auto &entry)
+												   { return !entry.second.m_Geometry.expired(); }));
+	}
+	void Clear();
+
+private:
+	std::shared_ptr<const ColliderGeometry> _Find(size_t hash, const CollisionGeometryCreateOptions &options);
+	void _PruneExpired();
+	size_t _Hash(const CollisionGeometryCreateOptions &options);
+	size_t _HashParams(const SphereGeometryParams &params);
+	size_t _HashParams(const BoxGeometryParams &params);
+	size_t _HashParams(const CapsuleGeometryParams &params);
+	size_t _HashParams(const PlaneGeometryParams &params);
+	size_t _HashParams(const TriangleMeshGeometryParams &params);
+	size_t _HashParams(const ConvexMeshGeometryParams &params);
+	size_t _HashParams(const HeightFieldGeometryParams &params);
+	size_t _HashMesh(const PhysicsMeshDataPtr &meshData);
+
+	static bool _Equal(const CollisionGeometryCreateOptions &lhs, const CollisionGeometryCreateOptions &rhs);
+	static bool _EqualParams(const SphereGeometryParams &lhs, const SphereGeometryParams &rhs);
+	static bool _EqualParams(const BoxGeometryParams &lhs, const BoxGeometryParams &rhs);
+	static bool _EqualParams(const CapsuleGeometryParams &lhs, const CapsuleGeometryParams &rhs);
+	static bool _EqualParams(const PlaneGeometryParams &lhs, const PlaneGeometryParams &rhs);
+	static bool _EqualParams(const TriangleMeshGeometryParams &lhs, const TriangleMeshGeometryParams &rhs);
+	static bool _EqualParams(const ConvexMeshGeometryParams &lhs, const ConvexMeshGeometryParams &rhs);
+	static bool _EqualParams(const HeightFieldGeometryParams &lhs, const HeightFieldGeometryParams &rhs);
+	static bool _EqualMesh(const PhysicsMeshDataPtr &lhs, const PhysicsMeshDataPtr &rhs);
+
+private:
+	struct RegisteredGeometry
+	{
+		CollisionGeometryCreateOptions m_Options;
+		std::weak_ptr<const ColliderGeometry> m_Geometry;
+	};
+	std::unordered_multimap<size_t, RegisteredGeometry> m_Geometries;
+	// Keyed by buffer address. Once the buffer expired the address may belong to another mesh, so
+	// an expired entry is hashed again.
+	std::unordered_map<const PhysicsMeshData *, std::pair<std::weak_ptr<const PhysicsMeshData>, size_t>> m_MeshHashes;
+	size_t m_PruneThreshold = MinPruneThreshold;
+	static constexpr size_t MinPruneThreshold = 64;
+	mutable std::mutex m_Mutex;
+};
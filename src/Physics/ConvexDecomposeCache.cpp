@@ -0,0 +1,297 @@
+#include "ConvexDecomposeCache.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t CacheMagic = 0x48434856; // "VHCH"
+    // Bumped whenever the decomposition output changes for the same key, so stale hulls read as misses.
+    // 2: plane-order merge, slab voxelization and the merge heap.
+    constexpr uint32_t CacheVersion = 2;
+
+    static_assert(sizeof(ConvexDecomposeCache::Key) == 96, "Cache keys are written verbatim and must not contain padding");
+
+    struct EntryHeader
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        ConvexDecomposeCache::Key m_Key;
+        uint32_t m_NumHulls;
+        uint32_t m_Reserved;
+    };
+
+    struct HullHeader
+    {
+        uint32_t m_NumPoints;
+        uint32_t m_NumTriangles;
+        double m_Volume;
+        double m_Center[3];
+    };
+
+    // Two independent 64-bit lanes over 8-byte words, an FNV-style and a multiply-xorshift mix; the
+    // on-disk key has to be stable across runs and builds, which std::hash does not promise.
+    struct Hasher
+    {
+        uint64_t m_Fnv = 0xcbf29ce484222325ull;
+        uint64_t m_Mix = 0x9e3779b97f4a7c15ull;
+
+        void Add(const void *data, size_t size)
+        {
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            for (; size >= sizeof(uint64_t); bytes += sizeof(uint64_t), size -= sizeof(uint64_t))
+            {
+                uint64_t word;
+                memcpy(&word, bytes, sizeof(word));
+                _AddWord(word);
+            }
+            if (size > 0)
+            {
+                uint64_t word = size;
+                memcpy(&word, bytes, size);
+                _AddWord(word);
+            }
+        }
+
+        void _AddWord(uint64_t word)
+        {
+            m_Fnv = (m_Fnv ^ word) * 0x100000001b3ull;
+            m_Mix = (m_Mix ^ word) * 0xff51afd7ed558ccdull;
+            m_Mix ^= m_Mix >> 29;
+        }
+    };
+
+    // Read-only view of a whole file, unmapped on destruction.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::filesystem::path &path)
+        {
+#ifdef _WIN32
+            m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_File == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+                return;
+            m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_Mapping == nullptr)
+                return;
+            m_Data = static_cast<const uint8_t *>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+            if (m_Data)
+                m_Size = size_t(size.QuadPart);
+#else
+            m_File = open(path.c_str(), O_RDONLY);
+            if (m_File < 0)
+                return;
+            struct stat status;
+            if (fstat(m_File, &status) != 0 || status.st_size == 0)
+                return;
+            void *data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, m_File, 0);
+            if (data == MAP_FAILED)
+                return;
+            m_Data = static_cast<const uint8_t *>(data);
+            m_Size = size_t(status.st_size);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (m_Data)
+                UnmapViewOfFile(m_Data);
+            if (m_Mapping)
+                CloseHandle(m_Mapping);
+            if (m_File != INVALID_HANDLE_VALUE)
+                CloseHandle(m_File);
+#else
+            if (m_Data)
+                munmap(const_cast<uint8_t *>(m_Data), m_Size);
+            if (m_File >= 0)
+                close(m_File);
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const uint8_t *GetData() const { return m_Data; }
+        size_t GetSize() const { return m_Size; }
+
+    private:
+#ifdef _WIN32
+        HANDLE m_File = INVALID_HANDLE_VALUE;
+        HANDLE m_Mapping = nullptr;
+#else
+        int m_File = -1;
+#endif
+        const uint8_t *m_Data = nullptr;
+        size_t m_Size = 0;
+    };
+
+    // Bounds-checked reads out of a mapped entry.
+    struct EntryReader
+    {
+        const uint8_t *m_Data;
+        size_t m_Size;
+        size_t m_Offset = 0;
+
+        size_t GetRemaining() const { return m_Size - m_Offset; }
+
+        bool Read(void *out, size_t size)
+        {
+            if (GetRemaining() < size)
+                return false;
+            memcpy(out, m_Data + m_Offset, size);
+            m_Offset += size;
+            return true;
+        }
+    };
+}
+
+ConvexDecomposeCache::ConvexDecomposeCache(const std::filesystem::path &directory)
+    : m_Directory(directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+}
+
+ConvexDecomposeCache::Key ConvexDecomposeCache::MakeKey(std::span<const float> vertices, std::span<const uint32_t> indices, const VHACD::IVHACD::Parameters &params)
+{
+    Key key;
+    memset(&key, 0, sizeof(key));
+    key.m_NumVertices = static_cast<uint32_t>(vertices.size() / 3);
+    key.m_NumIndices = static_cast<uint32_t>(indices.size());
+    key.m_Concavity = params.m_concavity;
+    key.m_Alpha = params.m_alpha;
+    key.m_Beta = params.m_beta;
+    key.m_MinVolumePerCH = params.m_minVolumePerCH;
+    key.m_Resolution = params.m_resolution;
+    key.m_MaxNumVerticesPerCH = params.m_maxNumVerticesPerCH;
+    key.m_PlaneDownsampling = params.m_planeDownsampling;
+    key.m_ConvexhullDownsampling = params.m_convexhullDownsampling;
+    key.m_PCA = params.m_pca;
+    key.m_Mode = params.m_mode;
+    key.m_ConvexhullApproximation = params.m_convexhullApproximation;
+    key.m_MaxConvexHulls = params.m_maxConvexHulls;
+    key.m_ProjectHullVertices = params.m_projectHullVertices;
+
+    Hasher hasher;
+    hasher.Add(vertices.data(), vertices.size_bytes());
+    hasher.Add(indices.data(), indices.size_bytes());
+    hasher.Add(&key, sizeof(key));
+    key.m_Hash[0] = hasher.m_Fnv;
+    key.m_Hash[1] = hasher.m_Mix;
+    return key;
+}
+
+bool ConvexDecomposeCache::Load(const Key &key, std::vector<PhysicsMeshData> &convexMeshesData) const
+{
+    const MappedFile file(_GetPath(key));
+    if (file.GetData() == nullptr)
+        return false;
+
+    EntryReader reader{file.GetData(), file.GetSize()};
+    EntryHeader header;
+    if (!reader.Read(&header, sizeof(header)) || header.m_Magic != CacheMagic || header.m_Version != CacheVersion ||
+        memcmp(&header.m_Key, &key, sizeof(key)) != 0 || header.m_NumHulls > reader.GetRemaining() / sizeof(HullHeader))
+        return false;
+
+    std::vector<PhysicsMeshData> hulls(header.m_NumHulls);
+    std::vector<float> points;
+    for (PhysicsMeshData &hull : hulls)
+    {
+        HullHeader hullHeader;
+        // Sizes are checked before anything is allocated and indices before the hull is used, a damaged
+        // entry is just a miss.
+        if (!reader.Read(&hullHeader, sizeof(hullHeader)) ||
+            (uint64_t(hullHeader.m_NumPoints) * 3 * sizeof(float) + uint64_t(hullHeader.m_NumTriangles) * 3 * sizeof(uint32_t)) > reader.GetRemaining())
+            return false;
+        points.resize(size_t(hullHeader.m_NumPoints) * 3);
+        hull.m_Indices.resize(size_t(hullHeader.m_NumTriangles) * 3);
+        if (!reader.Read(points.data(), points.size() * sizeof(float)) ||
+            !reader.Read(hull.m_Indices.data(), hull.m_Indices.size() * sizeof(uint32_t)))
+            return false;
+        for (uint32_t index : hull.m_Indices)
+        {
+            if (index >= hullHeader.m_NumPoints)
+                return false;
+        }
+        hull.m_Vertices.resize(hullHeader.m_NumPoints);
+        for (size_t i = 0; i < hull.m_Vertices.size(); i++)
+            hull.m_Vertices[i] = MathLib::HVector3(points[i * 3], points[i * 3 + 1], points[i * 3 + 2]);
+    }
+    convexMeshesData = std::move(hulls);
+    return true;
+}
+
+bool ConvexDecomposeCache::Store(const Key &key, const VHACD::IVHACD *vhacd) const
+{
+    EntryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_Magic = CacheMagic;
+    header.m_Version = CacheVersion;
+    header.m_Key = key;
+    header.m_NumHulls = vhacd->GetNConvexHulls();
+
+    // Unique per process and call, the rename below publishes the finished entry.
+    static std::atomic<uint32_t> counter = 0;
+    const std::filesystem::path path = _GetPath(key);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp" + std::to_string(counter++) + "_" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        if (!stream)
+            return false;
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        std::vector<float> points;
+        for (uint32_t i = 0; i < header.m_NumHulls; i++)
+        {
+            VHACD::IVHACD::ConvexHull ch;
+            vhacd->GetConvexHull(i, ch);
+            const HullHeader hullHeader = {ch.m_nPoints, ch.m_nTriangles, ch.m_volume, {ch.m_center[0], ch.m_center[1], ch.m_center[2]}};
+            points.assign(ch.m_points, ch.m_points + size_t(ch.m_nPoints) * 3);
+            stream.write(reinterpret_cast<const char *>(&hullHeader), sizeof(hullHeader));
+            stream.write(reinterpret_cast<const char *>(points.data()), points.size() * sizeof(float));
+            stream.write(reinterpret_cast<const char *>(ch.m_triangles), size_t(ch.m_nTriangles) * 3 * sizeof(uint32_t));
+        }
+        if (!stream)
+        {
+            stream.close();
+            std::error_code error;
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    // Another process may have published the same entry meanwhile; the rename replaces it, either copy is valid.
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+std::filesystem::path ConvexDecomposeCache::_GetPath(const Key &key) const
+{
+    char name[40];
+    snprintf(name, sizeof(name), "%016llx%016llx.hull", static_cast<unsigned long long>(key.m_Hash[0]), static_cast<unsigned long long>(key.m_Hash[1]));
+    return m_Directory / name;
+}
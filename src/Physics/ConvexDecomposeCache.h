@@ -0,0 +1,53 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+#include "VHACD/VHACD.h"
+#include <filesystem>
+
+// Content-addressed store of V-HACD results on disk, one file per key in the cache directory,
+// named after the key hash. The key covers the normalized input mesh and every parameter that
+// shapes the hulls, and the hulls are stored in that normalized space; copies of a mesh that only
+// differ by a placement normalizing to the same bits share an entry. Entries are memory-mapped for lookup and written through a temporary
+// file, so concurrent readers never see a partial entry. All methods are thread-safe.
+class ConvexDecomposeCache
+{
+public:
+	// Written verbatim at the start of every entry and compared on lookup, which guards against
+	// hash collisions and stale files; laid out without padding.
+	struct Key
+	{
+		uint64_t m_Hash[2];
+		uint32_t m_NumVertices;
+		uint32_t m_NumIndices;
+		double m_Concavity;
+		double m_Alpha;
+		double m_Beta;
+		double m_MinVolumePerCH;
+		uint32_t m_Resolution;
+		uint32_t m_MaxNumVerticesPerCH;
+		uint32_t m_PlaneDownsampling;
+		uint32_t m_ConvexhullDownsampling;
+		uint32_t m_PCA;
+		uint32_t m_Mode;
+		uint32_t m_ConvexhullApproximation;
+		uint32_t m_MaxConvexHulls;
+		uint32_t m_ProjectHullVertices;
+		uint32_t m_Reserved;
+	};
+
+	explicit ConvexDecomposeCache(const std::filesystem::path &directory);
+
+	const std::filesystem::path &GetDirectory() const { return m_Directory; }
+
+	// OpenCL acceleration is left out of the key, it only speeds up the volume sums.
+	static Key MakeKey(std::span<const float> vertices, std::span<const uint32_t> indices, const VHACD::IVHACD::Parameters &params);
+	// Hulls in the normalized space; false on a miss or an entry that does not parse.
+	bool Load(const Key &key, std::vector<PhysicsMeshData> &convexMeshesData) const;
+	// Stores the hulls of a finished Compute on the instance.
+	bool Store(const Key &key, const VHACD::IVHACD *vhacd) const;
+
+private:
+	std::filesystem::path _GetPath(const Key &key) const;
+
+private:
+	std::filesystem::path m_Directory;
+};
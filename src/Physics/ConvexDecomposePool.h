@@ -0,0 +1,243 @@
+#pragma once
+#include "VHACD/VHACD.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each owning one IVHACD that is cleaned and reused across jobs.
+// Every job books threads out of the pool's budget before it starts: small decompositions book
+// one and run side by side, large ones book more and their clipping-plane searches are spread over
+// the idle workers through the job's task scheduler. Jobs start in submission order, so a large
+// job is never starved.
+class ConvexDecomposePool
+{
+public:
+	struct Job
+	{
+		uint32_t m_NumThreads = 1;
+		// OpenCL device the job wants its instance initialized for, null to run on the CPU only.
+		void *m_OCLDevice = nullptr;
+		// Gets the worker's instance, whether OpenCL is ready on it and a scheduler limited to the
+		// booked threads; must leave the instance cleaned.
+		std::function<void(VHACD::IVHACD *vhacd, bool bOCLReady, VHACD::IVHACD::ITaskScheduler *scheduler)> m_Run;
+	};
+
+	explicit ConvexDecomposePool(uint32_t numThreads = std::thread::hardware_concurrency())
+	{
+		m_NumThreads = std::max(numThreads, 1u);
+		m_NumFreeThreads = m_NumThreads;
+		m_Workers.reserve(m_NumThreads);
+		for (uint32_t i = 0; i < m_NumThreads; i++)
+			m_Workers.emplace_back(&ConvexDecomposePool::_WorkerMain, this);
+	}
+
+	// Queued jobs still run, their owners wait on them; cancel them first for a quick shutdown.
+	~ConvexDecomposePool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_bStopping = true;
+		}
+		m_Condition.notify_all();
+		for (auto &worker : m_Workers)
+			worker.join();
+	}
+
+	uint32_t GetNumThreads() const { return m_NumThreads; }
+
+	void Submit(Job &&job)
+	{
+		job.m_NumThreads = std::clamp(job.m_NumThreads, 1u, m_NumThreads);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Jobs.push_back(std::move(job));
+		}
+		m_Condition.notify_all();
+	}
+
+	// Runs the job and waits for it. Called from one of this pool's threads, or while every thread is
+	// booked or jobs are queued, it runs on the caller instead, on a CPU-only instance of its own and
+	// without helpers: a worker waiting on the pool could wait forever, and the caller would otherwise
+	// queue behind the jobs holding the pool.
+	void Run(Job &&job)
+	{
+		job.m_NumThreads = std::clamp(job.m_NumThreads, 1u, m_NumThreads);
+		bool bInline = IsWorkerThread();
+		if (!bInline)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			bInline = m_NumFreeThreads == 0 || !m_Jobs.empty();
+		}
+		if (bInline)
+		{
+			VHACD::IVHACD *vhacd = VHACD::CreateVHACD();
+			JobScheduler scheduler(this, 1);
+			job.m_Run(vhacd, false, &scheduler);
+			vhacd->Release();
+			return;
+		}
+
+		std::promise<void> done;
+		auto run = std::move(job.m_Run);
+		job.m_Run = [&run, &done](VHACD::IVHACD *vhacd, bool bOCLReady, VHACD::IVHACD::ITaskScheduler *scheduler)
+		{
+			run(vhacd, bOCLReady, scheduler);
+			done.set_value();
+		};
+		Submit(std::move(job));
+		done.get_future().wait();
+	}
+
+	bool IsWorkerThread() const { return s_WorkerPool == this; }
+
+private:
+	// Tasks of one ParallelFor call, run by its caller and the helpers that joined it.
+	struct ParallelForBatch
+	{
+		void (*m_Task)(void *userData, uint32_t taskIndex, uint32_t workerIndex);
+		void *m_UserData;
+		uint32_t m_NumTasks;
+		uint32_t m_NumWorkers;
+		std::atomic<uint32_t> m_NextTask = 0;
+		// Guarded by the pool mutex.
+		uint32_t m_NextWorkerIndex = 1;
+		uint32_t m_NumActiveHelpers = 0;
+
+		void Run(uint32_t workerIndex)
+		{
+			for (uint32_t i = m_NextTask++; i < m_NumTasks; i = m_NextTask++)
+				m_Task(m_UserData, i, workerIndex);
+		}
+	};
+
+	// Handed to the jobs; the helpers are threads the job booked, which sit idle in the pool meanwhile.
+	class JobScheduler : public VHACD::IVHACD::ITaskScheduler
+	{
+	public:
+		JobScheduler(ConvexDecomposePool *pool, uint32_t numWorkers)
+			: m_Pool(pool), m_NumWorkers(numWorkers)
+		{
+		}
+
+		uint32_t GetNumWorkers() const override { return m_NumWorkers; }
+
+		void ParallelFor(const uint32_t numTasks, const uint32_t maxNumWorkers, void (*task)(void *userData, uint32_t taskIndex, uint32_t workerIndex), void *userData) override
+		{
+			ParallelForBatch batch;
+			batch.m_Task = task;
+			batch.m_UserData = userData;
+			batch.m_NumTasks = numTasks;
+			batch.m_NumWorkers = std::min({maxNumWorkers, m_NumWorkers, numTasks});
+			if (batch.m_NumWorkers <= 1)
+			{
+				batch.Run(0);
+				return;
+			}
+			m_Pool->_RunParallelFor(batch);
+		}
+
+	private:
+		ConvexDecomposePool *m_Pool;
+		uint32_t m_NumWorkers;
+	};
+
+	void _RunParallelFor(ParallelForBatch &batch)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Batches.push_back(&batch);
+		}
+		m_Condition.notify_all();
+		batch.Run(0);
+
+		// Helpers that did not join yet are not needed any more, the ones running finish their task.
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		auto it = std::find(m_Batches.begin(), m_Batches.end(), &batch);
+		if (it != m_Batches.end())
+			m_Batches.erase(it);
+		m_Condition.wait(lock, [&batch]
+						 { return batch.m_NumActiveHelpers == 0; });
+	}
+
+	// Called with the lock held, returns with it held.
+	void _HelpParallelFor(std::unique_lock<std::mutex> &lock)
+	{
+		ParallelForBatch *batch = m_Batches.front();
+		const uint32_t workerIndex = batch->m_NextWorkerIndex++;
+		if (batch->m_NextWorkerIndex == batch->m_NumWorkers)
+			m_Batches.pop_front();
+		batch->m_NumActiveHelpers++;
+		lock.unlock();
+		batch->Run(workerIndex);
+		lock.lock();
+		if (--batch->m_NumActiveHelpers == 0)
+			m_Condition.notify_all();
+	}
+
+	void _WorkerMain()
+	{
+		s_WorkerPool = this;
+		VHACD::IVHACD *vhacd = nullptr;
+		void *oclDevice = nullptr;
+		bool bOCLReady = false;
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (true)
+		{
+			m_Condition.wait(lock, [this]
+							 { return !m_Batches.empty() || (m_bStopping && m_Jobs.empty()) || (!m_Jobs.empty() && m_Jobs.front().m_NumThreads <= m_NumFreeThreads); });
+			if (!m_Batches.empty())
+			{
+				_HelpParallelFor(lock);
+				continue;
+			}
+			if (m_Jobs.empty())
+				break;
+			Job job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+			m_NumFreeThreads -= job.m_NumThreads;
+			lock.unlock();
+
+			if (vhacd == nullptr)
+				vhacd = VHACD::CreateVHACD();
+			if (job.m_OCLDevice != oclDevice)
+			{
+				if (bOCLReady)
+					vhacd->OCLRelease();
+				oclDevice = job.m_OCLDevice;
+				bOCLReady = oclDevice && vhacd->OCLInit(oclDevice);
+			}
+			JobScheduler scheduler(this, job.m_NumThreads);
+			job.m_Run(vhacd, bOCLReady, &scheduler);
+
+			lock.lock();
+			m_NumFreeThreads += job.m_NumThreads;
+			m_Condition.notify_all();
+		}
+		lock.unlock();
+
+		if (vhacd)
+		{
+			if (bOCLReady)
+				vhacd->OCLRelease();
+			vhacd->Release();
+		}
+	}
+
+private:
+	uint32_t m_NumThreads;
+	uint32_t m_NumFreeThreads;
+	bool m_bStopping = false;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::deque<Job> m_Jobs;
+	std::deque<ParallelForBatch *> m_Batches;
+	std::vector<std::thread> m_Workers;
+	// Pool the current thread works for, if any.
+	static inline thread_local const ConvexDecomposePool *s_WorkerPool = nullptr;
+};
@@ -2,28 +2,245 @@
 #include "Physics/PhysicsCommon.h"
 #include "VHACD/VHACD.h"
 #include "OCLAcceleration.h"
+#include "ConvexDecomposePool.h"
+#include "ConvexDecomposeCache.h"
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <span>
 #define PRINT_OCL_INFO 0
 
+// One V-HACD input: the mesh is normalized to the unit cube, and the hulls are scaled back when read.
+struct ConvexDecomposeInput
+{
+	std::vector<float> m_Vertices;
+	std::vector<uint32_t> m_Indices;
+	MathLib::HVector3 m_Min;
+	MathLib::HVector3 m_Extents;
+
+	explicit ConvexDecomposeInput(const PhysicsMeshData& meshData)
+		: m_Indices(meshData.m_Indices)
+	{
+		MathLib::HAABBox3D aabb;
+		aabb.setEmpty();
+		for (size_t i = 0; i < meshData.m_Vertices.size(); i++)
+		{
+			aabb.extend(meshData.m_Vertices[i]);
+		}
+		m_Min = aabb.min();
+		m_Extents = aabb.max() - aabb.min();
+
+		m_Vertices.resize(meshData.m_Vertices.size() * 3);
+		for (size_t i = 0; i < meshData.m_Vertices.size(); i++)
+		{
+			const MathLib::HVector3& v = meshData.m_Vertices[i];
+			m_Vertices[i * 3] = (v[0] - m_Min[0]) / m_Extents[0];
+			m_Vertices[i * 3 + 1] = (v[1] - m_Min[1]) / m_Extents[1];
+			m_Vertices[i * 3 + 2] = (v[2] - m_Min[2]) / m_Extents[2];
+		}
+	}
+
+	bool Compute(VHACD::IVHACD* vhacd, const VHACD::IVHACD::Parameters& params) const
+	{
+		return vhacd->Compute(m_Vertices.data(), m_Vertices.size() / 3, m_Indices.data(), m_Indices.size() / 3, params);
+	}
+
+	void ReadConvexHulls(const VHACD::IVHACD* vhacd, std::vector<PhysicsMeshData>& convexMeshesData) const
+	{
+		ReadRawConvexHulls(vhacd, convexMeshesData);
+		Denormalize(convexMeshesData);
+	}
+
+	// The hulls as the instance holds them, without the scale back onto the mesh.
+	static void ReadRawConvexHulls(const VHACD::IVHACD* vhacd, std::vector<PhysicsMeshData>& convexMeshesData)
+	{
+		const size_t nConvexHulls = vhacd->GetNConvexHulls();
+		convexMeshesData.resize(nConvexHulls);
+
+		for (size_t i = 0; i < nConvexHulls; i++)
+		{
+			VHACD::IVHACD::ConvexHull ch;
+			vhacd->GetConvexHull(i, ch);
+			ReadConvexHull(ch, convexMeshesData[i]);
+		}
+	}
+
+	static void ReadConvexHull(const VHACD::IVHACD::ConvexHull& ch, PhysicsMeshData& convexMeshData)
+	{
+		convexMeshData.m_Vertices.resize(ch.m_nPoints);
+		for (size_t j = 0; j < ch.m_nPoints; j++)
+			convexMeshData.m_Vertices[j] = MathLib::HVector3(ch.m_points[j * 3], ch.m_points[j * 3 + 1], ch.m_points[j * 3 + 2]);
+		convexMeshData.m_Indices.assign(ch.m_triangles, ch.m_triangles + ch.m_nTriangles * 3);
+	}
+
+	// Scales hulls from the unit cube back onto the mesh.
+	void Denormalize(std::vector<PhysicsMeshData>& convexMeshesData) const
+	{
+		for (PhysicsMeshData& convexMeshData : convexMeshesData)
+		{
+			for (MathLib::HVector3& v : convexMeshData.m_Vertices)
+			{
+				v = MathLib::HVector3(v[0] * m_Extents[0] + m_Min[0],
+					v[1] * m_Extents[1] + m_Min[1],
+					v[2] * m_Extents[2] + m_Min[2]);
+			}
+		}
+	}
+};
+
+// Background decomposition run by a pool worker. The progress callback runs on that worker, it
+// publishes the overall progress and forwards a pending cancel, because Compute clears the
+// library's cancel flag when it starts. The hull callback, when asked for, runs there as well.
+class ConvexDecomposeTask : public IConvexDecomposeTask, public VHACD::IVHACD::IUserCallback, public VHACD::IVHACD::IUserHullCallback
+{
+public:
+	ConvexDecomposeTask()
+	{
+		m_Result = m_Promise.get_future().share();
+	}
+
+	void Release() override
+	{
+		Cancel();
+		m_Result.wait();
+		delete this;
+	}
+
+	MathLib::HReal GetProgress() const override { return m_Progress; }
+
+	void Cancel() override
+	{
+		m_bCancelled = true;
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_VHACD)
+			m_VHACD->Cancel();
+	}
+
+	bool IsCancelled() const override { return m_bCancelled; }
+
+	bool IsReady() const override
+	{
+		return m_Result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	std::shared_future<std::vector<PhysicsMeshDataPtr>> GetResult() const override { return m_Result; }
+
+	bool HasTimedOut() const override { return m_bTimedOut; }
+
+	uint32_t GetIntermediateResult(std::vector<PhysicsMeshDataPtr>& hulls) const override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		hulls = m_IntermediateHulls;
+		return m_IntermediateRevision;
+	}
+
+	void Update(const double overallProgress, const double stageProgress, const double operationProgress, const char* const stage, const char* const operation) override
+	{
+		m_Progress = std::clamp(MathLib::HReal(overallProgress / 100), MathLib::HReal(0), MathLib::HReal(1));
+		if (m_bCancelled)
+			m_VHACD->Cancel();
+	}
+
+	void UpdateHulls(const VHACD::IVHACD::ConvexHull* const hulls, const uint32_t countHulls) override
+	{
+		std::vector<PhysicsMeshData> convexMeshesData(countHulls);
+		for (uint32_t i = 0; i < countHulls; i++)
+			ConvexDecomposeInput::ReadConvexHull(hulls[i], convexMeshesData[i]);
+		m_Input->Denormalize(convexMeshesData);
+
+		std::vector<PhysicsMeshDataPtr> intermediateHulls;
+		intermediateHulls.reserve(countHulls);
+		for (auto& convexMeshData : convexMeshesData)
+			intermediateHulls.push_back(MakePhysicsMeshData(std::move(convexMeshData)));
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IntermediateHulls = std::move(intermediateHulls);
+		m_IntermediateRevision++;
+	}
+
+	// Stores the result in the cache when one is given. A run cut short by the time budget is not
+	// stored, the key leaves the budget out so that budgeted requests still hit complete results.
+	void Run(VHACD::IVHACD* vhacd, const ConvexDecomposeInput& input, VHACD::IVHACD::Parameters params, const ConvexDecomposeCache* cache, const ConvexDecomposeCache::Key& key)
+	{
+		std::vector<PhysicsMeshData> convexMeshesData;
+		if (!m_bCancelled)
+		{
+			params.m_callback = this;
+			m_Input = &input;
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_VHACD = vhacd;
+			}
+
+			if (input.Compute(vhacd, params) && !m_bCancelled)
+			{
+				input.ReadConvexHulls(vhacd, convexMeshesData);
+				m_bTimedOut = vhacd->HasTimedOut();
+				if (cache && !m_bTimedOut)
+					cache->Store(key, vhacd);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_VHACD = nullptr;
+			}
+			m_Input = nullptr;
+			vhacd->Clean();
+		}
+		SetResult(std::move(convexMeshesData));
+	}
+
+	// Completes the task, also used for results that did not need a run.
+	void SetResult(std::vector<PhysicsMeshData>&& convexMeshesData)
+	{
+		// Release may delete the task as soon as the value is set, so the promise leaves it first.
+		std::promise<std::vector<PhysicsMeshDataPtr>> promise(std::move(m_Promise));
+		std::vector<PhysicsMeshDataPtr> hulls;
+		hulls.reserve(convexMeshesData.size());
+		for (auto& convexMeshData : convexMeshesData)
+			hulls.push_back(MakePhysicsMeshData(std::move(convexMeshData)));
+		if (!m_bCancelled)
+			m_Progress = 1;
+		promise.set_value(std::move(hulls));
+	}
+
+private:
+	mutable std::mutex m_Mutex;
+	VHACD::IVHACD* m_VHACD = nullptr;
+	const ConvexDecomposeInput* m_Input = nullptr;
+	std::vector<PhysicsMeshDataPtr> m_IntermediateHulls;
+	uint32_t m_IntermediateRevision = 0;
+	std::atomic<bool> m_bCancelled = false;
+	std::atomic<bool> m_bTimedOut = false;
+	std::atomic<MathLib::HReal> m_Progress = 0;
+	std::promise<std::vector<PhysicsMeshDataPtr>> m_Promise;
+	std::shared_future<std::vector<PhysicsMeshDataPtr>> m_Result;
+};
+
+// All decompositions run on a pool of reusable IVHACD instances, see ConvexDecomposePool.
 class ConvexMeshDecomposer
 {
 public:
+	// Without an explicit budget, voxel grids at least this fine get the pool's whole thread budget for
+	// the plane search; coarser ones are too short to amortize the fan-out and run one per thread instead.
+	static constexpr uint32_t InnerParallelResolution = 250000;
+
 	ConvexMeshDecomposer(const bool useOCLAcceleration=true)
 	{
-		m_VHACD = VHACD::CreateVHACD();
 		m_bUseOCLAcceleration = useOCLAcceleration;
 		_InitOCLAcceleration();
+		m_Pool = std::make_unique<ConvexDecomposePool>();
 	}
 
 	~ConvexMeshDecomposer()
 	{
-		if (m_VHACD)
-		{
-			m_VHACD->Release();
-			m_VHACD = nullptr;
-		}
+		// Workers keep the OpenCL device pointer, so they go first.
+		m_Pool.reset();
 		m_OCLAcceleration.reset();
 	};
 
+	// Only affects decompositions submitted afterwards.
 	void EnableOCLAcceleration(bool bEnable)
 	{
 		m_bUseOCLAcceleration = bEnable;
@@ -37,93 +254,194 @@ public:
 
 	bool Decompose(const PhysicsMeshData& meshData, const ConvexDecomposeOptions& params, std::vector<PhysicsMeshData>& convexMeshesData)
 	{
-		VHACD::IVHACD::Parameters vhacdParams;
-		vhacdParams.m_maxNumVerticesPerCH = params.m_MaximumNumberOfVerticesPerHull;
-		vhacdParams.m_maxConvexHulls = params.m_MaximumNumberOfHulls;
-		vhacdParams.m_resolution = params.m_VoxelGridResolution;
-		vhacdParams.m_concavity = params.m_Concavity;
-		vhacdParams.m_oclAcceleration = m_bUseOCLAcceleration;
-		vhacdParams.m_minVolumePerCH = 0.003f;
+		PhysicsPtr<IConvexDecomposeTask> task = _Decompose(meshData, params, true);
+		const std::vector<PhysicsMeshDataPtr>& hulls = task->GetResult().get();
+		convexMeshesData.clear();
+		convexMeshesData.reserve(hulls.size());
+		for (const PhysicsMeshDataPtr& hull : hulls)
+			convexMeshesData.push_back(*hull);
+		return !hulls.empty();
+	}
 
-		std::vector<float > vertices;
-		vertices.resize(meshData.m_Vertices.size() * 3);
+	// A cache hit completes the task before it is returned, without going through the pool.
+	PhysicsPtr<IConvexDecomposeTask> DecomposeAsync(const PhysicsMeshData& meshData, const ConvexDecomposeOptions& params)
+	{
+		return _Decompose(meshData, params, false);
+	}
 
-		MathLib::HAABBox3D aabb;
-		aabb.setEmpty();
-		for (size_t i = 0; i < meshData.m_Vertices.size(); i++)
+	// Merges existing hulls down to params.m_MaximumNumberOfHulls with the cost the decomposition merges
+	// its parts with. Blocks, see ConvexDecomposePool::Run; by default it books the whole pool for the pair costs.
+	bool MergeConvexHulls(const std::vector<PhysicsMeshData>& convexMeshesData, const ConvexDecomposeOptions& params, std::vector<PhysicsMeshData>& mergedMeshesData)
+	{
+		std::vector<std::vector<double>> points(convexMeshesData.size());
+		std::vector<VHACD::IVHACD::ConvexHull> hulls(convexMeshesData.size());
+		for (size_t i = 0; i < convexMeshesData.size(); i++)
 		{
-			aabb.extend(meshData.m_Vertices[i]);
+			const PhysicsMeshData& convexMeshData = convexMeshesData[i];
+			points[i].resize(convexMeshData.m_Vertices.size() * 3);
+			for (size_t j = 0; j < convexMeshData.m_Vertices.size(); j++)
+			{
+				points[i][j * 3] = convexMeshData.m_Vertices[j][0];
+				points[i][j * 3 + 1] = convexMeshData.m_Vertices[j][1];
+				points[i][j * 3 + 2] = convexMeshData.m_Vertices[j][2];
+			}
+			hulls[i] = VHACD::IVHACD::ConvexHull();
+			hulls[i].m_points = points[i].data();
+			hulls[i].m_nPoints = static_cast<uint32_t>(convexMeshData.m_Vertices.size());
+			// Merge only reads the input hulls.
+			hulls[i].m_triangles = const_cast<uint32_t*>(convexMeshData.m_Indices.data());
+			hulls[i].m_nTriangles = static_cast<uint32_t>(convexMeshData.m_Indices.size() / 3);
 		}
 
-		MathLib::HVector3 min = aabb.min();
-		MathLib::HVector3 max = aabb.max();
+		bool bMerged = false;
+		ConvexDecomposePool::Job job;
+		job.m_NumThreads = params.m_MaximumNumberOfThreads > 0 ? params.m_MaximumNumberOfThreads : m_Pool->GetNumThreads();
+		job.m_Run = [&](VHACD::IVHACD* vhacd, bool bOCLReady, VHACD::IVHACD::ITaskScheduler* scheduler)
+		{
+			VHACD::IVHACD::Parameters vhacdParams = _MakeParameters(params);
+			vhacdParams.m_taskScheduler = scheduler;
+			bMerged = vhacd->Merge(hulls.data(), static_cast<uint32_t>(hulls.size()), vhacdParams);
+			if (bMerged)
+				ConvexDecomposeInput::ReadRawConvexHulls(vhacd, mergedMeshesData);
+			vhacd->Clean();
+		};
+		m_Pool->Run(std::move(job));
+		return bMerged;
+	}
 
-		for (size_t i = 0; i < meshData.m_Vertices.size(); i++)
+	// Empty turns the disk cache off. Decompositions already submitted keep the cache they started with.
+	void SetCacheDirectory(const std::string& directory)
+	{
+		std::shared_ptr<const ConvexDecomposeCache> cache = directory.empty() ? nullptr : std::make_shared<const ConvexDecomposeCache>(directory);
+		std::lock_guard<std::mutex> lock(m_CacheMutex);
+		m_Cache = std::move(cache);
+	}
+
+	std::string GetCacheDirectory() const
+	{
+		const std::shared_ptr<const ConvexDecomposeCache> cache = _GetCache();
+		return cache ? cache->GetDirectory().string() : std::string();
+	}
+
+	// Submits the largest grids first, so the single-threaded tail of small meshes fills the cores
+	// at the end. Returns how many meshes produced hulls; convexMeshesData follows the request order.
+	// On a pool thread the meshes are decomposed one after another on the caller.
+	uint32_t DecomposeBatch(std::span<const ConvexDecomposeRequest> requests, std::vector<std::vector<PhysicsMeshDataPtr>>& convexMeshesData)
+	{
+		std::vector<size_t> order(requests.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&requests](size_t a, size_t b)
+						 {
+							 const ConvexDecomposeOptions& optionsA = requests[a].m_Options;
+							 const ConvexDecomposeOptions& optionsB = requests[b].m_Options;
+							 if (optionsA.m_VoxelGridResolution != optionsB.m_VoxelGridResolution)
+								 return optionsA.m_VoxelGridResolution > optionsB.m_VoxelGridResolution;
+							 const size_t sizeA = requests[a].m_MeshData ? requests[a].m_MeshData->m_Indices.size() : 0;
+							 const size_t sizeB = requests[b].m_MeshData ? requests[b].m_MeshData->m_Indices.size() : 0;
+							 return sizeA > sizeB; });
+
+		std::vector<PhysicsPtr<IConvexDecomposeTask>> tasks(requests.size());
+		for (size_t i : order)
 		{
-			const MathLib::HVector3& v = meshData.m_Vertices[i];
-			vertices[i * 3] = (v[0] - min[0]) / (max[0] - min[0]);
-			vertices[i * 3 + 1] = (v[1] - min[1]) / (max[1] - min[1]);
-			vertices[i * 3 + 2] = (v[2] - min[2]) / (max[2] - min[2]);
+			if (requests[i].m_MeshData)
+				tasks[i] = _Decompose(*requests[i].m_MeshData, requests[i].m_Options, m_Pool->IsWorkerThread());
 		}
-		
-		m_VHACD->Compute(vertices.data(), vertices.size()/3, meshData.m_Indices.data(), meshData.m_Indices.size() / 3, vhacdParams);
-
-		const size_t nConvexHulls = m_VHACD->GetNConvexHulls();
-		convexMeshesData.resize(nConvexHulls);
 
-		for (size_t i = 0; i < nConvexHulls; i++)
+		uint32_t numDecomposed = 0;
+		convexMeshesData.assign(requests.size(), {});
+		for (size_t i = 0; i < tasks.size(); i++)
 		{
-			VHACD::IVHACD::ConvexHull ch;
-			m_VHACD->GetConvexHull(i, ch);
-			PhysicsMeshData& convexMeshData = convexMeshesData[i];
-			convexMeshData.m_Vertices.resize(ch.m_nPoints);
-			for (size_t j = 0; j < ch.m_nPoints; j++)
-			{   const MathLib::HVector3 v(ch.m_points[j * 3], ch.m_points[j * 3 + 1], ch.m_points[j * 3 + 2]);
-				convexMeshData.m_Vertices[j] = MathLib::HVector3(v[0] * (max[0] - min[0]) + min[0],
-					v[1] * (max[1] - min[1]) + min[1],
-					v[2] * (max[2] - min[2]) + min[2]);
-			}
-			convexMeshData.m_Indices.resize(ch.m_nTriangles * 3);
-			for (size_t j = 0; j < ch.m_nTriangles; j++)
+			if (tasks[i] == nullptr)
+				continue;
+			convexMeshesData[i] = tasks[i]->GetResult().get();
+			if (!convexMeshesData[i].empty())
+				numDecomposed++;
+		}
+		return numDecomposed;
+	}
+private:
+	// With bWait the task is complete when returned, see ConvexDecomposePool::Run.
+	PhysicsPtr<IConvexDecomposeTask> _Decompose(const PhysicsMeshData& meshData, const ConvexDecomposeOptions& params, const bool bWait)
+	{
+		ConvexDecomposeTask* task = new ConvexDecomposeTask();
+		ConvexDecomposeInput input(meshData);
+		VHACD::IVHACD::Parameters vhacdParams = _MakeParameters(params);
+		const std::shared_ptr<const ConvexDecomposeCache> cache = _GetCache();
+		ConvexDecomposeCache::Key key{};
+		if (cache)
+		{
+			key = ConvexDecomposeCache::MakeKey(input.m_Vertices, input.m_Indices, vhacdParams);
+			std::vector<PhysicsMeshData> convexMeshesData;
+			if (cache->Load(key, convexMeshesData))
 			{
-				convexMeshData.m_Indices[j * 3] = ch.m_triangles[j * 3];
-				convexMeshData.m_Indices[j * 3 + 1] = ch.m_triangles[j * 3 + 1];
-				convexMeshData.m_Indices[j * 3 + 2] = ch.m_triangles[j * 3 + 2];
+				input.Denormalize(convexMeshesData);
+				task->SetResult(std::move(convexMeshesData));
+				return make_physics_ptr<IConvexDecomposeTask>(task);
 			}
 		}
 
-		m_VHACD->Clean();
-		return true;
+		if (params.m_bPublishIntermediateHulls)
+			vhacdParams.m_hullCallback = task;
+
+		ConvexDecomposePool::Job job;
+		if (params.m_MaximumNumberOfThreads > 0)
+			job.m_NumThreads = params.m_MaximumNumberOfThreads;
+		else
+			job.m_NumThreads = params.m_VoxelGridResolution >= InnerParallelResolution ? m_Pool->GetNumThreads() : 1;
+		job.m_OCLDevice = m_bUseOCLAcceleration ? m_OCLAcceleration->GetDevice() : nullptr;
+		job.m_Run = [task, input = std::move(input), vhacdParams, cache, key](VHACD::IVHACD* vhacd, bool bOCLReady, VHACD::IVHACD::ITaskScheduler* scheduler) mutable
+		{
+			vhacdParams.m_oclAcceleration = bOCLReady;
+			vhacdParams.m_taskScheduler = scheduler;
+			task->Run(vhacd, input, vhacdParams, cache.get(), key);
+		};
+		if (bWait)
+			m_Pool->Run(std::move(job));
+		else
+			m_Pool->Submit(std::move(job));
+		return make_physics_ptr<IConvexDecomposeTask>(task);
 	}
-private:
+
+	std::shared_ptr<const ConvexDecomposeCache> _GetCache() const
+	{
+		std::lock_guard<std::mutex> lock(m_CacheMutex);
+		return m_Cache;
+	}
+
+	static VHACD::IVHACD::Parameters _MakeParameters(const ConvexDecomposeOptions& params)
+	{
+		VHACD::IVHACD::Parameters vhacdParams;
+		vhacdParams.m_maxNumVerticesPerCH = params.m_MaximumNumberOfVerticesPerHull;
+		vhacdParams.m_maxConvexHulls = params.m_MaximumNumberOfHulls;
+		vhacdParams.m_resolution = params.m_VoxelGridResolution;
+		vhacdParams.m_concavity = params.m_Concavity;
+		vhacdParams.m_projectHullVertices = params.m_bProjectHullVertices;
+		vhacdParams.m_maxComputeTime = params.m_TimeBudgetMs;
+		vhacdParams.m_minVolumePerCH = 0.003f;
+		return vhacdParams;
+	}
+
+	// The device stays alive once created even when acceleration is turned off, because pool
+	// workers keep pointing at it until their next job.
 	void _InitOCLAcceleration()
 	{
-		if (m_bUseOCLAcceleration)
+		if (m_bUseOCLAcceleration && !m_OCLAcceleration)
 		{
-			if (!m_OCLAcceleration)
-			{
-				m_OCLAcceleration = std::make_unique<OCLAcceleration>();
-				bool res = InitOCL(0,
-					0,
-					*m_OCLAcceleration,PRINT_OCL_INFO);
-				if (!res) {
-					return ;
-				}
-			}
-			bool res = m_VHACD->OCLInit(m_OCLAcceleration->GetDevice());
+			m_OCLAcceleration = std::make_unique<OCLAcceleration>();
+			bool res = InitOCL(0,
+				0,
+				*m_OCLAcceleration,PRINT_OCL_INFO);
 			if (!res)
 			{
+				m_OCLAcceleration.reset();
 				m_bUseOCLAcceleration = false;
 			}
 		}
-		else
-		{
-			m_VHACD->OCLRelease();
-			m_OCLAcceleration.reset();
-		}
 	}
 private:
 	bool m_bUseOCLAcceleration = false;
-	VHACD::IVHACD* m_VHACD = nullptr;
 	std::unique_ptr<	OCLAcceleration> m_OCLAcceleration;
+	std::unique_ptr<ConvexDecomposePool> m_Pool;
+	std::shared_ptr<const ConvexDecomposeCache> m_Cache;
+	mutable std::mutex m_CacheMutex;
 };
\ No newline at end of file
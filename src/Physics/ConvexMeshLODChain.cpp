@@ -0,0 +1,39 @@
+#include "ConvexMeshLODChain.h"
+#include "PxPhysicsAPI.h"
+#include "Utility/PhysXUtils.h"
+#include <algorithm>
+using namespace physx;
+
+ConvexMeshLODChain::ConvexMeshLODChain(const PhysicsMeshData &meshData, const std::vector<uint32_t> &vertexLimits, uint32_t gaussMapLimit)
+{
+    std::vector<uint32_t> limits = vertexLimits;
+    std::sort(limits.begin(), limits.end(), std::greater<uint32_t>());
+    for (uint32_t limit : limits)
+    {
+        limit = std::clamp<uint32_t>(limit, 4, 255);
+        if (!m_Levels.empty() && m_Levels.back()->getNbVertices() <= limit)
+            continue;
+        PxConvexMesh *mesh = PhysXConstructTools::CreatePxConvexMesh<true>(uint32_t(meshData.m_Vertices.size()), meshData.m_Vertices.data(), limit, gaussMapLimit != 0 ? gaussMapLimit : PhysXConstructTools::GetGaussMapLimit(limit));
+        if (mesh != nullptr)
+            m_Levels.push_back(mesh);
+    }
+}
+
+ConvexMeshLODChain::~ConvexMeshLODChain()
+{
+    for (PxConvexMesh *mesh : m_Levels)
+        PX_RELEASE(mesh);
+}
+
+PxConvexMesh *ConvexMeshLODChain::GetConvexMesh(uint32_t lod) const
+{
+    if (m_Levels.empty())
+        return nullptr;
+    return m_Levels[std::min<size_t>(lod, m_Levels.size() - 1)];
+}
+
+uint32_t ConvexMeshLODChain::GetVertexCount(uint32_t lod) const
+{
+    const PxConvexMesh *mesh = GetConvexMesh(lod);
+    return mesh ? mesh->getNbVertices() : 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+
+namespace physx
+{
+	class PxConvexMesh;
+}
+
+// Cooked hulls of one convex mesh at decreasing vertex limits. Level 0 is the finest; levels that
+// would not drop any vertex are not cooked, so the chain can be shorter than the requested limits.
+class ConvexMeshLODChain
+{
+public:
+	// A gaussMapLimit of 0 picks one per level with GetGaussMapLimit, anything else applies to every level.
+	ConvexMeshLODChain(const PhysicsMeshData &meshData, const std::vector<uint32_t> &vertexLimits, uint32_t gaussMapLimit = 0);
+	~ConvexMeshLODChain();
+	ConvexMeshLODChain(const ConvexMeshLODChain &) = delete;
+	ConvexMeshLODChain &operator=(const ConvexMeshLODChain &) = delete;
+
+	uint32_t GetLODCount() const { return static_cast<uint32_t>(m_Levels.size()); }
+	// Requests past the coarsest level return the coarsest level.
+	physx::PxConvexMesh *GetConvexMesh(uint32_t lod) const;
+	uint32_t GetVertexCount(uint32_t lod) const;
+
+private:
+	std::vector<physx::PxConvexMesh *> m_Levels;
+};
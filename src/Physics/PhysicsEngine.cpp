@@ -4,8 +4,15 @@
 #include "PhysicsScene.h"
 #include "PhysicsObject.h"
 #include "PhysicsMaterial.h"
+#include "PhysicsMaterialManager.h"
+#include "TriangleMeshDecompositionCache.h"
 #include "ColliderGeometry.h"
+#include "ColliderGeometryRegistry.h"
+#include "PhysicsPrefab.h"
+#include "Base/PhysicsObjectPool.h"
+#include "ConvexMeshLODChain.h"
 #include "Utility/PhysxUtils.h"
+#include "Utility/PhysicsPrimitiveFitUtils.h"
 #include <assert.h>
 
 #ifndef NDEBUG
@@ -23,9 +30,12 @@ PhysicsEngine::PhysicsEngine(const PhysicsEngineOptions &options)
 	m_Physics = nullptr;
 	m_Pvd = nullptr;
 	m_CpuDispatcher = nullptr;
+	m_MaterialManager = nullptr;
+	m_GeometryRegistry = nullptr;
 	m_bInitialized = false;
 
 	m_Options = options;
+	m_SolverIterationCount = options.m_SolverIterationCount;
 #ifdef ENABLE_PVD
 	m_Options.m_bEnablePVD = true;
 #else
@@ -50,6 +60,8 @@ PhysicsEngine::PhysicsEngine(const PhysicsEngineOptions &options)
 
 		m_Physics = make_physx_ptr(PxCreatePhysics(PX_PHYSICS_VERSION, *m_Foundation, toleranceScale, true, m_Pvd.get()));
 		m_CpuDispatcher = std::unique_ptr<PxCpuDispatcher>(PxDefaultCpuDispatcherCreate(options.m_NumThreads == 0 ? DEFAULT_CPU_DISPATCHER_NUM_THREADS : options.m_NumThreads));
+		m_MaterialManager = std::make_unique<PhysicsMaterialManager>();
+		m_GeometryRegistry = std::make_unique<ColliderGeometryRegistry>();
 	}
 
 	m_bInitialized = true;
@@ -57,7 +69,10 @@ PhysicsEngine::PhysicsEngine(const PhysicsEngineOptions &options)
 
 PhysicsEngine::~PhysicsEngine()
 {
+	m_TriangleMeshDecompositionCache.reset();
+	m_GeometryRegistry.reset();
 	m_CpuDispatcher.reset();
+	m_MaterialManager.reset();
 	m_Physics.reset();
 	if (m_Pvd)
 	{
@@ -74,7 +89,8 @@ PhysicsPtr<IPhysicsObject> PhysicsEngine::CreateObject(const PhysicsObjectCreate
 {
 	if (!m_bInitialized)
 		return nullptr;
-	PhysicsPtr<IPhysicsMaterial> material = CreateMaterial(options.m_MaterialOptions);
+	// The body's material is not reachable from outside, so it can share its PxMaterial.
+	PhysicsPtr<IPhysicsMaterial> material = make_physics_ptr<IPhysicsMaterial>(new PhysicsMaterial(options.m_MaterialOptions, m_MaterialManager.get()));
 	IPhysicsObject *object = nullptr;
 	switch (options.m_ObjectType)
 	{
@@ -100,7 +116,8 @@ PhysicsPtr<IPhysicsMaterial> PhysicsEngine::CreateMaterial(const PhysicsMaterial
 {
 	if (!m_bInitialized)
 		return nullptr;
-	return make_physics_ptr(new PhysicsMaterial(options));
+	// Callers may change the material later, so it owns its PxMaterial.
+	return make_physics_ptr(new PhysicsMaterial(options, nullptr));
 }
 
 PhysicsPtr<IPhysicsScene> PhysicsEngine::CreateScene(const PhysicsSceneCreateOptions &options)
@@ -113,59 +130,94 @@ PhysicsPtr<IPhysicsScene> PhysicsEngine::CreateScene(const PhysicsSceneCreateOpt
 
 PhysicsPtr<IColliderGeometry> PhysicsEngine::CreateColliderGeometry(const CollisionGeometryCreateOptions &options)
 {
-	if (!m_bInitialized)
+	if (!m_bInitialized || !ColliderGeometry::IsValid(options.m_Params))
 		return nullptr;
-	IColliderGeometry *geometry = nullptr;
-	switch (options.m_GeometryType)
-	{
-	case CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX:
-	{
-		geometry = new BoxColliderGeometry(options.m_BoxParams.m_HalfExtents);
-		geometry->SetScale(options.m_Scale);
-		break;
-	}
-	case CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE:
-	{
-		geometry = new SphereColliderGeometry(options.m_SphereParams.m_Radius);
-		break;
-	}
-	case CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE:
-	{
-		geometry = new PlaneColliderGeometry(options.m_PlaneParams.m_Normal, options.m_PlaneParams.m_Distance);
-		break;
-	}
-	case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE:
+	// Cooking runs outside the registry lock; if another thread registered the same options
+	// in the meantime, its geometry wins and this one is dropped.
+	std::shared_ptr<const ColliderGeometry> prototype = m_GeometryRegistry->Find(options);
+	if (prototype == nullptr)
+		prototype = m_GeometryRegistry->Register(options, std::shared_ptr<const ColliderGeometry>(_CreateColliderGeometry(options)));
+	// Every caller gets its own copy, so setters only affect that caller; the copy shares the
+	// prototype's cooked meshes. The registry holds prototypes weakly, they go away with the last copy.
+	ColliderGeometry *geometry = new ColliderGeometry(*prototype);
+	geometry->SetPrototype(prototype);
+	return PhysicsPtr<IColliderGeometry>(geometry, [](IColliderGeometry *releasedGeometry)
+										 {
+											 releasedGeometry->Release();
+											 delete static_cast<ColliderGeometry *>(releasedGeometry); });
+}
+
+PhysicsPtr<IPhysicsObjectPool> PhysicsEngine::CreateObjectPool(PhysicsPtr<IPhysicsScene> &scene, const PhysicsObjectPoolCreateOptions &options)
+{
+	if (!m_bInitialized || scene == nullptr)
+		return nullptr;
+	PhysicsPtr<IPhysicsPrefab> prefab = CreatePrefab(options.m_Prefab);
+	if (prefab == nullptr)
+		return nullptr;
+	PhysicsPtr<IPhysicsObjectPool> pool = make_physics_ptr<IPhysicsObjectPool>(new PhysicsObjectPool(scene, prefab, options));
+	return pool;
+}
+
+PhysicsPtr<IPhysicsPrefab> PhysicsEngine::CreatePrefab(const PhysicsPrefabCreateOptions &options)
+{
+	if (!m_bInitialized || options.m_ColliderGeometries.empty() || options.m_ColliderGeometries.size() != options.m_ColliderLocalTransforms.size())
+		return nullptr;
+	PhysicsPtr<IPhysicsMaterial> material = make_physics_ptr<IPhysicsMaterial>(new PhysicsMaterial(options.m_ObjectOptions.m_MaterialOptions, m_MaterialManager.get()));
+	PhysicsPrefab *prefab = new PhysicsPrefab(options, material);
+	if (!prefab->IsValid())
 	{
-		geometry = new CapsuleColliderGeometry(options.m_CapsuleParams.m_Radius, options.m_CapsuleParams.m_HalfHeight);
-		break;
+		prefab->Release();
+		delete prefab;
+		return nullptr;
 	}
-	case CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH:
+	return make_physics_ptr<IPhysicsPrefab>(prefab);
+}
+
+ColliderGeometry *PhysicsEngine::_CreateColliderGeometry(const CollisionGeometryCreateOptions &options)
+{
+	if (options.m_bFitPrimitive)
 	{
-		geometry = new TriangleMeshColliderGeometry(options.m_TriangleMeshParams.m_Vertices, options.m_TriangleMeshParams.m_Indices);
-		break;
+		const PhysicsMeshData *meshData = nullptr;
+		if (const TriangleMeshGeometryParams *params = options.GetParams<TriangleMeshGeometryParams>())
+			meshData = params->m_MeshData.get();
+		else if (const ConvexMeshGeometryParams *params = options.GetParams<ConvexMeshGeometryParams>())
+			meshData = params->m_MeshData.get();
+
+		// The fit is done on the scaled mesh, so the proxy keeps a unit scale.
+		PrimitiveFitReport report;
+		if (meshData && PhysicsPrimitiveFitUtils::FitPrimitives(*meshData, options.m_Scale, report))
+		{
+			if (const PrimitiveFit *fit = report.SelectCheapest(options.m_PrimitiveFitTolerance))
+			{
+				return new ColliderGeometry(fit->m_Params, options.m_LocalTransform * fit->m_LocalTransform);
+			}
+		}
 	}
-	case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH:
+	ColliderGeometry *geometry = new ColliderGeometry(options.m_Params, options.m_LocalTransform);
+	geometry->SetScale(options.m_Scale);
+	// Convex meshes are cooked once here and shared by every shape built from the geometry.
+	if (const ConvexMeshGeometryParams *convexParams = options.GetParams<ConvexMeshGeometryParams>())
 	{
-		geometry = new ConvexMeshColliderGeometry(options.m_ConvexMeshParams.m_Vertices, options.m_ConvexMeshParams.m_Indices);
-		break;
+		// Without requested levels the single hull is cooked exactly as before LOD chains: up to 255
+		// vertices and no gauss map.
+		if (convexParams->m_LODVertexLimits.empty())
+			geometry->SetConvexLODs(std::make_shared<const ConvexMeshLODChain>(*convexParams->m_MeshData, std::vector<uint32_t>{255}, 256));
+		else
+			geometry->SetConvexLODs(std::make_shared<const ConvexMeshLODChain>(*convexParams->m_MeshData, convexParams->m_LODVertexLimits));
 	}
-	default:
-		break;
-	}
-	geometry->SetScale(options.m_Scale);
-	return make_physics_ptr(geometry);
+	return geometry;
 }
 
 void PhysicsEngine::SetSolverIterationCount(uint32_t count)
 {
 	if (!m_bInitialized)
 		return;
-	m_Options.m_SolverIterationCount = count;
+	m_SolverIterationCount = count;
 }
 
 uint32_t PhysicsEngine::GetSolverIterationCount() const
 {
 	if (!m_bInitialized)
 		return 0;
-	return m_Options.m_SolverIterationCount;
+	return m_SolverIterationCount;
 }
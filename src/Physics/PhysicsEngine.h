@@ -1,6 +1,7 @@
 #pragma once
 #include "Physics/PhysicsCommon.h"
 #include "physx/extensions/PxDefaultCpuDispatcher.h"
+#include <atomic>
 namespace physx
 {
 	class PxAllocatorCallback;
@@ -15,6 +16,10 @@ namespace physx
 
 class PhysicsAllocator;
 class PhysicsErrorCallback;
+class PhysicsMaterialManager;
+class TriangleMeshDecompositionCache;
+class ColliderGeometryRegistry;
+class ColliderGeometry;
 
 class PhysicsEngine : public IPhysicsEngine
 {
@@ -27,18 +32,29 @@ public:
 	PhysicsPtr<IPhysicsMaterial> CreateMaterial(const PhysicsMaterialCreateOptions &options) override;
 	PhysicsPtr<IPhysicsScene> CreateScene(const PhysicsSceneCreateOptions &options) override;
 	PhysicsPtr<IColliderGeometry> CreateColliderGeometry(const CollisionGeometryCreateOptions &options) override;
+	PhysicsPtr<IPhysicsObjectPool> CreateObjectPool(PhysicsPtr<IPhysicsScene> &scene, const PhysicsObjectPoolCreateOptions &options) override;
+	PhysicsPtr<IPhysicsPrefab> CreatePrefab(const PhysicsPrefabCreateOptions &options) override;
 	void SetSolverIterationCount(uint32_t count) override;
 	uint32_t GetSolverIterationCount() const override;
+	TriangleMeshDecompositionCache *GetTriangleMeshDecompositionCache() const { return m_TriangleMeshDecompositionCache.get(); }
+
+private:
+	ColliderGeometry *_CreateColliderGeometry(const CollisionGeometryCreateOptions &options);
 
 private:
 	friend class PhysicsEngineUtils;
 	PhysicsEngineOptions m_Options;
+	// Read by every object constructor, possibly on loader threads.
+	std::atomic<uint32_t> m_SolverIterationCount;
 	std::unique_ptr<physx::PxAllocatorCallback> m_AllocatorCallback;
 	std::unique_ptr<physx::PxErrorCallback> m_ErrorCallback;
 	PhysXPtr<physx::PxPvd> m_Pvd;
 	PhysXPtr<physx::PxFoundation> m_Foundation;
 	PhysXPtr<physx::PxPhysics> m_Physics;
 	std::unique_ptr<physx::PxCpuDispatcher> m_CpuDispatcher;
+	std::unique_ptr<PhysicsMaterialManager> m_MaterialManager;
+	std::unique_ptr<ColliderGeometryRegistry> m_GeometryRegistry;
+	std::unique_ptr<TriangleMeshDecompositionCache> m_TriangleMeshDecompositionCache;
 
 	bool m_bInitialized;
 
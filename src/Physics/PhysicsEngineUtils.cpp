@@ -1,7 +1,18 @@
 #include "Physics/PhysicsCommon.h"
 #include "PhysicsEngine.h"
 #include "ConvexMeshDecomposer.h"
+#include "TriangleMeshDecompositionCache.h"
 #include "Utility/PhysicsConvexUtils.h"
+#include "Utility/PhysicsHeightFieldUtils.h"
+#include "Utility/PhysicsPrimitiveFitUtils.h"
+#include "Utility/PhysicsSimdUtils.h"
+#include "Utility/PhysXUtils.h"
+#include "VHACD/vhacdRaycastMesh.h"
+#include <algorithm>
+#include <cfloat>
+#include <random>
+// Written only by Create/DestroyPhysicsEngine, which must not overlap with other calls; the
+// factory wrappers below only read it and are as thread-safe as the engine methods they forward to.
 static PhysicsEngine* gPhysicsEngine = nullptr;
 static ConvexMeshDecomposer* gConvexMeshDecomposer = nullptr;
 IPhysicsEngine* PhysicsEngineUtils::CreatePhysicsEngine(const PhysicsEngineOptions& options, const bool createConvexDecomposer)
@@ -9,7 +20,12 @@ IPhysicsEngine* PhysicsEngineUtils::CreatePhysicsEngine(const PhysicsEngineOptio
 	_ASSERT(!gPhysicsEngine);
 	gPhysicsEngine = new PhysicsEngine(options);
 	if(createConvexDecomposer)
+	{
 		gConvexMeshDecomposer =new ConvexMeshDecomposer();
+		gConvexMeshDecomposer->SetCacheDirectory(options.m_ConvexDecomposeCacheDirectory);
+	}
+	if (gConvexMeshDecomposer && options.m_bDecomposeDynamicTriangleMeshes)
+		gPhysicsEngine->m_TriangleMeshDecompositionCache = std::make_unique<TriangleMeshDecompositionCache>(gConvexMeshDecomposer, options.m_TriangleMeshDecomposeOptions);
 	return gPhysicsEngine;
 }
 
@@ -49,6 +65,14 @@ PhysicsPtr < IColliderGeometry> PhysicsEngineUtils::CreateColliderGeometry(const
 {
 	return gPhysicsEngine->CreateColliderGeometry(options);
 }
+PhysicsPtr<IPhysicsObjectPool> PhysicsEngineUtils::CreateObjectPool(PhysicsPtr<IPhysicsScene>& scene, const PhysicsObjectPoolCreateOptions& options)
+{
+	return gPhysicsEngine->CreateObjectPool(scene, options);
+}
+PhysicsPtr<IPhysicsPrefab> PhysicsEngineUtils::CreatePrefab(const PhysicsPrefabCreateOptions& options)
+{
+	return gPhysicsEngine->CreatePrefab(options);
+}
 
 bool PhysicsEngineUtils::ConvexDecomposition(const PhysicsMeshData& meshData, const ConvexDecomposeOptions& params, std::vector<PhysicsMeshData>& convexMeshesData)
 {
@@ -57,7 +81,115 @@ bool PhysicsEngineUtils::ConvexDecomposition(const PhysicsMeshData& meshData, co
 	return gConvexMeshDecomposer->Decompose(meshData, params, convexMeshesData);
 }
 
+PhysicsPtr<IConvexDecomposeTask> PhysicsEngineUtils::DecomposeAsync(const PhysicsMeshData& meshData, const ConvexDecomposeOptions& params)
+{
+	if (!gConvexMeshDecomposer)
+		return nullptr;
+	return gConvexMeshDecomposer->DecomposeAsync(meshData, params);
+}
+
+uint32_t PhysicsEngineUtils::ConvexDecompositionBatch(std::span<const ConvexDecomposeRequest> requests, std::vector<std::vector<PhysicsMeshDataPtr>>& convexMeshesData)
+{
+	convexMeshesData.clear();
+	if (!gConvexMeshDecomposer)
+		return 0;
+	return gConvexMeshDecomposer->DecomposeBatch(requests, convexMeshesData);
+}
+
+bool PhysicsEngineUtils::MergeConvexHulls(const std::vector<PhysicsMeshData>& convexMeshesData, const ConvexDecomposeOptions& params, std::vector<PhysicsMeshData>& mergedMeshesData)
+{
+	if (!gConvexMeshDecomposer)
+		return false;
+	return gConvexMeshDecomposer->MergeConvexHulls(convexMeshesData, params, mergedMeshesData);
+}
+
+void PhysicsEngineUtils::SetConvexDecomposeCacheDirectory(const std::string& directory)
+{
+	if (gConvexMeshDecomposer)
+		gConvexMeshDecomposer->SetCacheDirectory(directory);
+}
+
+std::string PhysicsEngineUtils::GetConvexDecomposeCacheDirectory()
+{
+	if (!gConvexMeshDecomposer)
+		return std::string();
+	return gConvexMeshDecomposer->GetCacheDirectory();
+}
+
 void PhysicsEngineUtils::BuildConvexMesh(const std::vector<MathLib::HVector3>& vertices, const std::vector<uint32_t>& indices, PhysicsMeshData& meshdata)
 {
 	PhysicsConvexUtils::BuildConvexMesh(vertices, indices, meshdata);
-}
\ No newline at end of file
+}
+
+void PhysicsEngineUtils::BuildHeightFieldMesh(const HeightFieldGeometryParams& params, PhysicsMeshData& meshdata)
+{
+	PhysicsHeightFieldUtils::BuildHeightFieldMesh(params, meshdata);
+}
+
+bool PhysicsEngineUtils::FitPrimitives(const PhysicsMeshData& meshData, const MathLib::HVector3& scale, PrimitiveFitReport& report)
+{
+	return PhysicsPrimitiveFitUtils::FitPrimitives(meshData, scale, report);
+}
+
+void PhysicsEngineUtils::ToTransforms(std::span<const PhysicsPose> poses, std::span<MathLib::HTransform3> transforms)
+{
+	ConvertUtils::ToTransforms(poses, transforms);
+}
+
+void PhysicsEngineUtils::SetWideSimdEnabled(bool bEnable)
+{
+	PhysicsSimdUtils::SetWideKernelsEnabled(bEnable);
+}
+
+uint32_t PhysicsEngineUtils::CountRaycastMismatches(const PhysicsMeshData& meshData, uint32_t numRays, uint32_t seed)
+{
+	const uint32_t numVertices = static_cast<uint32_t>(meshData.m_Vertices.size());
+	if (numVertices == 0 || meshData.m_Indices.size() < 3)
+		return 0;
+	std::vector<double> points(size_t(numVertices) * 3);
+	double boundsMin[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+	double boundsMax[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			points[i * 3 + a] = meshData.m_Vertices[i][a];
+			boundsMin[a] = std::min(boundsMin[a], points[i * 3 + a]);
+			boundsMax[a] = std::max(boundsMax[a], points[i * 3 + a]);
+		}
+	}
+	VHACD::RaycastMesh* mesh = VHACD::RaycastMesh::createRaycastMesh(numVertices, points.data(), static_cast<uint32_t>(meshData.m_Indices.size() / 3), meshData.m_Indices.data());
+
+	// Rays start and end anywhere in twice the bounds. Half of them look for the hit nearest to their
+	// start, as the hull projection does, the others for the hit nearest to a point inside the bounds;
+	// every fourth one runs along y, where the box tests see zero direction components.
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	uint32_t numMismatches = 0;
+	for (uint32_t ray = 0; ray < numRays; ray++)
+	{
+		double from[3], to[3], closestTo[3];
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			const double center = (boundsMin[a] + boundsMax[a]) * 0.5;
+			const double extent = boundsMax[a] - boundsMin[a];
+			from[a] = center + extent * unit(random);
+			to[a] = center + extent * unit(random);
+			closestTo[a] = center + extent * 0.5 * unit(random);
+		}
+		if (ray % 2 == 0)
+			std::copy(from, from + 3, closestTo);
+		if (ray % 4 == 0)
+		{
+			to[0] = from[0];
+			to[2] = from[2];
+		}
+		double hits[2][3], distances[2];
+		const bool bHit = mesh->raycast(from, to, closestTo, hits[0], &distances[0]);
+		const bool bReferenceHit = mesh->raycastBruteForce(from, to, closestTo, hits[1], &distances[1]);
+		if (bHit != bReferenceHit || (bHit && (distances[0] != distances[1] || !std::equal(hits[0], hits[0] + 3, hits[1]))))
+			numMismatches++;
+	}
+	mesh->release();
+	return numMismatches;
+}
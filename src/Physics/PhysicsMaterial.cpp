@@ -1,59 +1,92 @@
 #include "PhysicsMaterial.h"
+#include "PhysicsMaterialManager.h"
 #include "PxPhysicsAPI.h"
+#include <assert.h>
 using namespace physx;
 
-PhysicsMaterial::PhysicsMaterial(const PhysicsMaterialCreateOptions& options)
+PhysicsMaterial::PhysicsMaterial(const PhysicsMaterialCreateOptions& options, PhysicsMaterialManager* manager)
 {
-    m_Material = make_physx_ptr<PxMaterial>(PxGetPhysics().createMaterial(options.m_StaticFriction, options.m_DynamicFriction, options.m_Restitution));
-    m_Density = options.m_Density;
+    m_Manager = manager;
+    m_Options = options;
+    if (m_Manager != nullptr)
+        m_Material = m_Manager->AcquireMaterial(m_Options);
+    else
+        m_Material = PxGetPhysics().createMaterial(options.m_StaticFriction, options.m_DynamicFriction, options.m_Restitution);
 }
 
 void PhysicsMaterial::Release()
 {
-    m_Material.reset();
+    if (m_Material == nullptr)
+        return;
+    if (m_Manager != nullptr)
+        m_Manager->ReleaseMaterial(m_Options);
+    else
+        PX_RELEASE(m_Material);
+    m_Material = nullptr;
+}
+
+bool PhysicsMaterial::_MakeExclusive()
+{
+    if (m_Material == nullptr)
+        return false;
+    if (m_Manager == nullptr)
+        return true;
+    // Only the engine's own per-body materials are shared, and nothing changes those once shapes use them.
+    const bool bDetached = m_Manager->DetachMaterial(m_Options);
+    assert(bDetached && "a shared PxMaterial cannot be changed while other materials use it");
+    if (bDetached)
+        m_Manager = nullptr;
+    return bDetached;
 }
 
 MathLib::HReal PhysicsMaterial::GetStaticFriction() const
 {
-    return m_Material->getStaticFriction();
+    return m_Options.m_StaticFriction;
 }
 
 MathLib::HReal PhysicsMaterial::GetDynamicFriction() const
 {
-    return m_Material->getDynamicFriction();
+    return m_Options.m_DynamicFriction;
 }
 
 MathLib::HReal PhysicsMaterial::GetRestitution() const
 {
-    return m_Material->getRestitution();
+    return m_Options.m_Restitution;
 }
 
 MathLib::HReal PhysicsMaterial::SetStaticFriction(const MathLib::HReal &value)
 {
-    m_Material->setStaticFriction(value);
+    if (_MakeExclusive())
+        m_Material->setStaticFriction(value);
+    m_Options.m_StaticFriction = value;
     return value;
 }
 
 MathLib::HReal PhysicsMaterial::SetDynamicFriction(const MathLib::HReal &value)
 {
-    m_Material->setDynamicFriction(value);
+    if (_MakeExclusive())
+        m_Material->setDynamicFriction(value);
+    m_Options.m_DynamicFriction = value;
     return value;
 }
 
 MathLib::HReal PhysicsMaterial::SetRestitution(const MathLib::HReal &value)
 {
-    m_Material->setRestitution(value);
+    if (_MakeExclusive())
+        m_Material->setRestitution(value);
+    m_Options.m_Restitution = value;
     return value;
 }
 
 MathLib::HReal PhysicsMaterial::GetDensity() const 
 {
-    return m_Density;
+    return m_Options.m_Density;
 }
 
 MathLib::HReal PhysicsMaterial::SetDensity(const MathLib::HReal &value)
 {
-    m_Density = value;
+    // Density only feeds the mass computation, the PxMaterial does not carry it.
+    m_Options.m_Density = value;
     return value;
 }
 
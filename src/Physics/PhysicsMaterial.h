@@ -4,11 +4,14 @@ namespace physx
 {
 	class PxMaterial;
 }
+class PhysicsMaterialManager;
 
 class PhysicsMaterial : public IPhysicsMaterial
 {
 public:
-	PhysicsMaterial(const PhysicsMaterialCreateOptions& options);
+	// With a manager the PxMaterial is shared with every other shared material of equal friction and
+	// restitution; without one the material owns its PxMaterial.
+	PhysicsMaterial(const PhysicsMaterialCreateOptions& options, PhysicsMaterialManager* manager);
 	void Release()override;
 	MathLib::HReal GetStaticFriction() const override;
 	MathLib::HReal GetDynamicFriction() const override;
@@ -21,6 +24,12 @@ public:
 	size_t GetOffset() const override;
 
 private:
-	PhysXPtr<physx::PxMaterial> m_Material;
-	MathLib::HReal m_Density;
-};
\ No newline at end of file
+	// Setters change the PxMaterial in place, so shapes already built from it follow. A shared
+	// PxMaterial is taken over from the manager first, which only works for its last user.
+	bool _MakeExclusive();
+
+private:
+	physx::PxMaterial* m_Material;
+	PhysicsMaterialCreateOptions m_Options;
+	PhysicsMaterialManager* m_Manager;
+};
@@ -0,0 +1,59 @@
+#include "PhysicsMaterialManager.h"
+#include "PxPhysicsAPI.h"
+using namespace physx;
+
+PhysicsMaterialManager::~PhysicsMaterialManager()
+{
+    Clear();
+}
+
+PxMaterial *PhysicsMaterialManager::AcquireMaterial(const PhysicsMaterialCreateOptions &options)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    MaterialInfo &info = m_Materials[options];
+    if (info.m_Material == nullptr)
+    {
+        info.m_Material = PxGetPhysics().createMaterial(options.m_StaticFriction, options.m_DynamicFriction, options.m_Restitution);
+        if (info.m_Material == nullptr)
+        {
+            m_Materials.erase(options);
+            return nullptr;
+        }
+    }
+    info.m_ReferenceCount++;
+    return info.m_Material;
+}
+
+void PhysicsMaterialManager::ReleaseMaterial(const PhysicsMaterialCreateOptions &options)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Materials.find(options);
+    if (it == m_Materials.end())
+        return;
+    MaterialInfo &info = it->second;
+    if (--info.m_ReferenceCount == 0)
+    {
+        PX_RELEASE(info.m_Material);
+        m_Materials.erase(it);
+    }
+}
+
+bool PhysicsMaterialManager::DetachMaterial(const PhysicsMaterialCreateOptions &options)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Materials.find(options);
+    if (it == m_Materials.end() || it->second.m_ReferenceCount != 1)
+        return false;
+    m_Materials.erase(it);
+    return true;
+}
+
+void PhysicsMaterialManager::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto &material : m_Materials)
+    {
+        PX_RELEASE(material.second.m_Material);
+    }
+    m_Materials.clear();
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "Physics/PhysicsCommon.h"
+#include <mutex>
 
 namespace std
 {
@@ -8,16 +9,25 @@ namespace std
 	{
 		size_t operator()(const PhysicsMaterialCreateOptions& material) const
 		{
-			return hash<MathLib::HReal>()(material.m_Restitution) ^ hash<MathLib::HReal>()(material.m_StaticFriction) ^ hash<MathLib::HReal>()(material.m_DynamicFriction) ^ hash<MathLib::HReal>()(material.m_Density);
+			size_t seed = 0;
+			auto combine = [&seed](MathLib::HReal value)
+			{
+				seed ^= hash<MathLib::HReal>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+			};
+			combine(material.m_Restitution);
+			combine(material.m_StaticFriction);
+			combine(material.m_DynamicFriction);
+			return seed;
 		}
 	};
 
+	// Density is not a PxMaterial property, materials differing only in density share one.
 	template <>
 	struct equal_to<PhysicsMaterialCreateOptions>
 	{
 		bool operator()(const PhysicsMaterialCreateOptions& lhs, const PhysicsMaterialCreateOptions& rhs) const
 		{
-			return lhs.m_Restitution == rhs.m_Restitution && lhs.m_StaticFriction == rhs.m_StaticFriction && lhs.m_DynamicFriction == rhs.m_DynamicFriction&& lhs.m_Density == rhs.m_Density;
+			return lhs.m_Restitution == rhs.m_Restitution && lhs.m_StaticFriction == rhs.m_StaticFriction && lhs.m_DynamicFriction == rhs.m_DynamicFriction;
 		}
 	};
 };
@@ -27,14 +37,31 @@ namespace physx
 	class PxMaterial;
 }
 
+// Deduplicating registry of PxMaterials. Identical create options share one PxMaterial,
+// which is released once the last PhysicsMaterial referencing it goes away. Thread-safe.
 class PhysicsMaterialManager
 {
 public:
+	PhysicsMaterialManager() = default;
+	~PhysicsMaterialManager();
+
+	physx::PxMaterial* AcquireMaterial(const PhysicsMaterialCreateOptions& options);
+	void ReleaseMaterial(const PhysicsMaterialCreateOptions& options);
+	// Hands the PxMaterial over to its last user, who releases it from then on. Fails while it is shared.
+	bool DetachMaterial(const PhysicsMaterialCreateOptions& options);
+	uint32_t GetMaterialCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return static_cast<uint32_t>(m_Materials.size());
+	}
+	void Clear();
+
 private:
 	struct MaterialInfo
 	{
 		physx::PxMaterial* m_Material = nullptr;
-		uint32_t m_ReferenceCount;
+		uint32_t m_ReferenceCount = 0;
 	};
 	std::unordered_map<PhysicsMaterialCreateOptions,MaterialInfo > m_Materials;
-};
\ No newline at end of file
+	mutable std::mutex m_Mutex;
+};
@@ -2,96 +2,40 @@
 #include "PxPhysicsAPI.h"
 #include "PxRigidDynamic.h"
 #include "ColliderGeometry.h"
+#include "ConvexMeshLODChain.h"
+#include "ShapeFactory.h"
+#include "PhysicsPrefab.h"
 #include "PhysicsMaterial.h"
+#include "PhysicsEngine.h"
+#include "PhysicsScene.h"
+#include "TriangleMeshDecompositionCache.h"
 #include "Utility/PhysXUtils.h"
 #include "Utility/PhysicsUtils.h"
+#include "Utility/PhysicsBoundsUtils.h"
+#include <algorithm>
+#include <cmath>
 using namespace physx;
-class ShapeFactory
-{
-public:
-	static physx::PxShape *CreateShape(const IColliderGeometry *cGeo, IPhysicsMaterial *material)
-	{
-		if (cGeo == nullptr)
-			return nullptr;
-		physx::PxShape *shape = nullptr;
-		physx::PxPhysics *physics = &PxGetPhysics();
-		const PhysXPtr<physx::PxMaterial> *pxMaterial = reinterpret_cast<const PhysXPtr<physx::PxMaterial> *>(reinterpret_cast<char *>(material) + material->GetOffset());
-		switch (cGeo->GetType())
-		{
-		case CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX:
-		{
-			const BoxColliderGeometry *box = static_cast<const BoxColliderGeometry *>(cGeo);
-			const MathLib::HVector3 &halfSize = box->GetHalfSize();
-			const MathLib::HVector3 &scale = box->GetScale();
-			PxBoxGeometry geometry(halfSize[0] * scale[0], halfSize[1] * scale[1], halfSize[2] * scale[2]);
-			shape = physics->createShape(geometry, *pxMaterial->get());
-			break;
-		}
-		case CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE:
-		{
-			const SphereColliderGeometry *sphere = static_cast<const SphereColliderGeometry *>(cGeo);
-			const MathLib::HReal &radius = sphere->GetRadius();
-			const MathLib::HVector3 &scale = sphere->GetScale();
-			PxSphereGeometry geometry(radius * scale[0]);
-			shape = physics->createShape(geometry, *pxMaterial->get());
-			break;
-		}
-		case CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE:
-		{
-			shape = physics->createShape(PxPlaneGeometry(), *pxMaterial->get());
-			break;
-		}
-		case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE:
-		{
-			const CapsuleColliderGeometry *capsule = static_cast<const CapsuleColliderGeometry *>(cGeo);
-			const MathLib::HReal &radius = capsule->GetRadius();
-			const MathLib::HReal &halfHeight = capsule->GetHalfHeight();
-			const MathLib::HVector3 &scale = capsule->GetScale();
-			PxCapsuleGeometry geometry(radius * scale[0], halfHeight * scale[0]);
-			shape = physics->createShape(geometry, *pxMaterial->get());
-			break;
-		}
-		case CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH:
-		{
-			const TriangleMeshColliderGeometry *triangleMesh = static_cast<const TriangleMeshColliderGeometry *>(cGeo);
-			const std::vector<MathLib::HVector3> &vertices = triangleMesh->GetVertices();
-			const std::vector<uint32_t> &indices = triangleMesh->GetIndices();
-			PxTriangleMesh *mesh = PhysXConstructTools::CreatePxTriangleMesh<true>(vertices.size(), vertices.data(), indices.size() / 3, indices.data());
-			const MathLib::HVector3 &scale = triangleMesh->GetScale();
-			PxTriangleMeshGeometry geometry(mesh, PxMeshScale(ConvertUtils::ToPx(scale)));
-			shape = physics->createShape(geometry, *pxMaterial->get());
-			PX_RELEASE(mesh);
-			break;
-		}
-		case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH:
-		{
-			const ConvexMeshColliderGeometry *convexMesh = static_cast<const ConvexMeshColliderGeometry *>(cGeo);
-			const std::vector<MathLib::HVector3> &vertices = convexMesh->GetVertices();
-			PxConvexMesh *mesh = PhysXConstructTools::CreatePxConvexMesh<true, 256>(vertices.size(), vertices.data());
-			const MathLib::HVector3 &scale = convexMesh->GetScale();
-			PxConvexMeshGeometry geometry(mesh, PxMeshScale(ConvertUtils::ToPx(scale)));
-			shape = physics->createShape(geometry, *pxMaterial->get());
-			PX_RELEASE(mesh);
-			break;
-		}
-		default:
-			break;
-		};
-		return shape;
-	};
-};
-
 PhysicsRigidDynamic::PhysicsRigidDynamic(PhysicsPtr<IPhysicsMaterial> &material)
 {
 	m_RigidDynamic = make_physx_ptr<PxRigidDynamic>(PxGetPhysics().createRigidDynamic(PxTransform(PxIdentity)));
-	m_RigidDynamic->setSolverIterationCounts(PhysicsEngineUtils::GetPhysicsEngine()->GetSolverIterationCount());
+	m_DefaultPositionIterations = PhysicsEngineUtils::GetPhysicsEngine()->GetSolverIterationCount();
+	m_SolverBudgetScale = 1.0f;
+	m_RigidDynamic->setSolverIterationCounts(m_DefaultPositionIterations);
+	m_DefaultSleepThreshold = m_RigidDynamic->getSleepThreshold();
+	m_DefaultStabilizationThreshold = m_RigidDynamic->getStabilizationThreshold();
 	m_Material = material;
+	m_PendingWrites = 0;
+	m_PendingWriteIndex = NotQueued;
 	m_bIsKinematic = false;
+	m_bSimulationEnabled = true;
 	m_Mass = 0.0f;
 	m_LinearVelocity.setZero();
 	m_AngularVelocity.setZero();
 	m_AngularDamping = 0.0f;
+	m_ConvexLOD = 0;
+	m_LODImportance = 1.0f;
 	m_Transform.setIdentity();
+	m_bTransformDirty = false;
 	m_BoundingBox.setEmpty();
 	m_Type = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
 }
@@ -106,11 +50,12 @@ void PhysicsRigidDynamic::Update()
 {
 	if (m_RigidDynamic == nullptr)
 		return;
-	m_RigidDynamic->setSolverIterationCounts(PhysicsEngineUtils::GetPhysicsEngine()->GetSolverIterationCount());
-	m_AngularDamping = m_RigidDynamic->getAngularDamping();
+	if (!m_PendingDecompositions.empty())
+		_ResolvePendingDecompositions();
 	m_LinearVelocity = ConvertUtils::FromPx(m_RigidDynamic->getLinearVelocity());
 	m_AngularVelocity = ConvertUtils::FromPx(m_RigidDynamic->getAngularVelocity());
-	m_Transform = ConvertUtils::FromPx(m_RigidDynamic->getGlobalPose());
+	m_Pose = ConvertUtils::ToPose(m_RigidDynamic->getGlobalPose());
+	m_bTransformDirty = true;
 }
 
 void PhysicsRigidDynamic::SetKinematic(bool bKinematic)
@@ -123,57 +68,263 @@ void PhysicsRigidDynamic::SetKinematic(bool bKinematic)
 
 bool PhysicsRigidDynamic::AddColliderGeometry(PhysicsPtr<IColliderGeometry> &colliderGeometry, const MathLib::HTransform3 &localTrans)
 {
-	if (m_RigidDynamic == nullptr || colliderGeometry == nullptr || colliderGeometry->GetType() == CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH)
+	if (m_RigidDynamic == nullptr || colliderGeometry == nullptr)
 		return false;
-	physx::PxShape *shape = ShapeFactory::CreateShape(colliderGeometry.get(), m_Material.get());
-	if (shape == nullptr)
+	// Heightfields are only supported on static actors, triangle meshes only through their convex decomposition.
+	if (colliderGeometry->GetType() == CollierGeometryType::COLLIER_GEOMETRY_TYPE_HEIGHTFIELD)
+		return false;
+	if (colliderGeometry->GetType() == CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH)
+		return _AddDecomposedTriangleMesh(colliderGeometry, localTrans);
+	if (_AttachShape(colliderGeometry.get(), localTrans) == nullptr)
 		return false;
-	shape->setLocalPose(ConvertUtils::ToPx(localTrans));
+	PxRigidBodyExt::updateMassAndInertia(*m_RigidDynamic, m_Material->GetDensity());
+	m_Mass = m_RigidDynamic->getMass();
+	m_ColliderGeometries.push_back(colliderGeometry);
+	m_ColliderLocalPos.push_back(localTrans);
+	m_BoundingBox = ComputeBoundingBox(this);
+	return true;
+}
+
+physx::PxShape *PhysicsRigidDynamic::_AttachShape(const IColliderGeometry *colliderGeometry, const MathLib::HTransform3 &localTrans)
+{
+	physx::PxShape *shape = ShapeFactory::CreateShape(colliderGeometry, m_Material.get(), m_ConvexLOD);
+	if (shape == nullptr)
+		return nullptr;
+	const ColliderGeometry *geometry = static_cast<const ColliderGeometry *>(colliderGeometry);
+	shape->setLocalPose(ShapeFactory::ComputeLocalPose(colliderGeometry, localTrans));
 	m_RigidDynamic->attachShape(*shape);
+	if (geometry->GetConvexLODs() && geometry->GetConvexLODs()->GetLODCount() > 1)
+		m_ConvexLODShapes.push_back({shape, geometry->GetConvexLODs(), geometry->GetScale()});
+	// The actor holds the remaining reference; PX_RELEASE would null the pointer returned below.
+	shape->release();
+	return shape;
+}
+
+bool PhysicsRigidDynamic::_AddDecomposedTriangleMesh(PhysicsPtr<IColliderGeometry> &colliderGeometry, const MathLib::HTransform3 &localTrans)
+{
+	const PhysicsEngine *engine = static_cast<const PhysicsEngine *>(PhysicsEngineUtils::GetPhysicsEngine());
+	TriangleMeshDecompositionCache *decompositionCache = engine->GetTriangleMeshDecompositionCache();
+	if (decompositionCache == nullptr)
+		return false;
+	const ColliderGeometry *triangleMesh = static_cast<const ColliderGeometry *>(colliderGeometry.get());
+	std::shared_ptr<const TriangleMeshDecomposition> decomposition = decompositionCache->GetDecomposition(triangleMesh->GetGeometryParams<TriangleMeshGeometryParams>()->m_MeshData);
+	if (decomposition == nullptr)
+		return false;
+
+	// The single convex hull stands in until the background decomposition is done.
+	const MathLib::HTransform3 hullTrans = localTrans * triangleMesh->GetLocalTransform();
+	ColliderGeometry placeholder(ConvexMeshGeometryParams{decomposition->m_ConvexHull});
+	placeholder.SetScale(triangleMesh->GetScale());
+	physx::PxShape *placeholderShape = _AttachShape(&placeholder, hullTrans);
+	if (placeholderShape == nullptr)
+		return false;
+	m_PendingDecompositions.push_back({decomposition, triangleMesh->GetScale(), hullTrans, placeholderShape});
+
 	PxRigidBodyExt::updateMassAndInertia(*m_RigidDynamic, m_Material->GetDensity());
-	PX_RELEASE(shape);
 	m_Mass = m_RigidDynamic->getMass();
 	m_ColliderGeometries.push_back(colliderGeometry);
 	m_ColliderLocalPos.push_back(localTrans);
 	m_BoundingBox = ComputeBoundingBox(this);
+	_ResolvePendingDecompositions();
 	return true;
 }
 
+void PhysicsRigidDynamic::_ResolvePendingDecompositions()
+{
+	bool bShapesChanged = false;
+	for (auto it = m_PendingDecompositions.begin(); it != m_PendingDecompositions.end();)
+	{
+		if (!it->m_Decomposition->IsReady())
+		{
+			++it;
+			continue;
+		}
+		const std::vector<PhysicsMeshDataPtr> &convexHulls = it->m_Decomposition->m_ConvexHulls.get();
+		if (!convexHulls.empty())
+		{
+			m_RigidDynamic->detachShape(*it->m_PlaceholderShape);
+			for (const PhysicsMeshDataPtr &convexHull : convexHulls)
+			{
+				ColliderGeometry hull(ConvexMeshGeometryParams{convexHull});
+				hull.SetScale(it->m_Scale);
+				_AttachShape(&hull, it->m_LocalTrans);
+			}
+			bShapesChanged = true;
+		}
+		it = m_PendingDecompositions.erase(it);
+	}
+	if (bShapesChanged)
+	{
+		PxRigidBodyExt::updateMassAndInertia(*m_RigidDynamic, m_Material->GetDensity());
+		m_Mass = m_RigidDynamic->getMass();
+	}
+}
+
+void PhysicsRigidDynamic::SetConvexLOD(uint32_t lod)
+{
+	if (m_RigidDynamic == nullptr || lod == m_ConvexLOD)
+		return;
+	m_ConvexLOD = lod;
+	// Shapes are shared by default and cannot be edited while in a scene, so each one is replaced.
+	// Mass properties are left alone: the LOD only changes what collides, not how the body moves.
+	for (ConvexLODShape &lodShape : m_ConvexLODShapes)
+	{
+		if (lodShape.m_LODs->GetConvexMesh(lod) == static_cast<const PxConvexMeshGeometry &>(lodShape.m_Shape->getGeometry()).convexMesh)
+			continue;
+		PxMaterial *material = nullptr;
+		lodShape.m_Shape->getMaterials(&material, 1);
+		physx::PxShape *shape = ShapeFactory::CreateShape(*lodShape.m_LODs, lod, lodShape.m_Scale, *material);
+		if (shape == nullptr)
+			continue;
+		shape->setLocalPose(lodShape.m_Shape->getLocalPose());
+		m_RigidDynamic->detachShape(*lodShape.m_Shape);
+		m_RigidDynamic->attachShape(*shape);
+		shape->release();
+		lodShape.m_Shape = shape;
+	}
+}
+
 size_t PhysicsRigidDynamic::GetOffset() const
 {
 	return offsetof(PhysicsRigidDynamic, m_RigidDynamic);
 }
 
-void PhysicsRigidDynamic::SetTransform(const MathLib::HTransform3 &transform)
+void PhysicsRigidDynamic::SetPose(const PhysicsPose &pose)
 {
 	if (m_RigidDynamic == nullptr)
 		return;
-	m_RigidDynamic->setGlobalPose(ConvertUtils::ToPx(transform));
-	m_Transform = transform;
+	m_Pose = pose;
+	m_bTransformDirty = true;
+	_MarkPending(PENDING_WRITE_POSE);
+}
+
+void PhysicsRigidDynamic::SetTransform(const MathLib::HTransform3 &transform)
+{
+	SetPose(PhysicsPose(transform));
+}
+
+const MathLib::HTransform3 &PhysicsRigidDynamic::GetTransform() const
+{
+	if (m_bTransformDirty)
+	{
+		m_Transform = m_Pose.ToTransform();
+		m_bTransformDirty = false;
+	}
+	return m_Transform;
 }
 
 void PhysicsRigidDynamic::SetAngularDamping(const MathLib::HReal &damping)
 {
 	if (m_RigidDynamic == nullptr)
 		return;
-	m_RigidDynamic->setAngularDamping(damping);
 	m_AngularDamping = damping;
+	_MarkPending(PENDING_WRITE_ANGULAR_DAMPING);
 }
 
 void PhysicsRigidDynamic::SetLinearVelocity(const MathLib::HVector3 &velocity)
 {
 	if (m_RigidDynamic == nullptr)
 		return;
-	m_RigidDynamic->setLinearVelocity(ConvertUtils::ToPx(velocity));
 	m_LinearVelocity = velocity;
+	_MarkPending(PENDING_WRITE_LINEAR_VELOCITY);
 }
 
 void PhysicsRigidDynamic::SetAngularVelocity(const MathLib::HVector3 &velocity)
 {
 	if (m_RigidDynamic == nullptr)
 		return;
-	m_RigidDynamic->setAngularVelocity(ConvertUtils::ToPx(velocity));
 	m_AngularVelocity = velocity;
+	_MarkPending(PENDING_WRITE_ANGULAR_VELOCITY);
+}
+
+void PhysicsRigidDynamic::SetLODImportance(const MathLib::HReal &importance)
+{
+	// SelectConvexLODs divides by the importance, so only positive values are taken.
+	if (m_RigidDynamic == nullptr || !(importance > 0) || importance == m_LODImportance)
+		return;
+	m_LODImportance = importance;
+	if (m_SolverBudgetScale != 1.0f)
+		_MarkPending(PENDING_WRITE_SOLVER_ITERATIONS);
+}
+
+void PhysicsRigidDynamic::SetSolverOverrides(const PhysicsSolverOverrides &overrides)
+{
+	if (m_RigidDynamic == nullptr)
+		return;
+	m_SolverOverrides = overrides;
+	_MarkPending(PENDING_WRITE_SOLVER_ITERATIONS | PENDING_WRITE_SLEEP_THRESHOLDS);
+}
+
+void PhysicsRigidDynamic::SetSolverDefaults(uint32_t positionIterations, MathLib::HReal budgetScale)
+{
+	if (m_RigidDynamic == nullptr || (positionIterations == m_DefaultPositionIterations && budgetScale == m_SolverBudgetScale))
+		return;
+	const uint32_t previousIterations = _ComputePositionIterations();
+	m_DefaultPositionIterations = positionIterations;
+	m_SolverBudgetScale = budgetScale;
+	if (_ComputePositionIterations() != previousIterations)
+		_MarkPending(PENDING_WRITE_SOLVER_ITERATIONS);
+}
+
+uint32_t PhysicsRigidDynamic::_ComputePositionIterations() const
+{
+	if (m_SolverOverrides.m_PositionIterations)
+		return *m_SolverOverrides.m_PositionIterations;
+	// Under load only unimportant bodies are cut, with headroom only important ones are raised.
+	MathLib::HReal scale = 1.0f;
+	if (m_LODImportance < 1.0f)
+		scale = std::min(m_SolverBudgetScale, MathLib::HReal(1));
+	else if (m_LODImportance > 1.0f)
+		scale = std::max(m_SolverBudgetScale, MathLib::HReal(1));
+	return std::clamp(uint32_t(std::lround(MathLib::HReal(m_DefaultPositionIterations) * scale)), 1u, 255u);
+}
+
+void PhysicsRigidDynamic::FlushPendingWrites()
+{
+	if (m_RigidDynamic == nullptr || m_PendingWrites == 0)
+		return;
+	if (m_PendingWrites & PENDING_WRITE_POSE)
+		m_RigidDynamic->setGlobalPose(ConvertUtils::ToPx(m_Pose));
+	if (m_PendingWrites & PENDING_WRITE_SOLVER_ITERATIONS)
+		m_RigidDynamic->setSolverIterationCounts(_ComputePositionIterations(), m_SolverOverrides.m_VelocityIterations.value_or(1));
+	if (m_PendingWrites & PENDING_WRITE_SLEEP_THRESHOLDS)
+	{
+		m_RigidDynamic->setSleepThreshold(m_SolverOverrides.m_SleepThreshold.value_or(m_DefaultSleepThreshold));
+		m_RigidDynamic->setStabilizationThreshold(m_SolverOverrides.m_StabilizationThreshold.value_or(m_DefaultStabilizationThreshold));
+	}
+	// PhysX rejects velocity and damping writes on disabled actors, so they wait for SetSimulationEnabled(true).
+	if (!m_bSimulationEnabled)
+	{
+		m_PendingWrites &= PENDING_WRITE_LINEAR_VELOCITY | PENDING_WRITE_ANGULAR_VELOCITY | PENDING_WRITE_ANGULAR_DAMPING;
+		return;
+	}
+	if (m_PendingWrites & PENDING_WRITE_LINEAR_VELOCITY)
+		m_RigidDynamic->setLinearVelocity(ConvertUtils::ToPx(m_LinearVelocity));
+	if (m_PendingWrites & PENDING_WRITE_ANGULAR_VELOCITY)
+		m_RigidDynamic->setAngularVelocity(ConvertUtils::ToPx(m_AngularVelocity));
+	if (m_PendingWrites & PENDING_WRITE_ANGULAR_DAMPING)
+		m_RigidDynamic->setAngularDamping(m_AngularDamping);
+	m_PendingWrites = 0;
+}
+
+void PhysicsRigidDynamic::_MarkPending(uint32_t writes)
+{
+	m_PendingWrites |= writes;
+	_QueuePendingWrites();
+}
+
+void PhysicsRigidDynamic::_QueuePendingWrites()
+{
+	if (m_PendingWriteIndex != NotQueued)
+		return;
+	// Outside a scene there is no simulation to batch against, so the writes go straight through.
+	PxScene *scene = m_RigidDynamic->getScene();
+	if (scene == nullptr)
+	{
+		FlushPendingWrites();
+		return;
+	}
+	static_cast<PhysicsScene *>(scene->userData)->QueuePendingWrites(this);
 }
 
 bool PhysicsRigidDynamic::IsSleeping() const
@@ -187,7 +338,38 @@ MathLib::HAABBox3D PhysicsRigidDynamic::GetWorldBoundingBox() const
 {
 	if (m_RigidDynamic == nullptr)
 		return MathLib::HAABBox3D();
-	return ConvertUtils::FromPx(m_RigidDynamic->getWorldBounds());
+	return PhysicsBoundsUtils::TransformBoundingBox(m_BoundingBox, m_Pose);
+}
+
+void PhysicsRigidDynamic::InitFromPrefab(const PhysicsPrefabState &state, const MathLib::HTransform3 &transform)
+{
+	if (m_RigidDynamic == nullptr)
+		return;
+	SetTransform(transform);
+	for (size_t i = 0; i < state.m_Shapes.size(); i++)
+	{
+		m_RigidDynamic->attachShape(*state.m_Shapes[i]);
+		const ColliderGeometry *geometry = static_cast<const ColliderGeometry *>(state.m_ColliderGeometries[i].get());
+		if (geometry->GetConvexLODs() && geometry->GetConvexLODs()->GetLODCount() > 1)
+			m_ConvexLODShapes.push_back({state.m_Shapes[i], geometry->GetConvexLODs(), geometry->GetScale()});
+	}
+	m_RigidDynamic->setMass(state.m_Mass);
+	m_RigidDynamic->setMassSpaceInertiaTensor(ConvertUtils::ToPx(state.m_MassSpaceInertia));
+	m_RigidDynamic->setCMassLocalPose(ConvertUtils::ToPx(state.m_MassFrame));
+	m_Mass = state.m_Mass;
+	m_ColliderGeometries = state.m_ColliderGeometries;
+	m_ColliderLocalPos = state.m_ColliderLocalTransforms;
+	m_BoundingBox = state.m_BoundingBox;
+}
+
+void PhysicsRigidDynamic::SetSimulationEnabled(bool bEnabled)
+{
+	if (m_RigidDynamic == nullptr || bEnabled == m_bSimulationEnabled)
+		return;
+	m_RigidDynamic->setActorFlag(PxActorFlag::eDISABLE_SIMULATION, !bEnabled);
+	m_bSimulationEnabled = bEnabled;
+	if (bEnabled && m_PendingWrites != 0)
+		_QueuePendingWrites();
 }
 
 /////////////////RigidStatic////////////////////////
@@ -196,7 +378,9 @@ PhysicsRigidStatic::PhysicsRigidStatic(PhysicsPtr<IPhysicsMaterial> &material)
 	m_RigidStatic = make_physx_ptr<PxRigidStatic>(PxGetPhysics().createRigidStatic(PxTransform(PxIdentity)));
 	m_Material = material;
 	m_Transform.setIdentity();
+	m_bTransformDirty = false;
 	m_BoundingBox.setEmpty();
+	m_bSimulationEnabled = true;
 	m_Type = PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC;
 }
 
@@ -212,16 +396,7 @@ bool PhysicsRigidStatic::AddColliderGeometry(PhysicsPtr<IColliderGeometry> &coll
 	physx::PxShape *shape = ShapeFactory::CreateShape(colliderGeometry.get(), m_Material.get());
 	if (shape == nullptr)
 		return false;
-	if (colliderGeometry->GetType() == CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE)
-	{
-		const PlaneColliderGeometry *plane = static_cast<const PlaneColliderGeometry *>(colliderGeometry.get());
-		const MathLib::HVector3 &normal = plane->GetNormal();
-		const MathLib::HReal &distance = plane->GetDistance();
-		auto trans = PxTransformFromPlaneEquation(PxPlane(normal[0], normal[1], normal[2], distance));
-		shape->setLocalPose(ConvertUtils::ToPx(localTrans).transform(trans));
-	}
-	else
-		shape->setLocalPose(ConvertUtils::ToPx(localTrans));
+	shape->setLocalPose(ShapeFactory::ComputeLocalPose(colliderGeometry.get(), localTrans));
 	m_RigidStatic->attachShape(*shape);
 	PX_RELEASE(shape);
 	m_ColliderGeometries.push_back(colliderGeometry);
@@ -235,17 +410,53 @@ size_t PhysicsRigidStatic::GetOffset() const
 	return offsetof(PhysicsRigidStatic, m_RigidStatic);
 }
 
-void PhysicsRigidStatic::SetTransform(const MathLib::HTransform3 &transform)
+void PhysicsRigidStatic::SetPose(const PhysicsPose &pose)
 {
 	if (m_RigidStatic == nullptr)
 		return;
-	m_RigidStatic->setGlobalPose(ConvertUtils::ToPx(transform));
-	m_Transform = transform;
+	m_RigidStatic->setGlobalPose(ConvertUtils::ToPx(pose));
+	m_Pose = pose;
+	m_bTransformDirty = true;
+}
+
+void PhysicsRigidStatic::SetTransform(const MathLib::HTransform3 &transform)
+{
+	SetPose(PhysicsPose(transform));
+}
+
+const MathLib::HTransform3 &PhysicsRigidStatic::GetTransform() const
+{
+	if (m_bTransformDirty)
+	{
+		m_Transform = m_Pose.ToTransform();
+		m_bTransformDirty = false;
+	}
+	return m_Transform;
 }
 
 MathLib::HAABBox3D PhysicsRigidStatic::GetWorldBoundingBox() const
 {
 	if (m_RigidStatic == nullptr)
 		return MathLib::HAABBox3D();
-	return ConvertUtils::FromPx(m_RigidStatic->getWorldBounds());
+	return PhysicsBoundsUtils::TransformBoundingBox(m_BoundingBox, m_Pose);
+}
+
+void PhysicsRigidStatic::InitFromPrefab(const PhysicsPrefabState &state, const MathLib::HTransform3 &transform)
+{
+	if (m_RigidStatic == nullptr)
+		return;
+	SetTransform(transform);
+	for (physx::PxShape *shape : state.m_Shapes)
+		m_RigidStatic->attachShape(*shape);
+	m_ColliderGeometries = state.m_ColliderGeometries;
+	m_ColliderLocalPos = state.m_ColliderLocalTransforms;
+	m_BoundingBox = state.m_BoundingBox;
+}
+
+void PhysicsRigidStatic::SetSimulationEnabled(bool bEnabled)
+{
+	if (m_RigidStatic == nullptr || bEnabled == m_bSimulationEnabled)
+		return;
+	m_RigidStatic->setActorFlag(PxActorFlag::eDISABLE_SIMULATION, !bEnabled);
+	m_bSimulationEnabled = bEnabled;
 }
\ No newline at end of file
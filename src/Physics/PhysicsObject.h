@@ -6,7 +6,11 @@ namespace physx
 	class PxRigidDynamic;
 	class PxRigidStatic;
 	class PxHeightField;
+	class PxShape;
 }
+struct TriangleMeshDecomposition;
+struct PhysicsPrefabState;
+class ConvexMeshLODChain;
 
 class PhysicsRigidDynamic : public IPhysicsObject,virtual public IDynamicObject
 {
@@ -17,18 +21,19 @@ public:
 	void Update() override;
 	bool IsValid() const override { return m_RigidDynamic != nullptr; };
 	bool AddColliderGeometry(PhysicsPtr < IColliderGeometry >&colliderGeometry, const MathLib::HTransform3 &localTrans) override;
-	void GetColliderGeometries(std::vector<PhysicsPtr<IColliderGeometry>>& geomeries, std::vector<MathLib::HTransform3>* geoLocalPos = nullptr) override
-	{
-		geomeries = m_ColliderGeometries; 
-		if (geoLocalPos)
-			*geoLocalPos = m_ColliderLocalPos;
-	};
+	const std::vector<PhysicsPtr<IColliderGeometry>>& GetColliderGeometries() const override { return m_ColliderGeometries; };
+	const std::vector<MathLib::HTransform3>& GetColliderLocalTransforms() const override { return m_ColliderLocalPos; };
 	PhysicsObjectType GetType() const override { return m_Type; };
 	size_t GetOffset() const override;
+	void SetPose(const PhysicsPose &pose) override;
+	const PhysicsPose &GetPose() const override { return m_Pose; };
 	void SetTransform(const MathLib::HTransform3 &trans) override;
-	const MathLib::HTransform3 &GetTransform() const override { return m_Transform; };
+	const MathLib::HTransform3 &GetTransform() const override;
 	MathLib::HAABBox3D GetLocalBoundingBox() const override { return m_BoundingBox; };
 	MathLib::HAABBox3D GetWorldBoundingBox() const override;
+	void SetSimulationEnabled(bool bEnabled) override;
+	bool IsSimulationEnabled() const override { return m_bSimulationEnabled; };
+	void InitFromPrefab(const PhysicsPrefabState &state, const MathLib::HTransform3 &transform);
 
 public:
 	void SetAngularDamping(const MathLib::HReal &damping)override;
@@ -41,20 +46,80 @@ public:
 	MathLib::HReal GetAngularDamping() const override { return m_AngularDamping; };
 	MathLib::HVector3 GetAngularVelocity() const override { return m_AngularVelocity; };
 	bool IsSleeping() const override;
+	void SetConvexLOD(uint32_t lod) override;
+	uint32_t GetConvexLOD() const override { return m_ConvexLOD; };
+	void SetLODImportance(const MathLib::HReal &importance) override;
+	MathLib::HReal GetLODImportance() const override { return m_LODImportance; };
+	void SetSolverOverrides(const PhysicsSolverOverrides &overrides) override;
+	const PhysicsSolverOverrides &GetSolverOverrides() const override { return m_SolverOverrides; };
+
+public:
+	// Setters only record their value; the scene flushes the accumulated writes right before simulate.
+	void SetSolverDefaults(uint32_t positionIterations, MathLib::HReal budgetScale);
+	void FlushPendingWrites();
+	// Slot in the scene's pending-write list, kept by the scene so removal does not search the list.
+	static constexpr uint32_t NotQueued = UINT32_MAX;
+	uint32_t GetPendingWriteIndex() const { return m_PendingWriteIndex; }
+	void SetPendingWriteIndex(uint32_t index) { m_PendingWriteIndex = index; }
+
+private:
+	enum PendingWrite : uint32_t
+	{
+		PENDING_WRITE_POSE = 1 << 0,
+		PENDING_WRITE_LINEAR_VELOCITY = 1 << 1,
+		PENDING_WRITE_ANGULAR_VELOCITY = 1 << 2,
+		PENDING_WRITE_ANGULAR_DAMPING = 1 << 3,
+		PENDING_WRITE_SOLVER_ITERATIONS = 1 << 4,
+		PENDING_WRITE_SLEEP_THRESHOLDS = 1 << 5,
+	};
+	void _MarkPending(uint32_t writes);
+	uint32_t _ComputePositionIterations() const;
+	void _QueuePendingWrites();
+	physx::PxShape *_AttachShape(const IColliderGeometry *colliderGeometry, const MathLib::HTransform3 &localTrans);
+	bool _AddDecomposedTriangleMesh(PhysicsPtr<IColliderGeometry> &colliderGeometry, const MathLib::HTransform3 &localTrans);
+	void _ResolvePendingDecompositions();
 
 private:
+	struct PendingDecomposition
+	{
+		std::shared_ptr<const TriangleMeshDecomposition> m_Decomposition;
+		MathLib::HVector3 m_Scale;
+		MathLib::HTransform3 m_LocalTrans;
+		physx::PxShape *m_PlaceholderShape;
+	};
+	struct ConvexLODShape
+	{
+		physx::PxShape *m_Shape;
+		std::shared_ptr<const ConvexMeshLODChain> m_LODs;
+		MathLib::HVector3 m_Scale;
+	};
+
 	PhysicsObjectType m_Type;
 	PhysXPtr<physx::PxRigidDynamic> m_RigidDynamic;
 	PhysicsPtr<IPhysicsMaterial>  m_Material;
 	std::vector<PhysicsPtr<IColliderGeometry>> m_ColliderGeometries;
 	std::vector<MathLib::HTransform3> m_ColliderLocalPos;
 	bool m_bIsKinematic;
+	bool m_bSimulationEnabled;
 	MathLib::HReal m_Mass;
 	MathLib::HVector3 m_LinearVelocity;
 	MathLib::HReal m_AngularDamping;
 	MathLib::HVector3 m_AngularVelocity;
-	MathLib::HTransform3 m_Transform;
+	PhysicsPose m_Pose;
+	mutable MathLib::HTransform3 m_Transform;
+	mutable bool m_bTransformDirty;
 	MathLib::HAABBox3D m_BoundingBox;
+	std::vector<PendingDecomposition> m_PendingDecompositions;
+	std::vector<ConvexLODShape> m_ConvexLODShapes;
+	uint32_t m_ConvexLOD;
+	MathLib::HReal m_LODImportance;
+	PhysicsSolverOverrides m_SolverOverrides;
+	uint32_t m_DefaultPositionIterations;
+	MathLib::HReal m_SolverBudgetScale;
+	MathLib::HReal m_DefaultSleepThreshold;
+	MathLib::HReal m_DefaultStabilizationThreshold;
+	uint32_t m_PendingWrites;
+	uint32_t m_PendingWriteIndex;
 };
 
 class PhysicsRigidStatic : public IPhysicsObject
@@ -65,19 +130,20 @@ public:
 	void Release()override;
 	void Update() override {}
 	bool IsValid() const override { return m_RigidStatic != nullptr; };
-	void SetTransform(const MathLib::HTransform3 &trans);
-	const MathLib::HTransform3 &GetTransform() const override { return m_Transform; };
+	void SetPose(const PhysicsPose &pose) override;
+	const PhysicsPose &GetPose() const override { return m_Pose; };
+	void SetTransform(const MathLib::HTransform3 &trans) override;
+	const MathLib::HTransform3 &GetTransform() const override;
 	bool AddColliderGeometry(PhysicsPtr < IColliderGeometry >&colliderGeometry, const MathLib::HTransform3 &localTrans) override;	
-	void GetColliderGeometries(std::vector<PhysicsPtr<IColliderGeometry>>& geomeries, std::vector<MathLib::HTransform3>* geoLocalPos=nullptr) override 
-	{ 
-		geomeries = m_ColliderGeometries; 
-		if(geoLocalPos)
-			*geoLocalPos = m_ColliderLocalPos;
-	};
+	const std::vector<PhysicsPtr<IColliderGeometry>>& GetColliderGeometries() const override { return m_ColliderGeometries; };
+	const std::vector<MathLib::HTransform3>& GetColliderLocalTransforms() const override { return m_ColliderLocalPos; };
 	PhysicsObjectType GetType() const override { return m_Type; };
 	size_t GetOffset() const override;
 	MathLib::HAABBox3D GetLocalBoundingBox() const override { return m_BoundingBox; };
 	MathLib::HAABBox3D GetWorldBoundingBox() const override;
+	void SetSimulationEnabled(bool bEnabled) override;
+	bool IsSimulationEnabled() const override { return m_bSimulationEnabled; };
+	void InitFromPrefab(const PhysicsPrefabState &state, const MathLib::HTransform3 &transform);
 
 private:
 	PhysicsObjectType m_Type;
@@ -85,6 +151,9 @@ private:
 	PhysicsPtr<IPhysicsMaterial> m_Material;
 	std::vector<PhysicsPtr<IColliderGeometry>> m_ColliderGeometries;
 	std::vector<MathLib::HTransform3> m_ColliderLocalPos;
-	MathLib::HTransform3 m_Transform;
+	PhysicsPose m_Pose;
+	mutable MathLib::HTransform3 m_Transform;
+	mutable bool m_bTransformDirty;
 	MathLib::HAABBox3D m_BoundingBox;
+	bool m_bSimulationEnabled;
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "PhysicsPrefab.h"
+#include "PxPhysicsAPI.h"
+#include "PhysicsObject.h"
+#include "ShapeFactory.h"
+#include "Utility/PhysicsUtils.h"
+using namespace physx;
+
+PhysicsPrefab::PhysicsPrefab(const PhysicsPrefabCreateOptions &options, PhysicsPtr<IPhysicsMaterial> &material)
+{
+    m_ObjectType = options.m_ObjectOptions.m_ObjectType;
+    m_Material = material;
+    for (size_t i = 0; i < options.m_ColliderGeometries.size(); i++)
+    {
+        const PhysicsPtr<IColliderGeometry> &geometry = options.m_ColliderGeometries[i];
+        if (geometry == nullptr)
+            continue;
+        const CollierGeometryType type = geometry->GetType();
+        // Instances without these colliders would collide unlike what was asked for, so the prefab is left invalid.
+        if (m_ObjectType == PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC &&
+            (type == CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH || type == CollierGeometryType::COLLIER_GEOMETRY_TYPE_HEIGHTFIELD))
+        {
+            for (PxShape *shape : m_State.m_Shapes)
+                shape->release();
+            m_State = PhysicsPrefabState();
+            return;
+        }
+        PxShape *shape = ShapeFactory::CreateShape(geometry.get(), m_Material.get());
+        if (shape == nullptr)
+            continue;
+        shape->setLocalPose(ShapeFactory::ComputeLocalPose(geometry.get(), options.m_ColliderLocalTransforms[i]));
+        m_State.m_Shapes.push_back(shape);
+        m_State.m_ColliderGeometries.push_back(geometry);
+        m_State.m_ColliderLocalTransforms.push_back(options.m_ColliderLocalTransforms[i]);
+    }
+    if (m_State.m_Shapes.empty())
+        return;
+    m_State.m_BoundingBox = ComputeBoundingBox(m_State.m_ColliderGeometries, m_State.m_ColliderLocalTransforms);
+
+    if (m_ObjectType == PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC)
+    {
+        const PxMassProperties massProperties = PxRigidBodyExt::computeMassPropertiesFromShapes(m_State.m_Shapes.data(), PxU32(m_State.m_Shapes.size())) * m_Material->GetDensity();
+        PxQuat massFrame;
+        const PxVec3 inertia = PxMassProperties::getMassSpaceInertia(massProperties.inertiaTensor, massFrame);
+        m_State.m_Mass = massProperties.mass;
+        m_State.m_MassSpaceInertia = ConvertUtils::FromPx(inertia);
+        m_State.m_MassFrame = ConvertUtils::FromPx(PxTransform(massProperties.centerOfMass, massFrame));
+    }
+}
+
+void PhysicsPrefab::Release()
+{
+    for (PxShape *shape : m_State.m_Shapes)
+        shape->release();
+    m_State.m_Shapes.clear();
+    m_Material.reset();
+}
+
+std::vector<PhysicsPtr<IPhysicsObject>> PhysicsPrefab::Instantiate(std::span<const MathLib::HTransform3> transforms, std::span<const MathLib::HVector3> linearVelocities)
+{
+    std::vector<PhysicsPtr<IPhysicsObject>> objects;
+    if (!IsValid() || (!linearVelocities.empty() && linearVelocities.size() != transforms.size()))
+        return objects;
+    objects.reserve(transforms.size());
+    for (size_t i = 0; i < transforms.size(); i++)
+    {
+        IPhysicsObject *object = nullptr;
+        if (m_ObjectType == PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC)
+        {
+            PhysicsRigidDynamic *rigidDynamic = new PhysicsRigidDynamic(m_Material);
+            rigidDynamic->InitFromPrefab(m_State, transforms[i]);
+            if (!linearVelocities.empty())
+                rigidDynamic->SetLinearVelocity(linearVelocities[i]);
+            object = rigidDynamic;
+        }
+        else
+        {
+            PhysicsRigidStatic *rigidStatic = new PhysicsRigidStatic(m_Material);
+            rigidStatic->InitFromPrefab(m_State, transforms[i]);
+            object = rigidStatic;
+        }
+        objects.push_back(make_physics_ptr(object));
+    }
+    return objects;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+
+namespace physx
+{
+	class PxShape;
+}
+
+// State every instance of a prefab starts from. Shapes are shared, so attaching them costs a reference count.
+struct PhysicsPrefabState
+{
+	std::vector<physx::PxShape *> m_Shapes;
+	std::vector<PhysicsPtr<IColliderGeometry>> m_ColliderGeometries;
+	std::vector<MathLib::HTransform3> m_ColliderLocalTransforms;
+	MathLib::HAABBox3D m_BoundingBox;
+	MathLib::HReal m_Mass = 0;
+	MathLib::HVector3 m_MassSpaceInertia = {0, 0, 0};
+	MathLib::HTransform3 m_MassFrame = MathLib::HTransform3::Identity();
+};
+
+class PhysicsPrefab : public IPhysicsPrefab
+{
+public:
+	PhysicsPrefab(const PhysicsPrefabCreateOptions &options, PhysicsPtr<IPhysicsMaterial> &material);
+
+public:
+	void Release() override;
+	std::vector<PhysicsPtr<IPhysicsObject>> Instantiate(std::span<const MathLib::HTransform3> transforms, std::span<const MathLib::HVector3> linearVelocities) override;
+	MathLib::HAABBox3D GetLocalBoundingBox() const override { return m_State.m_BoundingBox; };
+	bool IsValid() const { return !m_State.m_Shapes.empty(); };
+
+private:
+	PhysicsObjectType m_ObjectType;
+	PhysicsPtr<IPhysicsMaterial> m_Material;
+	PhysicsPrefabState m_State;
+};
@@ -2,6 +2,9 @@
 #include "PxPhysicsAPI.h"
 #include "PhysicsObject.h"
 #include "Utility/PhysXUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #ifndef NDEBUG
 #define ENABLE_PVD
 #endif
@@ -15,6 +18,11 @@ PhysicsScene::PhysicsScene(const PhysicsSceneCreateOptions &options, physx::PxCp
     sceneDesc.cpuDispatcher = cpuDispatch;
     sceneDesc.filterShader = GetFilterShader(options.m_FilterShaderType);
     m_Scene = make_physx_ptr<PxScene>(physics.createScene(sceneDesc));
+    m_Scene->userData = this;
+    m_SolverIterationCount = PhysicsEngineUtils::GetPhysicsEngine()->GetSolverIterationCount();
+    m_AverageStepMilliseconds = 0.0f;
+    m_SolverBudgetScale = 1.0f;
+    m_AppliedSolverBudgetScale = 1.0f;
 #ifdef ENABLE_PVD
     _ASSERT(m_Scene.get());
     PxPvdSceneClient *pvdClient = m_Scene->getScenePvdClient();
@@ -29,18 +37,113 @@ PhysicsScene::PhysicsScene(const PhysicsSceneCreateOptions &options, physx::PxCp
 
 void PhysicsScene::Release()
 {
+    // Bodies can outlive the scene, so none of them may keep a slot in the released queue:
+    // their writes are applied now and later setters queue again or write through.
+    for (PhysicsRigidDynamic *rigidDynamic : m_PendingWriteObjects)
+    {
+        rigidDynamic->SetPendingWriteIndex(PhysicsRigidDynamic::NotQueued);
+        rigidDynamic->FlushPendingWrites();
+    }
+    m_PendingWriteObjects.clear();
     m_Scene.reset();
 }
 
 void PhysicsScene::Tick(MathLib::HReal deltaTime)
 {
+    _FlushPendingWrites();
+    const auto start = std::chrono::steady_clock::now();
     m_Scene->simulate(deltaTime);
     m_Scene->fetchResults(true);
+    _UpdateSolverBudget(std::chrono::duration<MathLib::HReal, std::milli>(std::chrono::steady_clock::now() - start).count());
 
     for (auto &dynamicObject : m_RigidDynamic)
     {
-        dynamicObject->Update();
+        if (dynamicObject->IsSimulationEnabled())
+            dynamicObject->Update();
+    }
+    UpdateWorldBoundingBoxes();
+}
+
+void PhysicsScene::_FlushPendingWrites()
+{
+    // Engine-wide settings and the budget scale only reach the bodies when they change.
+    const uint32_t solverIterationCount = PhysicsEngineUtils::GetPhysicsEngine()->GetSolverIterationCount();
+    const MathLib::HReal budgetScale = std::round(m_SolverBudgetScale * 8.0f) / 8.0f;
+    if (solverIterationCount != m_SolverIterationCount || budgetScale != m_AppliedSolverBudgetScale)
+    {
+        m_SolverIterationCount = solverIterationCount;
+        m_AppliedSolverBudgetScale = budgetScale;
+        for (auto &dynamicObject : m_RigidDynamic)
+            static_cast<PhysicsRigidDynamic *>(dynamicObject.get())->SetSolverDefaults(m_SolverIterationCount, m_AppliedSolverBudgetScale);
+    }
+    // PhysX scene writes are not thread-safe even across different actors, so this stays on the calling thread.
+    for (PhysicsRigidDynamic *rigidDynamic : m_PendingWriteObjects)
+    {
+        rigidDynamic->SetPendingWriteIndex(PhysicsRigidDynamic::NotQueued);
+        rigidDynamic->FlushPendingWrites();
+    }
+    m_PendingWriteObjects.clear();
+}
+
+void PhysicsScene::QueuePendingWrites(PhysicsRigidDynamic *rigidDynamic)
+{
+    rigidDynamic->SetPendingWriteIndex(static_cast<uint32_t>(m_PendingWriteObjects.size()));
+    m_PendingWriteObjects.push_back(rigidDynamic);
+}
+
+void PhysicsScene::SetSolverBudget(const PhysicsSolverBudgetOptions &options)
+{
+    m_SolverBudget = options;
+    if (!m_SolverBudget.m_bEnabled)
+        m_SolverBudgetScale = 1.0f;
+}
+
+void PhysicsScene::_UpdateSolverBudget(MathLib::HReal stepMilliseconds)
+{
+    if (m_AverageStepMilliseconds == 0.0f)
+        m_AverageStepMilliseconds = stepMilliseconds;
+    else
+        m_AverageStepMilliseconds += m_SolverBudget.m_Smoothing * (stepMilliseconds - m_AverageStepMilliseconds);
+    if (!m_SolverBudget.m_bEnabled)
+        return;
+    // Back off quickly when over budget, recover slowly below three quarters of it.
+    if (m_AverageStepMilliseconds > m_SolverBudget.m_TargetStepMilliseconds)
+        m_SolverBudgetScale = std::max(m_SolverBudget.m_MinScale, m_SolverBudgetScale * 0.9f);
+    else if (m_AverageStepMilliseconds < m_SolverBudget.m_TargetStepMilliseconds * 0.75f)
+        m_SolverBudgetScale = std::min(m_SolverBudget.m_MaxScale, m_SolverBudgetScale * 1.02f);
+}
+
+void PhysicsScene::UpdateWorldBoundingBoxes()
+{
+    m_BoundingBoxBatch.Resize(m_BoundingBoxObjects.size());
+    for (size_t i = 0; i < m_BoundingBoxObjects.size(); i++)
+        m_BoundingBoxBatch.Set(i, m_BoundingBoxObjects[i]->GetPose(), m_BoundingBoxObjects[i]->GetLocalBoundingBox());
+    m_WorldBoundingBoxes.resize(m_BoundingBoxObjects.size());
+    PhysicsBoundsUtils::ComputeWorldBoundingBoxes(m_BoundingBoxBatch, m_WorldBoundingBoxes);
+}
+
+void PhysicsScene::_AddBoundingBox(IPhysicsObject *physicsObject)
+{
+    m_BoundingBoxIndices.emplace(physicsObject, uint32_t(m_BoundingBoxObjects.size()));
+    m_BoundingBoxObjects.push_back(physicsObject);
+    m_WorldBoundingBoxes.push_back(physicsObject->GetWorldBoundingBox());
+}
+
+void PhysicsScene::_RemoveBoundingBox(IPhysicsObject *physicsObject)
+{
+    auto it = m_BoundingBoxIndices.find(physicsObject);
+    if (it == m_BoundingBoxIndices.end())
+        return;
+    const uint32_t index = it->second;
+    m_BoundingBoxIndices.erase(it);
+    if (index + 1 != m_BoundingBoxObjects.size())
+    {
+        m_BoundingBoxObjects[index] = m_BoundingBoxObjects.back();
+        m_WorldBoundingBoxes[index] = m_WorldBoundingBoxes.back();
+        m_BoundingBoxIndices[m_BoundingBoxObjects[index]] = index;
     }
+    m_BoundingBoxObjects.pop_back();
+    m_WorldBoundingBoxes.pop_back();
 }
 
 bool PhysicsScene::AddPhysicsObject(PhysicsPtr<IPhysicsObject> &physicsObject)
@@ -69,25 +172,89 @@ bool PhysicsScene::AddPhysicsObject(PhysicsPtr<IPhysicsObject> &physicsObject)
             result = m_RigidDynamic.emplace(physicsObject).second;
         if (!result)
             m_Scene->removeActor(*pRigidDynamic);
+        else
+            static_cast<PhysicsRigidDynamic *>(physicsObject.get())->SetSolverDefaults(m_SolverIterationCount, m_AppliedSolverBudgetScale);
         break;
     }
     default:
         break;
     }
+    if (result)
+        _AddBoundingBox(physicsObject.get());
     return result;
 }
 
+uint32_t PhysicsScene::AddPhysicsObjects(std::span<PhysicsPtr<IPhysicsObject>> physicsObjects)
+{
+    std::vector<PxActor *> actors;
+    std::vector<PhysicsPtr<IPhysicsObject> *> addedObjects;
+    actors.reserve(physicsObjects.size());
+    addedObjects.reserve(physicsObjects.size());
+    for (auto &physicsObject : physicsObjects)
+    {
+        PxRigidActor *actor = physicsObject ? _GetActor(physicsObject.get()) : nullptr;
+        if (actor == nullptr || actor->getNbShapes() == 0 || actor->getScene() != nullptr)
+            continue;
+        actors.push_back(actor);
+        addedObjects.push_back(&physicsObject);
+    }
+    if (actors.empty() || !m_Scene->addActors(actors.data(), PxU32(actors.size())))
+        return 0;
+
+    for (PhysicsPtr<IPhysicsObject> *physicsObject : addedObjects)
+    {
+        if ((*physicsObject)->GetType() == PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC)
+            m_RigidStatic.emplace(*physicsObject);
+        else
+        {
+            m_RigidDynamic.emplace(*physicsObject);
+            static_cast<PhysicsRigidDynamic *>(physicsObject->get())->SetSolverDefaults(m_SolverIterationCount, m_AppliedSolverBudgetScale);
+        }
+        _AddBoundingBox(physicsObject->get());
+    }
+    return uint32_t(addedObjects.size());
+}
+
+PxRigidActor *PhysicsScene::_GetActor(IPhysicsObject *physicsObject)
+{
+    const size_t offset = physicsObject->GetOffset();
+    switch (physicsObject->GetType())
+    {
+    case PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC:
+        return reinterpret_cast<PhysXPtr<PxRigidStatic> *>(reinterpret_cast<char *>(physicsObject) + offset)->get();
+    case PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC:
+        return reinterpret_cast<PhysXPtr<PxRigidDynamic> *>(reinterpret_cast<char *>(physicsObject) + offset)->get();
+    default:
+        return nullptr;
+    }
+}
+
 void PhysicsScene::RemovePhysicsObject(PhysicsPtr<IPhysicsObject> &physicsObject)
 {
     // m_Scene->removeActor(physicsObject->GetPhysicsObject());
     switch (physicsObject->GetType())
     {
     case PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_STATIC:
-        m_RigidStatic.erase(physicsObject);
+        if (m_RigidStatic.erase(physicsObject))
+            _RemoveBoundingBox(physicsObject.get());
         break;
     case PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC:
-        m_RigidDynamic.erase(physicsObject);
+    {
+        PhysicsRigidDynamic *rigidDynamic = static_cast<PhysicsRigidDynamic *>(physicsObject.get());
+        const uint32_t pendingIndex = rigidDynamic->GetPendingWriteIndex();
+        if (pendingIndex != PhysicsRigidDynamic::NotQueued)
+        {
+            PhysicsRigidDynamic *last = m_PendingWriteObjects.back();
+            m_PendingWriteObjects[pendingIndex] = last;
+            last->SetPendingWriteIndex(pendingIndex);
+            m_PendingWriteObjects.pop_back();
+            rigidDynamic->SetPendingWriteIndex(PhysicsRigidDynamic::NotQueued);
+            rigidDynamic->FlushPendingWrites();
+        }
+        if (m_RigidDynamic.erase(physicsObject))
+            _RemoveBoundingBox(physicsObject.get());
         break;
+    }
     default:
         break;
     }
@@ -108,6 +275,23 @@ uint32_t PhysicsScene::GetPhysicsRigidStaticCount() const
     return m_RigidStatic.size();
 }
 
+void PhysicsScene::SelectConvexLODs(const MathLib::HVector3 &viewPoint, const std::vector<MathLib::HReal> &lodDistances)
+{
+    for (size_t i = 0; i < m_BoundingBoxObjects.size(); i++)
+    {
+        if (m_BoundingBoxObjects[i]->GetType() != PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC)
+            continue;
+        PhysicsRigidDynamic *rigidDynamic = static_cast<PhysicsRigidDynamic *>(m_BoundingBoxObjects[i]);
+        if (!rigidDynamic->IsSimulationEnabled())
+            continue;
+        const MathLib::HReal distance = (m_WorldBoundingBoxes[i].center() - viewPoint).norm() / rigidDynamic->GetLODImportance();
+        uint32_t lod = 0;
+        while (lod < lodDistances.size() && distance > lodDistances[lod])
+            lod++;
+        rigidDynamic->SetConvexLOD(lod);
+    }
+}
+
 size_t PhysicsScene::GetOffset() const
 {
     return offsetof(PhysicsScene, m_Scene);
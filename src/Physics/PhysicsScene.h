@@ -1,9 +1,11 @@
 #pragma once
 #include "Physics/PhysicsCommon.h"
+#include "Utility/PhysicsBoundsUtils.h"
 
 namespace physx
 {
 	class PxPhysics;
+	class PxRigidActor;
 	class PxScene;
 	class PxCpuDispatcher;
 }
@@ -19,14 +21,44 @@ public:
 	void Release() override;
 	void Tick(MathLib::HReal deltaTime) override;
 	bool AddPhysicsObject(PhysicsPtr<IPhysicsObject> &physicsObject) override;
+	uint32_t AddPhysicsObjects(std::span<PhysicsPtr<IPhysicsObject>> physicsObjects) override;
 	void RemovePhysicsObject(PhysicsPtr<IPhysicsObject> &physicsObject) override;
+	std::span<const MathLib::HAABBox3D> GetWorldBoundingBoxes() const override { return m_WorldBoundingBoxes; };
+	std::span<IPhysicsObject *const> GetBoundingBoxObjects() const override { return m_BoundingBoxObjects; };
+	void UpdateWorldBoundingBoxes() override;
+	void SetSolverBudget(const PhysicsSolverBudgetOptions &options) override;
+	const PhysicsSolverBudgetOptions &GetSolverBudget() const override { return m_SolverBudget; };
+	MathLib::HReal GetAverageStepMilliseconds() const override { return m_AverageStepMilliseconds; };
+	MathLib::HReal GetSolverBudgetScale() const override { return m_SolverBudgetScale; };
 	uint32_t GetPhysicsObjectCount() const override;
 	uint32_t GetPhysicsRigidDynamicCount() const override;
 	uint32_t GetPhysicsRigidStaticCount() const override;
+	void SelectConvexLODs(const MathLib::HVector3 &viewPoint, const std::vector<MathLib::HReal> &lodDistances) override;
 	size_t GetOffset() const override;
+	void QueuePendingWrites(PhysicsRigidDynamic *rigidDynamic);
+
+private:
+	static physx::PxRigidActor *_GetActor(IPhysicsObject *physicsObject);
+	void _AddBoundingBox(IPhysicsObject *physicsObject);
+	void _RemoveBoundingBox(IPhysicsObject *physicsObject);
+	void _FlushPendingWrites();
+	void _UpdateSolverBudget(MathLib::HReal stepMilliseconds);
 
 private:
 	PhysXPtr<physx::PxScene> m_Scene;
 	std::unordered_set<PhysicsPtr<IPhysicsObject>> m_RigidStatic;
 	std::unordered_set<PhysicsPtr<IPhysicsObject>> m_RigidDynamic;
+	// Dense per-object arrays for the batched world bounds; removal swaps with the last entry.
+	std::vector<IPhysicsObject *> m_BoundingBoxObjects;
+	std::unordered_map<const IPhysicsObject *, uint32_t> m_BoundingBoxIndices;
+	PhysicsBoundsUtils::BoundingBoxBatch m_BoundingBoxBatch;
+	std::vector<MathLib::HAABBox3D> m_WorldBoundingBoxes;
+	// Dynamic objects with setter writes waiting for the next Tick; removal swaps with the last entry.
+	std::vector<PhysicsRigidDynamic *> m_PendingWriteObjects;
+	uint32_t m_SolverIterationCount;
+	PhysicsSolverBudgetOptions m_SolverBudget;
+	MathLib::HReal m_AverageStepMilliseconds;
+	// The controller's scale moves every step; bodies only see it in steps of 1/8.
+	MathLib::HReal m_SolverBudgetScale;
+	MathLib::HReal m_AppliedSolverBudgetScale;
 };
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+#include "PxPhysicsAPI.h"
+#include "ColliderGeometry.h"
+#include "ConvexMeshLODChain.h"
+#include "Utility/PhysXUtils.h"
+
+// Builds PxShapes for collider geometries; per-type creation is resolved with std::visit.
+class ShapeFactory
+{
+public:
+	static physx::PxShape *CreateShape(const IColliderGeometry *cGeo, IPhysicsMaterial *material, uint32_t convexLOD = 0)
+	{
+		if (cGeo == nullptr)
+			return nullptr;
+		const ColliderGeometry *geometry = static_cast<const ColliderGeometry *>(cGeo);
+		physx::PxMaterial *const *pxMaterial = reinterpret_cast<physx::PxMaterial *const *>(reinterpret_cast<char *>(material) + material->GetOffset());
+		const MathLib::HVector3 &scale = geometry->GetScale();
+		if (const ConvexMeshLODChain *lods = geometry->GetConvexLODs().get())
+			return CreateShape(*lods, convexLOD, scale, **pxMaterial);
+		return std::visit([&](const auto &params)
+						  { return _CreateShape(params, scale, **pxMaterial); },
+						  geometry->GetGeometryParams());
+	};
+
+	// Pose of a shape built from the geometry when it is attached at localTrans.
+	static physx::PxTransform ComputeLocalPose(const IColliderGeometry *cGeo, const MathLib::HTransform3 &localTrans)
+	{
+		const ColliderGeometry *geometry = static_cast<const ColliderGeometry *>(cGeo);
+		const physx::PxTransform pose = ConvertUtils::ToPx(localTrans * geometry->GetLocalTransform());
+		if (const PlaneGeometryParams *plane = geometry->GetGeometryParams<PlaneGeometryParams>())
+		{
+			const MathLib::HVector3 &normal = plane->m_Normal;
+			return pose.transform(physx::PxTransformFromPlaneEquation(physx::PxPlane(normal[0], normal[1], normal[2], plane->m_Distance)));
+		}
+		return pose;
+	}
+
+	static physx::PxShape *CreateShape(const ConvexMeshLODChain &lods, uint32_t lod, const MathLib::HVector3 &scale, physx::PxMaterial &material)
+	{
+		physx::PxConvexMesh *mesh = lods.GetConvexMesh(lod);
+		if (mesh == nullptr)
+			return nullptr;
+		physx::PxConvexMeshGeometry geometry(mesh, physx::PxMeshScale(ConvertUtils::ToPx(scale)));
+		return physx::PxGetPhysics().createShape(geometry, material);
+	}
+
+private:
+	static physx::PxShape *_CreateShape(const BoxGeometryParams &params, const MathLib::HVector3 &scale, physx::PxMaterial &material)
+	{
+		const MathLib::HVector3 &halfSize = params.m_HalfExtents;
+		physx::PxBoxGeometry geometry(halfSize[0] * scale[0], halfSize[1] * scale[1], halfSize[2] * scale[2]);
+		return physx::PxGetPhysics().createShape(geometry, material);
+	}
+
+	static physx::PxShape *_CreateShape(const SphereGeometryParams &params, const MathLib::HVector3 &scale, physx::PxMaterial &material)
+	{
+		physx::PxSphereGeometry geometry(params.m_Radius * scale[0]);
+		return physx::PxGetPhysics().createShape(geometry, material);
+	}
+
+	static physx::PxShape *_CreateShape(const PlaneGeometryParams &, const MathLib::HVector3 &, physx::PxMaterial &material)
+	{
+		return physx::PxGetPhysics().createShape(physx::PxPlaneGeometry(), material);
+	}
+
+	static physx::PxShape *_CreateShape(const CapsuleGeometryParams &params, const MathLib::HVector3 &scale, physx::PxMaterial &material)
+	{
+		physx::PxCapsuleGeometry geometry(params.m_Radius * scale[0], params.m_HalfHeight * scale[0]);
+		return physx::PxGetPhysics().createShape(geometry, material);
+	}
+
+	static physx::PxShape *_CreateShape(const TriangleMeshGeometryParams &params, const MathLib::HVector3 &scale, physx::PxMaterial &material)
+	{
+		const std::vector<MathLib::HVector3> &vertices = params.m_MeshData->m_Vertices;
+		const std::vector<uint32_t> &indices = params.m_MeshData->m_Indices;
+		physx::PxTriangleMesh *mesh = PhysXConstructTools::CreatePxTriangleMesh<true>(vertices.size(), vertices.data(), indices.size() / 3, indices.data());
+		if (mesh == nullptr)
+			return nullptr;
+		physx::PxTriangleMeshGeometry geometry(mesh, physx::PxMeshScale(ConvertUtils::ToPx(scale)));
+		physx::PxShape *shape = physx::PxGetPhysics().createShape(geometry, material);
+		PX_RELEASE(mesh);
+		return shape;
+	}
+
+	static physx::PxShape *_CreateShape(const HeightFieldGeometryParams &params, const MathLib::HVector3 &scale, physx::PxMaterial &material)
+	{
+		physx::PxHeightField *heightField = PhysXConstructTools::CreatePxHeightField(*params.m_HeightFieldData);
+		if (heightField == nullptr)
+			return nullptr;
+		physx::PxHeightFieldGeometry geometry(heightField, physx::PxMeshGeometryFlags(), params.m_HeightScale * scale[1], params.m_RowScale * scale[0], params.m_ColumnScale * scale[2]);
+		physx::PxShape *shape = nullptr;
+		if (params.m_Materials.empty())
+			shape = physx::PxGetPhysics().createShape(geometry, material);
+		else
+		{
+			std::vector<physx::PxMaterial *> materials(params.m_Materials.size());
+			for (size_t i = 0; i < materials.size(); i++)
+			{
+				IPhysicsMaterial *sampleMaterial = params.m_Materials[i].get();
+				materials[i] = *reinterpret_cast<physx::PxMaterial *const *>(reinterpret_cast<char *>(sampleMaterial) + sampleMaterial->GetOffset());
+			}
+			shape = physx::PxGetPhysics().createShape(geometry, materials.data(), physx::PxU16(materials.size()));
+		}
+		PX_RELEASE(heightField);
+		return shape;
+	}
+
+	static physx::PxShape *_CreateShape(const ConvexMeshGeometryParams &params, const MathLib::HVector3 &scale, physx::PxMaterial &material)
+	{
+		const std::vector<MathLib::HVector3> &vertices = params.m_MeshData->m_Vertices;
+		physx::PxConvexMesh *mesh = PhysXConstructTools::CreatePxConvexMesh<true, 256>(vertices.size(), vertices.data());
+		if (mesh == nullptr)
+			return nullptr;
+		physx::PxConvexMeshGeometry geometry(mesh, physx::PxMeshScale(ConvertUtils::ToPx(scale)));
+		physx::PxShape *shape = physx::PxGetPhysics().createShape(geometry, material);
+		PX_RELEASE(mesh);
+		return shape;
+	}
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+#include "ConvexMeshDecomposer.h"
+#include "Utility/PhysicsConvexUtils.h"
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <mutex>
+
+struct TriangleMeshDecomposition
+{
+	PhysicsMeshDataPtr m_ConvexHull;
+	PhysicsPtr<IConvexDecomposeTask> m_Task;
+	std::shared_future<std::vector<PhysicsMeshDataPtr>> m_ConvexHulls;
+
+	bool IsReady() const
+	{
+		return m_ConvexHulls.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+};
+
+// Convex decompositions of triangle meshes, keyed by their shared mesh buffer. The single convex
+// hull is built immediately, the decomposition runs as a background task per mesh. Entries do not
+// keep the mesh alive: once its last user releases it the entry is stale, is never matched by a
+// new buffer at the same address, and is dropped on a later lookup with its task cancelled.
+class TriangleMeshDecompositionCache
+{
+public:
+	TriangleMeshDecompositionCache(ConvexMeshDecomposer *decomposer, const ConvexDecomposeOptions &options)
+		: m_Decomposer(decomposer), m_Options(options)
+	{
+	}
+
+	~TriangleMeshDecompositionCache()
+	{
+		// Nothing can pick up the hulls after engine shutdown, so running tasks are cancelled.
+		for (auto &entry : m_Decompositions)
+			entry.second.m_Decomposition->m_Task->Cancel();
+	}
+
+	std::shared_ptr<const TriangleMeshDecomposition> GetDecomposition(const PhysicsMeshDataPtr &meshData)
+	{
+		if (meshData == nullptr)
+			return nullptr;
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Decompositions.size() >= m_NextSweepSize)
+			_EvictReleasedMeshes();
+		auto it = m_Decompositions.find(meshData.get());
+		if (it != m_Decompositions.end())
+		{
+			if (it->second.m_MeshData.lock() == meshData)
+				return it->second.m_Decomposition;
+			it->second.m_Decomposition->m_Task->Cancel();
+			m_Decompositions.erase(it);
+		}
+
+		PhysicsMeshData convexHull;
+		PhysicsConvexUtils::BuildConvexMesh(meshData->m_Vertices, meshData->m_Indices, convexHull);
+		if (convexHull.m_Vertices.empty())
+			return nullptr;
+
+		std::shared_ptr<TriangleMeshDecomposition> decomposition = std::make_shared<TriangleMeshDecomposition>();
+		decomposition->m_ConvexHull = MakePhysicsMeshData(std::move(convexHull));
+		decomposition->m_Task = m_Decomposer->DecomposeAsync(*meshData, m_Options);
+		decomposition->m_ConvexHulls = decomposition->m_Task->GetResult();
+		m_Decompositions.emplace(meshData.get(), Entry{meshData, decomposition});
+		return decomposition;
+	}
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<const PhysicsMeshData> m_MeshData;
+		std::shared_ptr<TriangleMeshDecomposition> m_Decomposition;
+	};
+
+	// Called with the lock held. Sweeps once the map doubled since the last sweep, so lookups stay
+	// constant time on average.
+	void _EvictReleasedMeshes()
+	{
+		for (auto it = m_Decompositions.begin(); it != m_Decompositions.end();)
+		{
+			if (it->second.m_MeshData.expired())
+			{
+				it->second.m_Decomposition->m_Task->Cancel();
+				it = m_Decompositions.erase(it);
+			}
+			else
+				++it;
+		}
+		m_NextSweepSize = std::max<size_t>(MinSweepSize, m_Decompositions.size() * 2);
+	}
+
+	static constexpr size_t MinSweepSize = 16;
+
+	ConvexMeshDecomposer *m_Decomposer;
+	ConvexDecomposeOptions m_Options;
+	std::mutex m_Mutex;
+	std::unordered_map<const PhysicsMeshData *, Entry> m_Decompositions;
+	size_t m_NextSweepSize = MinSweepSize;
+};
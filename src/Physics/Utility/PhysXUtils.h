@@ -1,6 +1,11 @@
 #pragma once
 #include <PxPhysicsAPI.h>
 #include "Physics/PhysicsTypes.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include "PhysicsSimdUtils.h"
 
 inline physx::PxSimulationFilterShader GetFilterShader(const PhysicsSceneFilterShaderType& type)
 {
@@ -29,32 +34,89 @@ namespace ConvertUtils
 		return MathLib::HVector3(vector.x, vector.y, vector.z);
 	}
 
-	inline physx::PxTransform ToPx(const MathLib::HTransform3& transform)
-	{
-		MathLib::HVector3 translation = transform.translation();
+	static_assert(sizeof(PhysicsPose) == sizeof(physx::PxTransform) && offsetof(physx::PxTransform, p) == offsetof(PhysicsPose, m_Position),
+				  "PhysicsPose must keep the PxTransform layout");
 
-		MathLib::HMatrix3 rotationMatrix = transform.rotation();
-		MathLib::HQuaternion rotationQuaternion(rotationMatrix);
+	inline physx::PxTransform ToPx(const PhysicsPose& pose)
+	{
+		physx::PxTransform pxTransform;
+		std::memcpy(&pxTransform, &pose, sizeof(pxTransform));
+		return pxTransform;
+	}
 
-		physx::PxVec3 pxTranslation(translation.x(), translation.y(), translation.z());
-		physx::PxQuat pxRotation(rotationQuaternion.x(), rotationQuaternion.y(), rotationQuaternion.z(), rotationQuaternion.w());
+	inline PhysicsPose ToPose(const physx::PxTransform& pxTransform)
+	{
+		PhysicsPose pose;
+		std::memcpy(&pose, &pxTransform, sizeof(pose));
+		return pose;
+	}
 
-		return physx::PxTransform(pxTranslation, pxRotation);
+	inline physx::PxTransform ToPx(const MathLib::HTransform3& transform)
+	{
+		return ToPx(PhysicsPose(transform));
 	}
 
 	inline MathLib::HTransform3 FromPx(const physx::PxTransform& pxTransform)
 	{
-		physx::PxVec3 pxTranslation = pxTransform.p;
-		physx::PxQuat pxRotation = pxTransform.q;
-
-		MathLib::HVector3 translation(pxTranslation.x, pxTranslation.y, pxTranslation.z);
-		MathLib::HQuaternion rotation(pxRotation.w, pxRotation.x, pxRotation.y, pxRotation.z);
+		return ToPose(pxTransform).ToTransform();
+	}
 
-		MathLib::HTransform3 eigenTransform = MathLib::HTransform3::Identity();
-		eigenTransform.translate(translation);
-		eigenTransform.rotate(rotation);
+	// Bulk readback; both sides share a layout, so this is a single copy.
+	inline void ToPoses(std::span<const physx::PxTransform> pxTransforms, std::span<PhysicsPose> poses)
+	{
+		std::memcpy(poses.data(), pxTransforms.data(), std::min(pxTransforms.size(), poses.size()) * sizeof(PhysicsPose));
+	}
 
-		return eigenTransform;
+	// Expands poses into affine transforms. With SSE four poses are converted at once: their
+	// quaternions and positions are transposed into lanes, the rotation matrices are built lane-wise
+	// and transposed back into the column-major 4x4 storage of each HTransform3.
+	inline void ToTransforms(std::span<const PhysicsPose> poses, std::span<MathLib::HTransform3> transforms)
+	{
+		const size_t count = std::min(poses.size(), transforms.size());
+		size_t i = 0;
+#ifdef PHYSICS_SIMD_SSE
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(poses[i].m_Rotation);
+			__m128 y = _mm_loadu_ps(poses[i + 1].m_Rotation);
+			__m128 z = _mm_loadu_ps(poses[i + 2].m_Rotation);
+			__m128 w = _mm_loadu_ps(poses[i + 3].m_Rotation);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			// Loading from the w component keeps the read inside the pose: (w, px, py, pz).
+			__m128 pw = _mm_loadu_ps(&poses[i].m_Rotation[3]);
+			__m128 px = _mm_loadu_ps(&poses[i + 1].m_Rotation[3]);
+			__m128 py = _mm_loadu_ps(&poses[i + 2].m_Rotation[3]);
+			__m128 pz = _mm_loadu_ps(&poses[i + 3].m_Rotation[3]);
+			_MM_TRANSPOSE4_PS(pw, px, py, pz);
+
+			const __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+			const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+			const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+			const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+			__m128 c0[4] = {_mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, wz), _mm_sub_ps(xz, wy), zero};
+			__m128 c1[4] = {_mm_sub_ps(xy, wz), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, wx), zero};
+			__m128 c2[4] = {_mm_add_ps(xz, wy), _mm_sub_ps(yz, wx), _mm_sub_ps(one, _mm_add_ps(xx, yy)), zero};
+			__m128 c3[4] = {px, py, pz, one};
+			_MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+			_MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+			_MM_TRANSPOSE4_PS(c2[0], c2[1], c2[2], c2[3]);
+			_MM_TRANSPOSE4_PS(c3[0], c3[1], c3[2], c3[3]);
+			for (size_t k = 0; k < 4; k++)
+			{
+				MathLib::HReal* matrix = transforms[i + k].data();
+				_mm_storeu_ps(matrix, c0[k]);
+				_mm_storeu_ps(matrix + 4, c1[k]);
+				_mm_storeu_ps(matrix + 8, c2[k]);
+				_mm_storeu_ps(matrix + 12, c3[k]);
+			}
+		}
+#endif
+		for (; i < count; i++)
+			transforms[i] = poses[i].ToTransform();
 	}
 
 	inline MathLib::HAABBox3D FromPx(const physx::PxBounds3& bounds)
@@ -70,8 +132,15 @@ namespace ConvertUtils
 
 namespace PhysXConstructTools
 {
-	template <bool directInsertion, uint32_t gaussMapLimit>
-	inline physx::PxConvexMesh* CreatePxConvexMesh(uint32_t numVerts, const MathLib::HVector3* verts)
+	// Hulls with at least this many vertices get a gauss map, which speeds up support mapping on large hulls
+	// but only costs memory and cache misses on small ones.
+	inline uint32_t GetGaussMapLimit(uint32_t vertexLimit)
+	{
+		return vertexLimit > 32 ? 32 : vertexLimit + 1;
+	}
+
+	template <bool directInsertion>
+	inline physx::PxConvexMesh* CreatePxConvexMesh(uint32_t numVerts, const MathLib::HVector3* verts, uint32_t vertexLimit, uint32_t gaussMapLimit)
 	{
 		if (PhysicsEngineUtils::GetPhysicsEngine() == nullptr)
 			return nullptr;
@@ -91,6 +160,13 @@ namespace PhysXConstructTools
 		desc.points.count = numVerts;
 		desc.points.stride = sizeof(physx::PxVec3);
 		desc.flags = physx::PxConvexFlag::eCOMPUTE_CONVEX;
+		desc.vertexLimit = physx::PxU16(vertexLimit);
+		// Quantizing dense input keeps the simplified hulls from hugging local detail.
+		if (vertexLimit < 255 && numVerts > vertexLimit * 4)
+		{
+			desc.flags |= physx::PxConvexFlag::eQUANTIZE_INPUT;
+			desc.quantizedCount = physx::PxU16(vertexLimit * 4);
+		}
 
 		physx::PxU32 meshSize = 0;
 		physx::PxConvexMesh* convex = nullptr;
@@ -115,6 +191,12 @@ namespace PhysXConstructTools
 		return convex;
 	}
 
+	template <bool directInsertion, uint32_t gaussMapLimit>
+	inline physx::PxConvexMesh* CreatePxConvexMesh(uint32_t numVerts, const MathLib::HVector3* verts)
+	{
+		return CreatePxConvexMesh<directInsertion>(numVerts, verts, 255, gaussMapLimit);
+	}
+
 	template <bool directInsertion>
 	inline physx::PxTriangleMesh* CreatePxTriangleMesh(uint32_t numVerts, const MathLib::HVector3* verts, uint32_t numTris, const uint32_t* tris)
 	{
@@ -160,6 +242,40 @@ namespace PhysXConstructTools
 
 		return triMesh;
 	}
+
+	inline physx::PxHeightField* CreatePxHeightField(const PhysicsHeightFieldData& heightField)
+	{
+		if (PhysicsEngineUtils::GetPhysicsEngine() == nullptr)
+			return nullptr;
+
+		const uint32_t numSamples = heightField.m_NumRows * heightField.m_NumColumns;
+		std::vector<physx::PxHeightFieldSample> samples(numSamples);
+		for (uint32_t i = 0; i < numSamples; i++)
+		{
+			physx::PxHeightFieldSample& sample = samples[i];
+			sample.height = heightField.m_Heights[i];
+			const uint8_t materialIndex = heightField.m_MaterialIndices.empty() ? 0 : heightField.m_MaterialIndices[i];
+			if (materialIndex == PhysicsHeightFieldData::HoleMaterialIndex)
+			{
+				sample.materialIndex0 = physx::PxHeightFieldMaterial::eHOLE;
+				sample.materialIndex1 = physx::PxHeightFieldMaterial::eHOLE;
+			}
+			else
+			{
+				sample.materialIndex0 = materialIndex;
+				sample.materialIndex1 = materialIndex;
+			}
+		}
+
+		physx::PxHeightFieldDesc desc;
+		desc.format = physx::PxHeightFieldFormat::eS16_TM;
+		desc.nbRows = heightField.m_NumRows;
+		desc.nbColumns = heightField.m_NumColumns;
+		desc.samples.data = samples.data();
+		desc.samples.stride = sizeof(physx::PxHeightFieldSample);
+
+		return PxCreateHeightField(desc, PxGetPhysics().getPhysicsInsertionCallback());
+	}
 }
 
 inline physx::PxBounds3 CalculateBoundingBox(physx::PxRigidActor* actor) {
@@ -0,0 +1,144 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+#include "PhysicsSimdUtils.h"
+#include <algorithm>
+#include <span>
+
+namespace PhysicsBoundsUtils
+{
+	// World box of a local box under a pose: the center is transformed, the half extents go through |R|.
+	inline MathLib::HAABBox3D TransformBoundingBox(const MathLib::HAABBox3D &box, const PhysicsPose &pose)
+	{
+		if (box.isEmpty())
+			return box;
+		const MathLib::HMatrix3 rotation = pose.GetRotation().toRotationMatrix();
+		const MathLib::HVector3 center = rotation * box.center() + pose.GetPosition();
+		const MathLib::HVector3 extents = rotation.cwiseAbs() * MathLib::HVector3(box.sizes() / 2);
+		return MathLib::HAABBox3D(center - extents, center + extents);
+	}
+
+	// Structure-of-arrays input of the world bounds kernels, padded to whole AVX iterations.
+	struct BoundingBoxBatch
+	{
+		static constexpr size_t Width = 8;
+		std::vector<MathLib::HReal> m_Rotation[4];
+		std::vector<MathLib::HReal> m_Position[3];
+		std::vector<MathLib::HReal> m_LocalCenter[3];
+		std::vector<MathLib::HReal> m_LocalExtents[3];
+		size_t m_Count = 0;
+
+		void Resize(size_t count)
+		{
+			m_Count = count;
+			const size_t padded = (count + Width - 1) / Width * Width;
+			for (auto &values : m_Rotation)
+				values.resize(padded, 0);
+			for (size_t k = 0; k < 3; k++)
+			{
+				m_Position[k].resize(padded, 0);
+				m_LocalCenter[k].resize(padded, 0);
+				m_LocalExtents[k].resize(padded, 0);
+			}
+		}
+
+		void Set(size_t i, const PhysicsPose &pose, const MathLib::HAABBox3D &localBox)
+		{
+			for (size_t k = 0; k < 4; k++)
+				m_Rotation[k][i] = pose.m_Rotation[k];
+			for (size_t k = 0; k < 3; k++)
+				m_Position[k][i] = pose.m_Position[k];
+			// Empty boxes get a hugely negative extent, which keeps min above max after any rotation.
+			const bool bEmpty = localBox.isEmpty();
+			const MathLib::HVector3 center = bEmpty ? MathLib::HVector3(0, 0, 0) : localBox.center();
+			const MathLib::HVector3 extents = bEmpty ? MathLib::HVector3::Constant(-std::numeric_limits<MathLib::HReal>::max() / 4) : MathLib::HVector3(localBox.sizes() / 2);
+			for (size_t k = 0; k < 3; k++)
+			{
+				m_LocalCenter[k][i] = center[k];
+				m_LocalExtents[k][i] = extents[k];
+			}
+		}
+	};
+
+	inline void _WriteBoxes(const MathLib::HReal (&lanes)[6][BoundingBoxBatch::Width], size_t width, size_t begin, size_t count, std::span<MathLib::HAABBox3D> boxes)
+	{
+		const size_t n = std::min(width, count - begin);
+		for (size_t k = 0; k < n; k++)
+		{
+			boxes[begin + k].min() = MathLib::HVector3(lanes[0][k], lanes[1][k], lanes[2][k]);
+			boxes[begin + k].max() = MathLib::HVector3(lanes[3][k], lanes[4][k], lanes[5][k]);
+		}
+	}
+
+	inline void _ComputeScalar(const BoundingBoxBatch &batch, std::span<MathLib::HAABBox3D> boxes)
+	{
+		for (size_t i = 0; i < batch.m_Count; i++)
+		{
+			const MathLib::HReal x = batch.m_Rotation[0][i], y = batch.m_Rotation[1][i], z = batch.m_Rotation[2][i], w = batch.m_Rotation[3][i];
+			MathLib::HMatrix3 rotation;
+			rotation << 1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y),
+				2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+				2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y);
+			const MathLib::HVector3 center = rotation * MathLib::HVector3(batch.m_LocalCenter[0][i], batch.m_LocalCenter[1][i], batch.m_LocalCenter[2][i]) +
+											 MathLib::HVector3(batch.m_Position[0][i], batch.m_Position[1][i], batch.m_Position[2][i]);
+			const MathLib::HVector3 extents = rotation.cwiseAbs() * MathLib::HVector3(batch.m_LocalExtents[0][i], batch.m_LocalExtents[1][i], batch.m_LocalExtents[2][i]);
+			boxes[i].min() = center - extents;
+			boxes[i].max() = center + extents;
+		}
+	}
+
+#ifdef PHYSICS_SIMD_SSE
+	// One macro body for both widths; V is the vector type and the arguments are its intrinsics.
+#define PHYSICS_BOUNDS_KERNEL(V, Width, Load, Set1, Add, Sub, Mul, AndNot, Store)                                               \
+	const V one = Set1(1.0f), two = Set1(2.0f), signMask = Set1(-0.0f);                                                          \
+	for (size_t i = 0; i < batch.m_Count; i += Width)                                                                        \
+	{                                                                                                                            \
+		const V x = Load(&batch.m_Rotation[0][i]), y = Load(&batch.m_Rotation[1][i]);                                            \
+		const V z = Load(&batch.m_Rotation[2][i]), w = Load(&batch.m_Rotation[3][i]);                                            \
+		const V x2 = Mul(x, two), y2 = Mul(y, two), z2 = Mul(z, two);                                                            \
+		const V xx = Mul(x, x2), yy = Mul(y, y2), zz = Mul(z, z2);                                                               \
+		const V xy = Mul(x, y2), xz = Mul(x, z2), yz = Mul(y, z2);                                                               \
+		const V wx = Mul(w, x2), wy = Mul(w, y2), wz = Mul(w, z2);                                                               \
+		const V r[3][3] = {{Sub(one, Add(yy, zz)), Sub(xy, wz), Add(xz, wy)},                                                    \
+						   {Add(xy, wz), Sub(one, Add(xx, zz)), Sub(yz, wx)},                                                    \
+						   {Sub(xz, wy), Add(yz, wx), Sub(one, Add(xx, yy))}};                                                   \
+		const V c[3] = {Load(&batch.m_LocalCenter[0][i]), Load(&batch.m_LocalCenter[1][i]), Load(&batch.m_LocalCenter[2][i])};  \
+		const V e[3] = {Load(&batch.m_LocalExtents[0][i]), Load(&batch.m_LocalExtents[1][i]), Load(&batch.m_LocalExtents[2][i])}; \
+		for (size_t row = 0; row < 3; row++)                                                                                     \
+		{                                                                                                                        \
+			const V center = Add(Load(&batch.m_Position[row][i]), Add(Mul(r[row][0], c[0]), Add(Mul(r[row][1], c[1]), Mul(r[row][2], c[2])))); \
+			const V extent = Add(Mul(AndNot(signMask, r[row][0]), e[0]), Add(Mul(AndNot(signMask, r[row][1]), e[1]), Mul(AndNot(signMask, r[row][2]), e[2]))); \
+			Store(lanes[row], Sub(center, extent));                                                                              \
+			Store(lanes[row + 3], Add(center, extent));                                                                          \
+		}                                                                                                                        \
+		_WriteBoxes(lanes, Width, i, batch.m_Count, boxes);                                                                           \
+	}
+
+	inline void _ComputeSSE(const BoundingBoxBatch &batch, std::span<MathLib::HAABBox3D> boxes)
+	{
+		alignas(32) MathLib::HReal lanes[6][BoundingBoxBatch::Width];
+		PHYSICS_BOUNDS_KERNEL(__m128, 4, _mm_loadu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_andnot_ps, _mm_storeu_ps)
+	}
+
+	PHYSICS_TARGET_AVX inline void _ComputeAVX(const BoundingBoxBatch &batch, std::span<MathLib::HAABBox3D> boxes)
+	{
+		alignas(32) MathLib::HReal lanes[6][BoundingBoxBatch::Width];
+		PHYSICS_BOUNDS_KERNEL(__m256, 8, _mm256_loadu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_andnot_ps, _mm256_storeu_ps)
+	}
+#undef PHYSICS_BOUNDS_KERNEL
+#endif
+
+	// Writes the world box of every batch entry, eight per iteration with AVX, four with SSE.
+	inline void ComputeWorldBoundingBoxes(const BoundingBoxBatch &batch, std::span<MathLib::HAABBox3D> boxes)
+	{
+		if (boxes.size() < batch.m_Count)
+			return;
+#ifdef PHYSICS_SIMD_SSE
+		if (PhysicsSimdUtils::HasAVX())
+			_ComputeAVX(batch, boxes);
+		else
+			_ComputeSSE(batch, boxes);
+#else
+		_ComputeScalar(batch, boxes);
+#endif
+	}
+};
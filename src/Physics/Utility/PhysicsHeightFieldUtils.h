@@ -0,0 +1,42 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+namespace PhysicsHeightFieldUtils
+{
+	// Triangulates a heightfield the same way the collider is laid out, skipping hole cells.
+	static void BuildHeightFieldMesh(const HeightFieldGeometryParams& params, PhysicsMeshData& meshdata)
+	{
+		if (params.m_HeightFieldData == nullptr)
+			return;
+		const PhysicsHeightFieldData& heightField = *params.m_HeightFieldData;
+		const uint32_t numRows = heightField.m_NumRows;
+		const uint32_t numColumns = heightField.m_NumColumns;
+
+		meshdata.m_Vertices.resize(size_t(numRows) * numColumns);
+		for (uint32_t row = 0; row < numRows; row++)
+		{
+			for (uint32_t column = 0; column < numColumns; column++)
+			{
+				const uint32_t index = row * numColumns + column;
+				meshdata.m_Vertices[index] = MathLib::HVector3(MathLib::HReal(row) * params.m_RowScale,
+					MathLib::HReal(heightField.m_Heights[index]) * params.m_HeightScale,
+					MathLib::HReal(column) * params.m_ColumnScale);
+			}
+		}
+
+		meshdata.m_Indices.clear();
+		meshdata.m_Indices.reserve(size_t(numRows - 1) * (numColumns - 1) * 6);
+		for (uint32_t row = 0; row + 1 < numRows; row++)
+		{
+			for (uint32_t column = 0; column + 1 < numColumns; column++)
+			{
+				const uint32_t v0 = row * numColumns + column;
+				if (!heightField.m_MaterialIndices.empty() && heightField.m_MaterialIndices[v0] == PhysicsHeightFieldData::HoleMaterialIndex)
+					continue;
+				const uint32_t v1 = v0 + 1;
+				const uint32_t v2 = v0 + numColumns;
+				const uint32_t v3 = v2 + 1;
+				meshdata.m_Indices.insert(meshdata.m_Indices.end(), { v0, v1, v2, v1, v3, v2 });
+			}
+		}
+	}
+};
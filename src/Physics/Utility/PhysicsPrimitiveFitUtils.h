@@ -0,0 +1,159 @@
+#pragma once
+#include "Physics/PhysicsCommon.h"
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+
+namespace PhysicsPrimitiveFitUtils
+{
+	static constexpr MathLib::HReal PI = MathLib::HReal(3.14159265358979323846);
+
+	// Volume enclosed by a closed triangle mesh (divergence theorem over its faces).
+	static MathLib::HReal ComputeMeshVolume(const std::vector<MathLib::HVector3> &vertices, const std::vector<uint32_t> &indices)
+	{
+		MathLib::HReal volume = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			volume += vertices[indices[i]].dot(vertices[indices[i + 1]].cross(vertices[indices[i + 2]]));
+		return std::abs(volume) / 6;
+	}
+
+	// Principal axes of the point cloud as the columns of a right-handed rotation.
+	static MathLib::HMatrix3 ComputePrincipalAxes(const std::vector<MathLib::HVector3> &vertices)
+	{
+		MathLib::HVector3 mean(0, 0, 0);
+		for (const auto &v : vertices)
+			mean += v;
+		mean /= MathLib::HReal(vertices.size());
+
+		MathLib::HMatrix3 covariance = MathLib::HMatrix3::Zero();
+		for (const auto &v : vertices)
+		{
+			const MathLib::HVector3 d = v - mean;
+			covariance += d * d.transpose();
+		}
+
+		// Eigenvalues come in increasing order, the major axis is the last column.
+		Eigen::SelfAdjointEigenSolver<MathLib::HMatrix3> solver(covariance);
+		MathLib::HMatrix3 axes;
+		axes.col(0) = solver.eigenvectors().col(2).normalized();
+		axes.col(1) = solver.eigenvectors().col(1).normalized();
+		axes.col(2) = axes.col(0).cross(axes.col(1));
+		return axes;
+	}
+
+	static MathLib::HTransform3 MakeTransform(const MathLib::HMatrix3 &rotation, const MathLib::HVector3 &translation)
+	{
+		MathLib::HTransform3 transform = MathLib::HTransform3::Identity();
+		transform.linear() = rotation;
+		transform.translation() = translation;
+		return transform;
+	}
+
+	// Ritter's bounding sphere.
+	static void FitSphere(const std::vector<MathLib::HVector3> &vertices, PrimitiveFit &fit)
+	{
+		auto farthest = [&vertices](const MathLib::HVector3 &from)
+		{
+			return *std::max_element(vertices.begin(), vertices.end(), [&from](const MathLib::HVector3 &a, const MathLib::HVector3 &b)
+									 { return (a - from).squaredNorm() < (b - from).squaredNorm(); });
+		};
+		const MathLib::HVector3 a = farthest(vertices[0]);
+		const MathLib::HVector3 b = farthest(a);
+		MathLib::HVector3 center = (a + b) / 2;
+		MathLib::HReal radius = (b - a).norm() / 2;
+		for (const auto &v : vertices)
+		{
+			const MathLib::HReal distance = (v - center).norm();
+			if (distance > radius)
+			{
+				const MathLib::HReal newRadius = (radius + distance) / 2;
+				center += (v - center) * ((newRadius - radius) / distance);
+				radius = newRadius;
+			}
+		}
+
+		fit.m_Params = SphereGeometryParams{radius};
+		fit.m_LocalTransform = MakeTransform(MathLib::HMatrix3::Identity(), center);
+		fit.m_Volume = 4 * PI * radius * radius * radius / 3;
+	}
+
+	// Box along the principal axes, or along the mesh axes when that one is smaller.
+	static void FitBox(const std::vector<MathLib::HVector3> &vertices, const MathLib::HMatrix3 &principalAxes, PrimitiveFit &fit)
+	{
+		fit.m_Volume = std::numeric_limits<MathLib::HReal>::max();
+		for (const MathLib::HMatrix3 &axes : {principalAxes, MathLib::HMatrix3(MathLib::HMatrix3::Identity())})
+		{
+			MathLib::HAABBox3D box;
+			box.setEmpty();
+			for (const auto &v : vertices)
+				box.extend(MathLib::HVector3(axes.transpose() * v));
+			const MathLib::HVector3 halfExtents = box.sizes() / 2;
+			const MathLib::HReal volume = 8 * halfExtents[0] * halfExtents[1] * halfExtents[2];
+			if (volume < fit.m_Volume)
+			{
+				fit.m_Params = BoxGeometryParams{halfExtents};
+				fit.m_LocalTransform = MakeTransform(axes, axes * box.center());
+				fit.m_Volume = volume;
+			}
+		}
+	}
+
+	// Capsule around the major principal axis; PhysX capsules extend along their local x axis.
+	static void FitCapsule(const std::vector<MathLib::HVector3> &vertices, const MathLib::HMatrix3 &axes, PrimitiveFit &fit)
+	{
+		std::vector<MathLib::HVector3> local(vertices.size());
+		MathLib::HVector3 center(0, 0, 0);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			local[i] = axes.transpose() * vertices[i];
+			center += local[i];
+		}
+		center /= MathLib::HReal(vertices.size());
+
+		MathLib::HReal radiusSquared = 0;
+		for (const auto &v : local)
+			radiusSquared = std::max(radiusSquared, (v[1] - center[1]) * (v[1] - center[1]) + (v[2] - center[2]) * (v[2] - center[2]));
+		const MathLib::HReal radius = std::sqrt(radiusSquared);
+
+		// Shortest segment whose end spheres still cover every vertex.
+		MathLib::HReal segmentMin = std::numeric_limits<MathLib::HReal>::max();
+		MathLib::HReal segmentMax = -std::numeric_limits<MathLib::HReal>::max();
+		for (const auto &v : local)
+		{
+			const MathLib::HReal distanceSquared = (v[1] - center[1]) * (v[1] - center[1]) + (v[2] - center[2]) * (v[2] - center[2]);
+			const MathLib::HReal reach = std::sqrt(std::max(radiusSquared - distanceSquared, MathLib::HReal(0)));
+			segmentMin = std::min(segmentMin, v[0] + reach);
+			segmentMax = std::max(segmentMax, v[0] - reach);
+		}
+		if (segmentMin > segmentMax)
+			segmentMin = segmentMax = (segmentMin + segmentMax) / 2;
+		center[0] = (segmentMin + segmentMax) / 2;
+		const MathLib::HReal halfHeight = (segmentMax - segmentMin) / 2;
+
+		fit.m_Params = CapsuleGeometryParams{radius, halfHeight};
+		fit.m_LocalTransform = MakeTransform(axes, axes * center);
+		fit.m_Volume = PI * radius * radius * (2 * halfHeight + 4 * radius / 3);
+	}
+
+	// Fits a bounding sphere, capsule and box to the mesh scaled by scale and reports their volume errors.
+	static bool FitPrimitives(const PhysicsMeshData &meshData, const MathLib::HVector3 &scale, PrimitiveFitReport &report)
+	{
+		if (meshData.m_Vertices.empty())
+			return false;
+		std::vector<MathLib::HVector3> vertices(meshData.m_Vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+			vertices[i] = MathLib::HadamardProduct<3>(meshData.m_Vertices[i], scale);
+
+		const MathLib::HMatrix3 axes = ComputePrincipalAxes(vertices);
+		FitSphere(vertices, report.m_Sphere);
+		FitCapsule(vertices, axes, report.m_Capsule);
+		FitBox(vertices, axes, report.m_Box);
+
+		report.m_MeshVolume = ComputeMeshVolume(vertices, meshData.m_Indices);
+		if (report.m_MeshVolume <= std::numeric_limits<MathLib::HReal>::epsilon())
+			return false;
+		for (PrimitiveFit *fit : {&report.m_Sphere, &report.m_Capsule, &report.m_Box})
+			fit->m_VolumeError = (fit->m_Volume - report.m_MeshVolume) / report.m_MeshVolume;
+		return true;
+	}
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHYSICS_SIMD_SSE
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// The build targets the SSE2 baseline; wider kernels are compiled per function and picked at runtime.
+// MSVC accepts AVX intrinsics in any function, GCC and Clang need the target attribute.
+// PHYSICS_TARGET_AVX2_NOFMA is for kernels that must round exactly like the scalar code, GCC would
+// otherwise fuse their multiplies and adds; MSVC never fuses intrinsics.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PHYSICS_TARGET_AVX
+#define PHYSICS_TARGET_AVX2
+#define PHYSICS_TARGET_AVX2_NOFMA
+#else
+#define PHYSICS_TARGET_AVX __attribute__((target("avx")))
+#define PHYSICS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define PHYSICS_TARGET_AVX2_NOFMA __attribute__((target("avx2")))
+#endif
+
+namespace PhysicsSimdUtils
+{
+#ifdef PHYSICS_SIMD_SSE
+	inline bool _DetectAVX(bool bAVX2)
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		// AVX and OSXSAVE, then the OS has to save the ymm registers.
+		if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+			return false;
+		if (!bAVX2)
+			return true;
+		const bool bFMA = (info[2] & (1 << 12)) != 0;
+		__cpuidex(info, 7, 0);
+		return bFMA && (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return bAVX2 ? __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") : __builtin_cpu_supports("avx");
+#endif
+	}
+#endif
+
+	inline std::atomic<bool> &_GetWideKernelsEnabled()
+	{
+		static std::atomic<bool> bEnabled = true;
+		return bEnabled;
+	}
+
+	// Benchmarks turn the AVX kernels off to compare them with the SSE and scalar paths.
+	inline void SetWideKernelsEnabled(bool bEnable)
+	{
+		_GetWideKernelsEnabled() = bEnable;
+	}
+
+	inline bool HasAVX()
+	{
+#ifdef PHYSICS_SIMD_SSE
+		static const bool bSupported = _DetectAVX(false);
+		return bSupported && _GetWideKernelsEnabled().load(std::memory_order_relaxed);
+#else
+		return false;
+#endif
+	}
+
+	inline bool HasAVX2()
+	{
+#ifdef PHYSICS_SIMD_SSE
+		static const bool bSupported = _DetectAVX(true);
+		return bSupported && _GetWideKernelsEnabled().load(std::memory_order_relaxed);
+#else
+		return false;
+#endif
+	}
+};
@@ -1,18 +1,19 @@
 #pragma once
 #include <Physics/PhysicsCommon.h>
 
-MathLib::HAABBox3D ComputeBoundingBox(IPhysicsObject *physicsObject)
+inline MathLib::HAABBox3D ComputeBoundingBox(const std::vector<PhysicsPtr<IColliderGeometry>> &colliderGeometries, const std::vector<MathLib::HTransform3> &geoLocalPos)
 {
 	MathLib::HAABBox3D newBox;
-	std::vector<PhysicsPtr<IColliderGeometry>> colliderGeometries;
-	std::vector<MathLib::HTransform3> geoLocalPos;
-	physicsObject->GetColliderGeometries(colliderGeometries, &geoLocalPos);
 	for (size_t i = 0; i < colliderGeometries.size(); i++)
 	{
 		MathLib::HAABBox3D box = colliderGeometries[i]->GetBoundingBox();
-		MathLib::HTransform3 trans = geoLocalPos[i];
-		box.transform(trans);
+		box.transform(geoLocalPos[i]);
 		newBox.extend(box);
 	}
 	return newBox;
-}
\ No newline at end of file
+}
+
+inline MathLib::HAABBox3D ComputeBoundingBox(IPhysicsObject *physicsObject)
+{
+	return ComputeBoundingBox(physicsObject->GetColliderGeometries(), physicsObject->GetColliderLocalTransforms());
+}
@@ -75,7 +75,8 @@ public:
 		mLogger		= _desc.m_logger;
 
 		IVHACD::Parameters desc = _desc;
-		// Set our intercepting callback interfaces if non-null
+		// Set our intercepting callback interfaces if non-null. The hull callback is handed
+		// through as is, so it runs on the background thread.
 		desc.m_callback = desc.m_callback ? this : nullptr;
 		desc.m_logger = desc.m_logger ? this : nullptr;
 
@@ -84,30 +85,7 @@ public:
 			bool ok = mVHACD->Compute(points, countPoints, triangles, countTriangles, desc);
 			if (ok)
 			{
-				ret = mVHACD->GetNConvexHulls();
-				mHulls = new IVHACD::ConvexHull[ret];
-				for (uint32_t i = 0; i < ret; i++)
-				{
-					VHACD::IVHACD::ConvexHull vhull;
-					mVHACD->GetConvexHull(i, vhull);
-					VHACD::IVHACD::ConvexHull h;
-					h.m_nPoints = vhull.m_nPoints;
-					h.m_points = (double *)HACD_ALLOC(sizeof(double) * 3 * h.m_nPoints);
-					memcpy(h.m_points, vhull.m_points, sizeof(double) * 3 * h.m_nPoints);
-					h.m_nTriangles = vhull.m_nTriangles;
-					h.m_triangles = (uint32_t *)HACD_ALLOC(sizeof(uint32_t) * 3 * h.m_nTriangles);
-					memcpy(h.m_triangles, vhull.m_triangles, sizeof(uint32_t) * 3 * h.m_nTriangles);
-					h.m_volume = vhull.m_volume;
-					h.m_center[0] = vhull.m_center[0];
-					h.m_center[1] = vhull.m_center[1];
-					h.m_center[2] = vhull.m_center[2];
-					mHulls[i] = h;
-					if (mCancel)
-					{
-						ret = 0;
-						break;
-					}
-				}
+				ret = copyHulls();
 			}
 		}
 
@@ -115,6 +93,91 @@ public:
 		return ret ? true : false;
 	}
 
+	// Copies the hulls out of the wrapped instance, stops early on a cancel.
+	uint32_t copyHulls(void)
+	{
+		uint32_t ret = mVHACD->GetNConvexHulls();
+		mHulls = new IVHACD::ConvexHull[ret];
+		for (uint32_t i = 0; i < ret; i++)
+		{
+			VHACD::IVHACD::ConvexHull vhull;
+			mVHACD->GetConvexHull(i, vhull);
+			VHACD::IVHACD::ConvexHull h;
+			h.m_nPoints = vhull.m_nPoints;
+			h.m_points = (double *)HACD_ALLOC(sizeof(double) * 3 * h.m_nPoints);
+			memcpy(h.m_points, vhull.m_points, sizeof(double) * 3 * h.m_nPoints);
+			h.m_nTriangles = vhull.m_nTriangles;
+			h.m_triangles = (uint32_t *)HACD_ALLOC(sizeof(uint32_t) * 3 * h.m_nTriangles);
+			memcpy(h.m_triangles, vhull.m_triangles, sizeof(uint32_t) * 3 * h.m_nTriangles);
+			h.m_volume = vhull.m_volume;
+			h.m_center[0] = vhull.m_center[0];
+			h.m_center[1] = vhull.m_center[1];
+			h.m_center[2] = vhull.m_center[2];
+			mHulls[i] = h;
+			if (mCancel)
+			{
+				ret = 0;
+				break;
+			}
+		}
+		return ret;
+	}
+
+	// Merging large hull sets takes seconds, so like Compute it runs on the background thread.
+	virtual bool Merge(const ConvexHull* const hulls,
+		const uint32_t countHulls,
+		const Parameters& _desc) final
+	{
+#if ENABLE_ASYNC
+		Cancel();
+		releaseHACD();
+
+		// The caller's hulls are copied so they may be released while the merge runs.
+		mMergeHulls = new IVHACD::ConvexHull[countHulls];
+		mMergeHullCount = countHulls;
+		for (uint32_t i = 0; i < countHulls; i++)
+		{
+			IVHACD::ConvexHull &h = mMergeHulls[i];
+			h = hulls[i];
+			h.m_points = (double *)HACD_ALLOC(sizeof(double) * 3 * h.m_nPoints);
+			memcpy(h.m_points, hulls[i].m_points, sizeof(double) * 3 * h.m_nPoints);
+			h.m_triangles = (uint32_t *)HACD_ALLOC(sizeof(uint32_t) * 3 * h.m_nTriangles);
+			memcpy(h.m_triangles, hulls[i].m_triangles, sizeof(uint32_t) * 3 * h.m_nTriangles);
+		}
+		mRunning = true;
+		mThread = new std::thread([this, countHulls, _desc]()
+		{
+			MergeNow(mMergeHulls, countHulls, _desc);
+			mRunning = false;
+		});
+#else
+		releaseHACD();
+		MergeNow(hulls, countHulls, _desc);
+#endif
+		return true;
+	}
+
+	bool MergeNow(const ConvexHull* const hulls,
+		const uint32_t countHulls,
+		const Parameters& _desc)
+	{
+		mHullCount	= 0;
+		mCallback	= _desc.m_callback;
+		mLogger		= _desc.m_logger;
+
+		IVHACD::Parameters desc = _desc;
+		desc.m_callback = desc.m_callback ? this : nullptr;
+		desc.m_logger = desc.m_logger ? this : nullptr;
+
+		uint32_t ret = 0;
+		if (mVHACD->Merge(hulls, countHulls, desc))
+		{
+			ret = copyHulls();
+		}
+		mHullCount = ret;
+		return ret ? true : false;
+	}
+
 	void releaseHull(VHACD::IVHACD::ConvexHull &h)
 	{
 		HACD_FREE((void *)h.m_triangles);
@@ -144,6 +207,13 @@ public:
 		mVertices = nullptr;
 		HACD_FREE(mIndices);
 		mIndices = nullptr;
+		for (uint32_t i = 0; i < mMergeHullCount; i++)
+		{
+			releaseHull(mMergeHulls[i]);
+		}
+		delete[]mMergeHulls;
+		mMergeHulls = nullptr;
+		mMergeHullCount = 0;
 	}
 
 
@@ -197,6 +267,12 @@ public:
 		return ret;
 	}
 
+	virtual bool HasTimedOut(void) const final
+	{
+		// The worker writes the flag while it runs, mRunning publishes it once it is done
+		return mVHACD && IsReady() && mVHACD->HasTimedOut();
+	}
+
 	virtual uint32_t GetNConvexHulls() const final
 	{
 		processPendingMessages();
@@ -325,6 +401,8 @@ public:
 private:
 	double							*mVertices{ nullptr };
 	uint32_t						*mIndices{ nullptr };
+	VHACD::IVHACD::ConvexHull		*mMergeHulls{ nullptr };
+	uint32_t						mMergeHullCount{ 0 };
 	std::atomic< uint32_t>			mHullCount{ 0 };
 	VHACD::IVHACD::ConvexHull		*mHulls{ nullptr };
 	VHACD::IVHACD::IUserCallback	*mCallback{ nullptr };
@@ -16,13 +16,13 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iomanip>
 #include <limits>
+#include <queue>
 #include <sstream>
-#if USE_OPENMP
-#include <omp.h>
-#endif // _OPENMP
+#include <vector>
 
 #include "VHACD.h"
 #include "btConvexHullComputer.h"
@@ -54,91 +54,6 @@ extern RENDER_DEBUG::RenderDebug *gRenderDebug;
 #pragma warning(disable:4267 4100 4244 4456)
 #endif
 
-#ifdef USE_SSE
-#include <immintrin.h>
-
-const int32_t SIMD_WIDTH = 4;
-inline int32_t FindMinimumElement(const float* const d, float* const _, const int32_t n)
-{
-    // Min within vectors
-    __m128 min_i = _mm_set1_ps(-1.0f);
-    __m128 min_v = _mm_set1_ps(std::numeric_limits<float>::max());
-    for (int32_t i = 0; i <= n - SIMD_WIDTH; i += SIMD_WIDTH) {
-        const __m128 data = _mm_load_ps(&d[i]);
-        const __m128 pred = _mm_cmplt_ps(data, min_v);
-
-        min_i = _mm_blendv_ps(min_i, _mm_set1_ps(i), pred);
-        min_v = _mm_min_ps(data, min_v);
-    }
-
-    /* Min within vector */
-    const __m128 min1 = _mm_shuffle_ps(min_v, min_v, _MM_SHUFFLE(1, 0, 3, 2));
-    const __m128 min2 = _mm_min_ps(min_v, min1);
-    const __m128 min3 = _mm_shuffle_ps(min2, min2, _MM_SHUFFLE(0, 1, 0, 1));
-    const __m128 min4 = _mm_min_ps(min2, min3);
-    float min_d = _mm_cvtss_f32(min4);
-
-    // Min index
-    const int32_t min_idx = __builtin_ctz(_mm_movemask_ps(_mm_cmpeq_ps(min_v, min4)));
-    int32_t ret = min_i[min_idx] + min_idx;
-
-    // Trailing elements
-    for (int32_t i = (n & ~(SIMD_WIDTH - 1)); i < n; ++i) {
-        if (d[i] < min_d) {
-            min_d = d[i];
-            ret = i;
-        }
-    }
-
-    *m = min_d;
-    return ret;
-}
-
-inline int32_t FindMinimumElement(const float* const d, float* const m, const int32_t begin, const int32_t end)
-{
-    // Leading elements
-    int32_t min_i = -1;
-    float min_d = std::numeric_limits<float>::max();
-    const int32_t aligned = (begin & ~(SIMD_WIDTH - 1)) + ((begin & (SIMD_WIDTH - 1)) ? SIMD_WIDTH : 0);
-    for (int32_t i = begin; i < std::min(end, aligned); ++i) {
-        if (d[i] < min_d) {
-            min_d = d[i];
-            min_i = i;
-        }
-    }
-
-    // Middle and trailing elements
-    float r_m = std::numeric_limits<float>::max();
-    const int32_t n = end - aligned;
-    const int32_t r_i = (n > 0) ? FindMinimumElement(&d[aligned], &r_m, n) : 0;
-
-    // Pick the lowest
-    if (r_m < min_d) {
-        *m = r_m;
-        return r_i + aligned;
-    }
-    else {
-        *m = min_d;
-        return min_i;
-    }
-}
-#else
-inline int32_t FindMinimumElement(const float* const d, float* const m, const int32_t begin, const int32_t end)
-{
-    int32_t idx = -1;
-    float min = (std::numeric_limits<float>::max)();
-    for (size_t i = begin; i < size_t(end); ++i) {
-        if (d[i] < min) {
-            idx = i;
-            min = d[i];
-        }
-    }
-
-    *m = min;
-    return idx;
-}
-#endif
-
 #define OCL_SOURCE_FROM_FILE
 #ifndef OCL_SOURCE_FROM_FILE
 const char* oclProgramSource = "\
@@ -279,13 +194,13 @@ bool VHACD::OCLInit(void* const oclDevice, IUserLogger* const logger)
     delete[] m_oclQueue;
 	delete[] m_oclKernelComputePartialVolumes;
 	delete[] m_oclKernelComputeSum;
-    m_oclQueue = new cl_command_queue[m_ompNumProcessors];
-    m_oclKernelComputePartialVolumes = new cl_kernel[m_ompNumProcessors];
-    m_oclKernelComputeSum = new cl_kernel[m_ompNumProcessors];
+    m_oclQueue = new cl_command_queue[m_maxNumWorkers];
+    m_oclKernelComputePartialVolumes = new cl_kernel[m_maxNumWorkers];
+    m_oclKernelComputeSum = new cl_kernel[m_maxNumWorkers];
 
     const char nameKernelComputePartialVolumes[] = "ComputePartialVolumes";
     const char nameKernelComputeSum[] = "ComputePartialSums";
-    for (int32_t k = 0; k < m_ompNumProcessors; ++k) {
+    for (int32_t k = 0; k < m_maxNumWorkers; ++k) {
         m_oclKernelComputePartialVolumes[k] = clCreateKernel(m_oclProgram, nameKernelComputePartialVolumes, &error);
         if (error != CL_SUCCESS) {
             if (logger) {
@@ -326,7 +241,7 @@ bool VHACD::OCLInit(void* const oclDevice, IUserLogger* const logger)
         m_oclWorkGroupSize = workGroupSize;
     }
 
-    for (int32_t k = 0; k < m_ompNumProcessors; ++k) {
+    for (int32_t k = 0; k < m_maxNumWorkers; ++k) {
         m_oclQueue[k] = clCreateCommandQueue(m_oclContext, *m_oclDevice, 0 /*CL_QUEUE_PROFILING_ENABLE*/, &error);
         if (error != CL_SUCCESS) {
             if (logger) {
@@ -345,7 +260,7 @@ bool VHACD::OCLRelease(IUserLogger* const logger)
 #ifdef CL_VERSION_1_1
     cl_int error;
     if (m_oclKernelComputePartialVolumes) {
-        for (int32_t k = 0; k < m_ompNumProcessors; ++k) {
+        for (int32_t k = 0; k < m_maxNumWorkers; ++k) {
             error = clReleaseKernel(m_oclKernelComputePartialVolumes[k]);
             if (error != CL_SUCCESS) {
                 if (logger) {
@@ -357,7 +272,7 @@ bool VHACD::OCLRelease(IUserLogger* const logger)
         delete[] m_oclKernelComputePartialVolumes;
     }
     if (m_oclKernelComputeSum) {
-        for (int32_t k = 0; k < m_ompNumProcessors; ++k) {
+        for (int32_t k = 0; k < m_maxNumWorkers; ++k) {
             error = clReleaseKernel(m_oclKernelComputeSum[k]);
             if (error != CL_SUCCESS) {
                 if (logger) {
@@ -369,7 +284,7 @@ bool VHACD::OCLRelease(IUserLogger* const logger)
         delete[] m_oclKernelComputeSum;
     }
     if (m_oclQueue) {
-        for (int32_t k = 0; k < m_ompNumProcessors; ++k) {
+        for (int32_t k = 0; k < m_maxNumWorkers; ++k) {
             error = clReleaseCommandQueue(m_oclQueue[k]);
             if (error != CL_SUCCESS) {
                 if (logger) {
@@ -458,6 +373,41 @@ bool VHACD::Compute(const float* const points,const uint32_t nPoints,
 {
     return ComputeACD(points, nPoints, triangles, nTriangles, params);
 }
+bool VHACD::Merge(const ConvexHull* const hulls, const uint32_t countHulls, const Parameters& params)
+{
+    // Init leaves the hulls of an earlier Compute or Merge in place
+    Clean();
+    Init();
+    SArray<Vec3<double> > pts;
+    for (uint32_t h = 0; h < countHulls; ++h) {
+        const ConvexHull& hull = hulls[h];
+        Mesh* mesh = new Mesh;
+        for (uint32_t v = 0; v < hull.m_nPoints; ++v) {
+            const Vec3<double> point(hull.m_points[v * 3], hull.m_points[v * 3 + 1], hull.m_points[v * 3 + 2]);
+            mesh->AddPoint(point);
+            pts.PushBack(point);
+        }
+        for (uint32_t t = 0; t < hull.m_nTriangles; ++t) {
+            mesh->AddTriangle(Vec3<int32_t>(hull.m_triangles[t * 3], hull.m_triangles[t * 3 + 1], hull.m_triangles[t * 3 + 2]));
+        }
+        m_convexHulls.PushBack(mesh);
+    }
+
+    // Compute normalizes the merge costs by the hull of the input mesh, here the hull of all hulls stands in
+    Mesh hull0;
+    hull0.ComputeConvexHull((double*)pts.Data(), pts.Size());
+    m_volumeCH0 = hull0.ComputeVolume();
+    if (!(m_volumeCH0 > 0.0)) {
+        m_volumeCH0 = 1.0;
+    }
+    MergeConvexHulls(params);
+    SimplifyConvexHulls(params);
+    if (GetCancel()) {
+        Clean();
+        return false;
+    }
+    return true;
+}
 double ComputePreferredCuttingDirection(const PrimitiveSet* const tset, Vec3<double>& dir)
 {
     double ex = tset->GetEigenValue(AXIS_X);
@@ -686,6 +636,223 @@ inline double ComputeConcavity(const double volume, const double volumeCH, const
     return fabs(volumeCH - volume) / volume0;
 }
 
+// Shared state of one clipping-plane search; every task evaluates one chunk of the candidate planes.
+struct VHACD::ClippingPlaneSearch {
+    struct ChunkResult {
+        int32_t m_iBest;
+        double m_total;
+        double m_concavity;
+        double m_balance;
+        double m_symmetry;
+        Plane m_plane;
+    };
+    VHACD* m_vhacd;
+    const PrimitiveSet* m_inputPSet;
+    const PrimitiveSet* m_onSurfacePSet;
+    const SArray<Plane>* m_planes;
+    Vec3<double> m_preferredCuttingDirection;
+    double m_w;
+    double m_alpha;
+    double m_beta;
+    int32_t m_convexhullDownsampling;
+    double m_progress0;
+    double m_progress1;
+    const Parameters* m_params;
+    bool m_oclAcceleration;
+    size_t m_nPrimitives;
+#ifdef CL_VERSION_1_1
+    cl_mem* m_partialVolumes;
+    size_t m_globalSize;
+    size_t m_nWorkGroups;
+    double m_unitVolume;
+#endif // CL_VERSION_1_1
+    int32_t m_nPlanes;
+    int32_t m_chunkSize;
+    std::atomic<bool> m_cancel;
+    std::atomic<int32_t> m_done;
+    Mutex m_progressMutex;
+    std::vector<ChunkResult> m_results;
+};
+
+void VHACD::ClippingPlaneTask(void* userData, uint32_t taskIndex, uint32_t workerIndex)
+{
+    ClippingPlaneSearch& search = *(ClippingPlaneSearch*)userData;
+    search.m_vhacd->EvaluateClippingPlanes(search, taskIndex, workerIndex);
+}
+
+void VHACD::EvaluateClippingPlanes(ClippingPlaneSearch& search, const uint32_t chunk, const uint32_t workerIndex)
+{
+    const Parameters& params = *search.m_params;
+    const PrimitiveSet* inputPSet = search.m_inputPSet;
+    const PrimitiveSet* onSurfacePSet = search.m_onSurfacePSet;
+    const size_t nPrimitives = search.m_nPrimitives;
+    const int32_t threadID = (int32_t)workerIndex;
+    ClippingScratch& scratch = *m_clippingScratch[threadID];
+    ClippingPlaneSearch::ChunkResult& result = search.m_results[chunk];
+
+    const int32_t begin = (int32_t)chunk * search.m_chunkSize;
+    const int32_t end = std::min(begin + search.m_chunkSize, search.m_nPlanes);
+    for (int32_t x = begin; x < end; ++x) {
+        // cooperative cancellation, checked before every plane
+        if (search.m_cancel.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (GetCancel()) {
+            search.m_cancel = true;
+            return;
+        }
+        // past the deadline the search settles for the best of the planes evaluated so far
+        if (IsOutOfTime()) {
+            return;
+        }
+        Plane plane = (*search.m_planes)[x];
+
+        if (search.m_oclAcceleration) {
+#ifdef CL_VERSION_1_1
+            const float fPlane[4] = { (float)plane.m_a, (float)plane.m_b, (float)plane.m_c, (float)plane.m_d };
+            cl_int error = clSetKernelArg(m_oclKernelComputePartialVolumes[threadID], 2, sizeof(float) * 4, fPlane);
+            if (error != CL_SUCCESS) {
+                if (params.m_logger) {
+                    params.m_logger->Log("Couldn't kernel atguments \n");
+                }
+                SetCancel(true);
+            }
+
+            error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputePartialVolumes[threadID],
+                1, NULL, &search.m_globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
+            if (error != CL_SUCCESS) {
+                if (params.m_logger) {
+                    params.m_logger->Log("Couldn't run kernel \n");
+                }
+                SetCancel(true);
+            }
+            int32_t nValues = (int32_t)search.m_nWorkGroups;
+            while (nValues > 1) {
+                error = clSetKernelArg(m_oclKernelComputeSum[threadID], 1, sizeof(int32_t), &nValues);
+                if (error != CL_SUCCESS) {
+                    if (params.m_logger) {
+                        params.m_logger->Log("Couldn't kernel atguments \n");
+                    }
+                    SetCancel(true);
+                }
+                size_t nWorkGroups = (nValues + m_oclWorkGroupSize - 1) / m_oclWorkGroupSize;
+                size_t globalSize = nWorkGroups * m_oclWorkGroupSize;
+                error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputeSum[threadID],
+                    1, NULL, &globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
+                if (error != CL_SUCCESS) {
+                    if (params.m_logger) {
+                        params.m_logger->Log("Couldn't run kernel \n");
+                    }
+                    SetCancel(true);
+                }
+                nValues = (int32_t)nWorkGroups;
+            }
+#endif // CL_VERSION_1_1
+        }
+
+        Mesh& leftCH = scratch.m_leftCH;
+        Mesh& rightCH = scratch.m_rightCH;
+        rightCH.ResizePoints(0);
+        leftCH.ResizePoints(0);
+        rightCH.ResizeTriangles(0);
+        leftCH.ResizeTriangles(0);
+
+// compute convex-hulls
+#ifdef TEST_APPROX_CH
+        double volumeLeftCH1;
+        double volumeRightCH1;
+#endif //TEST_APPROX_CH
+        if (params.m_convexhullApproximation) {
+            SArray<Vec3<double> >& leftCHPts = scratch.m_leftCHPts;
+            SArray<Vec3<double> >& rightCHPts = scratch.m_rightCHPts;
+            rightCHPts.Resize(0);
+            leftCHPts.Resize(0);
+            onSurfacePSet->Intersect(plane, &rightCHPts, &leftCHPts, search.m_convexhullDownsampling * 32);
+            inputPSet->GetConvexHull().Clip(plane, rightCHPts, leftCHPts);
+            rightCH.ComputeConvexHull((double*)rightCHPts.Data(), rightCHPts.Size());
+            leftCH.ComputeConvexHull((double*)leftCHPts.Data(), leftCHPts.Size());
+#ifdef TEST_APPROX_CH
+            Mesh leftCH1;
+            Mesh rightCH1;
+            VoxelSet right;
+            VoxelSet left;
+            onSurfacePSet->Clip(plane, &right, &left);
+            right.ComputeConvexHull(rightCH1, search.m_convexhullDownsampling);
+            left.ComputeConvexHull(leftCH1, search.m_convexhullDownsampling);
+
+            volumeLeftCH1 = leftCH1.ComputeVolume();
+            volumeRightCH1 = rightCH1.ComputeVolume();
+#endif //TEST_APPROX_CH
+        }
+        else if (onSurfacePSet->GetNPrimitives() > 0) {
+            // Clip leaves the parts untouched for an empty set, the reused ones would keep an older cut
+            if (!scratch.m_right) {
+                scratch.m_right = inputPSet->Create();
+                scratch.m_left = inputPSet->Create();
+            }
+            PrimitiveSet* const right = scratch.m_right;
+            PrimitiveSet* const left = scratch.m_left;
+            onSurfacePSet->Clip(plane, right, left);
+            right->ComputeConvexHull(rightCH, search.m_convexhullDownsampling);
+            left->ComputeConvexHull(leftCH, search.m_convexhullDownsampling);
+        }
+        double volumeLeftCH = leftCH.ComputeVolume();
+        double volumeRightCH = rightCH.ComputeVolume();
+
+        // compute clipped volumes
+        double volumeLeft = 0.0;
+        double volumeRight = 0.0;
+        if (search.m_oclAcceleration) {
+#ifdef CL_VERSION_1_1
+            uint32_t volumes[4];
+            cl_int error = clEnqueueReadBuffer(m_oclQueue[threadID], search.m_partialVolumes[threadID], CL_TRUE,
+                0, sizeof(uint32_t) * 4, volumes, 0, NULL, NULL);
+            size_t nPrimitivesRight = volumes[0] + volumes[1] + volumes[2] + volumes[3];
+            size_t nPrimitivesLeft = nPrimitives - nPrimitivesRight;
+            volumeRight = nPrimitivesRight * search.m_unitVolume;
+            volumeLeft = nPrimitivesLeft * search.m_unitVolume;
+            if (error != CL_SUCCESS) {
+                if (params.m_logger) {
+                    params.m_logger->Log("Couldn't read buffer \n");
+                }
+                SetCancel(true);
+            }
+#endif // CL_VERSION_1_1
+        }
+        else {
+            inputPSet->ComputeClippedVolumes(plane, volumeRight, volumeLeft);
+        }
+        double concavityLeft = ComputeConcavity(volumeLeft, volumeLeftCH, m_volumeCH0);
+        double concavityRight = ComputeConcavity(volumeRight, volumeRightCH, m_volumeCH0);
+        double concavity = (concavityLeft + concavityRight);
+
+        // compute cost
+        double balance = search.m_alpha * fabs(volumeLeft - volumeRight) / m_volumeCH0;
+        const Vec3<double>& preferredCuttingDirection = search.m_preferredCuttingDirection;
+        double d = search.m_w * (preferredCuttingDirection[0] * plane.m_a + preferredCuttingDirection[1] * plane.m_b + preferredCuttingDirection[2] * plane.m_c);
+        double symmetry = search.m_beta * d;
+        double total = concavity + balance + symmetry;
+
+        // planes of a chunk are visited in order, so the first of equal costs is kept as before
+        if (total < result.m_total) {
+            result.m_iBest = x;
+            result.m_total = total;
+            result.m_concavity = concavity;
+            result.m_balance = balance;
+            result.m_symmetry = symmetry;
+            result.m_plane = plane;
+        }
+        const int32_t done = ++search.m_done;
+        if (!(done & 127)) // reduce update frequency
+        {
+            double progress = done * (search.m_progress1 - search.m_progress0) / search.m_nPlanes + search.m_progress0;
+            search.m_progressMutex.Lock();
+            Update(m_stageProgress, progress, params);
+            search.m_progressMutex.Unlock();
+        }
+    }
+}
+
 //#define DEBUG_TEMP
 void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double volume, const SArray<Plane>& planes,
     const Vec3<double>& preferredCuttingDirection, const double w, const double alpha, const double beta,
@@ -700,25 +867,39 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
     bool oclAcceleration = (nPrimitives > OCL_MIN_NUM_PRIMITIVES && params.m_oclAcceleration && params.m_mode == 0) ? true : false;
     int32_t iBest = -1;
     int32_t nPlanes = static_cast<int32_t>(planes.Size());
-    bool cancel = false;
-    int32_t done = 0;
     double minTotal = MAX_DOUBLE;
     double minBalance = MAX_DOUBLE;
     double minSymmetry = MAX_DOUBLE;
     minConcavity = MAX_DOUBLE;
 
-    SArray<Vec3<double> >* chPts = new SArray<Vec3<double> >[2 * m_ompNumProcessors];
-    Mesh* chs = new Mesh[2 * m_ompNumProcessors];
+    // The scheduler decides how many threads the search may use; the scratch of each is kept until Clean.
+    uint32_t nWorkers = params.m_taskScheduler ? params.m_taskScheduler->GetNumWorkers() : 1;
+    nWorkers = std::max(std::min(nWorkers, (uint32_t)m_maxNumWorkers), 1u);
+    for (size_t i = m_clippingScratch.Size(); i < nWorkers; ++i) {
+        m_clippingScratch.PushBack(new ClippingScratch());
+    }
+
+    ClippingPlaneSearch search;
+    search.m_vhacd = this;
+    search.m_inputPSet = inputPSet;
     PrimitiveSet* onSurfacePSet = inputPSet->Create();
     inputPSet->SelectOnSurface(onSurfacePSet);
-
-    PrimitiveSet** psets = 0;
-    if (!params.m_convexhullApproximation) {
-        psets = new PrimitiveSet*[2 * m_ompNumProcessors];
-        for (int32_t i = 0; i < 2 * m_ompNumProcessors; ++i) {
-            psets[i] = inputPSet->Create();
-        }
-    }
+    search.m_onSurfacePSet = onSurfacePSet;
+    search.m_planes = &planes;
+    search.m_preferredCuttingDirection = preferredCuttingDirection;
+    search.m_w = w;
+    search.m_alpha = alpha;
+    search.m_beta = beta;
+    search.m_convexhullDownsampling = convexhullDownsampling;
+    search.m_progress0 = progress0;
+    search.m_progress1 = progress1;
+    search.m_params = &params;
+    search.m_nPrimitives = nPrimitives;
+    search.m_nPlanes = nPlanes;
+    // a few chunks per worker keeps the threads busy when plane costs differ
+    search.m_chunkSize = std::max((nPlanes + 4 * (int32_t)nWorkers - 1) / (4 * (int32_t)nWorkers), 1);
+    search.m_cancel = false;
+    search.m_done = 0;
 
 #ifdef CL_VERSION_1_1
     // allocate OpenCL data structures
@@ -737,10 +918,13 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
         nWorkGroups = (nPrimitives + 4 * m_oclWorkGroupSize - 1) / (4 * m_oclWorkGroupSize);
         globalSize = nWorkGroups * m_oclWorkGroupSize;
         cl_int error;
+        // the kernels read one Voxel per voxel, the bricks are expanded for the upload
+        SArray<Voxel> expandedVoxels;
+        vset->ExpandVoxels(expandedVoxels);
         voxels = clCreateBuffer(m_oclContext,
             CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
             sizeof(Voxel) * nPrimitives,
-            vset->GetVoxels(),
+            expandedVoxels.Data(),
             &error);
         if (error != CL_SUCCESS) {
             if (params.m_logger) {
@@ -749,8 +933,8 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
             SetCancel(true);
         }
 
-        partialVolumes = new cl_mem[m_ompNumProcessors];
-        for (int32_t i = 0; i < m_ompNumProcessors; ++i) {
+        partialVolumes = new cl_mem[m_maxNumWorkers];
+        for (int32_t i = 0; i < m_maxNumWorkers; ++i) {
             partialVolumes[i] = clCreateBuffer(m_oclContext,
                 CL_MEM_WRITE_ONLY,
                 sizeof(uint32_t) * 4 * nWorkGroups,
@@ -779,173 +963,44 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
             }
         }
     }
+    search.m_partialVolumes = partialVolumes;
+    search.m_globalSize = globalSize;
+    search.m_nWorkGroups = nWorkGroups;
+    search.m_unitVolume = unitVolume;
 #else // CL_VERSION_1_1
     oclAcceleration = false;
 #endif // CL_VERSION_1_1
+    search.m_oclAcceleration = oclAcceleration;
 
 #ifdef DEBUG_TEMP
     Timer timerComputeCost;
     timerComputeCost.Tic();
 #endif // DEBUG_TEMP
 
-#if USE_THREAD == 1 && _OPENMP
-#pragma omp parallel for
-#endif
-    for (int32_t x = 0; x < nPlanes; ++x) {
-        int32_t threadID = 0;
-#if USE_THREAD == 1 && _OPENMP
-        threadID = omp_get_thread_num();
-#pragma omp flush(cancel)
-#endif
-        if (!cancel) {
-            //Update progress
-            if (GetCancel()) {
-                cancel = true;
-#if USE_THREAD == 1 && _OPENMP
-#pragma omp flush(cancel)
-#endif
-            }
-            Plane plane = planes[x];
-
-            if (oclAcceleration) {
-#ifdef CL_VERSION_1_1
-                const float fPlane[4] = { (float)plane.m_a, (float)plane.m_b, (float)plane.m_c, (float)plane.m_d };
-                cl_int error = clSetKernelArg(m_oclKernelComputePartialVolumes[threadID], 2, sizeof(float) * 4, fPlane);
-                if (error != CL_SUCCESS) {
-                    if (params.m_logger) {
-                        params.m_logger->Log("Couldn't kernel atguments \n");
-                    }
-                    SetCancel(true);
-                }
-
-                error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputePartialVolumes[threadID],
-                    1, NULL, &globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
-                if (error != CL_SUCCESS) {
-                    if (params.m_logger) {
-                        params.m_logger->Log("Couldn't run kernel \n");
-                    }
-                    SetCancel(true);
-                }
-                int32_t nValues = (int32_t)nWorkGroups;
-                while (nValues > 1) {
-                    error = clSetKernelArg(m_oclKernelComputeSum[threadID], 1, sizeof(int32_t), &nValues);
-                    if (error != CL_SUCCESS) {
-                        if (params.m_logger) {
-                            params.m_logger->Log("Couldn't kernel atguments \n");
-                        }
-                        SetCancel(true);
-                    }
-                    size_t nWorkGroups = (nValues + m_oclWorkGroupSize - 1) / m_oclWorkGroupSize;
-                    size_t globalSize = nWorkGroups * m_oclWorkGroupSize;
-                    error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputeSum[threadID],
-                        1, NULL, &globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
-                    if (error != CL_SUCCESS) {
-                        if (params.m_logger) {
-                            params.m_logger->Log("Couldn't run kernel \n");
-                        }
-                        SetCancel(true);
-                    }
-                    nValues = (int32_t)nWorkGroups;
-                }
-#endif // CL_VERSION_1_1
-            }
-
-            Mesh& leftCH = chs[threadID];
-            Mesh& rightCH = chs[threadID + m_ompNumProcessors];
-            rightCH.ResizePoints(0);
-            leftCH.ResizePoints(0);
-            rightCH.ResizeTriangles(0);
-            leftCH.ResizeTriangles(0);
-
-// compute convex-hulls
-#ifdef TEST_APPROX_CH
-            double volumeLeftCH1;
-            double volumeRightCH1;
-#endif //TEST_APPROX_CH
-            if (params.m_convexhullApproximation) {
-                SArray<Vec3<double> >& leftCHPts = chPts[threadID];
-                SArray<Vec3<double> >& rightCHPts = chPts[threadID + m_ompNumProcessors];
-                rightCHPts.Resize(0);
-                leftCHPts.Resize(0);
-                onSurfacePSet->Intersect(plane, &rightCHPts, &leftCHPts, convexhullDownsampling * 32);
-                inputPSet->GetConvexHull().Clip(plane, rightCHPts, leftCHPts);
-                rightCH.ComputeConvexHull((double*)rightCHPts.Data(), rightCHPts.Size());
-                leftCH.ComputeConvexHull((double*)leftCHPts.Data(), leftCHPts.Size());
-#ifdef TEST_APPROX_CH
-                Mesh leftCH1;
-                Mesh rightCH1;
-                VoxelSet right;
-                VoxelSet left;
-                onSurfacePSet->Clip(plane, &right, &left);
-                right.ComputeConvexHull(rightCH1, convexhullDownsampling);
-                left.ComputeConvexHull(leftCH1, convexhullDownsampling);
-
-                volumeLeftCH1 = leftCH1.ComputeVolume();
-                volumeRightCH1 = rightCH1.ComputeVolume();
-#endif //TEST_APPROX_CH
-            }
-            else {
-                PrimitiveSet* const right = psets[threadID];
-                PrimitiveSet* const left = psets[threadID + m_ompNumProcessors];
-                onSurfacePSet->Clip(plane, right, left);
-                right->ComputeConvexHull(rightCH, convexhullDownsampling);
-                left->ComputeConvexHull(leftCH, convexhullDownsampling);
-            }
-            double volumeLeftCH = leftCH.ComputeVolume();
-            double volumeRightCH = rightCH.ComputeVolume();
+    const uint32_t nChunks = (uint32_t)((nPlanes + search.m_chunkSize - 1) / search.m_chunkSize);
+    ClippingPlaneSearch::ChunkResult unvisited;
+    unvisited.m_iBest = -1;
+    unvisited.m_total = MAX_DOUBLE;
+    search.m_results.assign(nChunks, unvisited);
+    if (nWorkers > 1 && nChunks > 1) {
+        params.m_taskScheduler->ParallelFor(nChunks, nWorkers, &VHACD::ClippingPlaneTask, &search);
+    }
+    else {
+        for (uint32_t chunk = 0; chunk < nChunks; ++chunk) {
+            EvaluateClippingPlanes(search, chunk, 0);
+        }
+    }
 
-            // compute clipped volumes
-            double volumeLeft = 0.0;
-            double volumeRight = 0.0;
-            if (oclAcceleration) {
-#ifdef CL_VERSION_1_1
-                uint32_t volumes[4];
-                cl_int error = clEnqueueReadBuffer(m_oclQueue[threadID], partialVolumes[threadID], CL_TRUE,
-                    0, sizeof(uint32_t) * 4, volumes, 0, NULL, NULL);
-                size_t nPrimitivesRight = volumes[0] + volumes[1] + volumes[2] + volumes[3];
-                size_t nPrimitivesLeft = nPrimitives - nPrimitivesRight;
-                volumeRight = nPrimitivesRight * unitVolume;
-                volumeLeft = nPrimitivesLeft * unitVolume;
-                if (error != CL_SUCCESS) {
-                    if (params.m_logger) {
-                        params.m_logger->Log("Couldn't read buffer \n");
-                    }
-                    SetCancel(true);
-                }
-#endif // CL_VERSION_1_1
-            }
-            else {
-                inputPSet->ComputeClippedVolumes(plane, volumeRight, volumeLeft);
-            }
-            double concavityLeft = ComputeConcavity(volumeLeft, volumeLeftCH, m_volumeCH0);
-            double concavityRight = ComputeConcavity(volumeRight, volumeRightCH, m_volumeCH0);
-            double concavity = (concavityLeft + concavityRight);
-
-            // compute cost
-            double balance = alpha * fabs(volumeLeft - volumeRight) / m_volumeCH0;
-            double d = w * (preferredCuttingDirection[0] * plane.m_a + preferredCuttingDirection[1] * plane.m_b + preferredCuttingDirection[2] * plane.m_c);
-            double symmetry = beta * d;
-            double total = concavity + balance + symmetry;
-
-#if USE_THREAD == 1 && _OPENMP
-#pragma omp critical
-#endif
-            {
-                if (total < minTotal || (total == minTotal && x < iBest)) {
-                    minConcavity = concavity;
-                    minBalance = balance;
-                    minSymmetry = symmetry;
-                    bestPlane = plane;
-                    minTotal = total;
-                    iBest = x;
-                }
-                ++done;
-                if (!(done & 127)) // reduce update frequency
-                {
-                    double progress = done * (progress1 - progress0) / nPlanes + progress0;
-                    Update(m_stageProgress, progress, params);
-                }
-            }
+    // chunks are merged in plane order, which picks the same plane whatever the number of workers
+    for (uint32_t chunk = 0; chunk < nChunks; ++chunk) {
+        const ClippingPlaneSearch::ChunkResult& result = search.m_results[chunk];
+        if (result.m_iBest >= 0 && result.m_total < minTotal) {
+            minConcavity = result.m_concavity;
+            minBalance = result.m_balance;
+            minSymmetry = result.m_symmetry;
+            bestPlane = result.m_plane;
+            minTotal = result.m_total;
+            iBest = result.m_iBest;
         }
     }
 
@@ -957,27 +1012,57 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
 #ifdef CL_VERSION_1_1
     if (oclAcceleration) {
         clReleaseMemObject(voxels);
-        for (int32_t i = 0; i < m_ompNumProcessors; ++i) {
+        for (int32_t i = 0; i < m_maxNumWorkers; ++i) {
             clReleaseMemObject(partialVolumes[i]);
         }
         delete[] partialVolumes;
     }
 #endif // CL_VERSION_1_1
 
-    if (psets) {
-        for (int32_t i = 0; i < 2 * m_ompNumProcessors; ++i) {
-            delete psets[i];
-        }
-        delete[] psets;
-    }
     delete onSurfacePSet;
-    delete[] chPts;
-    delete[] chs;
     if (params.m_logger) {
         sprintf(msg, "\n\t\t\t Best  %04i T=%2.6f C=%2.6f B=%2.6f S=%2.6f (%1.1f, %1.1f, %1.1f, %3.3f)\n\n", iBest, minTotal, minConcavity, minBalance, minSymmetry, bestPlane.m_a, bestPlane.m_b, bestPlane.m_c, bestPlane.m_d);
         params.m_logger->Log(msg);
     }
 }
+void VHACD::PublishParts(const SArray<PrimitiveSet*>& parts, const SArray<PrimitiveSet*>& inputParts, const Parameters& params)
+{
+    // the final hulls are generated without downsampling, coarse ones only need to be quick
+    const size_t nParts = parts.Size();
+    const size_t nHulls = nParts + inputParts.Size();
+    std::vector<Mesh> meshes(nHulls);
+    std::vector<ConvexHull> hulls(nHulls);
+    for (size_t p = 0; p < nHulls && !m_cancel; ++p) {
+        const PrimitiveSet* pset = p < nParts ? parts[p] : inputParts[p - nParts];
+        Mesh& mesh = meshes[p];
+        pset->ComputeConvexHull(mesh, params.m_convexhullDownsampling);
+        const size_t nv = mesh.GetNPoints();
+        double x, y, z;
+        for (size_t i = 0; i < nv; ++i) {
+            Vec3<double>& pt = mesh.GetPoint(i);
+            x = pt[0];
+            y = pt[1];
+            z = pt[2];
+            pt[0] = m_rot[0][0] * x + m_rot[0][1] * y + m_rot[0][2] * z + m_barycenter[0];
+            pt[1] = m_rot[1][0] * x + m_rot[1][1] * y + m_rot[1][2] * z + m_barycenter[1];
+            pt[2] = m_rot[2][0] * x + m_rot[2][1] * y + m_rot[2][2] * z + m_barycenter[2];
+        }
+        ConvexHull& ch = hulls[p];
+        ch.m_nPoints = (uint32_t)nv;
+        ch.m_nTriangles = (uint32_t)mesh.GetNTriangles();
+        ch.m_points = mesh.GetPoints();
+        ch.m_triangles = (uint32_t*)mesh.GetTriangles();
+        ch.m_volume = mesh.ComputeVolume();
+        const Vec3<double>& center = mesh.ComputeCenter();
+        ch.m_center[0] = center.X();
+        ch.m_center[1] = center.Y();
+        ch.m_center[2] = center.Z();
+    }
+    if (!GetCancel()) {
+        params.m_hullCallback->UpdateHulls(hulls.data(), (uint32_t)nHulls);
+    }
+}
+
 void VHACD::ComputeACD(const Parameters& params)
 {
     if (GetCancel()) {
@@ -1050,6 +1135,12 @@ void VHACD::ComputeACD(const Parameters& params)
 
             PrimitiveSet* pset = inputParts[p];
             inputParts[p] = 0;
+            if (IsOutOfTime()) {
+                // the remaining parts are kept as they are
+                m_timedOut = true;
+                parts.PushBack(pset);
+                continue;
+            }
             double volume = pset->ComputeVolume();
             pset->ComputeBB();
             pset->ComputePrincipalAxes();
@@ -1115,7 +1206,7 @@ void VHACD::ComputeACD(const Parameters& params)
                     bestPlane,
                     minConcavity,
                     params);
-                if (!m_cancel && (params.m_planeDownsampling > 1 || params.m_convexhullDownsampling > 1)) {
+                if (!m_cancel && !IsOutOfTime() && (params.m_planeDownsampling > 1 || params.m_convexhullDownsampling > 1)) {
                     planesRef.Resize(0);
 
                     if (params.m_mode == 0) {
@@ -1146,10 +1237,21 @@ void VHACD::ComputeACD(const Parameters& params)
                         minConcavity,
                         params);
                 }
+                const bool outOfTime = IsOutOfTime();
+                if (outOfTime) {
+                    m_timedOut = true;
+                }
                 if (GetCancel()) {
                     delete pset; // clean up
                     break;
                 }
+                else if (outOfTime && minConcavity == MAX_DOUBLE) {
+                    // the deadline passed before any plane was evaluated, the part stays whole
+                    if (params.m_pca) {
+                        pset->RevertAlignToPrincipalAxes();
+                    }
+                    parts.PushBack(pset);
+                }
                 else {
                     if (maxConcavity < minConcavity) {
                         maxConcavity = minConcavity;
@@ -1185,6 +1287,10 @@ void VHACD::ComputeACD(const Parameters& params)
         else {
             inputParts = temp;
             temp.Resize(0);
+            // once out of time the result follows right away
+            if (params.m_hullCallback && !m_timedOut) {
+                PublishParts(parts, inputParts, params);
+            }
         }
     }
     const size_t nInputParts = inputParts.Size();
@@ -1218,7 +1324,17 @@ void VHACD::ComputeACD(const Parameters& params)
     for (size_t p = 0; p < nConvexHulls && !m_cancel; ++p) {
         Update(m_stageProgress, p * 100.0 / nConvexHulls, params);
         m_convexHulls.PushBack(new Mesh);
-        parts[p]->ComputeConvexHull(*m_convexHulls[p]);
+        if (parts[p]->GetConvexHull().GetNPoints() > 0 && !params.m_pca) {
+            // the parts that were evaluated still hold the hull computed for them, outside of the principal axes frame
+            *m_convexHulls[p] = parts[p]->GetConvexHull();
+        }
+        else if (m_timedOut) {
+            // past the deadline the parts that never got evaluated only get a coarse hull
+            parts[p]->ComputeConvexHull(*m_convexHulls[p], params.m_convexhullDownsampling);
+        }
+        else {
+            parts[p]->ComputeConvexHull(*m_convexHulls[p]);
+        }
         size_t nv = m_convexHulls[p]->GetNPoints();
         double x, y, z;
         for (size_t i = 0; i < nv; ++i) {
@@ -1292,6 +1408,99 @@ void ComputeConvexHull(const Mesh* const ch1, const Mesh* const ch2, SArray<Vec3
         }
     }
 }
+// Shared state of one batch of hull merge costs; every task evaluates one chunk of the pairs.
+struct VHACD::MergeCostBatch {
+    struct Pair {
+        // The first hull's points go first and its volume is rounded to float, as the serial merge did.
+        uint32_t m_first;
+        uint32_t m_second;
+        size_t m_addr;
+    };
+    struct Scratch {
+        SArray<Vec3<double> > m_pts;
+        Mesh m_combinedCH;
+    };
+    VHACD* m_vhacd;
+    const double* m_volumes;
+    float* m_costs;
+    std::vector<Pair> m_pairs;
+    Scratch* m_scratch;
+    uint32_t m_chunkSize;
+};
+
+// Candidate merge of the hulls at p1 > p2. The stamps tell whether either position changed hull
+// since the cost was computed; stale candidates are dropped when they reach the top.
+struct MergeCandidate {
+    float m_cost;
+    size_t m_addr;
+    uint32_t m_p1;
+    uint32_t m_p2;
+    uint32_t m_stamp1;
+    uint32_t m_stamp2;
+};
+// Lowest cost first, ties to the lowest matrix address, the element a linear scan of the matrix finds.
+struct MergeCandidateGreater {
+    bool operator()(const MergeCandidate& a, const MergeCandidate& b) const
+    {
+        return a.m_cost > b.m_cost || (a.m_cost == b.m_cost && a.m_addr > b.m_addr);
+    }
+};
+typedef std::priority_queue<MergeCandidate, std::vector<MergeCandidate>, MergeCandidateGreater> MergeQueue;
+
+inline size_t GetMergeCostAddress(const size_t p1, const size_t p2)
+{
+    return ((p1 * (p1 - 1)) >> 1) + p2;
+}
+
+void PushMergeCandidate(MergeQueue& queue, const float* const costMatrix, const SArray<uint32_t>& stamps, const size_t a, const size_t b)
+{
+    const size_t p1 = std::max(a, b);
+    const size_t p2 = std::min(a, b);
+    const size_t addr = GetMergeCostAddress(p1, p2);
+    // the scan never picked costs that are not below the float maximum, NaN included
+    if (costMatrix[addr] < (std::numeric_limits<float>::max)()) {
+        queue.push(MergeCandidate{ costMatrix[addr], addr, (uint32_t)p1, (uint32_t)p2, stamps[p1], stamps[p2] });
+    }
+}
+
+void VHACD::MergeCostTask(void* userData, uint32_t taskIndex, uint32_t workerIndex)
+{
+    MergeCostBatch& batch = *(MergeCostBatch*)userData;
+    batch.m_vhacd->ComputeMergeCosts(batch, taskIndex, workerIndex);
+}
+
+void VHACD::ComputeMergeCosts(MergeCostBatch& batch, const uint32_t chunk, const uint32_t workerIndex)
+{
+    MergeCostBatch::Scratch& scratch = batch.m_scratch[workerIndex];
+    const size_t begin = (size_t)chunk * batch.m_chunkSize;
+    const size_t end = std::min(begin + batch.m_chunkSize, batch.m_pairs.size());
+    for (size_t i = begin; i < end; ++i) {
+        if (GetCancel()) {
+            return;
+        }
+        const MergeCostBatch::Pair& pair = batch.m_pairs[i];
+        ComputeConvexHull(m_convexHulls[pair.m_first], m_convexHulls[pair.m_second], scratch.m_pts, &scratch.m_combinedCH);
+        const float volume1 = (float)batch.m_volumes[pair.m_first];
+        batch.m_costs[pair.m_addr] = (float)ComputeConcavity(volume1 + batch.m_volumes[pair.m_second], scratch.m_combinedCH.ComputeVolume(), m_volumeCH0);
+    }
+}
+
+void VHACD::RunMergeCostBatch(MergeCostBatch& batch, const uint32_t nWorkers, const Parameters& params)
+{
+    // a few chunks per worker keeps the threads busy, hull sizes differ a lot
+    const size_t nPairs = batch.m_pairs.size();
+    batch.m_chunkSize = (uint32_t)std::max((nPairs + 4 * nWorkers - 1) / (4 * nWorkers), (size_t)1);
+    const uint32_t nChunks = (uint32_t)((nPairs + batch.m_chunkSize - 1) / batch.m_chunkSize);
+    if (nWorkers > 1 && nChunks > 1) {
+        params.m_taskScheduler->ParallelFor(nChunks, nWorkers, &VHACD::MergeCostTask, &batch);
+    }
+    else {
+        for (uint32_t chunk = 0; chunk < nChunks; ++chunk) {
+            ComputeMergeCosts(batch, chunk, 0);
+        }
+    }
+}
+
 void VHACD::MergeConvexHulls(const Parameters& params)
 {
     if (GetCancel()) {
@@ -1314,21 +1523,46 @@ void VHACD::MergeConvexHulls(const Parameters& params)
 	// While we have more than at least one convex hull and the user has not asked us to cancel the operation
     if (nConvexHulls > 1 && !m_cancel) 
 	{
-		// Get the gamma error threshold for when to exit
-        SArray<Vec3<double> > pts;
-        Mesh combinedCH;
+        uint32_t nWorkers = params.m_taskScheduler ? params.m_taskScheduler->GetNumWorkers() : 1;
+        nWorkers = std::max(std::min(nWorkers, (uint32_t)m_maxNumWorkers), 1u);
+        std::vector<MergeCostBatch::Scratch> scratch(nWorkers);
 
-        // Populate the cost matrix
-        size_t idx = 0;
+        // Hull volumes are cached by position and follow the hulls as they move
+        SArray<double> volumes;
+        volumes.Resize(nConvexHulls);
+        for (size_t p = 0; p < nConvexHulls; ++p) {
+            volumes[p] = m_convexHulls[p]->ComputeVolume();
+        }
+
+        // Populate the cost matrix, the lower triangle in row order
         SArray<float> costMatrix;
         costMatrix.Resize(((nConvexHulls * nConvexHulls) - nConvexHulls) >> 1);
+        MergeCostBatch batch;
+        batch.m_vhacd = this;
+        batch.m_volumes = volumes.Data();
+        batch.m_costs = costMatrix.Data();
+        batch.m_scratch = scratch.data();
+        batch.m_pairs.reserve(costMatrix.Size());
         for (size_t p1 = 1; p1 < nConvexHulls; ++p1) 
 		{
-            const float volume1 = m_convexHulls[p1]->ComputeVolume();
             for (size_t p2 = 0; p2 < p1; ++p2) 
 			{
-                ComputeConvexHull(m_convexHulls[p1], m_convexHulls[p2], pts, &combinedCH);
-                costMatrix[idx++] = ComputeConcavity(volume1 + m_convexHulls[p2]->ComputeVolume(), combinedCH.ComputeVolume(), m_volumeCH0);
+                batch.m_pairs.push_back(MergeCostBatch::Pair{ (uint32_t)p1, (uint32_t)p2, GetMergeCostAddress(p1, p2) });
+            }
+        }
+        RunMergeCostBatch(batch, nWorkers, params);
+
+        // Every merge only changes the costs of two positions, so the cheapest pair comes off a heap
+        // instead of a scan of the whole matrix
+        SArray<uint32_t> stamps;
+        stamps.Resize(nConvexHulls);
+        for (size_t p = 0; p < nConvexHulls; ++p) {
+            stamps[p] = 0;
+        }
+        MergeQueue queue;
+        for (size_t p1 = 1; p1 < nConvexHulls; ++p1) {
+            for (size_t p2 = 0; p2 < p1; ++p2) {
+                PushMergeCandidate(queue, costMatrix.Data(), stamps, p1, p2);
             }
         }
 
@@ -1340,20 +1574,28 @@ void VHACD::MergeConvexHulls(const Parameters& params)
             msg << "Iteration " << iteration++;
             m_operation = msg.str();
 
-            // Search for lowest cost
-            float bestCost = (std::numeric_limits<float>::max)();
-            const size_t addr = FindMinimumElement(costMatrix.Data(), &bestCost, 0, costMatrix.Size());
 			if ( (costSize-1) < params.m_maxConvexHulls)
 			{
 				break;
 			}
-            const size_t addrI = (static_cast<int32_t>(sqrt(1 + (8 * addr))) - 1) >> 1;
-            const size_t p1 = addrI + 1;
-            const size_t p2 = addr - ((addrI * (addrI + 1)) >> 1);
-            assert(p1 >= 0);
-            assert(p2 >= 0);
+            // Search for lowest cost
+            while (!queue.empty()) {
+                const MergeCandidate& top = queue.top();
+                if (top.m_p1 < costSize && stamps[top.m_p1] == top.m_stamp1 && stamps[top.m_p2] == top.m_stamp2) {
+                    break;
+                }
+                queue.pop();
+            }
+            if (queue.empty()) {
+                break;
+            }
+            const MergeCandidate best = queue.top();
+            queue.pop();
+            const float bestCost = best.m_cost;
+            const size_t p1 = best.m_p1;
+            const size_t p2 = best.m_p2;
             assert(p1 < costSize);
-            assert(p2 < costSize);
+            assert(p2 < p1);
 
             if (params.m_logger) 
 			{
@@ -1365,38 +1607,35 @@ void VHACD::MergeConvexHulls(const Parameters& params)
 
             // Make the lowest cost row and column into a new hull
             Mesh* cch = new Mesh;
-            ComputeConvexHull(m_convexHulls[p1], m_convexHulls[p2], pts, cch);
+            ComputeConvexHull(m_convexHulls[p1], m_convexHulls[p2], scratch[0].m_pts, cch);
             delete m_convexHulls[p2];
             m_convexHulls[p2] = cch;
+            volumes[p2] = cch->ComputeVolume();
+            ++stamps[p2];
 
             delete m_convexHulls[p1];
             std::swap(m_convexHulls[p1], m_convexHulls[m_convexHulls.Size() - 1]);
             m_convexHulls.PopBack();
 
             costSize = costSize - 1;
-
-            // Calculate costs versus the new hull
-            size_t rowIdx = ((p2 - 1) * p2) >> 1;
-            const float volume1 = m_convexHulls[p2]->ComputeVolume();
-            for (size_t i = 0; (i < p2) && (!m_cancel); ++i) 
-			{
-                ComputeConvexHull(m_convexHulls[p2], m_convexHulls[i], pts, &combinedCH);
-                costMatrix[rowIdx++] = ComputeConcavity(volume1 + m_convexHulls[i]->ComputeVolume(), combinedCH.ComputeVolume(), m_volumeCH0);
+            if (p1 < costSize) {
+                volumes[p1] = volumes[costSize];
+                ++stamps[p1];
             }
 
-            rowIdx += p2;
-            for (size_t i = p2 + 1; (i < costSize) && (!m_cancel); ++i) 
-			{
-                ComputeConvexHull(m_convexHulls[p2], m_convexHulls[i], pts, &combinedCH);
-                costMatrix[rowIdx] = ComputeConcavity(volume1 + m_convexHulls[i]->ComputeVolume(), combinedCH.ComputeVolume(), m_volumeCH0);
-                rowIdx += i;
-                assert(rowIdx >= 0);
+            // Calculate costs versus the new hull
+            batch.m_pairs.clear();
+            for (size_t i = 0; i < costSize; ++i) {
+                if (i != p2) {
+                    batch.m_pairs.push_back(MergeCostBatch::Pair{ (uint32_t)p2, (uint32_t)i, i < p2 ? GetMergeCostAddress(p2, i) : GetMergeCostAddress(i, p2) });
+                }
             }
+            RunMergeCostBatch(batch, nWorkers, params);
 
             // Move the top column in to replace its space
             const size_t erase_idx = ((costSize - 1) * costSize) >> 1;
             if (p1 < costSize) {
-                rowIdx = (addrI * p1) >> 1;
+                size_t rowIdx = GetMergeCostAddress(p1, 0);
                 size_t top_row = erase_idx;
                 for (size_t i = 0; i < p1; ++i) {
                     if (i != p2) {
@@ -1408,13 +1647,22 @@ void VHACD::MergeConvexHulls(const Parameters& params)
 
                 ++top_row;
                 rowIdx += p1;
-                for (size_t i = p1 + 1; i < (costSize + 1); ++i) {
+                for (size_t i = p1 + 1; i < costSize; ++i) {
                     costMatrix[rowIdx] = costMatrix[top_row++];
                     rowIdx += i;
-                    assert(rowIdx >= 0);
                 }
             }
             costMatrix.Resize(erase_idx);
+
+            // Queue the pairs of the two positions that changed
+            for (size_t i = 0; i < costSize; ++i) {
+                if (i != p2) {
+                    PushMergeCandidate(queue, costMatrix.Data(), stamps, p2, i);
+                }
+                if (p1 < costSize && i != p1 && i != p2) {
+                    PushMergeCandidate(queue, costMatrix.Data(), stamps, p1, i);
+                }
+            }
         }
     }
     m_overallProgress = 99.0;
@@ -59,6 +59,23 @@ public:
         virtual void Log(const char* const msg) = 0;
     };
 
+    // Runs the parallel stages: voxelization slabs, the clipping-plane search and the merge pair costs.
+    // Without one they all run on the calling thread.
+    class ITaskScheduler {
+    public:
+        virtual ~ITaskScheduler(){};
+        // Number of threads, the caller included, that may run tasks at the same time.
+        virtual uint32_t GetNumWorkers() const = 0;
+        // Calls task(userData, taskIndex, workerIndex) for every taskIndex below numTasks on at most
+        // maxNumWorkers threads, the calling thread included, and returns once all of them finished.
+        // workerIndex is below maxNumWorkers and is never shared by two tasks running at the same time.
+        virtual void ParallelFor(const uint32_t numTasks,
+            const uint32_t maxNumWorkers,
+            void (*task)(void* userData, uint32_t taskIndex, uint32_t workerIndex),
+            void* userData)
+            = 0;
+    };
+
     class ConvexHull {
     public:
         double* m_points;
@@ -69,6 +86,15 @@ public:
 		double		m_center[3];
     };
 
+    // Receives the hulls of the parts after every subdivision level, before they are merged, so a
+    // caller can use coarse hulls while the decomposition refines. Runs on the computing thread; the
+    // hulls are only valid during the call.
+    class IUserHullCallback {
+    public:
+        virtual ~IUserHullCallback(){};
+        virtual void UpdateHulls(const ConvexHull* const hulls, const uint32_t countHulls) = 0;
+    };
+
     class Parameters {
     public:
         Parameters(void) { Init(); }
@@ -86,9 +112,12 @@ public:
             m_minVolumePerCH = 0.0001;
             m_callback = 0;
             m_logger = 0;
+            m_hullCallback = 0;
+            m_taskScheduler = 0;
             m_convexhullApproximation = true;
             m_oclAcceleration = true;
             m_maxConvexHulls = 1024;
+            m_maxComputeTime = 0; // Wall-clock budget of Compute in ms, 0 for none. Once it runs out no part is split any further and the parts found so far are merged into the result
 			m_projectHullVertices = true; // This will project the output convex hull vertices onto the original source mesh to increase the floating point accuracy of the results
         }
         double m_concavity;
@@ -97,6 +126,8 @@ public:
         double m_minVolumePerCH;
         IUserCallback* m_callback;
         IUserLogger* m_logger;
+        IUserHullCallback* m_hullCallback;
+        ITaskScheduler* m_taskScheduler;
         uint32_t m_resolution;
         uint32_t m_maxNumVerticesPerCH;
         uint32_t m_planeDownsampling;
@@ -106,6 +137,7 @@ public:
         uint32_t m_convexhullApproximation;
         uint32_t m_oclAcceleration;
         uint32_t	m_maxConvexHulls;
+        uint32_t m_maxComputeTime;
 		bool	m_projectHullVertices;
     };
 
@@ -130,6 +162,14 @@ public:
         const uint32_t countTriangles,
         const Parameters& params)
         = 0;
+    // Merges existing hulls down to params.m_maxConvexHulls the way Compute merges its parts, then
+    // simplifies them; the merged hulls become the instance's results, as after Compute.
+    virtual bool Merge(const ConvexHull* const hulls,
+        const uint32_t countHulls,
+        const Parameters& params)
+        = 0;
+    // True when the last Compute ran out of m_maxComputeTime, its hulls are then coarser than a full run.
+    virtual bool HasTimedOut(void) const = 0;
     virtual uint32_t GetNConvexHulls() const = 0;
     virtual void GetConvexHull(const uint32_t index, ConvexHull& ch) const = 0;
     virtual void Clean(void) = 0; // release internally allocated memory
@@ -1,6 +1,11 @@
 #include "vhacdRaycastMesh.h"
+#include "../Utility/PhysicsSimdUtils.h"
 #include <math.h>
 #include <assert.h>
+#include <float.h>
+#include <algorithm>
+#include <bit>
+#include <vector>
 
 namespace RAYCAST_MESH
 {
@@ -21,14 +26,45 @@ namespace RAYCAST_MESH
 	(a)[1] = (b)[2] * (c)[0] - (c)[2] * (b)[0]; \
 	(a)[2] = (b)[0] * (c)[1] - (c)[0] * (b)[1];
 
+// Triangles per packet, one per lane of a 256-bit double vector.
+const uint32_t PACKET_SIZE = 4;
+// A leaf never holds more packets than this, larger sets are split even when SAH prefers a leaf.
+const uint32_t MAX_LEAF_PACKETS = 4;
+const uint32_t SAH_BIN_COUNT = 12;
+// Bounds the traversal stack; deeper nodes become leaves.
+const uint32_t MAX_TREE_DEPTH = 60;
+
+// Edges are precomputed the same way the brute force test computed them, so every lane
+// sees exactly the values the scalar code did. Unused lanes hold a degenerate triangle.
+struct alignas(32) TrianglePacket
+{
+	double		mV0[3][PACKET_SIZE];
+	double		mE1[3][PACKET_SIZE];
+	double		mE2[3][PACKET_SIZE];
+	uint32_t	mTriangle[PACKET_SIZE];
+};
+
+struct BvhNode
+{
+	double		mMin[3];
+	double		mMax[3];
+	uint32_t	mFirst;		// First packet of a leaf, or the second child of an inner node; the first child follows the node
+	uint32_t	mCount;		// Number of packets of a leaf, 0 for inner nodes
+};
 
-static inline bool rayIntersectsTriangle(const double *p,const double *d,const double *v0,const double *v1,const double *v2,double &t)
+struct BuildTriangle
 {
-	double e1[3],e2[3],h[3],s[3],q[3];
+	double		mMin[3];
+	double		mMax[3];
+	double		mCentroid[3];
+	uint32_t	mIndex;
+};
+
+static inline bool rayIntersectsTriangle(const double *p,const double *d,const double *v0,const double *e1,const double *e2,double &t)
+{
+	double h[3],s[3],q[3];
 	double a,f,u,v;
 
-	vector(e1,v1,v0);
-	vector(e2,v2,v0);
 	crossProduct(h,d,e2);
 	a = innerProduct(e1,h);
 
@@ -56,6 +92,68 @@ static inline bool rayIntersectsTriangle(const double *p,const double *d,const d
 		return (false);
 }
 
+// Bit i of the result is set when lane i is hit, with its distance along the ray in t[i].
+static uint32_t rayIntersectsPacket(const double *p,const double *d,const TrianglePacket &packet,double (&t)[PACKET_SIZE])
+{
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < PACKET_SIZE; i++)
+	{
+		const double v0[3] = { packet.mV0[0][i], packet.mV0[1][i], packet.mV0[2][i] };
+		const double e1[3] = { packet.mE1[0][i], packet.mE1[1][i], packet.mE1[2][i] };
+		const double e2[3] = { packet.mE2[0][i], packet.mE2[1][i], packet.mE2[2][i] };
+		if (rayIntersectsTriangle(p,d,v0,e1,e2,t[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+#ifdef PHYSICS_SIMD_SSE
+// The scalar test on four triangles at once, in the same operation order and without fused
+// multiply-adds so every lane rounds like rayIntersectsTriangle; the early outs become masks.
+PHYSICS_TARGET_AVX2_NOFMA inline void crossProductAVX2(__m256d (&a)[3], const __m256d (&b)[3], const __m256d (&c)[3])
+{
+	a[0] = _mm256_sub_pd(_mm256_mul_pd(b[1], c[2]), _mm256_mul_pd(c[1], b[2]));
+	a[1] = _mm256_sub_pd(_mm256_mul_pd(b[2], c[0]), _mm256_mul_pd(c[2], b[0]));
+	a[2] = _mm256_sub_pd(_mm256_mul_pd(b[0], c[1]), _mm256_mul_pd(c[0], b[1]));
+}
+
+PHYSICS_TARGET_AVX2_NOFMA inline __m256d innerProductAVX2(const __m256d (&v)[3], const __m256d (&q)[3])
+{
+	return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(v[0], q[0]), _mm256_mul_pd(v[1], q[1])), _mm256_mul_pd(v[2], q[2]));
+}
+
+PHYSICS_TARGET_AVX2_NOFMA static uint32_t rayIntersectsPacketAVX2(const double *p,const double *d,const TrianglePacket &packet,double (&t)[PACKET_SIZE])
+{
+	const __m256d dir[3] = { _mm256_set1_pd(d[0]), _mm256_set1_pd(d[1]), _mm256_set1_pd(d[2]) };
+	__m256d e1[3], e2[3], s[3], h[3], q[3];
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		e1[i] = _mm256_load_pd(packet.mE1[i]);
+		e2[i] = _mm256_load_pd(packet.mE2[i]);
+		s[i] = _mm256_sub_pd(_mm256_set1_pd(p[i]), _mm256_load_pd(packet.mV0[i]));
+	}
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d one = _mm256_set1_pd(1.0);
+
+	crossProductAVX2(h, dir, e2);
+	const __m256d a = innerProductAVX2(e1, h);
+	__m256d rejected = _mm256_and_pd(_mm256_cmp_pd(a, _mm256_set1_pd(-0.00001), _CMP_GT_OQ), _mm256_cmp_pd(a, _mm256_set1_pd(0.00001), _CMP_LT_OQ));
+
+	const __m256d f = _mm256_div_pd(one, a);
+	const __m256d u = _mm256_mul_pd(f, innerProductAVX2(s, h));
+	rejected = _mm256_or_pd(rejected, _mm256_or_pd(_mm256_cmp_pd(u, zero, _CMP_LT_OQ), _mm256_cmp_pd(u, one, _CMP_GT_OQ)));
+
+	crossProductAVX2(q, s, e1);
+	const __m256d v = _mm256_mul_pd(f, innerProductAVX2(dir, q));
+	rejected = _mm256_or_pd(rejected, _mm256_or_pd(_mm256_cmp_pd(v, zero, _CMP_LT_OQ), _mm256_cmp_pd(_mm256_add_pd(u, v), one, _CMP_GT_OQ)));
+
+	const __m256d distance = _mm256_mul_pd(f, innerProductAVX2(e2, q));
+	const __m256d hit = _mm256_andnot_pd(rejected, _mm256_cmp_pd(distance, zero, _CMP_GT_OQ));
+	_mm256_storeu_pd(t, distance);
+	return (uint32_t)_mm256_movemask_pd(hit);
+}
+#endif // PHYSICS_SIMD_SSE
+
 static double getPointDistance(const double *p1, const double *p2)
 {
 	double dx = p1[0] - p2[0];
@@ -64,6 +162,28 @@ static double getPointDistance(const double *p1, const double *p2)
 	return sqrt(dx*dx + dy*dy + dz*dz);
 }
 
+static double getSurfaceArea(const double *bmin, const double *bmax)
+{
+	double dx = bmax[0] - bmin[0];
+	double dy = bmax[1] - bmin[1];
+	double dz = bmax[2] - bmin[2];
+	return dx*dy + dy*dz + dz*dx;
+}
+
+static inline void growBounds(double *bmin, double *bmax, const double *pmin, const double *pmax)
+{
+	for (uint32_t a = 0; a < 3; a++)
+	{
+		bmin[a] = std::min(bmin[a], pmin[a]);
+		bmax[a] = std::max(bmax[a], pmax[a]);
+	}
+}
+
+static inline uint32_t getPacketCount(uint32_t tcount)
+{
+	return (tcount + PACKET_SIZE - 1) / PACKET_SIZE;
+}
+
 class MyRaycastMesh : public VHACD::RaycastMesh
 {
 public:
@@ -74,31 +194,20 @@ public:
                   uint32_t tcount,
                   const uint32_t *indices)
 	{
-        mVcount = vcount;
-        mVertices = new double[mVcount * 3];
-        for (uint32_t i = 0; i < mVcount; i++)
+        double *points = new double[vcount * 3];
+        for (uint32_t i = 0; i < vcount * 3; i++)
         {
-            mVertices[i * 3 + 0] = vertices[0];
-            mVertices[i * 3 + 1] = vertices[1];
-            mVertices[i * 3 + 2] = vertices[2];
-            vertices += 3;
-        }
-        mTcount = tcount;
-        mIndices = new uint32_t[mTcount * 3];
-        for (uint32_t i = 0; i < mTcount; i++)
-        {
-            mIndices[i * 3 + 0] = indices[0];
-            mIndices[i * 3 + 1] = indices[1];
-            mIndices[i * 3 + 2] = indices[2];
-            indices += 3;
+            points[i] = vertices[i];
         }
+        buildTree(points, tcount, indices);
+        delete[]points;
 	}
 
 
 	~MyRaycastMesh(void)
 	{
-        delete[]mVertices;
-        delete[]mIndices;
+        delete[]mNodes;
+        delete[]mPackets;
 	}
 
 	virtual void release(void)
@@ -112,8 +221,6 @@ public:
 		double *hitLocation,			// The point where the ray hit nearest to the 'closestToPoint' location
 		double *hitDistance) final		// The distance the ray traveled to the hit location
 	{
-		bool ret = false;
-
 		double dir[3];
 
 		dir[0] = to[0] - from[0];
@@ -122,27 +229,168 @@ public:
 
 		double distance = sqrt( dir[0]*dir[0] + dir[1]*dir[1]+dir[2]*dir[2] );
 		if ( distance < 0.0000000001f ) return false;
+		if ( mNodeCount == 0 ) return false;
 		double recipDistance = 1.0f / distance;
 		dir[0]*=recipDistance;
 		dir[1]*=recipDistance;
 		dir[2]*=recipDistance;
-		const uint32_t *indices = mIndices;
-		const double *vertices = mVertices;
+
+		// The hit nearest to closestToPoint wins, ties go to the lowest triangle index, which is
+		// the one the brute force loop kept. A hit closer than nearestDistance has to lie within
+		// that distance of the projection of closestToPoint on the ray, so boxes are clipped to
+		// that range of the ray and it shrinks with every hit.
+		double toClosest[3];
+		vector(toClosest,closestToPoint,from);
+		const double closestT = innerProduct(toClosest,dir);
+		const double lineDistanceSquared = std::max(innerProduct(toClosest,toClosest) - closestT*closestT, 0.0);
+		double invDir[3];
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			invDir[a] = dir[a] != 0 ? 1.0 / dir[a] : 0;
+		}
+
 		double nearestDistance = distance;
+		uint32_t nearestTriangle = UINT32_MAX;
+		double nearestPos[3] = { 0, 0, 0 };
+		double tmin, tmax;
+		getSearchRange(closestT, lineDistanceSquared, nearestDistance, tmin, tmax);
+
+#ifdef PHYSICS_SIMD_SSE
+		const bool useAVX2 = PhysicsSimdUtils::HasAVX2();
+#endif // PHYSICS_SIMD_SSE
+		uint32_t stack[MAX_TREE_DEPTH + 1];
+		uint32_t stackSize = 0;
+		uint32_t nodeIndex = 0;
+		if (!intersectsNode(mNodes[0], from, dir, invDir, tmin, tmax))
+			return false;
+		while (true)
+		{
+			const BvhNode &node = mNodes[nodeIndex];
+			if (node.mCount == 0)
+			{
+				// Near child first, the far one waits on the stack.
+				uint32_t first = nodeIndex + 1;
+				uint32_t second = node.mFirst;
+				double firstEntry, secondEntry;
+				const bool hitFirst = intersectsNode(mNodes[first], from, dir, invDir, tmin, tmax, &firstEntry);
+				const bool hitSecond = intersectsNode(mNodes[second], from, dir, invDir, tmin, tmax, &secondEntry);
+				if (hitFirst && hitSecond)
+				{
+					if (secondEntry < firstEntry)
+						std::swap(first, second);
+					stack[stackSize++] = second;
+					nodeIndex = first;
+					continue;
+				}
+				if (hitFirst || hitSecond)
+				{
+					nodeIndex = hitFirst ? first : second;
+					continue;
+				}
+			}
+			else
+			{
+				for (uint32_t i = node.mFirst; i < node.mFirst + node.mCount; i++)
+				{
+					const TrianglePacket &packet = mPackets[i];
+					double t[PACKET_SIZE];
+#ifdef PHYSICS_SIMD_SSE
+					uint32_t mask = useAVX2 ? rayIntersectsPacketAVX2(from,dir,packet,t) : rayIntersectsPacket(from,dir,packet,t);
+#else
+					uint32_t mask = rayIntersectsPacket(from,dir,packet,t);
+#endif // PHYSICS_SIMD_SSE
+					for (; mask != 0; mask &= mask - 1)
+					{
+						const uint32_t lane = (uint32_t)std::countr_zero(mask);
+						const uint32_t tri = packet.mTriangle[lane];
+						double hitPos[3];
+
+						hitPos[0] = from[0] + dir[0] * t[lane];
+						hitPos[1] = from[1] + dir[1] * t[lane];
+						hitPos[2] = from[2] + dir[2] * t[lane];
+
+						double pointDistance = getPointDistance(hitPos, closestToPoint);
+
+						if (pointDistance < nearestDistance || (pointDistance == nearestDistance && tri < nearestTriangle && nearestTriangle != UINT32_MAX))
+						{
+							nearestDistance = pointDistance;
+							nearestTriangle = tri;
+							nearestPos[0] = hitPos[0];
+							nearestPos[1] = hitPos[1];
+							nearestPos[2] = hitPos[2];
+							getSearchRange(closestT, lineDistanceSquared, nearestDistance, tmin, tmax);
+						}
+					}
+				}
+			}
+
+			// Ranges only shrink, so nodes pushed earlier are tested again before they are entered.
+			bool found = false;
+			while (stackSize > 0)
+			{
+				nodeIndex = stack[--stackSize];
+				if (intersectsNode(mNodes[nodeIndex], from, dir, invDir, tmin, tmax))
+				{
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+				break;
+		}
 
-		for (uint32_t tri=0; tri<mTcount; tri++)
+		if (nearestTriangle == UINT32_MAX)
+			return false;
+		if ( hitLocation )
 		{
-			uint32_t i1 = indices[tri*3+0];
-			uint32_t i2 = indices[tri*3+1];
-			uint32_t i3 = indices[tri*3+2];
+			hitLocation[0] = nearestPos[0];
+			hitLocation[1] = nearestPos[1];
+			hitLocation[2] = nearestPos[2];
+		}
+		if ( hitDistance )
+		{
+			*hitDistance = nearestDistance;
+		}
+		return true;
+	}
+
+	virtual bool raycastBruteForce(const double *from,
+		const double *to,
+		const double *closestToPoint,
+		double *hitLocation,
+		double *hitDistance) final
+	{
+		double dir[3];
+
+		dir[0] = to[0] - from[0];
+		dir[1] = to[1] - from[1];
+		dir[2] = to[2] - from[2];
 
-			const double *p1 = &vertices[i1*3];
-			const double *p2 = &vertices[i2*3];
-			const double *p3 = &vertices[i3*3];
+		double distance = sqrt( dir[0]*dir[0] + dir[1]*dir[1]+dir[2]*dir[2] );
+		if ( distance < 0.0000000001f ) return false;
+		double recipDistance = 1.0f / distance;
+		dir[0]*=recipDistance;
+		dir[1]*=recipDistance;
+		dir[2]*=recipDistance;
 
-			double t;
-			if ( rayIntersectsTriangle(from,dir,p1,p2,p3,t))
+		// Packets are in tree order, the tie rule keeps the hit of the lowest triangle index.
+		double nearestDistance = distance;
+		uint32_t nearestTriangle = UINT32_MAX;
+		double nearestPos[3] = { 0, 0, 0 };
+		for (uint32_t i = 0; i < mPacketCount; i++)
+		{
+			const TrianglePacket &packet = mPackets[i];
+			for (uint32_t lane = 0; lane < PACKET_SIZE; lane++)
 			{
+				const uint32_t tri = packet.mTriangle[lane];
+				if (tri == UINT32_MAX)
+					continue;
+				const double v0[3] = { packet.mV0[0][lane], packet.mV0[1][lane], packet.mV0[2][lane] };
+				const double e1[3] = { packet.mE1[0][lane], packet.mE1[1][lane], packet.mE1[2][lane] };
+				const double e2[3] = { packet.mE2[0][lane], packet.mE2[1][lane], packet.mE2[2][lane] };
+				double t;
+				if (!rayIntersectsTriangle(from,dir,v0,e1,e2,t))
+					continue;
 				double hitPos[3];
 
 				hitPos[0] = from[0] + dir[0] * t;
@@ -151,30 +399,273 @@ public:
 
 				double pointDistance = getPointDistance(hitPos, closestToPoint);
 
-				if (pointDistance < nearestDistance )
+				if (pointDistance < nearestDistance || (pointDistance == nearestDistance && tri < nearestTriangle && nearestTriangle != UINT32_MAX))
 				{
 					nearestDistance = pointDistance;
-					if ( hitLocation )
+					nearestTriangle = tri;
+					nearestPos[0] = hitPos[0];
+					nearestPos[1] = hitPos[1];
+					nearestPos[2] = hitPos[2];
+				}
+			}
+		}
+
+		if (nearestTriangle == UINT32_MAX)
+			return false;
+		if ( hitLocation )
+		{
+			hitLocation[0] = nearestPos[0];
+			hitLocation[1] = nearestPos[1];
+			hitLocation[2] = nearestPos[2];
+		}
+		if ( hitDistance )
+		{
+			*hitDistance = nearestDistance;
+		}
+		return true;
+	}
+
+private:
+	// Range of the ray that can still hold a hit within nearestDistance of closestToPoint,
+	// widened by mMargin against rounding in the box tests.
+	void getSearchRange(double closestT, double lineDistanceSquared, double nearestDistance, double &tmin, double &tmax) const
+	{
+		const double halfChord = sqrt(std::max(nearestDistance*nearestDistance - lineDistanceSquared, 0.0));
+		tmin = std::max(closestT - halfChord, 0.0) - mMargin;
+		tmax = closestT + halfChord + mMargin;
+	}
+
+	bool intersectsNode(const BvhNode &node, const double *from, const double *dir, const double *invDir, double tmin, double tmax, double *entry = nullptr) const
+	{
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			if (dir[a] == 0)
+			{
+				if (from[a] < node.mMin[a] || from[a] > node.mMax[a])
+					return false;
+				continue;
+			}
+			double t0 = (node.mMin[a] - from[a]) * invDir[a];
+			double t1 = (node.mMax[a] - from[a]) * invDir[a];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tmin = std::max(tmin, t0);
+			tmax = std::min(tmax, t1);
+			if (tmin > tmax)
+				return false;
+		}
+		if (entry)
+			*entry = tmin;
+		return true;
+	}
+
+	void buildTree(const double *points, uint32_t tcount, const uint32_t *indices)
+	{
+		std::vector<BuildTriangle> triangles(tcount);
+		double bmin[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+		double bmax[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (uint32_t tri = 0; tri < tcount; tri++)
+		{
+			BuildTriangle &triangle = triangles[tri];
+			triangle.mIndex = tri;
+			for (uint32_t a = 0; a < 3; a++)
+			{
+				const double p1 = points[indices[tri*3+0]*3+a];
+				const double p2 = points[indices[tri*3+1]*3+a];
+				const double p3 = points[indices[tri*3+2]*3+a];
+				triangle.mMin[a] = std::min(p1, std::min(p2, p3));
+				triangle.mMax[a] = std::max(p1, std::max(p2, p3));
+				triangle.mCentroid[a] = (triangle.mMin[a] + triangle.mMax[a]) * 0.5;
+			}
+			growBounds(bmin, bmax, triangle.mMin, triangle.mMax);
+		}
+
+		mNodes = nullptr;
+		mNodeCount = 0;
+		mPackets = nullptr;
+		mPacketCount = 0;
+		mMargin = 0;
+		if (tcount == 0)
+			return;
+		double scale = 0;
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			scale = std::max(scale, std::max(bmax[a] - bmin[a], std::max(fabs(bmin[a]), fabs(bmax[a]))));
+		}
+		mMargin = scale * 1e-8;
+
+		std::vector<BvhNode> nodes;
+		std::vector<TrianglePacket> packets;
+		nodes.reserve(2 * getPacketCount(tcount));
+		packets.reserve(2 * getPacketCount(tcount));
+		buildNode(&triangles[0], tcount, 0, points, indices, nodes, packets);
+
+		mNodeCount = (uint32_t)nodes.size();
+		mNodes = new BvhNode[nodes.size()];
+		std::copy(nodes.begin(), nodes.end(), mNodes);
+		mPackets = new TrianglePacket[packets.size()];
+		mPacketCount = (uint32_t)packets.size();
+		std::copy(packets.begin(), packets.end(), mPackets);
+	}
+
+	// Binned SAH, costs counted in packets since a leaf tests whole packets.
+	void buildNode(BuildTriangle *triangles, uint32_t count, uint32_t depth, const double *points, const uint32_t *indices,
+		std::vector<BvhNode> &nodes, std::vector<TrianglePacket> &packets)
+	{
+		const uint32_t nodeIndex = (uint32_t)nodes.size();
+		nodes.emplace_back();
+		double bmin[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+		double bmax[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		double cmin[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+		double cmax[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (uint32_t i = 0; i < count; i++)
+		{
+			growBounds(bmin, bmax, triangles[i].mMin, triangles[i].mMax);
+			growBounds(cmin, cmax, triangles[i].mCentroid, triangles[i].mCentroid);
+		}
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			nodes[nodeIndex].mMin[a] = bmin[a] - mMargin;
+			nodes[nodeIndex].mMax[a] = bmax[a] + mMargin;
+		}
+
+		uint32_t splitCount = 0;
+		if (count > PACKET_SIZE && depth < MAX_TREE_DEPTH)
+		{
+			splitCount = findSplit(triangles, count, bmin, bmax, cmin, cmax);
+			if (splitCount == 0 && getPacketCount(count) > MAX_LEAF_PACKETS)
+			{
+				// Every centroid in one bin, split the set in halves.
+				splitCount = count / 2;
+			}
+		}
+		if (splitCount == 0)
+		{
+			nodes[nodeIndex].mFirst = (uint32_t)packets.size();
+			nodes[nodeIndex].mCount = getPacketCount(count);
+			for (uint32_t i = 0; i < count; i += PACKET_SIZE)
+			{
+				packets.emplace_back();
+				TrianglePacket &packet = packets.back();
+				for (uint32_t lane = 0; lane < PACKET_SIZE; lane++)
+				{
+					if (i + lane >= count)
 					{
-						hitLocation[0] = hitPos[0];
-						hitLocation[1] = hitPos[1];
-						hitLocation[2] = hitPos[2];
+						packet.mTriangle[lane] = UINT32_MAX;
+						for (uint32_t a = 0; a < 3; a++)
+						{
+							packet.mV0[a][lane] = 0;
+							packet.mE1[a][lane] = 0;
+							packet.mE2[a][lane] = 0;
+						}
+						continue;
 					}
-					if ( hitDistance )
+					const uint32_t tri = triangles[i + lane].mIndex;
+					const double *p1 = &points[indices[tri*3+0]*3];
+					const double *p2 = &points[indices[tri*3+1]*3];
+					const double *p3 = &points[indices[tri*3+2]*3];
+					double e1[3],e2[3];
+					vector(e1,p2,p1);
+					vector(e2,p3,p1);
+					packet.mTriangle[lane] = tri;
+					for (uint32_t a = 0; a < 3; a++)
 					{
-						*hitDistance = pointDistance;
+						packet.mV0[a][lane] = p1[a];
+						packet.mE1[a][lane] = e1[a];
+						packet.mE2[a][lane] = e2[a];
 					}
-					ret = true;
 				}
 			}
+			return;
 		}
-		return ret;
+
+		nodes[nodeIndex].mCount = 0;
+		buildNode(triangles, splitCount, depth + 1, points, indices, nodes, packets);
+		nodes[nodeIndex].mFirst = (uint32_t)nodes.size();
+		buildNode(triangles + splitCount, count - splitCount, depth + 1, points, indices, nodes, packets);
+	}
+
+	// Partitions the triangles on the cheapest bin boundary and returns the size of the first
+	// part, or 0 when no split beats a leaf the size limit allows.
+	static uint32_t findSplit(BuildTriangle *triangles, uint32_t count, const double *bmin, const double *bmax, const double *cmin, const double *cmax)
+	{
+		const double leafCost = (double)getPacketCount(count);
+		double bestCost = getPacketCount(count) > MAX_LEAF_PACKETS ? DBL_MAX : leafCost;
+		uint32_t bestAxis = 3;
+		uint32_t bestBin = 0;
+		const double area = std::max(getSurfaceArea(bmin, bmax), DBL_MIN);
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			const double extent = cmax[a] - cmin[a];
+			if (!(extent > 0))
+				continue;
+			const double binScale = SAH_BIN_COUNT / extent;
+			uint32_t binCounts[SAH_BIN_COUNT] = {};
+			double binMin[SAH_BIN_COUNT][3], binMax[SAH_BIN_COUNT][3];
+			for (uint32_t b = 0; b < SAH_BIN_COUNT; b++)
+			{
+				binMin[b][0] = binMin[b][1] = binMin[b][2] = DBL_MAX;
+				binMax[b][0] = binMax[b][1] = binMax[b][2] = -DBL_MAX;
+			}
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const uint32_t b = getBin(triangles[i].mCentroid[a], cmin[a], binScale);
+				binCounts[b]++;
+				growBounds(binMin[b], binMax[b], triangles[i].mMin, triangles[i].mMax);
+			}
+
+			// Sweep from the right for the suffix areas, then from the left for the costs.
+			double rightArea[SAH_BIN_COUNT];
+			uint32_t rightCount[SAH_BIN_COUNT];
+			double rmin[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+			double rmax[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+			uint32_t n = 0;
+			for (uint32_t b = SAH_BIN_COUNT - 1; b > 0; b--)
+			{
+				n += binCounts[b];
+				if (binCounts[b] > 0)
+					growBounds(rmin, rmax, binMin[b], binMax[b]);
+				rightCount[b] = n;
+				rightArea[b] = n > 0 ? getSurfaceArea(rmin, rmax) : 0;
+			}
+			double lmin[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+			double lmax[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+			n = 0;
+			for (uint32_t b = 0; b + 1 < SAH_BIN_COUNT; b++)
+			{
+				n += binCounts[b];
+				if (binCounts[b] > 0)
+					growBounds(lmin, lmax, binMin[b], binMax[b]);
+				if (n == 0 || rightCount[b + 1] == 0)
+					continue;
+				const double cost = 0.5 + (getSurfaceArea(lmin, lmax) * getPacketCount(n) + rightArea[b + 1] * getPacketCount(rightCount[b + 1])) / area;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = a;
+					bestBin = b;
+				}
+			}
+		}
+		if (bestAxis == 3)
+			return 0;
+
+		const double binScale = SAH_BIN_COUNT / (cmax[bestAxis] - cmin[bestAxis]);
+		BuildTriangle *middle = std::partition(triangles, triangles + count, [&](const BuildTriangle &triangle)
+			{ return getBin(triangle.mCentroid[bestAxis], cmin[bestAxis], binScale) <= bestBin; });
+		return (uint32_t)(middle - triangles);
+	}
+
+	static inline uint32_t getBin(double centroid, double cmin, double binScale)
+	{
+		return std::min((uint32_t)((centroid - cmin) * binScale), SAH_BIN_COUNT - 1);
 	}
 
-	uint32_t		mVcount;
-	double	        *mVertices;
-	uint32_t		mTcount;
-	uint32_t	    *mIndices;
+	BvhNode			*mNodes;
+	uint32_t		mNodeCount;
+	TrianglePacket	*mPackets;
+	uint32_t		mPacketCount;
+	double			mMargin;
 };
 
 };
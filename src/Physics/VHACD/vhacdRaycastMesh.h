@@ -7,7 +7,8 @@
 namespace VHACD
 {
 
-    // Very simple brute force raycast against a triangle mesh.  Tests every triangle; no hierachy.
+    // Raycast against a triangle mesh through a SAH bounding volume hierarchy built on creation, with
+    // the triangles of each leaf tested four at a time. Returns the same hit as testing every triangle.
     // Does a deep copy, always does calculations with full double float precision
     class RaycastMesh
     {
@@ -29,6 +30,14 @@ namespace VHACD
             double *hitLocation,			// The point where the ray hit nearest to the 'closestToPoint' location
             double *hitDistance) = 0;		// The distance the ray traveled to the hit location
 
+        // Same arguments and result as raycast, testing every triangle one at a time without the
+        // hierarchy; the reference raycast is checked against.
+        virtual bool raycastBruteForce(const double *from,
+            const double *to,
+            const double *closestToPoint,
+            double *hitLocation,
+            double *hitDistance) = 0;
+
         virtual void release(void) = 0;
     protected:
         virtual ~RaycastMesh(void) { };
@@ -22,11 +22,13 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include "vhacdMutex.h"
 #include "vhacdVolume.h"
 #include "vhacdRaycastMesh.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include <vector>
 
 typedef std::vector< VHACD::IVHACD::Constraint > ConstraintVector;
 
-#define USE_THREAD 1
 #define OCL_MIN_NUM_PRIMITIVES 4096
 #define CH_APP_MIN_NUM_PRIMITIVES 64000
 namespace VHACD {
@@ -35,12 +37,8 @@ public:
     //! Constructor.
     VHACD()
     {
-#if USE_THREAD == 1 && _OPENMP
-        m_ompNumProcessors = 2 * omp_get_num_procs();
-        omp_set_num_threads(m_ompNumProcessors);
-#else //USE_THREAD == 1 && _OPENMP
-        m_ompNumProcessors = 1;
-#endif //USE_THREAD == 1 && _OPENMP
+        // Upper bound of the workers in one clipping-plane search, sizes the per-worker OpenCL queues.
+        m_maxNumWorkers = std::max(int32_t(std::thread::hardware_concurrency()), 1);
 #ifdef CL_VERSION_1_1
         m_oclWorkGroupSize = 0;
         m_oclDevice = 0;
@@ -53,6 +51,11 @@ public:
     //! Destructor.
     ~VHACD(void) 
     {
+        ReleaseClippingScratch();
+    }
+    bool HasTimedOut(void) const
+    {
+        return m_timedOut;
     }
     uint32_t GetNConvexHulls() const
     {
@@ -89,6 +92,7 @@ public:
             delete m_convexHulls[p];
         }
         m_convexHulls.Clear();
+        ReleaseClippingScratch();
     }
     void Release(void)
     {
@@ -104,6 +108,9 @@ public:
         const uint32_t* const triangles,
         const uint32_t nTriangles,
         const Parameters& params);
+    bool Merge(const ConvexHull* const hulls,
+        const uint32_t countHulls,
+        const Parameters& params);
     bool OCLInit(void* const oclDevice,
         IUserLogger* const logger = 0);
     bool OCLRelease(IUserLogger* const logger = 0);
@@ -168,9 +175,51 @@ private:
         m_barycenter[0] = m_barycenter[1] = m_barycenter[2] = 0.0;
         m_rot[0][0] = m_rot[1][1] = m_rot[2][2] = 1.0;
         SetCancel(false);
+        m_hasDeadline = false;
+        m_timedOut = false;
+        ReleaseClippingScratch();
     }
+    // Read by every search worker, so it only looks at the clock.
+    bool IsOutOfTime() const
+    {
+        return m_hasDeadline && std::chrono::steady_clock::now() >= m_deadline;
+    }
+    // Buffers of one clipping-plane search worker, reused by every search of a decomposition.
+    struct ClippingScratch {
+        ClippingScratch()
+            : m_left(0)
+            , m_right(0)
+        {
+        }
+        ~ClippingScratch()
+        {
+            delete m_left;
+            delete m_right;
+        }
+        Mesh m_leftCH;
+        Mesh m_rightCH;
+        SArray<Vec3<double> > m_leftCHPts;
+        SArray<Vec3<double> > m_rightCHPts;
+        PrimitiveSet* m_left;
+        PrimitiveSet* m_right;
+    };
+    struct ClippingPlaneSearch;
+    void ReleaseClippingScratch()
+    {
+        for (size_t i = 0; i < m_clippingScratch.Size(); ++i) {
+            delete m_clippingScratch[i];
+        }
+        m_clippingScratch.Clear();
+    }
+    static void ClippingPlaneTask(void* userData, uint32_t taskIndex, uint32_t workerIndex);
+    void EvaluateClippingPlanes(ClippingPlaneSearch& search, const uint32_t chunk, const uint32_t workerIndex);
     void ComputePrimitiveSet(const Parameters& params);
     void ComputeACD(const Parameters& params);
+    void PublishParts(const SArray<PrimitiveSet*>& parts, const SArray<PrimitiveSet*>& inputParts, const Parameters& params);
+    struct MergeCostBatch;
+    static void MergeCostTask(void* userData, uint32_t taskIndex, uint32_t workerIndex);
+    void ComputeMergeCosts(MergeCostBatch& batch, const uint32_t chunk, const uint32_t workerIndex);
+    void RunMergeCostBatch(MergeCostBatch& batch, const uint32_t nWorkers, const Parameters& params);
     void MergeConvexHulls(const Parameters& params);
     void SimplifyConvexHull(Mesh* const ch, const size_t nvertices, const double minVolume);
     void SimplifyConvexHulls(const Parameters& params);
@@ -218,7 +267,7 @@ private:
         Volume volume;
         volume.Voxelize(points, stridePoints, nPoints,
             triangles, strideTriangles, nTriangles,
-            m_dim, m_barycenter, m_rot);
+            m_dim, m_barycenter, m_rot, params.m_taskScheduler);
         size_t n = volume.GetNPrimitivesOnSurf() + volume.GetNPrimitivesInsideSurf();
         Update(50.0, 100.0, params);
 
@@ -281,7 +330,7 @@ private:
             m_volume = new Volume;
             m_volume->Voxelize(points, stridePoints, nPoints,
                 triangles, strideTriangles, nTriangles,
-                m_dim, m_barycenter, m_rot);
+                m_dim, m_barycenter, m_rot, params.m_taskScheduler);
 
             Update(progress, 100.0, params);
 
@@ -321,6 +370,10 @@ private:
         const Parameters& params)
     {
         Init();
+        if (params.m_maxComputeTime > 0) {
+            m_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(params.m_maxComputeTime);
+            m_hasDeadline = true;
+        }
         if (params.m_projectHullVertices)
         {
             mRaycastMesh = RaycastMesh::createRaycastMesh(nPoints, points, nTriangles, (const uint32_t *)triangles);
@@ -361,7 +414,11 @@ private:
     PrimitiveSet* m_pset;
     Mutex m_cancelMutex;
     bool m_cancel;
-    int32_t m_ompNumProcessors;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_hasDeadline;
+    bool m_timedOut;
+    int32_t m_maxNumWorkers;
+    SArray<ClippingScratch*> m_clippingScratch;
 #ifdef CL_VERSION_1_1
     cl_device_id* m_oclDevice;
     cl_context m_oclContext;
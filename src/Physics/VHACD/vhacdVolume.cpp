@@ -15,10 +15,11 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "btConvexHullComputer.h"
 #include "vhacdVolume.h"
+#include "../Utility/PhysicsSimdUtils.h"
 #include <algorithm>
+#include <bit>
 #include <float.h>
 #include <math.h>
-#include <queue>
 #include <string.h>
 
 #ifdef _MSC_VER
@@ -257,6 +258,173 @@ int32_t TriBoxOverlap(const Vec3<double>& boxcenter,
     return 1; /* box and triangle overlaps */
 }
 
+// Volume rows hold 32 voxels per word, voxel i in bits 2 * (i % 32) and up. VOXEL_LOW_BITS is the
+// low bit of every voxel, which is also a word of outside voxels.
+static const uint64_t VOXEL_LOW_BITS = 0x5555555555555555ull;
+
+// Sets voxel i of the word on the surface unless it is defined already, returns whether it was set.
+inline bool MarkOnSurface(uint64_t& word, const size_t i)
+{
+    const uint32_t shift = (uint32_t)(i & 31) << 1;
+    if (((word >> shift) & 3) != PRIMITIVE_UNDEFINED) {
+        return false;
+    }
+    word |= (uint64_t)PRIMITIVE_ON_SURFACE << shift;
+    return true;
+}
+
+#ifdef PHYSICS_SIMD_SSE
+// TriBoxOverlap for the unit boxes centered on (i, j, k + lane), one lane per box. Each lane goes
+// through the same operations as the scalar test, without fused multiply-adds, so both agree on
+// every voxel; the early outs become a mask of rejected lanes.
+struct TriBoxLanesAVX2 {
+    __m256d m_sign;
+    __m256d m_half;
+    __m256d m_rejected;
+};
+
+PHYSICS_TARGET_AVX2_NOFMA inline __m256d ProjectXAVX2(const __m256d a, const __m256d b, const __m256d (&v)[3])
+{
+    return _mm256_sub_pd(_mm256_mul_pd(a, v[Y]), _mm256_mul_pd(b, v[Z]));
+}
+
+PHYSICS_TARGET_AVX2_NOFMA inline __m256d ProjectYAVX2(const __m256d a, const __m256d b, const __m256d (&v)[3], const __m256d sign)
+{
+    return _mm256_add_pd(_mm256_mul_pd(_mm256_xor_pd(a, sign), v[X]), _mm256_mul_pd(b, v[Z]));
+}
+
+PHYSICS_TARGET_AVX2_NOFMA inline __m256d ProjectZAVX2(const __m256d a, const __m256d b, const __m256d (&v)[3])
+{
+    return _mm256_sub_pd(_mm256_mul_pd(a, v[X]), _mm256_mul_pd(b, v[Y]));
+}
+
+// One AXISTEST_*, p is the projection the scalar macro takes as min when p < q.
+PHYSICS_TARGET_AVX2_NOFMA inline void AxisTestAVX2(const __m256d p, const __m256d q, const __m256d fa, const __m256d fb, TriBoxLanesAVX2& lanes)
+{
+    const __m256d less = _mm256_cmp_pd(p, q, _CMP_LT_OQ);
+    const __m256d min = _mm256_blendv_pd(q, p, less);
+    const __m256d max = _mm256_blendv_pd(p, q, less);
+    const __m256d rad = _mm256_add_pd(_mm256_mul_pd(fa, lanes.m_half), _mm256_mul_pd(fb, lanes.m_half));
+    lanes.m_rejected = _mm256_or_pd(lanes.m_rejected, _mm256_cmp_pd(min, rad, _CMP_GT_OQ));
+    lanes.m_rejected = _mm256_or_pd(lanes.m_rejected, _mm256_cmp_pd(max, _mm256_xor_pd(rad, lanes.m_sign), _CMP_LT_OQ));
+}
+
+PHYSICS_TARGET_AVX2_NOFMA inline void FindMinMaxTestAVX2(const __m256d x0, const __m256d x1, const __m256d x2, TriBoxLanesAVX2& lanes)
+{
+    __m256d min = x0;
+    __m256d max = x0;
+    min = _mm256_blendv_pd(min, x1, _mm256_cmp_pd(x1, min, _CMP_LT_OQ));
+    max = _mm256_blendv_pd(max, x1, _mm256_cmp_pd(x1, max, _CMP_GT_OQ));
+    min = _mm256_blendv_pd(min, x2, _mm256_cmp_pd(x2, min, _CMP_LT_OQ));
+    max = _mm256_blendv_pd(max, x2, _mm256_cmp_pd(x2, max, _CMP_GT_OQ));
+    lanes.m_rejected = _mm256_or_pd(lanes.m_rejected, _mm256_cmp_pd(min, lanes.m_half, _CMP_GT_OQ));
+    lanes.m_rejected = _mm256_or_pd(lanes.m_rejected, _mm256_cmp_pd(max, _mm256_xor_pd(lanes.m_half, lanes.m_sign), _CMP_LT_OQ));
+}
+
+// Bit h of the result is set when the triangle overlaps the box of lane h.
+PHYSICS_TARGET_AVX2_NOFMA inline int32_t TriBoxOverlapAVX2(const Vec3<double> (&tri)[3], const double i, const double j, const double k)
+{
+    TriBoxLanesAVX2 lanes;
+    lanes.m_sign = _mm256_set1_pd(-0.0);
+    lanes.m_half = _mm256_set1_pd(0.5);
+    lanes.m_rejected = _mm256_setzero_pd();
+    const __m256d boxcenter[3] = { _mm256_set1_pd(i), _mm256_set1_pd(j), _mm256_setr_pd(k, k + 1.0, k + 2.0, k + 3.0) };
+    __m256d v0[3], v1[3], v2[3], e0[3], e1[3], e2[3], fe[3];
+    for (int32_t h = X; h <= Z; ++h) {
+        v0[h] = _mm256_sub_pd(_mm256_set1_pd(tri[0][h]), boxcenter[h]);
+        v1[h] = _mm256_sub_pd(_mm256_set1_pd(tri[1][h]), boxcenter[h]);
+        v2[h] = _mm256_sub_pd(_mm256_set1_pd(tri[2][h]), boxcenter[h]);
+    }
+    for (int32_t h = X; h <= Z; ++h) {
+        e0[h] = _mm256_sub_pd(v1[h], v0[h]);
+        e1[h] = _mm256_sub_pd(v2[h], v1[h]);
+        e2[h] = _mm256_sub_pd(v0[h], v2[h]);
+    }
+
+    for (int32_t h = X; h <= Z; ++h) {
+        fe[h] = _mm256_andnot_pd(lanes.m_sign, e0[h]);
+    }
+    AxisTestAVX2(ProjectXAVX2(e0[Z], e0[Y], v0), ProjectXAVX2(e0[Z], e0[Y], v2), fe[Z], fe[Y], lanes);
+    AxisTestAVX2(ProjectYAVX2(e0[Z], e0[X], v0, lanes.m_sign), ProjectYAVX2(e0[Z], e0[X], v2, lanes.m_sign), fe[Z], fe[X], lanes);
+    AxisTestAVX2(ProjectZAVX2(e0[Y], e0[X], v2), ProjectZAVX2(e0[Y], e0[X], v1), fe[Y], fe[X], lanes);
+
+    for (int32_t h = X; h <= Z; ++h) {
+        fe[h] = _mm256_andnot_pd(lanes.m_sign, e1[h]);
+    }
+    AxisTestAVX2(ProjectXAVX2(e1[Z], e1[Y], v0), ProjectXAVX2(e1[Z], e1[Y], v2), fe[Z], fe[Y], lanes);
+    AxisTestAVX2(ProjectYAVX2(e1[Z], e1[X], v0, lanes.m_sign), ProjectYAVX2(e1[Z], e1[X], v2, lanes.m_sign), fe[Z], fe[X], lanes);
+    AxisTestAVX2(ProjectZAVX2(e1[Y], e1[X], v0), ProjectZAVX2(e1[Y], e1[X], v1), fe[Y], fe[X], lanes);
+
+    for (int32_t h = X; h <= Z; ++h) {
+        fe[h] = _mm256_andnot_pd(lanes.m_sign, e2[h]);
+    }
+    AxisTestAVX2(ProjectXAVX2(e2[Z], e2[Y], v0), ProjectXAVX2(e2[Z], e2[Y], v1), fe[Z], fe[Y], lanes);
+    AxisTestAVX2(ProjectYAVX2(e2[Z], e2[X], v0, lanes.m_sign), ProjectYAVX2(e2[Z], e2[X], v1, lanes.m_sign), fe[Z], fe[X], lanes);
+    AxisTestAVX2(ProjectZAVX2(e2[Y], e2[X], v2), ProjectZAVX2(e2[Y], e2[X], v1), fe[Y], fe[X], lanes);
+
+    for (int32_t h = X; h <= Z; ++h) {
+        FindMinMaxTestAVX2(v0[h], v1[h], v2[h], lanes);
+    }
+
+    // PlaneBoxOverlap with normal = e0 ^ e1
+    const __m256d normal[3] = { _mm256_sub_pd(_mm256_mul_pd(e0[Y], e1[Z]), _mm256_mul_pd(e0[Z], e1[Y])),
+        _mm256_sub_pd(_mm256_mul_pd(e0[Z], e1[X]), _mm256_mul_pd(e0[X], e1[Z])),
+        _mm256_sub_pd(_mm256_mul_pd(e0[X], e1[Y]), _mm256_mul_pd(e0[Y], e1[X])) };
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d minusHalf = _mm256_xor_pd(lanes.m_half, lanes.m_sign);
+    __m256d vmin[3], vmax[3];
+    for (int32_t h = X; h <= Z; ++h) {
+        const __m256d positive = _mm256_cmp_pd(normal[h], zero, _CMP_GT_OQ);
+        const __m256d low = _mm256_sub_pd(minusHalf, v0[h]);
+        const __m256d high = _mm256_sub_pd(lanes.m_half, v0[h]);
+        vmin[h] = _mm256_blendv_pd(high, low, positive);
+        vmax[h] = _mm256_blendv_pd(low, high, positive);
+    }
+    const __m256d dmin = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(normal[X], vmin[X]), _mm256_mul_pd(normal[Y], vmin[Y])), _mm256_mul_pd(normal[Z], vmin[Z]));
+    const __m256d dmax = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(normal[X], vmax[X]), _mm256_mul_pd(normal[Y], vmax[Y])), _mm256_mul_pd(normal[Z], vmax[Z]));
+    lanes.m_rejected = _mm256_or_pd(lanes.m_rejected, _mm256_cmp_pd(dmin, zero, _CMP_GT_OQ));
+    lanes.m_rejected = _mm256_or_pd(lanes.m_rejected, _mm256_cmp_pd(dmax, zero, _CMP_NGE_UQ));
+    return _mm256_movemask_pd(lanes.m_rejected) ^ 0xF;
+}
+
+// Marks the voxels (i, j, k0..k1 - 1) the triangle overlaps, four boxes per test. column is the
+// word of voxel (i, j, 0) and stride the distance between the words of consecutive k.
+PHYSICS_TARGET_AVX2_NOFMA size_t RasterizeColumnAVX2(const VoxelizedTriangle& triangle, const size_t i, const size_t j,
+    const size_t k0, const size_t k1, uint64_t* const column, const size_t stride)
+{
+    size_t nOnSurface = 0;
+    for (size_t k = k0; k < k1; k += 4) {
+        int32_t overlaps = TriBoxOverlapAVX2(triangle.m_pts, (double)i, (double)j, (double)k);
+        if (k1 - k < 4) {
+            overlaps &= (1 << (k1 - k)) - 1;
+        }
+        for (; overlaps != 0; overlaps &= overlaps - 1) {
+            nOnSurface += MarkOnSurface(column[(k + std::countr_zero((uint32_t)overlaps)) * stride], i);
+        }
+    }
+    return nOnSurface;
+}
+#endif // PHYSICS_SIMD_SSE
+
+size_t RasterizeColumn(const VoxelizedTriangle& triangle, const size_t i, const size_t j,
+    const size_t k0, const size_t k1, uint64_t* const column, const size_t stride)
+{
+#ifdef PHYSICS_SIMD_SSE
+    if (PhysicsSimdUtils::HasAVX2()) {
+        return RasterizeColumnAVX2(triangle, i, j, k0, k1, column, stride);
+    }
+#endif // PHYSICS_SIMD_SSE
+    size_t nOnSurface = 0;
+    const Vec3<double> boxhalfsize(0.5, 0.5, 0.5);
+    for (size_t k = k0; k < k1; ++k) {
+        const Vec3<double> boxcenter((double)i, (double)j, (double)k);
+        if (TriBoxOverlap(boxcenter, boxhalfsize, triangle.m_pts[0], triangle.m_pts[1], triangle.m_pts[2]) == 1) {
+            nOnSurface += MarkOnSurface(column[k * stride], i);
+        }
+    }
+    return nOnSurface;
+}
+
 // Slightly modified version of  Stan Melax's code for 3x3 matrix diagonalization (Thanks Stan!)
 // source: http://www.melax.com/diag.html?attredirects=0
 void Diagonalize(const double (&A)[3][3], double (&Q)[3][3], double (&D)[3][3])
@@ -374,81 +542,109 @@ VoxelSet::VoxelSet()
 VoxelSet::~VoxelSet(void)
 {
 }
+// Voxel b of a brick.
+inline void GetBrickVoxel(const VoxelBrick& brick, const int32_t b, Voxel& voxel)
+{
+    voxel.m_coord[0] = brick.m_coord[0];
+    voxel.m_coord[1] = brick.m_coord[1];
+    voxel.m_coord[2] = (short)(brick.m_coord[2] + b);
+    voxel.m_data = ((brick.m_onSurface >> b) & 1) ? PRIMITIVE_ON_SURFACE : PRIMITIVE_INSIDE_SURFACE;
+}
 void VoxelSet::ComputeBB()
 {
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
+    Voxel voxel;
+    GetBrickVoxel(m_bricks[0], std::countr_zero(m_bricks[0].GetVoxels()), voxel);
     for (int32_t h = 0; h < 3; ++h) {
-        m_minBBVoxels[h] = m_voxels[0].m_coord[h];
-        m_maxBBVoxels[h] = m_voxels[0].m_coord[h];
+        m_minBBVoxels[h] = voxel.m_coord[h];
+        m_maxBBVoxels[h] = voxel.m_coord[h];
     }
+    // the coordinates are integers, their sums are exact in any order
     Vec3<double> bary(0.0);
-    for (size_t p = 0; p < nVoxels; ++p) {
+    for (size_t p = 0; p < nBricks; ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        const uint32_t voxels = brick.GetVoxels();
+        const int32_t nVoxels = std::popcount(voxels);
+        bary[0] += (double)brick.m_coord[0] * nVoxels;
+        bary[1] += (double)brick.m_coord[1] * nVoxels;
+        for (uint32_t bits = voxels; bits != 0; bits &= bits - 1) {
+            bary[2] += brick.m_coord[2] + std::countr_zero(bits);
+        }
+        const short minCoord[3] = { brick.m_coord[0], brick.m_coord[1], (short)(brick.m_coord[2] + std::countr_zero(voxels)) };
+        const short maxCoord[3] = { brick.m_coord[0], brick.m_coord[1], (short)(brick.m_coord[2] + VOXEL_BRICK_SIZE - 1 - std::countl_zero(voxels)) };
         for (int32_t h = 0; h < 3; ++h) {
-            bary[h] += m_voxels[p].m_coord[h];
-            if (m_minBBVoxels[h] > m_voxels[p].m_coord[h])
-                m_minBBVoxels[h] = m_voxels[p].m_coord[h];
-            if (m_maxBBVoxels[h] < m_voxels[p].m_coord[h])
-                m_maxBBVoxels[h] = m_voxels[p].m_coord[h];
+            if (m_minBBVoxels[h] > minCoord[h])
+                m_minBBVoxels[h] = minCoord[h];
+            if (m_maxBBVoxels[h] < maxCoord[h])
+                m_maxBBVoxels[h] = maxCoord[h];
         }
     }
-    bary /= (double)nVoxels;
+    bary /= (double)GetNPrimitives();
     for (int32_t h = 0; h < 3; ++h) {
         m_minBBPts[h] = m_minBBVoxels[h] * m_scale + m_minBB[h];
         m_maxBBPts[h] = m_maxBBVoxels[h] * m_scale + m_minBB[h];
         m_barycenter[h] = (short)(bary[h] + 0.5);
     }
 }
+// Appends the vertices of the hull of one cluster of points.
+static void AddClusterHull(Vec3<double>* const points, const size_t nPoints, SArray<Vec3<double> >& cpoints)
+{
+    btConvexHullComputer ch;
+    ch.compute((double*)points, 3 * sizeof(double), (int32_t)nPoints, -1.0, -1.0);
+    for (int32_t v = 0; v < ch.vertices.size(); v++) {
+        cpoints.PushBack(Vec3<double>(ch.vertices[v].getX(), ch.vertices[v].getY(), ch.vertices[v].getZ()));
+    }
+}
 void VoxelSet::ComputeConvexHull(Mesh& meshCH, const size_t sampling) const
 {
     const size_t CLUSTER_SIZE = 65536;
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
 
     SArray<Vec3<double> > cpoints;
 
     Vec3<double>* points = new Vec3<double>[CLUSTER_SIZE];
-    size_t p = 0;
+    size_t q = 0;
     size_t s = 0;
     short i, j, k;
-    while (p < nVoxels) {
-        size_t q = 0;
-        while (q < CLUSTER_SIZE && p < nVoxels) {
-            if (m_voxels[p].m_data == PRIMITIVE_ON_SURFACE) {
-                ++s;
-                if (s == sampling) {
-                    s = 0;
-                    i = m_voxels[p].m_coord[0];
-                    j = m_voxels[p].m_coord[1];
-                    k = m_voxels[p].m_coord[2];
-                    Vec3<double> p0((i - 0.5) * m_scale, (j - 0.5) * m_scale, (k - 0.5) * m_scale);
-                    Vec3<double> p1((i + 0.5) * m_scale, (j - 0.5) * m_scale, (k - 0.5) * m_scale);
-                    Vec3<double> p2((i + 0.5) * m_scale, (j + 0.5) * m_scale, (k - 0.5) * m_scale);
-                    Vec3<double> p3((i - 0.5) * m_scale, (j + 0.5) * m_scale, (k - 0.5) * m_scale);
-                    Vec3<double> p4((i - 0.5) * m_scale, (j - 0.5) * m_scale, (k + 0.5) * m_scale);
-                    Vec3<double> p5((i + 0.5) * m_scale, (j - 0.5) * m_scale, (k + 0.5) * m_scale);
-                    Vec3<double> p6((i + 0.5) * m_scale, (j + 0.5) * m_scale, (k + 0.5) * m_scale);
-                    Vec3<double> p7((i - 0.5) * m_scale, (j + 0.5) * m_scale, (k + 0.5) * m_scale);
-                    points[q++] = p0 + m_minBB;
-                    points[q++] = p1 + m_minBB;
-                    points[q++] = p2 + m_minBB;
-                    points[q++] = p3 + m_minBB;
-                    points[q++] = p4 + m_minBB;
-                    points[q++] = p5 + m_minBB;
-                    points[q++] = p6 + m_minBB;
-                    points[q++] = p7 + m_minBB;
+    for (size_t p = 0; p < nBricks; ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        for (uint32_t bits = brick.m_onSurface; bits != 0; bits &= bits - 1) {
+            ++s;
+            if (s == sampling) {
+                s = 0;
+                i = brick.m_coord[0];
+                j = brick.m_coord[1];
+                k = (short)(brick.m_coord[2] + std::countr_zero(bits));
+                Vec3<double> p0((i - 0.5) * m_scale, (j - 0.5) * m_scale, (k - 0.5) * m_scale);
+                Vec3<double> p1((i + 0.5) * m_scale, (j - 0.5) * m_scale, (k - 0.5) * m_scale);
+                Vec3<double> p2((i + 0.5) * m_scale, (j + 0.5) * m_scale, (k - 0.5) * m_scale);
+                Vec3<double> p3((i - 0.5) * m_scale, (j + 0.5) * m_scale, (k - 0.5) * m_scale);
+                Vec3<double> p4((i - 0.5) * m_scale, (j - 0.5) * m_scale, (k + 0.5) * m_scale);
+                Vec3<double> p5((i + 0.5) * m_scale, (j - 0.5) * m_scale, (k + 0.5) * m_scale);
+                Vec3<double> p6((i + 0.5) * m_scale, (j + 0.5) * m_scale, (k + 0.5) * m_scale);
+                Vec3<double> p7((i - 0.5) * m_scale, (j + 0.5) * m_scale, (k + 0.5) * m_scale);
+                points[q++] = p0 + m_minBB;
+                points[q++] = p1 + m_minBB;
+                points[q++] = p2 + m_minBB;
+                points[q++] = p3 + m_minBB;
+                points[q++] = p4 + m_minBB;
+                points[q++] = p5 + m_minBB;
+                points[q++] = p6 + m_minBB;
+                points[q++] = p7 + m_minBB;
+                if (q == CLUSTER_SIZE) {
+                    AddClusterHull(points, q, cpoints);
+                    q = 0;
                 }
             }
-            ++p;
-        }
-        btConvexHullComputer ch;
-        ch.compute((double*)points, 3 * sizeof(double), (int32_t)q, -1.0, -1.0);
-        for (int32_t v = 0; v < ch.vertices.size(); v++) {
-            cpoints.PushBack(Vec3<double>(ch.vertices[v].getX(), ch.vertices[v].getY(), ch.vertices[v].getZ()));
         }
     }
+    if (q > 0) {
+        AddClusterHull(points, q, cpoints);
+    }
     delete[] points;
 
     points = cpoints.Data();
@@ -474,6 +670,124 @@ void VoxelSet::ComputeConvexHull(Mesh& meshCH, const size_t sampling) const
         }
     }
 }
+// Plane tests over the voxels of a brick. The AVX2 kernels evaluate the same expression as GetPoint
+// and the scalar tests, in double precision and without fused multiply-adds, so every voxel ends up
+// on the same side of the plane whichever path runs.
+inline void ComputeBrickDistancesScalar(const VoxelBrick& brick, const Plane& plane, const double scale,
+    const Vec3<double>& minBB, double* const distances)
+{
+    const double x = brick.m_coord[0] * scale + minBB[0];
+    const double y = brick.m_coord[1] * scale + minBB[1];
+    const double xy = plane.m_a * x + plane.m_b * y;
+    for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+        const int32_t b = std::countr_zero(bits);
+        const double z = (brick.m_coord[2] + b) * scale + minBB[2];
+        distances[b] = xy + plane.m_c * z + plane.m_d;
+    }
+}
+
+#ifdef PHYSICS_SIMD_SSE
+struct BrickPlaneAVX2 {
+    __m256d m_c;
+    __m256d m_d;
+    __m256d m_scale;
+    __m256d m_minZ;
+};
+
+PHYSICS_TARGET_AVX2_NOFMA inline BrickPlaneAVX2 MakeBrickPlaneAVX2(const Plane& plane, const double scale, const Vec3<double>& minBB)
+{
+    BrickPlaneAVX2 p;
+    p.m_c = _mm256_set1_pd(plane.m_c);
+    p.m_d = _mm256_set1_pd(plane.m_d);
+    p.m_scale = _mm256_set1_pd(scale);
+    p.m_minZ = _mm256_set1_pd(minBB[2]);
+    return p;
+}
+
+// Distances of voxels b..b + 3 of the brick, xy is the part shared by the whole brick.
+PHYSICS_TARGET_AVX2_NOFMA inline __m256d ComputeBrickDistancesAVX2(const VoxelBrick& brick, const int32_t b, const __m256d xy, const BrickPlaneAVX2& p)
+{
+    const double k = (double)(brick.m_coord[2] + b);
+    const __m256d z = _mm256_add_pd(_mm256_mul_pd(_mm256_setr_pd(k, k + 1.0, k + 2.0, k + 3.0), p.m_scale), p.m_minZ);
+    return _mm256_add_pd(_mm256_add_pd(xy, _mm256_mul_pd(p.m_c, z)), p.m_d);
+}
+
+PHYSICS_TARGET_AVX2_NOFMA inline __m256d ComputeBrickXYAVX2(const VoxelBrick& brick, const Plane& plane, const double scale, const Vec3<double>& minBB)
+{
+    const double x = brick.m_coord[0] * scale + minBB[0];
+    const double y = brick.m_coord[1] * scale + minBB[1];
+    return _mm256_set1_pd(plane.m_a * x + plane.m_b * y);
+}
+
+PHYSICS_TARGET_AVX2_NOFMA void ComputeBrickDistancesAVX2(const VoxelBrick& brick, const Plane& plane, const double scale,
+    const Vec3<double>& minBB, double* const distances)
+{
+    const BrickPlaneAVX2 p = MakeBrickPlaneAVX2(plane, scale, minBB);
+    const __m256d xy = ComputeBrickXYAVX2(brick, plane, scale, minBB);
+    const uint32_t voxels = brick.GetVoxels();
+    for (int32_t b = 0; b < VOXEL_BRICK_SIZE; b += 4) {
+        if ((voxels >> b) & 0xF) {
+            _mm256_storeu_pd(distances + b, ComputeBrickDistancesAVX2(brick, b, xy, p));
+        }
+    }
+}
+
+PHYSICS_TARGET_AVX2_NOFMA size_t CountPositiveVoxelsAVX2(const VoxelBrick* const bricks, const size_t nBricks, const Plane& plane,
+    const double scale, const Vec3<double>& minBB)
+{
+    const BrickPlaneAVX2 p = MakeBrickPlaneAVX2(plane, scale, minBB);
+    const __m256d zero = _mm256_setzero_pd();
+    size_t nPositiveVoxels = 0;
+    for (size_t q = 0; q < nBricks; ++q) {
+        const VoxelBrick& brick = bricks[q];
+        const __m256d xy = ComputeBrickXYAVX2(brick, plane, scale, minBB);
+        const uint32_t voxels = brick.GetVoxels();
+        uint32_t positive = 0;
+        for (int32_t b = 0; b < VOXEL_BRICK_SIZE; b += 4) {
+            if ((voxels >> b) & 0xF) {
+                const __m256d d = ComputeBrickDistancesAVX2(brick, b, xy, p);
+                positive |= (uint32_t)_mm256_movemask_pd(_mm256_cmp_pd(d, zero, _CMP_GE_OQ)) << b;
+            }
+        }
+        nPositiveVoxels += std::popcount(positive & voxels);
+    }
+    return nPositiveVoxels;
+}
+#endif // PHYSICS_SIMD_SSE
+
+// Distances of the voxels of a brick to the plane, distances[b] for voxel b; the entries of missing
+// voxels are left undefined.
+void ComputeBrickDistances(const VoxelBrick& brick, const Plane& plane, const double scale,
+    const Vec3<double>& minBB, double* const distances)
+{
+#ifdef PHYSICS_SIMD_SSE
+    if (PhysicsSimdUtils::HasAVX2()) {
+        ComputeBrickDistancesAVX2(brick, plane, scale, minBB, distances);
+        return;
+    }
+#endif // PHYSICS_SIMD_SSE
+    ComputeBrickDistancesScalar(brick, plane, scale, minBB, distances);
+}
+
+size_t CountPositiveVoxels(const VoxelBrick* const bricks, const size_t nBricks, const Plane& plane,
+    const double scale, const Vec3<double>& minBB)
+{
+#ifdef PHYSICS_SIMD_SSE
+    if (PhysicsSimdUtils::HasAVX2()) {
+        return CountPositiveVoxelsAVX2(bricks, nBricks, plane, scale, minBB);
+    }
+#endif // PHYSICS_SIMD_SSE
+    double distances[VOXEL_BRICK_SIZE];
+    size_t nPositiveVoxels = 0;
+    for (size_t q = 0; q < nBricks; ++q) {
+        ComputeBrickDistancesScalar(bricks[q], plane, scale, minBB, distances);
+        for (uint32_t bits = bricks[q].GetVoxels(); bits != 0; bits &= bits - 1) {
+            nPositiveVoxels += (distances[std::countr_zero(bits)] >= 0.0);
+        }
+    }
+    return nPositiveVoxels;
+}
+
 void VoxelSet::GetPoints(const Voxel& voxel,
     Vec3<double>* const pts) const
 {
@@ -510,55 +824,59 @@ void VoxelSet::Intersect(const Plane& plane,
     SArray<Vec3<double> >* const negativePts,
     const size_t sampling) const
 {
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
     const double d0 = m_scale;
     double d;
+    double distances[VOXEL_BRICK_SIZE];
     Vec3<double> pts[8];
-    Vec3<double> pt;
     Voxel voxel;
     size_t sp = 0;
     size_t sn = 0;
-    for (size_t v = 0; v < nVoxels; ++v) {
-        voxel = m_voxels[v];
-        pt = GetPoint(voxel);
-        d = plane.m_a * pt[0] + plane.m_b * pt[1] + plane.m_c * pt[2] + plane.m_d;
-        //            if      (d >= 0.0 && d <= d0) positivePts->PushBack(pt);
-        //            else if (d < 0.0 && -d <= d0) negativePts->PushBack(pt);
-        if (d >= 0.0) {
-            if (d <= d0) {
-                GetPoints(voxel, pts);
-                for (int32_t k = 0; k < 8; ++k) {
-                    positivePts->PushBack(pts[k]);
-                }
-            }
-            else {
-                if (++sp == sampling) {
-                    //                        positivePts->PushBack(pt);
+    for (size_t p = 0; p < nBricks; ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        ComputeBrickDistances(brick, plane, m_scale, m_minBB, distances);
+        for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+            const int32_t b = std::countr_zero(bits);
+            GetBrickVoxel(brick, b, voxel);
+            d = distances[b];
+            //            if      (d >= 0.0 && d <= d0) positivePts->PushBack(pt);
+            //            else if (d < 0.0 && -d <= d0) negativePts->PushBack(pt);
+            if (d >= 0.0) {
+                if (d <= d0) {
                     GetPoints(voxel, pts);
                     for (int32_t k = 0; k < 8; ++k) {
                         positivePts->PushBack(pts[k]);
                     }
-                    sp = 0;
                 }
-            }
-        }
-        else {
-            if (-d <= d0) {
-                GetPoints(voxel, pts);
-                for (int32_t k = 0; k < 8; ++k) {
-                    negativePts->PushBack(pts[k]);
+                else {
+                    if (++sp == sampling) {
+                        //                        positivePts->PushBack(pt);
+                        GetPoints(voxel, pts);
+                        for (int32_t k = 0; k < 8; ++k) {
+                            positivePts->PushBack(pts[k]);
+                        }
+                        sp = 0;
+                    }
                 }
             }
             else {
-                if (++sn == sampling) {
-                    //                        negativePts->PushBack(pt);
+                if (-d <= d0) {
                     GetPoints(voxel, pts);
                     for (int32_t k = 0; k < 8; ++k) {
                         negativePts->PushBack(pts[k]);
                     }
-                    sn = 0;
+                }
+                else {
+                    if (++sn == sampling) {
+                        //                        negativePts->PushBack(pt);
+                        GetPoints(voxel, pts);
+                        for (int32_t k = 0; k < 8; ++k) {
+                            negativePts->PushBack(pts[k]);
+                        }
+                        sn = 0;
+                    }
                 }
             }
         }
@@ -568,22 +886,26 @@ void VoxelSet::ComputeExteriorPoints(const Plane& plane,
     const Mesh& mesh,
     SArray<Vec3<double> >* const exteriorPts) const
 {
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
-    double d;
+    double distances[VOXEL_BRICK_SIZE];
     Vec3<double> pt;
     Vec3<double> pts[8];
     Voxel voxel;
-    for (size_t v = 0; v < nVoxels; ++v) {
-        voxel = m_voxels[v];
-        pt = GetPoint(voxel);
-        d = plane.m_a * pt[0] + plane.m_b * pt[1] + plane.m_c * pt[2] + plane.m_d;
-        if (d >= 0.0) {
-            if (!mesh.IsInside(pt)) {
-                GetPoints(voxel, pts);
-                for (int32_t k = 0; k < 8; ++k) {
-                    exteriorPts->PushBack(pts[k]);
+    for (size_t p = 0; p < nBricks; ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        ComputeBrickDistances(brick, plane, m_scale, m_minBB, distances);
+        for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+            const int32_t b = std::countr_zero(bits);
+            if (distances[b] >= 0.0) {
+                GetBrickVoxel(brick, b, voxel);
+                pt = GetPoint(voxel);
+                if (!mesh.IsInside(pt)) {
+                    GetPoints(voxel, pts);
+                    for (int32_t k = 0; k < 8; ++k) {
+                        exteriorPts->PushBack(pts[k]);
+                    }
                 }
             }
         }
@@ -595,42 +917,36 @@ void VoxelSet::ComputeClippedVolumes(const Plane& plane,
 {
     negativeVolume = 0.0;
     positiveVolume = 0.0;
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
-    double d;
-    Vec3<double> pt;
-    size_t nPositiveVoxels = 0;
-    for (size_t v = 0; v < nVoxels; ++v) {
-        pt = GetPoint(m_voxels[v]);
-        d = plane.m_a * pt[0] + plane.m_b * pt[1] + plane.m_c * pt[2] + plane.m_d;
-        nPositiveVoxels += (d >= 0.0);
-    }
-    size_t nNegativeVoxels = nVoxels - nPositiveVoxels;
+    size_t nPositiveVoxels = CountPositiveVoxels(m_bricks.Data(), nBricks, plane, m_scale, m_minBB);
+    size_t nNegativeVoxels = GetNPrimitives() - nPositiveVoxels;
     positiveVolume = m_unitVolume * nPositiveVoxels;
     negativeVolume = m_unitVolume * nNegativeVoxels;
 }
 void VoxelSet::SelectOnSurface(PrimitiveSet* const onSurfP) const
 {
     VoxelSet* const onSurf = (VoxelSet*)onSurfP;
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
 
     for (int32_t h = 0; h < 3; ++h) {
         onSurf->m_minBB[h] = m_minBB[h];
     }
-    onSurf->m_voxels.Resize(0);
+    onSurf->m_bricks.Resize(0);
     onSurf->m_scale = m_scale;
     onSurf->m_unitVolume = m_unitVolume;
     onSurf->m_numVoxelsOnSurface = 0;
     onSurf->m_numVoxelsInsideSurface = 0;
-    Voxel voxel;
-    for (size_t v = 0; v < nVoxels; ++v) {
-        voxel = m_voxels[v];
-        if (voxel.m_data == PRIMITIVE_ON_SURFACE) {
-            onSurf->m_voxels.PushBack(voxel);
-            ++onSurf->m_numVoxelsOnSurface;
+    VoxelBrick brick;
+    for (size_t p = 0; p < nBricks; ++p) {
+        brick = m_bricks[p];
+        if (brick.m_onSurface != 0) {
+            brick.m_inside = 0;
+            onSurf->m_bricks.PushBack(brick);
+            onSurf->m_numVoxelsOnSurface += std::popcount(brick.m_onSurface);
         }
     }
 }
@@ -640,64 +956,81 @@ void VoxelSet::Clip(const Plane& plane,
 {
     VoxelSet* const positivePart = (VoxelSet*)positivePartP;
     VoxelSet* const negativePart = (VoxelSet*)negativePartP;
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
 
     for (int32_t h = 0; h < 3; ++h) {
         negativePart->m_minBB[h] = positivePart->m_minBB[h] = m_minBB[h];
     }
-    positivePart->m_voxels.Resize(0);
-    negativePart->m_voxels.Resize(0);
-    positivePart->m_voxels.Allocate(nVoxels);
-    negativePart->m_voxels.Allocate(nVoxels);
+    positivePart->m_bricks.Resize(0);
+    negativePart->m_bricks.Resize(0);
+    positivePart->m_bricks.Allocate(nBricks);
+    negativePart->m_bricks.Allocate(nBricks);
     negativePart->m_scale = positivePart->m_scale = m_scale;
     negativePart->m_unitVolume = positivePart->m_unitVolume = m_unitVolume;
     negativePart->m_numVoxelsOnSurface = positivePart->m_numVoxelsOnSurface = 0;
     negativePart->m_numVoxelsInsideSurface = positivePart->m_numVoxelsInsideSurface = 0;
 
     double d;
-    Vec3<double> pt;
-    Voxel voxel;
+    double distances[VOXEL_BRICK_SIZE];
+    VoxelBrick positive;
+    VoxelBrick negative;
     const double d0 = m_scale;
-    for (size_t v = 0; v < nVoxels; ++v) {
-        voxel = m_voxels[v];
-        pt = GetPoint(voxel);
-        d = plane.m_a * pt[0] + plane.m_b * pt[1] + plane.m_c * pt[2] + plane.m_d;
-        if (d >= 0.0) {
-            if (voxel.m_data == PRIMITIVE_ON_SURFACE || d <= d0) {
-                voxel.m_data = PRIMITIVE_ON_SURFACE;
-                positivePart->m_voxels.PushBack(voxel);
-                ++positivePart->m_numVoxelsOnSurface;
+    for (size_t p = 0; p < nBricks; ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        ComputeBrickDistances(brick, plane, m_scale, m_minBB, distances);
+        positive = negative = brick;
+        positive.m_onSurface = positive.m_inside = 0;
+        negative.m_onSurface = negative.m_inside = 0;
+        for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+            const int32_t b = std::countr_zero(bits);
+            const uint32_t bit = (uint32_t)1 << b;
+            const bool onSurface = (brick.m_onSurface & bit) != 0;
+            d = distances[b];
+            if (d >= 0.0) {
+                if (onSurface || d <= d0) {
+                    positive.m_onSurface |= bit;
+                }
+                else {
+                    positive.m_inside |= bit;
+                }
             }
             else {
-                positivePart->m_voxels.PushBack(voxel);
-                ++positivePart->m_numVoxelsInsideSurface;
+                if (onSurface || -d <= d0) {
+                    negative.m_onSurface |= bit;
+                }
+                else {
+                    negative.m_inside |= bit;
+                }
             }
         }
-        else {
-            if (voxel.m_data == PRIMITIVE_ON_SURFACE || -d <= d0) {
-                voxel.m_data = PRIMITIVE_ON_SURFACE;
-                negativePart->m_voxels.PushBack(voxel);
-                ++negativePart->m_numVoxelsOnSurface;
-            }
-            else {
-                negativePart->m_voxels.PushBack(voxel);
-                ++negativePart->m_numVoxelsInsideSurface;
-            }
+        if (positive.GetVoxels() != 0) {
+            positivePart->m_bricks.PushBack(positive);
+            positivePart->m_numVoxelsOnSurface += std::popcount(positive.m_onSurface);
+            positivePart->m_numVoxelsInsideSurface += std::popcount(positive.m_inside);
+        }
+        if (negative.GetVoxels() != 0) {
+            negativePart->m_bricks.PushBack(negative);
+            negativePart->m_numVoxelsOnSurface += std::popcount(negative.m_onSurface);
+            negativePart->m_numVoxelsInsideSurface += std::popcount(negative.m_inside);
         }
     }
 }
 void VoxelSet::Convert(Mesh& mesh, const VOXEL_VALUE value) const
 {
-    const size_t nVoxels = m_voxels.Size();
-    if (nVoxels == 0)
+    const size_t nBricks = m_bricks.Size();
+    if (nBricks == 0)
         return;
     Voxel voxel;
     Vec3<double> pts[8];
-    for (size_t v = 0; v < nVoxels; ++v) {
-        voxel = m_voxels[v];
-        if (voxel.m_data == value) {
+    for (size_t p = 0; p < nBricks; ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+            GetBrickVoxel(brick, std::countr_zero(bits), voxel);
+            if (voxel.m_data != value) {
+                continue;
+            }
             GetPoints(voxel, pts);
             int32_t s = (int32_t)mesh.GetNPoints();
             for (int32_t k = 0; k < 8; ++k) {
@@ -718,17 +1051,34 @@ void VoxelSet::Convert(Mesh& mesh, const VOXEL_VALUE value) const
         }
     }
 }
+void VoxelSet::ExpandVoxels(SArray<Voxel>& voxels) const
+{
+    voxels.Resize(0);
+    voxels.Allocate(GetNPrimitives());
+    Voxel voxel;
+    for (size_t p = 0; p < m_bricks.Size(); ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+            GetBrickVoxel(brick, std::countr_zero(bits), voxel);
+            voxels.PushBack(voxel);
+        }
+    }
+}
 void VoxelSet::ComputePrincipalAxes()
 {
-    const size_t nVoxels = m_voxels.Size();
+    const size_t nVoxels = GetNPrimitives();
     if (nVoxels == 0)
         return;
+    Voxel voxel;
     m_barycenterPCA[0] = m_barycenterPCA[1] = m_barycenterPCA[2] = 0.0;
-    for (size_t v = 0; v < nVoxels; ++v) {
-        Voxel& voxel = m_voxels[v];
-        m_barycenterPCA[0] += voxel.m_coord[0];
-        m_barycenterPCA[1] += voxel.m_coord[1];
-        m_barycenterPCA[2] += voxel.m_coord[2];
+    for (size_t p = 0; p < m_bricks.Size(); ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+            GetBrickVoxel(brick, std::countr_zero(bits), voxel);
+            m_barycenterPCA[0] += voxel.m_coord[0];
+            m_barycenterPCA[1] += voxel.m_coord[1];
+            m_barycenterPCA[2] += voxel.m_coord[2];
+        }
     }
     m_barycenterPCA /= (double)nVoxels;
 
@@ -736,17 +1086,20 @@ void VoxelSet::ComputePrincipalAxes()
         { 0.0, 0.0, 0.0 },
         { 0.0, 0.0, 0.0 } };
     double x, y, z;
-    for (size_t v = 0; v < nVoxels; ++v) {
-        Voxel& voxel = m_voxels[v];
-        x = voxel.m_coord[0] - m_barycenter[0];
-        y = voxel.m_coord[1] - m_barycenter[1];
-        z = voxel.m_coord[2] - m_barycenter[2];
-        covMat[0][0] += x * x;
-        covMat[1][1] += y * y;
-        covMat[2][2] += z * z;
-        covMat[0][1] += x * y;
-        covMat[0][2] += x * z;
-        covMat[1][2] += y * z;
+    for (size_t p = 0; p < m_bricks.Size(); ++p) {
+        const VoxelBrick& brick = m_bricks[p];
+        for (uint32_t bits = brick.GetVoxels(); bits != 0; bits &= bits - 1) {
+            GetBrickVoxel(brick, std::countr_zero(bits), voxel);
+            x = voxel.m_coord[0] - m_barycenter[0];
+            y = voxel.m_coord[1] - m_barycenter[1];
+            z = voxel.m_coord[2] - m_barycenter[2];
+            covMat[0][0] += x * x;
+            covMat[1][1] += y * y;
+            covMat[2][2] += z * z;
+            covMat[0][1] += x * y;
+            covMat[0][2] += x * z;
+            covMat[1][2] += y * z;
+        }
     }
     covMat[0][0] /= nVoxels;
     covMat[1][1] /= nVoxels;
@@ -768,6 +1121,7 @@ Volume::Volume()
     m_numVoxelsInsideSurface = 0;
     m_numVoxelsOutsideSurface = 0;
     m_scale = 1.0;
+    m_rowSize = 0;
     m_data = 0;
 }
 Volume::~Volume(void)
@@ -777,81 +1131,265 @@ Volume::~Volume(void)
 void Volume::Allocate()
 {
     delete[] m_data;
-    size_t size = m_dim[0] * m_dim[1] * m_dim[2];
-    m_data = new unsigned char[size];
-    memset(m_data, PRIMITIVE_UNDEFINED, sizeof(unsigned char) * size);
+    m_rowSize = (m_dim[0] + 31) / 32;
+    const size_t nRows = m_dim[1] * m_dim[2];
+    const size_t size = nRows * m_rowSize;
+    m_data = new uint64_t[size];
+    memset(m_data, PRIMITIVE_UNDEFINED, sizeof(uint64_t) * size);
+    // the unused end of every row is outside, none of the fills ever changes it
+    const size_t nUsed = m_dim[0] & 31;
+    if (nUsed != 0) {
+        const uint64_t unused = VOXEL_LOW_BITS & ~(((uint64_t)1 << (2 * nUsed)) - 1);
+        for (size_t r = 0; r < nRows; ++r) {
+            m_data[(r + 1) * m_rowSize - 1] = unused;
+        }
+    }
 }
 void Volume::Free()
 {
     delete[] m_data;
     m_data = 0;
 }
-void Volume::FillOutsideSurface(const size_t i0,
-    const size_t j0,
-    const size_t k0,
-    const size_t i1,
-    const size_t j1,
-    const size_t k1)
-{
-    const short neighbours[6][3] = { { 1, 0, 0 },
-        { 0, 1, 0 },
-        { 0, 0, 1 },
-        { -1, 0, 0 },
-        { 0, -1, 0 },
-        { 0, 0, -1 } };
-    std::queue<Vec3<short> > fifo;
-    Vec3<short> current;
-    short a, b, c;
-    for (size_t i = i0; i < i1; ++i) {
+// One pass over the grid split into slabs along one axis, a task per slab. The slabs outnumber the
+// workers a few times over to even out the load.
+struct Volume::SlabPass {
+    SlabPass(Volume* const volume, const size_t dim, IVHACD::ITaskScheduler* const scheduler)
+        : m_volume(volume)
+        , m_scheduler(scheduler)
+        , m_dim(dim)
+        , m_triangles(0)
+        , m_run(0)
+    {
+        m_nWorkers = scheduler ? std::max(scheduler->GetNumWorkers(), 1u) : 1;
+        m_nSlabs = (m_nWorkers > 1) ? (uint32_t)std::max(std::min(dim, (size_t)m_nWorkers * 4), (size_t)1) : 1;
+    }
+    size_t GetBegin(const size_t slab) const { return m_dim * slab / m_nSlabs; }
+    size_t GetSlab(const size_t v) const { return ((v + 1) * m_nSlabs - 1) / m_dim; }
+
+    Volume* m_volume;
+    IVHACD::ITaskScheduler* m_scheduler;
+    size_t m_dim;
+    uint32_t m_nWorkers;
+    uint32_t m_nSlabs;
+    const VoxelizedTriangle* m_triangles;
+    std::vector<size_t> m_binStart;
+    std::vector<uint32_t> m_bins;
+    size_t (Volume::*m_run)(const SlabPass& pass, const size_t slab, const size_t begin, const size_t end);
+    std::vector<size_t> m_results;
+};
+
+void Volume::SlabTask(void* userData, uint32_t taskIndex, uint32_t)
+{
+    SlabPass& pass = *(SlabPass*)userData;
+    pass.m_results[taskIndex] = (pass.m_volume->*pass.m_run)(pass, taskIndex, pass.GetBegin(taskIndex), pass.GetBegin(taskIndex + 1));
+}
+
+size_t Volume::RunSlabs(SlabPass& pass)
+{
+    pass.m_results.assign(pass.m_nSlabs, 0);
+    if (pass.m_nWorkers > 1 && pass.m_nSlabs > 1) {
+        pass.m_scheduler->ParallelFor(pass.m_nSlabs, pass.m_nWorkers, &Volume::SlabTask, &pass);
+    }
+    else {
+        for (uint32_t slab = 0; slab < pass.m_nSlabs; ++slab) {
+            SlabTask(&pass, slab, 0);
+        }
+    }
+    size_t sum = 0;
+    for (uint32_t slab = 0; slab < pass.m_nSlabs; ++slab) {
+        sum += pass.m_results[slab];
+    }
+    return sum;
+}
+
+size_t Volume::RasterizeSlab(const SlabPass& pass, const size_t slab, const size_t k0, const size_t k1)
+{
+    const size_t stride = m_dim[1] * m_rowSize;
+    size_t nOnSurface = 0;
+    for (size_t b = pass.m_binStart[slab]; b < pass.m_binStart[slab + 1]; ++b) {
+        const VoxelizedTriangle& triangle = pass.m_triangles[pass.m_bins[b]];
+        const size_t kb = std::max(triangle.m_min[2], k0);
+        const size_t ke = std::min(triangle.m_max[2], k1);
+        for (size_t i = triangle.m_min[0]; i < triangle.m_max[0]; ++i) {
+            for (size_t j = triangle.m_min[1]; j < triangle.m_max[1]; ++j) {
+                nOnSurface += RasterizeColumn(triangle, i, j, kb, ke, GetRow(j, 0) + (i >> 5), stride);
+            }
+        }
+    }
+    return nOnSurface;
+}
+
+void Volume::Rasterize(const std::vector<VoxelizedTriangle>& triangles, IVHACD::ITaskScheduler* const scheduler)
+{
+    // Triangles are binned by the slabs of k they span and every slab only writes its own voxels,
+    // so the tasks never share a voxel and the result does not depend on the number of workers.
+    SlabPass pass(this, m_dim[2], scheduler);
+    pass.m_triangles = triangles.data();
+    pass.m_binStart.assign(pass.m_nSlabs + 1, 0);
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        for (size_t slab = pass.GetSlab(triangles[t].m_min[2]); slab <= pass.GetSlab(triangles[t].m_max[2] - 1); ++slab) {
+            ++pass.m_binStart[slab + 1];
+        }
+    }
+    for (uint32_t slab = 0; slab < pass.m_nSlabs; ++slab) {
+        pass.m_binStart[slab + 1] += pass.m_binStart[slab];
+    }
+    pass.m_bins.resize(pass.m_binStart[pass.m_nSlabs]);
+    std::vector<size_t> cursor(pass.m_binStart.begin(), pass.m_binStart.end() - 1);
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        for (size_t slab = pass.GetSlab(triangles[t].m_min[2]); slab <= pass.GetSlab(triangles[t].m_max[2] - 1); ++slab) {
+            pass.m_bins[cursor[slab]++] = (uint32_t)t;
+        }
+    }
+    pass.m_run = &Volume::RasterizeSlab;
+    m_numVoxelsOnSurface = RunSlabs(pass);
+}
+
+// Marks the undefined voxels of line whose neighbours in the parallel line from are outside,
+// 32 voxels per word; returns how many were marked.
+inline size_t FillOutsideFrom(uint64_t* const line, const uint64_t* const from, const size_t nWords)
+{
+    size_t nFilled = 0;
+    for (size_t w = 0; w < nWords; ++w) {
+        // undefined voxels are 00 and outside ones 01, the result has the low bit of the voxels to mark
+        const uint64_t fill = ~(line[w] | (line[w] >> 1)) & from[w] & ~(from[w] >> 1) & VOXEL_LOW_BITS;
+        line[w] |= fill;
+        nFilled += std::popcount(fill);
+    }
+    return nFilled;
+}
+
+// Low bits of the undefined voxels of the word reached by outside voxels below them, through runs of
+// undefined voxels; carry is 1 when the voxel below the word is outside. A seed at the bottom of a
+// run carries through the whole run when added to it.
+inline uint64_t SpreadOutside(const uint64_t word, const uint64_t carry)
+{
+    const uint64_t undefined = ~(word | (word >> 1)) & VOXEL_LOW_BITS;
+    const uint64_t runs = undefined | (undefined << 1);
+    const uint64_t outside = word & ~(word >> 1) & VOXEL_LOW_BITS;
+    const uint64_t seeds = ((outside << 2) | carry) & runs;
+    return runs & ~(runs + seeds) & VOXEL_LOW_BITS;
+}
+
+// Reverses the order of the 32 voxels of a word.
+inline uint64_t ReverseVoxels(uint64_t word)
+{
+    word = (word >> 32) | (word << 32);
+    word = ((word >> 16) & 0x0000FFFF0000FFFFull) | ((word & 0x0000FFFF0000FFFFull) << 16);
+    word = ((word >> 8) & 0x00FF00FF00FF00FFull) | ((word & 0x00FF00FF00FF00FFull) << 8);
+    word = ((word >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((word & 0x0F0F0F0F0F0F0F0Full) << 4);
+    return ((word >> 2) & 0x3333333333333333ull) | ((word & 0x3333333333333333ull) << 2);
+}
+
+size_t Volume::SweepXSlab(const SlabPass&, const size_t, const size_t k0, const size_t k1)
+{
+    // Whole words at a time, backwards through reversed words. The voxels at both ends of a row are
+    // defined once the faces are seeded, so the outside end of a row never spreads into it.
+    size_t nFilled = 0;
+    for (size_t k = k0; k < k1; ++k) {
+        for (size_t j = 0; j < m_dim[1]; ++j) {
+            uint64_t* const row = GetRow(j, k);
+            uint64_t carry = 0;
+            for (size_t w = 0; w < m_rowSize; ++w) {
+                const uint64_t fill = SpreadOutside(row[w], carry);
+                row[w] |= fill;
+                nFilled += std::popcount(fill);
+                carry = ((row[w] >> 62) == PRIMITIVE_OUTSIDE_SURFACE);
+            }
+            carry = 0;
+            for (size_t w = m_rowSize; w-- > 0;) {
+                uint64_t reversed = ReverseVoxels(row[w]);
+                const uint64_t fill = SpreadOutside(reversed, carry);
+                reversed |= fill;
+                nFilled += std::popcount(fill);
+                carry = ((reversed >> 62) == PRIMITIVE_OUTSIDE_SURFACE);
+                row[w] = ReverseVoxels(reversed);
+            }
+        }
+    }
+    return nFilled;
+}
+
+size_t Volume::SweepYSlab(const SlabPass&, const size_t, const size_t k0, const size_t k1)
+{
+    size_t nFilled = 0;
+    for (size_t k = k0; k < k1; ++k) {
+        for (size_t j = 1; j < m_dim[1]; ++j) {
+            nFilled += FillOutsideFrom(GetRow(j, k), GetRow(j - 1, k), m_rowSize);
+        }
+        for (size_t j = m_dim[1] - 1; j > 0; --j) {
+            nFilled += FillOutsideFrom(GetRow(j - 1, k), GetRow(j, k), m_rowSize);
+        }
+    }
+    return nFilled;
+}
+
+size_t Volume::SweepZSlab(const SlabPass&, const size_t, const size_t j0, const size_t j1)
+{
+    size_t nFilled = 0;
+    for (size_t k = 1; k < m_dim[2]; ++k) {
+        for (size_t j = j0; j < j1; ++j) {
+            nFilled += FillOutsideFrom(GetRow(j, k), GetRow(j, k - 1), m_rowSize);
+        }
+    }
+    for (size_t k = m_dim[2] - 1; k > 0; --k) {
         for (size_t j = j0; j < j1; ++j) {
-            for (size_t k = k0; k < k1; ++k) {
+            nFilled += FillOutsideFrom(GetRow(j, k - 1), GetRow(j, k), m_rowSize);
+        }
+    }
+    return nFilled;
+}
 
+void Volume::FillOutsideSurface(IVHACD::ITaskScheduler* const scheduler)
+{
+    // The undefined voxels of the six faces are outside, the fill then sweeps grid lines along the
+    // three axes until a round marks nothing: the same voxels a flood fill from the faces reaches,
+    // but every sweep runs over whole rows in parallel slabs.
+    m_numVoxelsOutsideSurface = 0;
+    for (size_t k = 0; k < m_dim[2]; ++k) {
+        for (size_t j = 0; j < m_dim[1]; ++j) {
+            const bool face = (k == 0 || k == m_dim[2] - 1 || j == 0 || j == m_dim[1] - 1);
+            const size_t step = face ? 1 : std::max(m_dim[0] - 1, (size_t)1);
+            for (size_t i = 0; i < m_dim[0]; i += step) {
                 if (GetVoxel(i, j, k) == PRIMITIVE_UNDEFINED) {
-                    current[0] = (short)i;
-                    current[1] = (short)j;
-                    current[2] = (short)k;
-                    fifo.push(current);
-                    GetVoxel(current[0], current[1], current[2]) = PRIMITIVE_OUTSIDE_SURFACE;
+                    SetVoxel(i, j, k, PRIMITIVE_OUTSIDE_SURFACE);
                     ++m_numVoxelsOutsideSurface;
-                    while (fifo.size() > 0) {
-                        current = fifo.front();
-                        fifo.pop();
-                        for (int32_t h = 0; h < 6; ++h) {
-                            a = current[0] + neighbours[h][0];
-                            b = current[1] + neighbours[h][1];
-                            c = current[2] + neighbours[h][2];
-                            if (a < 0 || a >= (int32_t)m_dim[0] || b < 0 || b >= (int32_t)m_dim[1] || c < 0 || c >= (int32_t)m_dim[2]) {
-                                continue;
-                            }
-                            unsigned char& v = GetVoxel(a, b, c);
-                            if (v == PRIMITIVE_UNDEFINED) {
-                                v = PRIMITIVE_OUTSIDE_SURFACE;
-                                ++m_numVoxelsOutsideSurface;
-                                fifo.push(Vec3<short>(a, b, c));
-                            }
-                        }
-                    }
                 }
             }
         }
     }
+    SlabPass sweepX(this, m_dim[2], scheduler);
+    SlabPass sweepY(this, m_dim[2], scheduler);
+    SlabPass sweepZ(this, m_dim[1], scheduler);
+    sweepX.m_run = &Volume::SweepXSlab;
+    sweepY.m_run = &Volume::SweepYSlab;
+    sweepZ.m_run = &Volume::SweepZSlab;
+    size_t nFilled;
+    do {
+        nFilled = RunSlabs(sweepX);
+        nFilled += RunSlabs(sweepY);
+        nFilled += RunSlabs(sweepZ);
+        m_numVoxelsOutsideSurface += nFilled;
+    } while (nFilled > 0);
 }
-void Volume::FillInsideSurface()
+size_t Volume::FillInsideSlab(const SlabPass&, const size_t, const size_t k0, const size_t k1)
 {
-    const size_t i0 = m_dim[0];
-    const size_t j0 = m_dim[1];
-    const size_t k0 = m_dim[2];
-    for (size_t i = 0; i < i0; ++i) {
-        for (size_t j = 0; j < j0; ++j) {
-            for (size_t k = 0; k < k0; ++k) {
-                unsigned char& v = GetVoxel(i, j, k);
-                if (v == PRIMITIVE_UNDEFINED) {
-                    v = PRIMITIVE_INSIDE_SURFACE;
-                    ++m_numVoxelsInsideSurface;
-                }
-            }
-        }
+    uint64_t* const begin = GetRow(0, k0);
+    const size_t nWords = (k1 - k0) * m_dim[1] * m_rowSize;
+    size_t nInside = 0;
+    for (size_t w = 0; w < nWords; ++w) {
+        // PRIMITIVE_UNDEFINED is 00, setting the high bit makes it PRIMITIVE_INSIDE_SURFACE
+        const uint64_t undefined = ~(begin[w] | (begin[w] >> 1)) & VOXEL_LOW_BITS;
+        begin[w] |= undefined << 1;
+        nInside += std::popcount(undefined);
     }
+    return nInside;
+}
+void Volume::FillInsideSurface(IVHACD::ITaskScheduler* const scheduler)
+{
+    SlabPass pass(this, m_dim[2], scheduler);
+    pass.m_run = &Volume::FillInsideSlab;
+    m_numVoxelsInsideSurface = RunSlabs(pass);
 }
 void Volume::Convert(Mesh& mesh, const VOXEL_VALUE value) const
 {
@@ -861,7 +1399,7 @@ void Volume::Convert(Mesh& mesh, const VOXEL_VALUE value) const
     for (size_t i = 0; i < i0; ++i) {
         for (size_t j = 0; j < j0; ++j) {
             for (size_t k = 0; k < k0; ++k) {
-                const unsigned char& voxel = GetVoxel(i, j, k);
+                const unsigned char voxel = GetVoxel(i, j, k);
                 if (voxel == value) {
                     Vec3<double> p0((i - 0.5) * m_scale, (j - 0.5) * m_scale, (k - 0.5) * m_scale);
                     Vec3<double> p1((i + 0.5) * m_scale, (j - 0.5) * m_scale, (k - 0.5) * m_scale);
@@ -902,34 +1440,36 @@ void Volume::Convert(VoxelSet& vset) const
     for (int32_t h = 0; h < 3; ++h) {
         vset.m_minBB[h] = m_minBB[h];
     }
-    vset.m_voxels.Allocate(m_numVoxelsInsideSurface + m_numVoxelsOnSurface);
     vset.m_scale = m_scale;
     vset.m_unitVolume = m_scale * m_scale * m_scale;
     const short i0 = (short)m_dim[0];
     const short j0 = (short)m_dim[1];
     const short k0 = (short)m_dim[2];
-    Voxel voxel;
+    VoxelBrick brick;
     vset.m_numVoxelsOnSurface = 0;
     vset.m_numVoxelsInsideSurface = 0;
     for (short i = 0; i < i0; ++i) {
         for (short j = 0; j < j0; ++j) {
-            for (short k = 0; k < k0; ++k) {
-                const unsigned char& value = GetVoxel(i, j, k);
-                if (value == PRIMITIVE_INSIDE_SURFACE) {
-                    voxel.m_coord[0] = i;
-                    voxel.m_coord[1] = j;
-                    voxel.m_coord[2] = k;
-                    voxel.m_data = PRIMITIVE_INSIDE_SURFACE;
-                    vset.m_voxels.PushBack(voxel);
-                    ++vset.m_numVoxelsInsideSurface;
+            for (short kb = 0; kb < k0; kb += VOXEL_BRICK_SIZE) {
+                brick.m_coord[0] = i;
+                brick.m_coord[1] = j;
+                brick.m_coord[2] = kb;
+                brick.m_onSurface = 0;
+                brick.m_inside = 0;
+                const short k1 = std::min((short)(kb + VOXEL_BRICK_SIZE), k0);
+                for (short k = kb; k < k1; ++k) {
+                    const unsigned char value = GetVoxel(i, j, k);
+                    if (value == PRIMITIVE_INSIDE_SURFACE) {
+                        brick.m_inside |= (uint32_t)1 << (k - kb);
+                        ++vset.m_numVoxelsInsideSurface;
+                    }
+                    else if (value == PRIMITIVE_ON_SURFACE) {
+                        brick.m_onSurface |= (uint32_t)1 << (k - kb);
+                        ++vset.m_numVoxelsOnSurface;
+                    }
                 }
-                else if (value == PRIMITIVE_ON_SURFACE) {
-                    voxel.m_coord[0] = i;
-                    voxel.m_coord[1] = j;
-                    voxel.m_coord[2] = k;
-                    voxel.m_data = PRIMITIVE_ON_SURFACE;
-                    vset.m_voxels.PushBack(voxel);
-                    ++vset.m_numVoxelsOnSurface;
+                if (brick.GetVoxels() != 0) {
+                    vset.m_bricks.PushBack(brick);
                 }
             }
         }
@@ -949,7 +1489,7 @@ void Volume::Convert(TetrahedronSet& tset) const
     for (short i = 0; i < i0; ++i) {
         for (short j = 0; j < j0; ++j) {
             for (short k = 0; k < k0; ++k) {
-                const unsigned char& value = GetVoxel(i, j, k);
+                const unsigned char value = GetVoxel(i, j, k);
                 if (value == PRIMITIVE_INSIDE_SURFACE || value == PRIMITIVE_ON_SURFACE) {
                     tetrahedron.m_data = value;
                     Vec3<double> p1((i - 0.5) * m_scale + m_minBB[0], (j - 0.5) * m_scale + m_minBB[1], (k - 0.5) * m_scale + m_minBB[2]);
@@ -1012,7 +1552,7 @@ void Volume::AlignToPrincipalAxes(double (&rot)[3][3]) const
     for (short i = 0; i < i0; ++i) {
         for (short j = 0; j < j0; ++j) {
             for (short k = 0; k < k0; ++k) {
-                const unsigned char& value = GetVoxel(i, j, k);
+                const unsigned char value = GetVoxel(i, j, k);
                 if (value == PRIMITIVE_INSIDE_SURFACE || value == PRIMITIVE_ON_SURFACE) {
                     barycenter[0] += i;
                     barycenter[1] += j;
@@ -1031,7 +1571,7 @@ void Volume::AlignToPrincipalAxes(double (&rot)[3][3]) const
     for (short i = 0; i < i0; ++i) {
         for (short j = 0; j < j0; ++j) {
             for (short k = 0; k < k0; ++k) {
-                const unsigned char& value = GetVoxel(i, j, k);
+                const unsigned char value = GetVoxel(i, j, k);
                 if (value == PRIMITIVE_INSIDE_SURFACE || value == PRIMITIVE_ON_SURFACE) {
                     x = i - barycenter[0];
                     y = j - barycenter[1];
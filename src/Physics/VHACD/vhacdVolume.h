@@ -15,9 +15,11 @@
 #pragma once
 #ifndef VHACD_VOLUME_H
 #define VHACD_VOLUME_H
+#include "VHACD.h"
 #include "vhacdMesh.h"
 #include "vhacdVector.h"
 #include <assert.h>
+#include <vector>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -39,6 +41,17 @@ public:
     short m_data;
 };
 
+const short VOXEL_BRICK_SIZE = 32;
+
+//! VOXEL_BRICK_SIZE consecutive voxels along z, the first one at a multiple of it. Bit b of the
+//! masks stands for the voxel at m_coord[2] + b, two bits of state per voxel.
+struct VoxelBrick {
+    short m_coord[3];
+    uint32_t m_onSurface;
+    uint32_t m_inside;
+    uint32_t GetVoxels() const { return m_onSurface | m_inside; }
+};
+
 class PrimitiveSet {
 public:
     virtual ~PrimitiveSet(){};
@@ -70,7 +83,7 @@ private:
     Mesh m_convexHull;
 };
 
-//!
+//! Voxels are kept in bricks, sorted by x, y then z, and bricks without voxels are not stored.
 class VoxelSet : public PrimitiveSet {
     friend class Volume;
 
@@ -80,11 +93,11 @@ public:
     //! Constructor.
     VoxelSet();
 
-    const size_t GetNPrimitives() const { return m_voxels.Size(); }
+    const size_t GetNPrimitives() const { return m_numVoxelsOnSurface + m_numVoxelsInsideSurface; }
     const size_t GetNPrimitivesOnSurf() const { return m_numVoxelsOnSurface; }
     const size_t GetNPrimitivesInsideSurf() const { return m_numVoxelsInsideSurface; }
     const double GetEigenValue(AXIS axis) const { return m_D[axis][axis]; }
-    const double ComputeVolume() const { return m_unitVolume * m_voxels.Size(); }
+    const double ComputeVolume() const { return m_unitVolume * GetNPrimitives(); }
     const double ComputeMaxVolumeError() const { return m_unitVolume * m_numVoxelsOnSurface; }
     const Vec3<short>& GetMinBBVoxels() const { return m_minBBVoxels; }
     const Vec3<short>& GetMaxBBVoxels() const { return m_maxBBVoxels; }
@@ -127,15 +140,17 @@ public:
     }
     void AlignToPrincipalAxes(){};
     void RevertAlignToPrincipalAxes(){};
-    Voxel* const GetVoxels() { return m_voxels.Data(); }
-    const Voxel* const GetVoxels() const { return m_voxels.Data(); }
+    const VoxelBrick* const GetBricks() const { return m_bricks.Data(); }
+    const size_t GetNBricks() const { return m_bricks.Size(); }
+    //! One entry per voxel, in brick order
+    void ExpandVoxels(SArray<Voxel>& voxels) const;
 
 private:
     size_t m_numVoxelsOnSurface;
     size_t m_numVoxelsInsideSurface;
     Vec3<double> m_minBB;
     double m_scale;
-    SArray<Voxel, 8> m_voxels;
+    SArray<VoxelBrick, 8> m_bricks;
     double m_unitVolume;
     Vec3<double> m_minBBPts;
     Vec3<double> m_maxBBPts;
@@ -207,6 +222,13 @@ private:
     double m_D[3][3];
 };
 
+//! Triangle in voxel coordinates, with the range of voxels it may overlap (upper bounds excluded).
+struct VoxelizedTriangle {
+    Vec3<double> m_pts[3];
+    size_t m_min[3];
+    size_t m_max[3];
+};
+
 //!
 class Volume {
 public:
@@ -216,24 +238,26 @@ public:
     //! Constructor.
     Volume();
 
-    //! Voxelize
+    //! Voxelize, slabs of the grid are rasterized and filled in parallel when a scheduler is given
     template <class T>
     void Voxelize(const T* const points, const uint32_t stridePoints, const uint32_t nPoints,
         const int32_t* const triangles, const uint32_t strideTriangles, const uint32_t nTriangles,
-        const size_t dim, const Vec3<double>& barycenter, const double (&rot)[3][3]);
-    unsigned char& GetVoxel(const size_t i, const size_t j, const size_t k)
+        const size_t dim, const Vec3<double>& barycenter, const double (&rot)[3][3],
+        IVHACD::ITaskScheduler* const scheduler = 0);
+    //! Rows along x are packed 32 voxels to a word, two bits per voxel; the unused end of the last
+    //! word of a row is kept outside.
+    uint64_t* GetRow(const size_t j, const size_t k) { return m_data + (j + k * m_dim[1]) * m_rowSize; }
+    const uint64_t* GetRow(const size_t j, const size_t k) const { return m_data + (j + k * m_dim[1]) * m_rowSize; }
+    unsigned char GetVoxel(const size_t i, const size_t j, const size_t k) const
     {
-        assert(i < m_dim[0] || i >= 0);
-        assert(j < m_dim[0] || j >= 0);
-        assert(k < m_dim[0] || k >= 0);
-        return m_data[i + j * m_dim[0] + k * m_dim[0] * m_dim[1]];
+        assert(i < m_dim[0] && j < m_dim[1] && k < m_dim[2]);
+        return (unsigned char)((GetRow(j, k)[i >> 5] >> ((i & 31) << 1)) & 3);
     }
-    const unsigned char& GetVoxel(const size_t i, const size_t j, const size_t k) const
+    void SetVoxel(const size_t i, const size_t j, const size_t k, const VOXEL_VALUE value)
     {
-        assert(i < m_dim[0] || i >= 0);
-        assert(j < m_dim[0] || j >= 0);
-        assert(k < m_dim[0] || k >= 0);
-        return m_data[i + j * m_dim[0] + k * m_dim[0] * m_dim[1]];
+        assert(i < m_dim[0] && j < m_dim[1] && k < m_dim[2]);
+        uint64_t& word = GetRow(j, k)[i >> 5];
+        word = (word & ~((uint64_t)3 << ((i & 31) << 1))) | ((uint64_t)value << ((i & 31) << 1));
     }
     const size_t GetNPrimitivesOnSurf() const { return m_numVoxelsOnSurface; }
     const size_t GetNPrimitivesInsideSurf() const { return m_numVoxelsInsideSurface; }
@@ -243,9 +267,17 @@ public:
     void AlignToPrincipalAxes(double (&rot)[3][3]) const;
 
 private:
-    void FillOutsideSurface(const size_t i0, const size_t j0, const size_t k0, const size_t i1,
-        const size_t j1, const size_t k1);
-    void FillInsideSurface();
+    struct SlabPass;
+    static void SlabTask(void* userData, uint32_t taskIndex, uint32_t workerIndex);
+    size_t RunSlabs(SlabPass& pass);
+    size_t RasterizeSlab(const SlabPass& pass, const size_t slab, const size_t k0, const size_t k1);
+    size_t SweepXSlab(const SlabPass& pass, const size_t slab, const size_t k0, const size_t k1);
+    size_t SweepYSlab(const SlabPass& pass, const size_t slab, const size_t k0, const size_t k1);
+    size_t SweepZSlab(const SlabPass& pass, const size_t slab, const size_t j0, const size_t j1);
+    size_t FillInsideSlab(const SlabPass& pass, const size_t slab, const size_t k0, const size_t k1);
+    void Rasterize(const std::vector<VoxelizedTriangle>& triangles, IVHACD::ITaskScheduler* const scheduler);
+    void FillOutsideSurface(IVHACD::ITaskScheduler* const scheduler);
+    void FillInsideSurface(IVHACD::ITaskScheduler* const scheduler);
     template <class T>
     void ComputeBB(const T* const points, const uint32_t stridePoints, const uint32_t nPoints,
         const Vec3<double>& barycenter, const double (&rot)[3][3]);
@@ -259,7 +291,8 @@ private:
     size_t m_numVoxelsOnSurface;
     size_t m_numVoxelsInsideSurface;
     size_t m_numVoxelsOutsideSurface;
-    unsigned char* m_data;
+    size_t m_rowSize; //>! words per row
+    uint64_t* m_data;
 };
 int32_t TriBoxOverlap(const Vec3<double>& boxcenter, const Vec3<double>& boxhalfsize, const Vec3<double>& triver0,
     const Vec3<double>& triver1, const Vec3<double>& triver2);
@@ -307,7 +340,8 @@ void Volume::ComputeBB(const T* const points, const uint32_t stridePoints, const
 template <class T>
 void Volume::Voxelize(const T* const points, const uint32_t stridePoints, const uint32_t nPoints,
     const int32_t* const triangles, const uint32_t strideTriangles, const uint32_t nTriangles,
-    const size_t dim, const Vec3<double>& barycenter, const double (&rot)[3][3])
+    const size_t dim, const Vec3<double>& barycenter, const double (&rot)[3][3],
+    IVHACD::ITaskScheduler* const scheduler)
 {
     if (nPoints == 0) {
         return;
@@ -343,14 +377,13 @@ void Volume::Voxelize(const T* const points, const uint32_t stridePoints, const
     m_numVoxelsInsideSurface = 0;
     m_numVoxelsOutsideSurface = 0;
 
-    Vec3<double> p[3];
-    size_t i, j, k;
-    size_t i0, j0, k0;
-    size_t i1, j1, k1;
-    Vec3<double> boxcenter;
+    std::vector<VoxelizedTriangle> gridTriangles(nTriangles);
     Vec3<double> pt;
-    const Vec3<double> boxhalfsize(0.5, 0.5, 0.5);
     for (size_t t = 0, ti = 0; t < nTriangles; ++t, ti += strideTriangles) {
+        VoxelizedTriangle& triangle = gridTriangles[t];
+        Vec3<double>* const p = triangle.m_pts;
+        size_t* const lo = triangle.m_min;
+        size_t* const hi = triangle.m_max;
         Vec3<int32_t> tri(triangles[ti + 0],
             triangles[ti + 1],
             triangles[ti + 2]);
@@ -359,66 +392,30 @@ void Volume::Voxelize(const T* const points, const uint32_t stridePoints, const
             p[c][0] = (pt[0] - m_minBB[0]) * invScale;
             p[c][1] = (pt[1] - m_minBB[1]) * invScale;
             p[c][2] = (pt[2] - m_minBB[2]) * invScale;
-            i = static_cast<size_t>(p[c][0] + 0.5);
-            j = static_cast<size_t>(p[c][1] + 0.5);
-            k = static_cast<size_t>(p[c][2] + 0.5);
-            assert(i < m_dim[0] && i >= 0 && j < m_dim[1] && j >= 0 && k < m_dim[2] && k >= 0);
-
-            if (c == 0) {
-                i0 = i1 = i;
-                j0 = j1 = j;
-                k0 = k1 = k;
-            }
-            else {
-                if (i < i0)
-                    i0 = i;
-                if (j < j0)
-                    j0 = j;
-                if (k < k0)
-                    k0 = k;
-                if (i > i1)
-                    i1 = i;
-                if (j > j1)
-                    j1 = j;
-                if (k > k1)
-                    k1 = k;
-            }
-        }
-        if (i0 > 0)
-            --i0;
-        if (j0 > 0)
-            --j0;
-        if (k0 > 0)
-            --k0;
-        if (i1 < m_dim[0])
-            ++i1;
-        if (j1 < m_dim[1])
-            ++j1;
-        if (k1 < m_dim[2])
-            ++k1;
-        for (size_t i = i0; i < i1; ++i) {
-            boxcenter[0] = (double)i;
-            for (size_t j = j0; j < j1; ++j) {
-                boxcenter[1] = (double)j;
-                for (size_t k = k0; k < k1; ++k) {
-                    boxcenter[2] = (double)k;
-                    int32_t res = TriBoxOverlap(boxcenter, boxhalfsize, p[0], p[1], p[2]);
-                    unsigned char& value = GetVoxel(i, j, k);
-                    if (res == 1 && value == PRIMITIVE_UNDEFINED) {
-                        value = PRIMITIVE_ON_SURFACE;
-                        ++m_numVoxelsOnSurface;
-                    }
+            for (int32_t h = 0; h < 3; ++h) {
+                const size_t v = static_cast<size_t>(p[c][h] + 0.5);
+                assert(v < m_dim[h]);
+                if (c == 0) {
+                    lo[h] = hi[h] = v;
+                }
+                else if (v < lo[h]) {
+                    lo[h] = v;
+                }
+                else if (v > hi[h]) {
+                    hi[h] = v;
                 }
             }
         }
+        for (int32_t h = 0; h < 3; ++h) {
+            if (lo[h] > 0)
+                --lo[h];
+            if (hi[h] < m_dim[h])
+                ++hi[h];
+        }
     }
-    FillOutsideSurface(0, 0, 0, m_dim[0], m_dim[1], 1);
-    FillOutsideSurface(0, 0, m_dim[2] - 1, m_dim[0], m_dim[1], m_dim[2]);
-    FillOutsideSurface(0, 0, 0, m_dim[0], 1, m_dim[2]);
-    FillOutsideSurface(0, m_dim[1] - 1, 0, m_dim[0], m_dim[1], m_dim[2]);
-    FillOutsideSurface(0, 0, 0, 1, m_dim[1], m_dim[2]);
-    FillOutsideSurface(m_dim[0] - 1, 0, 0, m_dim[0], m_dim[1], m_dim[2]);
-    FillInsideSurface();
+    Rasterize(gridTriangles, scheduler);
+    FillOutsideSurface(scheduler);
+    FillInsideSurface(scheduler);
 }
 }
 
@@ -3,7 +3,11 @@
 #include "PxPhysicsAPI.h"
 #include <Math/GraphicUtils/Camara.h>
 #include "TestRigidBodyCreate.h"
+#include "TestPhysicsBenchmark.h"
+#include "TestPhysicsChecks.h"
 #include "RenderObjectAdapter.h"
+#include <string_view>
+#include <unordered_map>
 
 using namespace physx;
 PhysicsEngineTestingApplication *pApp = nullptr;
@@ -17,6 +21,7 @@ public:
 	void Release() override
 	{
 		// 先停止场景和物理引擎
+		m_RenderObjects.clear();
 		m_Scene.reset();
 		m_Material.reset();
 		PhysicsEngineUtils::DestroyPhysicsEngine();
@@ -31,9 +36,13 @@ public:
 	}
 	int Run() override
 	{
+		// 带--check启动时只运行检查，返回失败的检查数
+		if (m_bRunChecks)
+			return int(TestCheck::RunAll(TestRigidBody::TriangleMeshData));
 		while (m_Renderer->Tick())
 		{
 			m_Scene->Tick(1.f / 60.f);
+			_UpdateWorldBoundingBoxes();
 		}
 		return 1;
 	}
@@ -48,16 +57,25 @@ private:
 
 	void _InitPhysics(bool interactive);
 	void _AddPhysicsDebugRenderableObject(const PhysicsPtr<IPhysicsObject> &object);
+	void _UpdateWorldBoundingBoxes();
 	PhysicsPtr<IPhysicsObject> _CreateDynamic(const MathLib::HTransform3 &t, PhysicsPtr<IColliderGeometry> &geometry, const MathLib::HVector3 &velocity = MathLib::HVector3(0, 0, 0));
 
 private:
 	PhysicsPtr<IRenderer> m_Renderer;
 	PhysicsPtr<IPhysicsMaterial> m_Material;
 	PhysicsPtr<IPhysicsScene> m_Scene;
+	// 物理对象到渲染对象的映射，用于下发场景的世界包围盒
+	std::unordered_map<const IPhysicsObject *, std::shared_ptr<RenderObjectAdapter>> m_RenderObjects;
+	bool m_bRunChecks = false;
 };
 
 TestingApplication::TestingApplication(int argc, char **argv)
 {
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string_view(argv[i]) == "--check")
+			m_bRunChecks = true;
+	}
 	m_Renderer = make_physics_ptr(CreateRenderer(argc, argv));
 	m_Renderer->SetApplicationName("Physics Engine Testing Application");
 	m_Renderer->SetUp(
@@ -88,8 +106,7 @@ void TestingApplication::_KeyReleaseEvent(void* eventData)
 	// 处理空格键发射球体
 	if (key == ' ') {
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE;
-		options.m_SphereParams.m_Radius = 2.0f;
+		options.m_Params = SphereGeometryParams{2.0f};
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
 
@@ -107,6 +124,74 @@ void TestingApplication::_KeyReleaseEvent(void* eventData)
 			}
 		}
 	}
+	// 处理X键运行全部检查
+	else if (key == 'X' || key == 'x') {
+		TestCheck::RunAll(TestRigidBody::TriangleMeshData);
+	}
+	// 处理H键运行高度场性能测试
+	else if (key == 'H' || key == 'h') {
+		TestBenchmark::BenchmarkHeightFieldTerrain();
+	}
+	// 处理P键运行基本体代理性能测试
+	else if (key == 'P' || key == 'p') {
+		TestBenchmark::BenchmarkPrimitiveProxies(TestRigidBody::ConvexMeshData);
+	}
+	// 处理L键运行凸包LOD性能测试
+	else if (key == 'L' || key == 'l') {
+		TestBenchmark::BenchmarkConvexLODs(TestRigidBody::TriangleMeshData);
+	}
+	// 处理O键运行对象池性能测试
+	else if (key == 'O' || key == 'o') {
+		TestBenchmark::BenchmarkObjectPool();
+	}
+	// 处理I键运行预制体批量生成性能测试
+	else if (key == 'I' || key == 'i') {
+		TestBenchmark::BenchmarkPrefabWave(TestRigidBody::ConvexDecomposedMeshData);
+	}
+	// 处理M键运行多线程创建压力测试
+	else if (key == 'M' || key == 'm') {
+		TestBenchmark::StressParallelCreation(TestRigidBody::ConvexMeshData);
+	}
+	// 处理T键运行位姿转换性能测试
+	else if (key == 'T' || key == 't') {
+		TestBenchmark::BenchmarkPoseConversion();
+	}
+	// 处理U键运行世界包围盒批量更新性能测试
+	else if (key == 'U' || key == 'u') {
+		TestBenchmark::BenchmarkWorldBounds();
+	}
+	// 处理G键运行求解器预算控制测试
+	else if (key == 'G' || key == 'g') {
+		TestBenchmark::BenchmarkSolverBudget();
+	}
+	// 处理Y键运行异步凸分解测试
+	else if (key == 'Y' || key == 'y') {
+		TestBenchmark::BenchmarkAsyncDecomposition(TestRigidBody::TriangleMeshData);
+	}
+	// 处理K键运行批量凸分解性能测试
+	else if (key == 'K' || key == 'k') {
+		TestBenchmark::BenchmarkBatchDecomposition(TestRigidBody::TriangleMeshData);
+	}
+	// 处理C键运行凸分解磁盘缓存性能测试
+	else if (key == 'C' || key == 'c') {
+		TestBenchmark::BenchmarkDecomposeCache(TestRigidBody::TriangleMeshData);
+	}
+	// 处理V键运行体素平面裁剪SIMD性能测试
+	else if (key == 'V' || key == 'v') {
+		TestBenchmark::BenchmarkVoxelClipping(TestRigidBody::TriangleMeshData);
+	}
+	// 处理R键运行凸包顶点投影性能测试
+	else if (key == 'R' || key == 'r') {
+		TestBenchmark::BenchmarkHullProjection(TestRigidBody::TriangleMeshData);
+	}
+	// 处理N键运行凸包合并性能测试
+	else if (key == 'N' || key == 'n') {
+		TestBenchmark::BenchmarkHullMerging(TestRigidBody::TriangleMeshData);
+	}
+	// 处理J键运行限时凸分解性能测试
+	else if (key == 'J' || key == 'j') {
+		TestBenchmark::BenchmarkTimeBudget(TestRigidBody::TriangleMeshData);
+	}
 }
 
 void TestingApplication::_MousePressEvent(void* eventData)
@@ -155,6 +240,7 @@ void TestingApplication::_InitPhysics(bool interactive)
 {
 	PhysicsEngineOptions options;
 	options.m_NumThreads = 10;
+	options.m_ConvexDecomposeCacheDirectory = "ConvexDecomposeCache";
 	IPhysicsEngine *engine = PhysicsEngineUtils::CreatePhysicsEngine(options);
 
 	PhysicsSceneCreateOptions sceneOptions;
@@ -171,9 +257,7 @@ void TestingApplication::_InitPhysics(bool interactive)
 	m_Material = PhysicsEngineUtils::CreateMaterial(materialOptions);
 
 	CollisionGeometryCreateOptions groundPlaneOptions;
-	groundPlaneOptions.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE;
-	groundPlaneOptions.m_PlaneParams.m_Normal = MathLib::HVector3(0, 1, 0);
-	groundPlaneOptions.m_PlaneParams.m_Distance = 0.0f;
+	groundPlaneOptions.m_Params = PlaneGeometryParams{MathLib::HVector3(0, 1, 0), 0.0f};
 	PhysicsPtr<IColliderGeometry> groundPlane = PhysicsEngineUtils::CreateColliderGeometry(groundPlaneOptions);
 
 	PhysicsObjectCreateOptions groundPlaneObjectOptions;
@@ -202,8 +286,7 @@ void TestingApplication::_InitPhysics(bool interactive)
 	if (!interactive)
 	{
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE;
-		options.m_SphereParams.m_Radius = 10.0f;
+		options.m_Params = SphereGeometryParams{10.0f};
 		options.m_Scale = MathLib::HVector3(1.0f, 1.0f, 1.0f);
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
@@ -217,8 +300,22 @@ void TestingApplication::_InitPhysics(bool interactive)
 
 void TestingApplication::_AddPhysicsDebugRenderableObject(const PhysicsPtr<IPhysicsObject> &physicsObject)
 {
-	std::shared_ptr<RenderObject> renderable = std::make_shared<RenderObjectAdapter>(physicsObject);
+	std::shared_ptr<RenderObjectAdapter> renderable = std::make_shared<RenderObjectAdapter>(physicsObject);
 	m_Renderer->AddRenderObject(renderable);
+	m_RenderObjects[physicsObject.get()] = renderable;
+}
+
+void TestingApplication::_UpdateWorldBoundingBoxes()
+{
+	// 一次遍历场景的包围盒数组，而不是逐个对象计算世界包围盒
+	std::span<IPhysicsObject *const> objects = m_Scene->GetBoundingBoxObjects();
+	std::span<const MathLib::HAABBox3D> worldBoxes = m_Scene->GetWorldBoundingBoxes();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		auto it = m_RenderObjects.find(objects[i]);
+		if (it != m_RenderObjects.end())
+			it->second->SetWorldBoundingBox(worldBoxes[i]);
+	}
 }
 
 PhysicsPtr<IPhysicsObject> TestingApplication::_CreateDynamic(const MathLib::HTransform3 &t, PhysicsPtr<IColliderGeometry> &geometry, const MathLib::HVector3 &velocity)
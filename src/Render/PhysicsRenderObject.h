@@ -10,10 +10,9 @@ namespace MagnumRender
 		explicit PhysicsRenderObject(const PhysicsPtr<IPhysicsObject>& physicsObject)
 			: m_PhysicsObject(physicsObject)
 		{
-			std::vector<PhysicsPtr<IColliderGeometry>> geometries;
-			std::vector<MathLib::HTransform3> transforms;
 			m_bIsDynamic = physicsObject->GetType() == PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
-			physicsObject->GetColliderGeometries(geometries,&transforms);
+			const std::vector<PhysicsPtr<IColliderGeometry>>& geometries = physicsObject->GetColliderGeometries();
+			const std::vector<MathLib::HTransform3>& transforms = physicsObject->GetColliderLocalTransforms();
 			for (size_t i = 0; i < geometries.size(); i++)
 			{
 				const auto& geometry = geometries[i];
@@ -29,39 +28,37 @@ namespace MagnumRender
 				Magnum::Matrix4 scalingMatrix= Magnum::Matrix4::scaling(Magnum::Vector3(1.f));
 				Magnum::Matrix4x4 rotateMatrix;
 				MathLib::GraphicUtils::MeshData32 meshData;
-				switch (options.m_GeometryType)
+				switch (options.GetType())
 				{
 				case CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE:
 				{
-					meshData = MathLib::GraphicUtils::GenerateSphereMeshData<uint32_t>(options.m_SphereParams.m_Radius, 8, 8);
+					meshData = MathLib::GraphicUtils::GenerateSphereMeshData<uint32_t>(std::get<SphereGeometryParams>(options.m_Params).m_Radius, 8, 8);
 					scalingMatrix = Magnum::Matrix4::scaling(ToMagnum(options.m_Scale));
 					break;
 				}
 				case CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX:
 				{
-					meshData = MathLib::GraphicUtils::GenerateBoxMeshData<uint32_t>(options.m_BoxParams.m_HalfExtents);
+					meshData = MathLib::GraphicUtils::GenerateBoxMeshData<uint32_t>(std::get<BoxGeometryParams>(options.m_Params).m_HalfExtents);
 					scalingMatrix = Magnum::Matrix4::scaling(ToMagnum(options.m_Scale));
 					break;
 				}
 				case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE:
 				{
-					meshData = MathLib::GraphicUtils::GenerateCapsuleMeshData<uint32_t>(options.m_CapsuleParams.m_Radius, options.m_CapsuleParams.m_HalfHeight, 8, 8);
+					meshData = MathLib::GraphicUtils::GenerateCapsuleMeshData<uint32_t>(std::get<CapsuleGeometryParams>(options.m_Params).m_Radius, std::get<CapsuleGeometryParams>(options.m_Params).m_HalfHeight, 8, 8);
 					scalingMatrix = Magnum::Matrix4::scaling(ToMagnum(options.m_Scale));
 					break;
 				}
 				case CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE:
-					meshData = MathLib::GraphicUtils::GeneratePlaneMeshData<uint32_t>(options.m_PlaneParams.m_Normal, options.m_PlaneParams.m_Distance);
+					meshData = MathLib::GraphicUtils::GeneratePlaneMeshData<uint32_t>(std::get<PlaneGeometryParams>(options.m_Params).m_Normal, std::get<PlaneGeometryParams>(options.m_Params).m_Distance);
 					rotateMatrix=Magnum::Matrix4::rotationX(90.0_degf);
 					scalingMatrix = Magnum::Matrix4::scaling(ToMagnum(options.m_Scale));
 					break;
 				case CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH:
-					meshData.m_Vertices= options.m_TriangleMeshParams.m_Vertices;
-					meshData.m_Indices = options.m_TriangleMeshParams.m_Indices;
+					meshData = *std::get<TriangleMeshGeometryParams>(options.m_Params).m_MeshData;
 					scalingMatrix = Magnum::Matrix4::scaling(ToMagnum(options.m_Scale));
 					break;
 				case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH:
-					meshData.m_Vertices = options.m_ConvexMeshParams.m_Vertices;
-					meshData.m_Indices = options.m_ConvexMeshParams.m_Indices;
+					meshData = *std::get<ConvexMeshGeometryParams>(options.m_Params).m_MeshData;
 					scalingMatrix = Magnum::Matrix4::scaling(ToMagnum(options.m_Scale));
 					break;
 				default:
@@ -89,6 +86,7 @@ namespace MagnumRender
 				m_BoundingBox = std::make_shared<GizmoRenderUnit>(MathLib::GraphicUtils::GenerateBoxWireFrameMeshData<uint32_t>(MathLib::HVector3(1,1,1)));
 				m_BoundingBox->SetColor(0x999999_rgbf);
 				m_BoundingBox->SetTransformation(&halfSize);
+				m_WorldBoundingBox = physicsObject->GetWorldBoundingBox();
 			}
 		}
 
@@ -103,8 +101,8 @@ namespace MagnumRender
 			m_Object.setTransformation(ToMagnum(transposeMatrix));
 			if(m_bShowBoundingBox&&m_UseWorldBoundingBox)
 			{
-				MathLib::HVector3 halfSize = m_PhysicsObject->GetWorldBoundingBox().sizes() / 2.f;
-				MathLib::HVector3 center = m_PhysicsObject->GetWorldBoundingBox().center();
+				MathLib::HVector3 halfSize = m_WorldBoundingBox.sizes() / 2.f;
+				MathLib::HVector3 center = m_WorldBoundingBox.center();
 				m_BoundingBox->SetTransformation(&halfSize, &center);
 			}
 			IDynamicObject* dynamicObject = dynamic_cast<IDynamicObject*>(m_PhysicsObject.get());
@@ -161,12 +159,9 @@ namespace MagnumRender
 			}
 		}
 
-		MathLib::HAABBox3D GetWorldBoundingBox() const
-		{
-			if(m_PhysicsObject == nullptr)
-				return MathLib::HAABBox3D();
-			return m_PhysicsObject->GetWorldBoundingBox();
-		}
+		// Filled from IPhysicsScene::GetWorldBoundingBoxes() once per frame instead of asking each object.
+		void SetWorldBoundingBox(const MathLib::HAABBox3D& worldBox) { m_WorldBoundingBox = worldBox; }
+		const MathLib::HAABBox3D& GetWorldBoundingBox() const { return m_WorldBoundingBox; }
 
 		void Render(MathLib::GraphicUtils::Camera& camera)
 		{
@@ -216,6 +211,7 @@ namespace MagnumRender
 		bool m_bShowBoundingBox = true;
 		bool m_UseWorldBoundingBox = false;
 		std::shared_ptr<GizmoRenderUnit> m_BoundingBox;
+		MathLib::HAABBox3D m_WorldBoundingBox;
 		std::vector<std::shared_ptr<SimpleRenderUnit>> m_RenderObjects;
 		PhysicsPtr<IPhysicsObject> m_PhysicsObject;
 		Object3D m_Object ;
@@ -11,9 +11,8 @@ RenderObjectAdapter::RenderObjectAdapter(const PhysicsPtr<IPhysicsObject>& physi
     m_isDynamic = physicsObject->GetType() == PhysicsObjectType::PHYSICS_OBJECT_TYPE_RIGID_DYNAMIC;
     
     // 获取碰撞几何体
-    std::vector<PhysicsPtr<IColliderGeometry>> geometries;
-    std::vector<MathLib::HTransform3> transforms;
-    physicsObject->GetColliderGeometries(geometries, &transforms);
+    const std::vector<PhysicsPtr<IColliderGeometry>>& geometries = physicsObject->GetColliderGeometries();
+    const std::vector<MathLib::HTransform3>& transforms = physicsObject->GetColliderLocalTransforms();
     
     // 为每个几何体创建渲染单元
     for (size_t i = 0; i < geometries.size(); i++) {
@@ -27,6 +26,7 @@ RenderObjectAdapter::RenderObjectAdapter(const PhysicsPtr<IPhysicsObject>& physi
     MathLib::GraphicUtils::MeshData32 boxMeshData = MathLib::GraphicUtils::GenerateBoxWireFrameMeshData<uint32_t>(MathLib::HVector3(1, 1, 1));
     m_boundingBox = std::make_shared<GizmoRenderUnit>(boxMeshData);
     m_boundingBox->SetTransformation(&halfSize);
+    m_worldBoundingBox = physicsObject->GetWorldBoundingBox();
     
     // 设置颜色
     float color[4] = { 0.6f, 0.6f, 0.6f, 1.0f };
@@ -39,39 +39,45 @@ void RenderObjectAdapter::CreateRenderGeometry(const PhysicsPtr<IColliderGeometr
     geometry->GetParams(options);
     
     MathLib::GraphicUtils::MeshData32 meshData;
+    // 网格几何体直接引用共享的网格数据，避免拷贝
+    const MathLib::GraphicUtils::MeshData32* sourceMeshData = &meshData;
     MathLib::HVector3 scale = options.m_Scale;
     
     // 根据几何体类型创建网格数据
-    switch (options.m_GeometryType) {
+    switch (options.GetType()) {
         case CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE:
-            meshData = MathLib::GraphicUtils::GenerateSphereMeshData<uint32_t>(options.m_SphereParams.m_Radius, 16, 16);
+            meshData = MathLib::GraphicUtils::GenerateSphereMeshData<uint32_t>(std::get<SphereGeometryParams>(options.m_Params).m_Radius, 16, 16);
             break;
         case CollierGeometryType::COLLIER_GEOMETRY_TYPE_BOX:
-            meshData = MathLib::GraphicUtils::GenerateBoxMeshData<uint32_t>(options.m_BoxParams.m_HalfExtents);
+            meshData = MathLib::GraphicUtils::GenerateBoxMeshData<uint32_t>(std::get<BoxGeometryParams>(options.m_Params).m_HalfExtents);
             break;
         case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CAPSULE:
-            meshData = MathLib::GraphicUtils::GenerateCapsuleMeshData<uint32_t>(options.m_CapsuleParams.m_Radius, options.m_CapsuleParams.m_HalfHeight, 16, 16);
+            meshData = MathLib::GraphicUtils::GenerateCapsuleMeshData<uint32_t>(std::get<CapsuleGeometryParams>(options.m_Params).m_Radius, std::get<CapsuleGeometryParams>(options.m_Params).m_HalfHeight, 16, 16);
             break;
         case CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE:
-            meshData = MathLib::GraphicUtils::GeneratePlaneMeshData<uint32_t>(options.m_PlaneParams.m_Normal, options.m_PlaneParams.m_Distance);
+            meshData = MathLib::GraphicUtils::GeneratePlaneMeshData<uint32_t>(std::get<PlaneGeometryParams>(options.m_Params).m_Normal, std::get<PlaneGeometryParams>(options.m_Params).m_Distance);
             break;
         case CollierGeometryType::COLLIER_GEOMETRY_TYPE_TRIANGLE_MESH:
-            meshData.m_Vertices = options.m_TriangleMeshParams.m_Vertices;
-            meshData.m_Indices = options.m_TriangleMeshParams.m_Indices;
+            sourceMeshData = std::get<TriangleMeshGeometryParams>(options.m_Params).m_MeshData.get();
             break;
         case CollierGeometryType::COLLIER_GEOMETRY_TYPE_CONVEX_MESH:
-            meshData.m_Vertices = options.m_ConvexMeshParams.m_Vertices;
-            meshData.m_Indices = options.m_ConvexMeshParams.m_Indices;
+            sourceMeshData = std::get<ConvexMeshGeometryParams>(options.m_Params).m_MeshData.get();
+            break;
+        case CollierGeometryType::COLLIER_GEOMETRY_TYPE_HEIGHTFIELD:
+            PhysicsEngineUtils::BuildHeightFieldMesh(std::get<HeightFieldGeometryParams>(options.m_Params), meshData);
             break;
         default:
             return;
     }
     
     // 创建渲染单元
-    std::shared_ptr<SimpleRenderUnit> renderUnit = std::make_shared<SimpleRenderUnit>(meshData);
+    if (!sourceMeshData) {
+        return;
+    }
+    std::shared_ptr<SimpleRenderUnit> renderUnit = std::make_shared<SimpleRenderUnit>(*sourceMeshData);
     
     // 设置变换
-    MathLib::HMatrix4 transformMatrix = transform.matrix();
+    MathLib::HMatrix4 transformMatrix = (transform * options.m_LocalTransform).matrix();
     renderUnit->SetTransformation(&transformMatrix);
     
     // 设置颜色
@@ -111,8 +117,8 @@ void RenderObjectAdapter::UpdateTransform()
     
     // 更新包围盒
     if (m_showBoundingBox) {
-        MathLib::HVector3 halfSize = m_physicsObject->GetWorldBoundingBox().sizes() / 2.0f;
-        MathLib::HVector3 center = m_physicsObject->GetWorldBoundingBox().center();
+        MathLib::HVector3 halfSize = m_worldBoundingBox.sizes() / 2.0f;
+        MathLib::HVector3 center = m_worldBoundingBox.center();
         m_boundingBox->SetTransformation(&halfSize, &center);
         m_boundingBox->UpdateTransformation();
     }
@@ -29,6 +29,9 @@ public:
     // 渲染对象
     void Render(MathLib::GraphicUtils::Camera& camera) override;
     
+    // 设置世界包围盒，由场景的包围盒数组统一下发
+    void SetWorldBoundingBox(const MathLib::HAABBox3D& worldBox) { m_worldBoundingBox = worldBox; }
+    
 private:
     // 创建渲染几何体
     void CreateRenderGeometry(const PhysicsPtr<IColliderGeometry>& geometry, const MathLib::HTransform3& transform);
@@ -36,6 +39,7 @@ private:
     PhysicsPtr<IPhysicsObject> m_physicsObject;
     std::vector<std::shared_ptr<SimpleRenderUnit>> m_renderUnits;
     std::shared_ptr<GizmoRenderUnit> m_boundingBox;
+    MathLib::HAABBox3D m_worldBoundingBox;
     bool m_showWireframe = false;
     bool m_showBoundingBox = true;
     bool m_visible = true;
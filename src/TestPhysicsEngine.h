@@ -27,9 +27,7 @@ void initPhysics(bool interactive)
 	gMaterial = PhysicsEngineUtils::CreateMaterial(materialOptions);
 
 	CollisionGeometryCreateOptions groundPlaneOptions;
-	groundPlaneOptions.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_PLANE;
-	groundPlaneOptions.m_PlaneParams.m_Normal = MathLib::HVector3(0, 1, 0);
-	groundPlaneOptions.m_PlaneParams.m_Distance = 0.0f;
+	groundPlaneOptions.m_Params = PlaneGeometryParams{MathLib::HVector3(0, 1, 0), 0.0f};
 	PhysicsPtr<IColliderGeometry> groundPlane = PhysicsEngineUtils::CreateColliderGeometry(groundPlaneOptions);
 
 	PhysicsObjectCreateOptions groundPlaneObjectOptions;
@@ -54,8 +52,7 @@ void initPhysics(bool interactive)
 	if (!interactive)
 	{
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE;
-		options.m_SphereParams.m_Radius = 10.0f;
+		options.m_Params = SphereGeometryParams{10.0f};
 		options.m_Scale = MathLib::HVector3(1.0f, 1.0f, 1.0f);
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
@@ -92,8 +89,7 @@ void keyPress(unsigned char key, const MathLib::HTransform3 &camera)
 		break;
 	case ' ':
 		CollisionGeometryCreateOptions options;
-		options.m_GeometryType = CollierGeometryType::COLLIER_GEOMETRY_TYPE_SPHERE;
-		options.m_SphereParams.m_Radius = 2.0f;
+		options.m_Params = SphereGeometryParams{2.0f};
 
 		PhysicsPtr<IColliderGeometry> geometry = PhysicsEngineUtils::CreateColliderGeometry(options);
 		auto dynamic = TestRigidBody::CreateDynamic(camera, geometry, camera.rotation() * MathLib::HVector3(0, 0, -1) * 100);